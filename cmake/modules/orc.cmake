@@ -2,6 +2,17 @@ file(GLOB_RECURSE orc_source "orc/*.cc" "orc/*.c")
 file(GLOB_RECURSE orc_test_source "orc/*_test.cc")
 
 list(REMOVE_ITEM orc_source ${orc_test_source})
+
+file(GLOB_RECURSE orc_proto_files "orc/proto/*.proto")
+protobuf_generate_cpp_py(
+    ${PROJECT_BINARY_DIR}/proto/
+    orc_proto_srcs
+    orc_proto_hdrs
+    orc_proto_python
+    "${PROJECT_SOURCE_DIR}/orc"
+    "proto"
+    ${orc_proto_files})
+list(APPEND orc_source ${orc_proto_srcs})
 file(GLOB_RECURSE orc_main_source "orc/*_main.cc")
 list(REMOVE_ITEM orc_source ${orc_main_source})
 
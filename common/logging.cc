@@ -53,6 +53,10 @@ void LogMessage::RawLog(const char* format, ...) {
   log_stream_ << buffer;
 }
 
+void LogSuppressed(const char* file, int line, LogLevel level, uint64_t count) {
+  LogMessage(file, line, level).stream() << "suppressed " << count << " messages";
+}
+
 LogMessageFatal::~LogMessageFatal() {
   fprintf(fd, "%s", kLogLevelString[log_level_]);
   fprintf(fd, " %s\n", log_stream_.str().c_str());
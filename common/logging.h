@@ -12,6 +12,9 @@
 #include <stdexcept>
 
 #include <assert.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
 #include <iostream>
 #include <sstream>
 #include <ctime>
@@ -86,8 +89,70 @@ class LogMessageFatal : public LogMessage {
   void operator=(const LogMessageFatal&);
 };
 
+/// Emit "suppressed N messages" for a sampled call site
+extern void LogSuppressed(const char* file, int line, LogLevel level, uint64_t count);
+
+/*!
+ * \brief Per call site state of the sampled logging macros, each
+ * LOG_EVERY_N / LOG_FIRST_N / LOG_EVERY_T expansion owns one instance.
+ */
+class LogSite {
+ public:
+  LogSite() : count_(0), suppressed_(0), next_time_us_(0) { }
+
+  /** @brief Pass the 1st, (n+1)th, (2n+1)th ... occurrence */
+  bool EveryN(uint64_t n, const char* file, int line, LogLevel level) {
+    uint64_t count = count_.fetch_add(1, std::memory_order_relaxed);
+    if (n > 1 && count % n != 0) {
+      suppressed_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    Flush(file, line, level);
+    return true;
+  }
+
+  /** @brief Pass the first n occurrences only */
+  bool FirstN(uint64_t n) {
+    if (count_.load(std::memory_order_relaxed) >= n) return false;
+    return count_.fetch_add(1, std::memory_order_relaxed) < n;
+  }
+
+  /** @brief Pass at most one occurrence every seconds */
+  bool EveryT(double seconds, const char* file, int line, LogLevel level) {
+    int64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    int64_t next = next_time_us_.load(std::memory_order_relaxed);
+    if (now < next || !next_time_us_.compare_exchange_strong(
+            next, now + static_cast<int64_t>(seconds * 1000000),
+            std::memory_order_relaxed)) {
+      suppressed_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    Flush(file, line, level);
+    return true;
+  }
+
+ protected:
+  void Flush(const char* file, int line, LogLevel level) {
+    uint64_t suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+    if (suppressed > 0) LogSuppressed(file, line, level, suppressed);
+  }
+
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> suppressed_;
+  std::atomic<int64_t> next_time_us_;
+
+ private:
+  LogSite(const LogSite&);
+  void operator=(const LogSite&);
+};
+
 }  // namespace common
 
+/// The LogSite of current call site, every expansion gets its own static.
+#define COMMON_LOG_SITE() \
+    ([]() -> common::LogSite& { static common::LogSite site; return site; }())
+
 /// Always-on checking
 #ifndef CHECK
 #define CHECK(x)                                                                                \
@@ -186,6 +251,34 @@ class LogMessageFatal : public LogMessage {
 #define LOG(severity) LOG_##severity.stream()
 #endif
 
+#define COMMON_LOG_LEVEL_DEBUG    common::kLogDebug
+#define COMMON_LOG_LEVEL_INFO     common::kLogInfo
+#define COMMON_LOG_LEVEL_WARNING  common::kLogWarn
+#define COMMON_LOG_LEVEL_ERROR    common::kLogError
+#define COMMON_LOG_LEVEL_FATAL    common::kLogFatal
+
+/// Sampled logging for hot paths, the skipped messages are counted per call
+/// site and reported as one summary line before the next emitted message.
+#ifndef LOG_EVERY_N
+#define LOG_EVERY_N(severity, n)                                                 \
+    if (!COMMON_LOG_SITE().EveryN((n), __FILE__, __LINE__,                       \
+                                  COMMON_LOG_LEVEL_##severity)) {                \
+    } else LOG(severity)
+#endif
+
+#ifndef LOG_FIRST_N
+#define LOG_FIRST_N(severity, n)                                                 \
+    if (!COMMON_LOG_SITE().FirstN(n)) {                                          \
+    } else LOG(severity)
+#endif
+
+#ifndef LOG_EVERY_T
+#define LOG_EVERY_T(severity, seconds)                                           \
+    if (!COMMON_LOG_SITE().EveryT((seconds), __FILE__, __LINE__,                 \
+                                  COMMON_LOG_LEVEL_##severity)) {                \
+    } else LOG(severity)
+#endif
+
 #ifndef RAW_LOG
 #define RAW_LOG(severity, fmt, ...) LOG_##severity.RawLog(fmt, ##__VA_ARGS__)
 #endif
@@ -12,6 +12,11 @@
     #define MONITOR_STATUS_NORMAL_TIMER(module_name, timer_name)
     #define MONITOR_STATUS_NORMAL_TIMER_BY(module_name, timer_name, total_time, total_count)
     #define MONITOR_STATUS_NORMAL_BINARY_BY(module_name, item_name, flag)
+    #define MONITOR_STATUS_SHARDED_COUNTER(module_name, counter_name)
+    #define MONITOR_STATUS_SHARDED_COUNTER_BY(module_name, counter_name, inc_count)
+    #define MONITOR_STATUS_SHARDED_TIMER_BY(module_name, timer_name, total_time, total_count)
+    #define MONITOR_STATUS_HISTOGRAM_BY(module_name, timer_name, total_time, total_count)
+    #define MONITOR_STATUS_HISTOGRAM_TIMER(module_name, timer_name)
 #else
     #include "monitor_status_impl.h"
 #endif
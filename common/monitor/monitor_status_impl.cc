@@ -14,6 +14,7 @@
 
 #include <cstdio>
 #include <cstring>
+#include <vector>
 
 #include "common/common_defines.h"
 #include "common/logging.h"
@@ -23,11 +24,17 @@ namespace common{
 
 using namespace std;
 
-#define RAW_MMAP_LIST_MAGIC 0x11223345
+#define RAW_MMAP_LIST_MAGIC 0x11223347
 #define COUNTER_PREFIX "C#"
 #define TIMER_COUNTER_PREFIX "T#"
 #define BINARY_COUNTER_PREFIX "B#"
-#define MAX_CACHE_SIZE 10
+#define SHARDED_COUNTER_PREFIX "SC#"
+#define SHARDED_TIMER_COUNTER_PREFIX "ST#"
+#define HISTOGRAM_COUNTER_PREFIX "H#"
+#define MONITOR_STATUS_FILE_SIZE (4 * 1024 * 1024)
+// entries a file holds at most, the hash index is sized for it whatever the
+// file size is, 3/4 loaded at most
+#define MONITOR_STATUS_MAX_ENTRIES 16384
 
 union semun {
   int val;
@@ -37,8 +44,64 @@ union semun {
 
 MonitorStatus * MonitorStatus::instance_ = NULL;
 
+double MonitorStatusCyclesPerUs() {
+  static double cycles_per_us = []() {
+#if defined(__x86_64__) || defined(__i386__)
+    struct timespec begin, end;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    uint64_t begin_cycles = MonitorStatusCycles();
+    do {
+      clock_gettime(CLOCK_MONOTONIC, &end);
+    } while ((end.tv_sec - begin.tv_sec) * 1000000000LL + end.tv_nsec - begin.tv_nsec < 10000000LL);
+    uint64_t end_cycles = MonitorStatusCycles();
+    double us = ((end.tv_sec - begin.tv_sec) * 1000000000LL + end.tv_nsec - begin.tv_nsec) / 1000.0;
+    return (end_cycles - begin_cycles) / us;
+#else
+    return 1000.0;
+#endif
+  }();
+  return cycles_per_us;
+}
+
 class MonitorStatusImpl : public MonitorStatus {
+  // key of a monitor unit: prefix module_name # item_name, hashed piecewise
+  // so that lookups never format or allocate
+  struct MonitorKey {
+    MonitorKey(const char *prefix, const char *module_name, const char *item_name)
+        : prefix(prefix), module_name(module_name), item_name(item_name) {
+      hash = 14695981039346656037ULL;  // FNV-1a
+      Hash(prefix);
+      Hash(module_name);
+      Hash("#");
+      Hash(item_name);
+      if (hash == 0) hash = 1;
+    }
+
+    void Hash(const char *str) {
+      for (; *str != '\0'; ++str) {
+        hash ^= static_cast<uint8_t>(*str);
+        hash *= 1099511628211ULL;
+      }
+    }
+
+    // key size including the trailing '\0'
+    uint32_t Size() const {
+      return strlen(prefix) + strlen(module_name) + 1 + strlen(item_name) + 1;
+    }
+
+    const char *prefix;
+    const char *module_name;
+    const char *item_name;
+    uint64_t hash;
+  };
+
   // raw memory-map list is used to store monitor status
+  //
+  // file layout: | ListHeader | hash index | entry | entry | ... |
+  // the hash index is an open-addressing table of index_size uint64_t slots,
+  // each slot is (high 32 bits of key hash << 32 | entry offset), 0 is empty.
+  // entries and slots are published with release stores under the SysV
+  // semaphore, readers probe the index without any lock.
   class RawMMapList{
    public:
     struct ListHeader {
@@ -48,20 +111,30 @@ class MonitorStatusImpl : public MonitorStatus {
       uint32_t size;          // size
       uint32_t flag;          // flag
       pthread_mutex_t mutex;  // deprecated
+      uint32_t index_size;    // hash index slot count, power of 2
+      uint32_t index_offset;  // hash index offset from file begin
+      uint32_t entry_offset;  // first entry offset from file begin
+      uint32_t reserved;
       
       //
       // @param max_file_size maximum size of raw memory map list
+      // @param max_entries entry capacity the hash index is sized for
       //
-      void Init(uint32_t max_file_size) {
+      void Init(uint32_t max_file_size, uint32_t max_entries) {
         if (flag && magic == RAW_MMAP_LIST_MAGIC) {
           return;
         }
         memset(this, '\0', max_file_size);  // clear
         magic    = RAW_MMAP_LIST_MAGIC;
-        flag     = true;
         size     = 0;
         max_size = max_file_size;
         count    = 0;
+        index_size = 1;
+        while (index_size * 3 < max_entries * 4) {
+          index_size <<= 1;
+        }
+        index_offset = AlignN(sizeof(*this), sizeof(uint64_t));
+        entry_offset = index_offset + index_size * sizeof(uint64_t);
         // init mutex, deprecated
         pthread_mutexattr_t attr;
         pthread_mutexattr_init(&attr);
@@ -69,6 +142,7 @@ class MonitorStatusImpl : public MonitorStatus {
         pthread_mutexattr_setrobust_np(&attr, 1);
         pthread_mutex_init(&mutex, &attr);
         pthread_mutexattr_destroy(&attr);
+        __atomic_store_n(&flag, 1, __ATOMIC_RELEASE);
       }
     };
     
@@ -86,21 +160,12 @@ class MonitorStatusImpl : public MonitorStatus {
     // @param max_size
     RawMMapList(const char * file_name, uint32_t max_size) {
       CHECK(file_name != NULL);
-      mode_t mode = umask(0);
-      int fd = open(file_name, O_RDWR | O_CREAT, 0666);
-      umask(mode);
+      int fd = OpenLocked(file_name, max_size);
       if (fd == -1) {
-        fprintf(stderr, "open file error:%s, %s\n", strerror(errno), file_name);
         return;
       }
-      CHECK(fd != -1);
-      flock(fd, LOCK_EX);
       struct stat st;
       fstat(fd, &st);
-      if (st.st_size == 0) {
-        ftruncate(fd, max_size);
-        st.st_size = max_size;
-      }
       base_ = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE , MAP_POPULATE | MAP_SHARED, fd, 0);
       if (base_  == MAP_FAILED) {
         fprintf(stderr, "mmap file error:%s, %s\n", strerror(errno), file_name);
@@ -109,82 +174,182 @@ class MonitorStatusImpl : public MonitorStatus {
       }
       CHECK(base_ != MAP_FAILED);
       list_header_ = reinterpret_cast<ListHeader *>(base_);
-      list_header_->Init(st.st_size);
+      list_header_->Init(st.st_size, MONITOR_STATUS_MAX_ENTRIES);
       flock(fd, LOCK_UN);
       close(fd);
-      entrys_ = static_cast<uint8_t *>(base_) + AlignN(sizeof(*list_header_), sizeof(uint64_t));
+      index_  = reinterpret_cast<uint64_t *>(static_cast<uint8_t *>(base_) + list_header_->index_offset);
+      index_mask_ = list_header_->index_size - 1;
+      entrys_ = static_cast<uint8_t *>(base_) + list_header_->entry_offset;
       end_    = static_cast<uint8_t *>(base_) + st.st_size;
     }
+
+    // open file_name and lock it, a file of another format is replaced by a
+    // new one of max_size rather than cleared, so the processes still mapping
+    // it are not corrupted, they keep writing the old inode
+    // @return the fd locked, -1 if failed
+    static int OpenLocked(const char * file_name, uint32_t max_size) {
+      for (;;) {
+        mode_t mode = umask(0);
+        int fd = open(file_name, O_RDWR | O_CREAT, 0666);
+        umask(mode);
+        if (fd == -1) {
+          fprintf(stderr, "open file error:%s, %s\n", strerror(errno), file_name);
+          return -1;
+        }
+        flock(fd, LOCK_EX);
+        struct stat st, path_st;
+        fstat(fd, &st);
+        if (stat(file_name, &path_st) != 0 || path_st.st_ino != st.st_ino ||
+            path_st.st_dev != st.st_dev) {
+          // replaced by another process before locked
+          flock(fd, LOCK_UN);
+          close(fd);
+          continue;
+        }
+        if (st.st_size == 0) {
+          ftruncate(fd, max_size);
+          return fd;
+        }
+        ListHeader header;
+        if (st.st_size >= static_cast<off_t>(sizeof(header)) &&
+            pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+            (header.magic == RAW_MMAP_LIST_MAGIC || (header.magic == 0 && header.flag == 0))) {
+          // of this format or not initialized yet
+          return fd;
+        }
+        std::string temp_name = std::string(file_name) + ".tmp";
+        mode = umask(0);
+        int temp_fd = open(temp_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+        umask(mode);
+        if (temp_fd == -1 || ftruncate(temp_fd, max_size) != 0 ||
+            rename(temp_name.c_str(), file_name) != 0) {
+          fprintf(stderr, "replace file error:%s, %s\n", strerror(errno), file_name);
+          if (temp_fd != -1) {
+            close(temp_fd);
+          }
+          flock(fd, LOCK_UN);
+          close(fd);
+          return -1;
+        }
+        close(temp_fd);
+        flock(fd, LOCK_UN);
+        close(fd);
+      }
+    }
     
     virtual ~RawMMapList() {
       munmap(base_, static_cast<uint8_t *>(end_) - static_cast<uint8_t *>(base_));
       base_   = NULL;
+      index_  = NULL;
       entrys_ = NULL;
       end_    = NULL;
     }
     
-    // add new monitor counter entry
-    // @param key entry key address
-    // @param key_size entry key size
+    // add new monitor counter entry, must be called in SemP/SemV
+    // @param key entry key
     // @param value entry value address
     // @param value_size entry value size
-    Entry* AddEntry(const void *key, uint32_t key_size, const void *value, uint32_t value_size) {
-      CHECK(key != NULL && key_size > 0 && value != NULL && value_size > 0);
-      //pthread_mutex_lock(&list_header_->mutex); //lock
-      Entry *tmp = Find(key, key_size);
+    Entry* AddEntry(const MonitorKey &key, const void *value, uint32_t value_size) {
+      CHECK(value != NULL && value_size > 0);
+      Entry *tmp = Find(key);
       if (tmp != NULL) {
-        //pthread_mutex_unlock(&list_header_->mutex); //unlock
         return tmp;
       }
-      Entry * cur = Next(NULL);
-      while (cur->key_size != 0 && cur->total_size != 0) { //move to end
-        cur = Next(cur);
+      uint32_t key_size = AlignN(key.Size(), sizeof(uint64_t));
+      uint32_t total_size = sizeof(Entry) + key_size + AlignN(value_size, sizeof(uint64_t));
+      // keep a zeroed Entry at the end as terminator of the list
+      if (list_header_->entry_offset + list_header_->size + total_size + sizeof(Entry) >
+              list_header_->max_size ||
+          (list_header_->count + 1) * 4 > list_header_->index_size * 3) {
+        LOG_EVERY_T(ERROR, 10) << "monitor status file is full, drop "
+            << key.prefix << key.module_name << "#" << key.item_name;
+        return NULL;
       }
-      cur->key_size   = AlignN(key_size, sizeof(uint64_t));
+      Entry * cur = reinterpret_cast<Entry *>(static_cast<uint8_t *>(entrys_) + list_header_->size);
+      cur->key_size   = key_size;
       cur->value_size = AlignN(value_size, sizeof(uint64_t));
 
       // copy to file
-      memcpy(cur->Key(), key, key_size);
+      char *key_buff = static_cast<char *>(cur->Key());
+      key_buff = stpcpy(key_buff, key.prefix);
+      key_buff = stpcpy(key_buff, key.module_name);
+      key_buff = stpcpy(key_buff, "#");
+      stpcpy(key_buff, key.item_name);
       memcpy(cur->Value(), value, value_size);
 
-      cur->total_size     = cur->key_size  + cur->value_size + sizeof(Entry);
-      list_header_->size += cur->total_size;
-      CHECK(list_header_->size <= list_header_->max_size);
-
+      // publish the entry, then the index slot
+      __atomic_store_n(&cur->total_size, total_size, __ATOMIC_RELEASE);
+      list_header_->size += total_size;
       ++list_header_->count;
-      //pthread_mutex_unlock(&list_header_->mutex); //unlock
+
+      uint64_t slot = (key.hash & 0xffffffff00000000ULL) |
+          (reinterpret_cast<uint8_t *>(cur) - static_cast<uint8_t *>(base_));
+      uint32_t pos = key.hash & index_mask_;
+      while (__atomic_load_n(&index_[pos], __ATOMIC_ACQUIRE) != 0) {
+        pos = (pos + 1) & index_mask_;
+      }
+      __atomic_store_n(&index_[pos], slot, __ATOMIC_RELEASE);
       return cur;
     }
     
-    // find monitor counter entry according key key_size pair
-    // @param key entry key address
-    // @param key_size entry key size
-    Entry * Find(const void *key, uint32_t key_size) {
-      CHECK(key != NULL && key_size > 0);
-      
-      uint32_t key_buff_size = AlignN(key_size, sizeof(uint64_t));
-      void *key_buff = calloc(1, key_buff_size);
-      memcpy(key_buff, key, key_size);
-      Entry * cur = Next(NULL);
-      
-      while (cur->key_size != 0 && cur->total_size != 0) {
-        if ((cur->key_size == key_buff_size) && (memcmp(cur->Key(), key_buff, key_buff_size) == 0)) {
-          break;
+    // find monitor counter entry according key, lock free
+    // @param key entry key
+    Entry * Find(const MonitorKey &key) {
+      uint32_t pos = key.hash & index_mask_;
+      for (uint32_t i = 0; i <= index_mask_; ++i) {
+        uint64_t slot = __atomic_load_n(&index_[pos], __ATOMIC_ACQUIRE);
+        if (slot == 0) {
+          return NULL;
+        }
+        if ((slot & 0xffffffff00000000ULL) == (key.hash & 0xffffffff00000000ULL)) {
+          Entry *cur = reinterpret_cast<Entry *>(static_cast<uint8_t *>(base_) +
+                                                 (slot & 0xffffffffULL));
+          if (Match(cur, key)) {
+            return cur;
+          }
         }
-        cur = Next(cur);
+        pos = (pos + 1) & index_mask_;
       }
-      free(key_buff);
-      return cur->key_size == 0 ? NULL : cur;
+      return NULL;
+    }
+
+    // whether entry stores key
+    static bool Match(Entry *entry, const MonitorKey &key) {
+      const char *cur = static_cast<const char *>(entry->Key());
+      const char *end = cur + entry->key_size;
+      if ((cur = MatchPart(cur, end, key.prefix)) == NULL ||
+          (cur = MatchPart(cur, end, key.module_name)) == NULL ||
+          (cur = MatchPart(cur, end, "#")) == NULL ||
+          (cur = MatchPart(cur, end, key.item_name)) == NULL) {
+        return false;
+      }
+      return cur < end && *cur == '\0';
+    }
+
+    static const char *MatchPart(const char *cur, const char *end, const char *part) {
+      for (; *part != '\0'; ++cur, ++part) {
+        if (cur == end || *cur != *part) {
+          return NULL;
+        }
+      }
+      return cur;
     }
     
-    // get next entry
+    // get next entry, NULL if from is the last one
     Entry * Next(Entry *from) {
       CHECK(from < end_);
-      if (from == NULL) {
-        return static_cast<Entry *>(entrys_);
+      uint8_t* next = static_cast<uint8_t *>(entrys_);
+      if (from != NULL) {
+        next = reinterpret_cast<uint8_t *>(from) + from->total_size;
+      }
+      if (next + sizeof(Entry) > static_cast<uint8_t *>(end_)) {
+        return NULL;
+      }
+      Entry *entry = reinterpret_cast<Entry *>(next);
+      if (__atomic_load_n(&entry->total_size, __ATOMIC_ACQUIRE) == 0) {
+        return NULL;
       }
-      uint8_t* next = reinterpret_cast<uint8_t *>(from) + from->total_size;
-      return reinterpret_cast<Entry *>(next);
+      return entry;
     }
     
     // P operation
@@ -213,6 +378,8 @@ class MonitorStatusImpl : public MonitorStatus {
    private:
     ListHeader *list_header_;
     void *base_;
+    uint64_t *index_;
+    uint32_t index_mask_;
     void *entrys_;
     void *end_;
     int sem_id_;
@@ -224,7 +391,7 @@ class MonitorStatusImpl : public MonitorStatus {
   
   // initialization of MonitorStatusImpl
   bool Init(const std::string &monitor_stats_file) {
-    status_list_ = new RawMMapList(monitor_stats_file.c_str(), 64*1024);
+    status_list_ = new RawMMapList(monitor_stats_file.c_str(), MONITOR_STATUS_FILE_SIZE);
     key_t key    = ftok(monitor_stats_file.c_str(), 0x66);
     int sem_id   = semget(key, 1, 0666);
     if (sem_id < 0) {
@@ -238,9 +405,8 @@ class MonitorStatusImpl : public MonitorStatus {
       }
     }
     status_list_->SetSemId(sem_id);
-    counter_cache_map_index_ = 0;
-    timer_cache_map_index_   = 0;
-    binary_cache_map_index_  = 0;
+    // calibrate cycle clock of histogram timer out of the request path
+    MonitorStatusCyclesPerUs();
     return true;
   }
 
@@ -249,35 +415,18 @@ class MonitorStatusImpl : public MonitorStatus {
   // @param module_name module name
   // @param counter_key counter key
   virtual volatile uint64_t *GetCounter(const char * module_name, const char * counter_key) {
+    return GetCounter(module_name, counter_key, NULL);
+  }
+
+  virtual volatile uint64_t *GetCounter(const char * module_name, const char * counter_key,
+                                        MonitorStatusCache * cache) {
     CHECK(module_name != NULL);
     CHECK(counter_key != NULL);
     
-    char buff[128] = "";
-    snprintf(buff, sizeof(buff) - 1, "%s%s#%s", COUNTER_PREFIX, module_name, counter_key);
-    string key = buff;
-
-    int current_index = counter_cache_map_index_;
-    std::map<std::string, uint64_t *>::iterator mit = counter_cache_map_[current_index].find(key);
-    if (mit != counter_cache_map_[current_index].end()) {
-      return mit->second;
-    }
-
     uint64_t value = 0;
-    CHECK(status_list_ != NULL && "must be Init first");
-    // P process for muti-process enviroment
-    status_list_->SemP();
-    RawMMapList::Entry * entry = status_list_->AddEntry(key.c_str(), key.size() + 1, (void *)(&value), sizeof(value));
-    volatile uint64_t * counter = const_cast<volatile uint64_t *>(static_cast<uint64_t *>(entry->Value()));
-    
-    if (counter_cache_map_[counter_cache_map_index_].find(key) == counter_cache_map_[counter_cache_map_index_].end()) {
-      int new_index                       = (counter_cache_map_index_ + 1) % MAX_CACHE_SIZE;
-      counter_cache_map_[new_index]       = counter_cache_map_[counter_cache_map_index_]; 
-      counter_cache_map_[new_index][key]  = const_cast<uint64_t *>(counter);
-      counter_cache_map_index_            = new_index;
-    }
-    
-    status_list_->SemV();
-    return counter;
+    void *counter = GetValue(MonitorKey(COUNTER_PREFIX, module_name, counter_key),
+                             &value, sizeof(value), cache);
+    return static_cast<volatile uint64_t *>(counter);
   }
   
   // get timer counter
@@ -285,36 +434,19 @@ class MonitorStatusImpl : public MonitorStatus {
   // @param module_name module name
   // @param timer_key timer key
   virtual volatile TimerMonitorStatus *GetTimerCounter(const char * module_name, const char * timer_key) {
+    return GetTimerCounter(module_name, timer_key, NULL);
+  }
+
+  virtual volatile TimerMonitorStatus *GetTimerCounter(const char * module_name, const char * timer_key,
+                                                       MonitorStatusCache * cache) {
     CHECK(module_name != NULL);
     CHECK(timer_key != NULL);
     
-    char buff[128] = "";
-    snprintf(buff, sizeof(buff) - 1, "%s%s#%s", TIMER_COUNTER_PREFIX, module_name, timer_key);
-    string key = buff;
-    
-    int current_index = timer_cache_map_index_;
-    std::map<std::string, TimerMonitorStatus *>::iterator mit = timer_cache_map_[current_index].find(key);
-    if (mit != timer_cache_map_[current_index].end()) {
-      return mit->second;
-    }
-
     TimerMonitorStatus value;
     memset(&value, '\0', sizeof(value));
-    CHECK(status_list_ != NULL && "must be Init first");
-    // P process for multi-process enviroment
-    status_list_->SemP();
-    RawMMapList::Entry * entry = status_list_->AddEntry(key.c_str(), key.size() + 1, (void *)(&value), sizeof(value));
-    volatile TimerMonitorStatus *timer = const_cast<volatile TimerMonitorStatus *>(static_cast<TimerMonitorStatus *>(entry->Value()));
-    
-    if (timer_cache_map_[timer_cache_map_index_].find(key) == timer_cache_map_[timer_cache_map_index_].end()) {
-      int new_index                    = (timer_cache_map_index_ + 1) % MAX_CACHE_SIZE;
-      timer_cache_map_[new_index]      = timer_cache_map_[timer_cache_map_index_];
-      timer_cache_map_[new_index][key] = const_cast<TimerMonitorStatus *>(timer);
-      timer_cache_map_index_           = new_index;
-    }
-
-    status_list_->SemV();
-    return timer;
+    void *timer = GetValue(MonitorKey(TIMER_COUNTER_PREFIX, module_name, timer_key),
+                           &value, sizeof(value), cache);
+    return static_cast<volatile TimerMonitorStatus *>(timer);
   }
 
   // get binary counter
@@ -322,37 +454,61 @@ class MonitorStatusImpl : public MonitorStatus {
   // @param module_name module name
   // @param binary_key binary key
   virtual volatile BinaryMonitorStatus *GetBinaryCounter(const char * module_name, const char * binary_key) {
+    return GetBinaryCounter(module_name, binary_key, NULL);
+  }
+
+  virtual volatile BinaryMonitorStatus *GetBinaryCounter(const char * module_name, const char * binary_key,
+                                                         MonitorStatusCache * cache) {
     CHECK(module_name != NULL);
     CHECK(binary_key != NULL);
     
-    char buff[128] = "";
-    snprintf(buff, sizeof(buff) - 1, "%s%s#%s", BINARY_COUNTER_PREFIX, module_name, binary_key);
-    string key = buff;
-
-    int current_index = binary_cache_map_index_;
-    std::map<std::string, BinaryMonitorStatus *>::iterator mit = binary_cache_map_[current_index].find(key);
-    if (mit != binary_cache_map_[current_index].end()) {
-      return mit->second;
-    }
-
     BinaryMonitorStatus value;
     memset(&value, '\0', sizeof(value));
-    CHECK(status_list_ != NULL && "must be Init first");
-    
-    // V process for multi-enviroment
-    status_list_->SemP();
-    RawMMapList::Entry * entry = status_list_->AddEntry(key.c_str(), key.size() + 1, (void *)(&value), sizeof(value));
-    volatile BinaryMonitorStatus *binary = const_cast<volatile BinaryMonitorStatus *>(static_cast<BinaryMonitorStatus *>(entry->Value()));
-
-    if (binary_cache_map_[binary_cache_map_index_].find(key) == binary_cache_map_[binary_cache_map_index_].end()) {
-      int new_index                     = (binary_cache_map_index_ + 1) % MAX_CACHE_SIZE;
-      binary_cache_map_[new_index]      = binary_cache_map_[binary_cache_map_index_];
-      binary_cache_map_[new_index][key] = const_cast<BinaryMonitorStatus *>(binary);
-      binary_cache_map_index_           = new_index;
-    }
-    
-    status_list_->SemV();
-    return binary;
+    void *binary = GetValue(MonitorKey(BINARY_COUNTER_PREFIX, module_name, binary_key),
+                            &value, sizeof(value), cache);
+    return static_cast<volatile BinaryMonitorStatus *>(binary);
+  }
+
+  // get sharded counter
+  //  key: SHARDED_COUNTER_PREFIX module_name # counter_key
+  // @param module_name module name
+  // @param counter_key counter key
+  virtual volatile CounterMonitorStatusShard *GetShardedCounter(const char * module_name, const char * counter_key,
+                                                               MonitorStatusCache * cache) {
+    CHECK(module_name != NULL);
+    CHECK(counter_key != NULL);
+
+    void *shards = GetShardedValue(MonitorKey(SHARDED_COUNTER_PREFIX, module_name, counter_key),
+                                   sizeof(CounterMonitorStatusShard), cache);
+    return static_cast<volatile CounterMonitorStatusShard *>(shards);
+  }
+
+  // get sharded timer counter
+  //  key: SHARDED_TIMER_COUNTER_PREFIX module_name # timer_key
+  // @param module_name module name
+  // @param timer_key timer key
+  virtual volatile TimerMonitorStatusShard *GetShardedTimerCounter(const char * module_name, const char * timer_key,
+                                                                   MonitorStatusCache * cache) {
+    CHECK(module_name != NULL);
+    CHECK(timer_key != NULL);
+
+    void *shards = GetShardedValue(MonitorKey(SHARDED_TIMER_COUNTER_PREFIX, module_name, timer_key),
+                                   sizeof(TimerMonitorStatusShard), cache);
+    return static_cast<volatile TimerMonitorStatusShard *>(shards);
+  }
+
+  // get histogram timer counter
+  //  key: HISTOGRAM_COUNTER_PREFIX module_name # timer_key
+  // @param module_name module name
+  // @param timer_key timer key
+  virtual volatile HistogramMonitorStatus *GetHistogramCounter(const char * module_name, const char * timer_key,
+                                                               MonitorStatusCache * cache) {
+    CHECK(module_name != NULL);
+    CHECK(timer_key != NULL);
+
+    void *histogram = GetValue(MonitorKey(HISTOGRAM_COUNTER_PREFIX, module_name, timer_key),
+                               NULL, sizeof(HistogramMonitorStatus), cache);
+    return static_cast<volatile HistogramMonitorStatus *>(histogram);
   }
 
   virtual void GetAllCounters(std::map<std::string, uint64_t> *all_counters) {
@@ -373,15 +529,73 @@ class MonitorStatusImpl : public MonitorStatus {
     std::swap(*all_binary_counter, binary_counter_map_);
   }
 
+  virtual void GetAllHistogramCounters(std::map<std::string, HistogramMonitorStatus> * all_histogram_counter) {
+    assert(all_histogram_counter != NULL);
+    ParseCounters();
+    std::swap(*all_histogram_counter, histogram_counter_map_);
+  }
+
  private:
+  // get value address of key, the entry is added with init_value if absent
+  // @param key entry key
+  // @param init_value initial value of a new entry, zeroed if NULL
+  // @param value_size size of value
+  // @param cache call site cache of the calling thread, may be NULL
+  void *GetValue(const MonitorKey &key, const void *init_value, uint32_t value_size,
+                 MonitorStatusCache *cache) {
+    CHECK(status_list_ != NULL && "must be Init first");
+    uint32_t cache_slot = key.hash % MonitorStatusCache::kSize;
+    if (cache != NULL && cache->hash[cache_slot] == key.hash) {
+      RawMMapList::Entry *entry = static_cast<RawMMapList::Entry *>(cache->entry[cache_slot]);
+      if (RawMMapList::Match(entry, key)) {
+        return entry->Value();
+      }
+    }
+
+    RawMMapList::Entry *entry = status_list_->Find(key);
+    if (entry == NULL) {
+      // built on a miss only, large values are on every hot call otherwise
+      std::vector<uint8_t> zero;
+      if (init_value == NULL) {
+        zero.resize(value_size, 0);
+        init_value = &zero[0];
+      }
+      // P process for multi-process enviroment
+      status_list_->SemP();
+      entry = status_list_->AddEntry(key, init_value, value_size);
+      status_list_->SemV();
+      if (entry == NULL) {
+        return NULL;
+      }
+    }
+
+    if (cache != NULL) {
+      cache->hash[cache_slot]  = key.hash;
+      cache->entry[cache_slot] = entry;
+    }
+    return entry->Value();
+  }
+
+  // value of sharded entry is kMonitorStatusShardNum shards aligned to cache line,
+  // mmap base is page aligned so all processes see the same alignment
+  static void *AlignShards(void *value) {
+    uintptr_t addr = reinterpret_cast<uintptr_t>(value);
+    return reinterpret_cast<void *>(AlignN(addr, kMonitorStatusCacheLine));
+  }
+
+  void *GetShardedValue(const MonitorKey &key, uint32_t shard_size, MonitorStatusCache *cache) {
+    uint32_t value_size = shard_size * kMonitorStatusShardNum + kMonitorStatusCacheLine;
+    void *shards = GetValue(key, NULL, value_size, cache);
+    return shards == NULL ? NULL : AlignShards(shards);
+  }
+
   void ParseCounters() {
     counter_map_.clear();
     timer_counter_map_.clear();
+    binary_counter_map_.clear();
+    histogram_counter_map_.clear();
     RawMMapList::Entry * cur = NULL;
     while ((cur = status_list_->Next(cur)) != NULL) {
-      if (cur->key_size == 0 || cur->total_size == 0) {
-        break;
-      }
       std::string key(static_cast<char *>(cur->Key()));
       if (common::StringUtils::startsWith(key.c_str(), COUNTER_PREFIX)) {
         volatile uint64_t * value = const_cast<volatile uint64_t *>(static_cast<uint64_t *>(cur->Value()));
@@ -392,6 +606,33 @@ class MonitorStatusImpl : public MonitorStatus {
       } else if (common::StringUtils::startsWith(key.c_str(), BINARY_COUNTER_PREFIX)) {
         BinaryMonitorStatus * value = (static_cast<BinaryMonitorStatus *>(cur->Value()));
         binary_counter_map_.insert(std::make_pair(key.substr(2), *value));
+      } else if (common::StringUtils::startsWith(key.c_str(), HISTOGRAM_COUNTER_PREFIX)) {
+        HistogramMonitorStatus * value = (static_cast<HistogramMonitorStatus *>(cur->Value()));
+        histogram_counter_map_.insert(std::make_pair(key.substr(2), *value));
+      } else if (common::StringUtils::startsWith(key.c_str(), SHARDED_COUNTER_PREFIX)) {
+        volatile CounterMonitorStatusShard * shards =
+            static_cast<volatile CounterMonitorStatusShard *>(AlignShards(cur->Value()));
+        uint64_t & value = counter_map_[key.substr(3)];
+        for (uint32_t i = 0; i < kMonitorStatusShardNum; ++i) {
+          value += shards[i].count;
+        }
+      } else if (common::StringUtils::startsWith(key.c_str(), SHARDED_TIMER_COUNTER_PREFIX)) {
+        volatile TimerMonitorStatusShard * shards =
+            static_cast<volatile TimerMonitorStatusShard *>(AlignShards(cur->Value()));
+        std::map<std::string, TimerMonitorStatus>::iterator it = timer_counter_map_.find(key.substr(3));
+        if (it == timer_counter_map_.end()) {
+          TimerMonitorStatus zero;
+          memset(&zero, '\0', sizeof(zero));
+          it = timer_counter_map_.insert(std::make_pair(key.substr(3), zero)).first;
+        }
+        // TimerMonitorStatus is an array of uint64_t
+        uint64_t * value = reinterpret_cast<uint64_t *>(&it->second);
+        for (uint32_t i = 0; i < kMonitorStatusShardNum; ++i) {
+          volatile uint64_t * shard = reinterpret_cast<volatile uint64_t *>(&shards[i].status);
+          for (uint32_t j = 0; j < sizeof(TimerMonitorStatus) / sizeof(uint64_t); ++j) {
+            value[j] += shard[j];
+          }
+        }
       } else {
         fprintf(stderr, "not support counter type");
         abort();
@@ -404,20 +645,52 @@ class MonitorStatusImpl : public MonitorStatus {
   RawMMapList * status_list_;
   
   std::map<std::string, uint64_t> counter_map_;
-  std::map<std::string, uint64_t *> counter_cache_map_[MAX_CACHE_SIZE];
-  volatile int counter_cache_map_index_;
-  
   std::map<std::string, TimerMonitorStatus> timer_counter_map_;
-  std::map<std::string, TimerMonitorStatus *> timer_cache_map_[MAX_CACHE_SIZE];
-  volatile int timer_cache_map_index_;
-
   std::map<std::string, BinaryMonitorStatus> binary_counter_map_;
-  std::map<std::string, BinaryMonitorStatus *> binary_cache_map_[MAX_CACHE_SIZE];
-  volatile int binary_cache_map_index_;
+  std::map<std::string, HistogramMonitorStatus> histogram_counter_map_;
   
   time_t time_;
 };
 
+namespace {
+
+// threads using each shard of the process, never destroyed so that threads
+// exiting after static destruction can still release their shards
+pthread_mutex_t shard_mutex = PTHREAD_MUTEX_INITIALIZER;
+uint32_t shard_threads[kMonitorStatusShardNum];
+
+struct MonitorStatusShardHolder {
+  uint32_t shard_id;
+  MonitorStatusShardHolder() : shard_id(kMonitorStatusShardNum) {}
+  ~MonitorStatusShardHolder() {
+    if (shard_id < kMonitorStatusShardNum) {
+      pthread_mutex_lock(&shard_mutex);
+      --shard_threads[shard_id];
+      pthread_mutex_unlock(&shard_mutex);
+    }
+  }
+};
+
+}  // namespace
+
+uint32_t AllocMonitorStatusShardId() {
+  static thread_local MonitorStatusShardHolder holder;
+  if (holder.shard_id < kMonitorStatusShardNum) {
+    return holder.shard_id;
+  }
+  pthread_mutex_lock(&shard_mutex);
+  uint32_t shard_id = 0;
+  for (uint32_t i = 1; i < kMonitorStatusShardNum; ++i) {
+    if (shard_threads[i] < shard_threads[shard_id]) {
+      shard_id = i;
+    }
+  }
+  ++shard_threads[shard_id];
+  pthread_mutex_unlock(&shard_mutex);
+  holder.shard_id = shard_id;
+  return shard_id;
+}
+
 MonitorStatus *MonitorStatus::Instance() {
   if (instance_ == NULL) {
     instance_ = new MonitorStatusImpl();
@@ -5,6 +5,7 @@
 #include <string>
 #include <stdint.h>
 #include <sys/time.h>
+#include <time.h>
 
 #include "common/common_defines.h"
 #include "common/monitor/monitor_status.h"
@@ -32,6 +33,114 @@ struct TimerMonitorStatus {
     uint64_t gt1000ms;
 };
 
+//
+// 对数线性直方图(HdrHistogram 风格)类型的计时器, 单位 us, 量程 1us ~ 60s.
+// 小于 64us 的值每 1us 一个桶, 其后每个 2 的幂区间分为 32 个桶,
+// 取桶中点作为分位值时相对误差不超过 1.6%.
+//
+const uint32_t kHistogramSubBucketBits = 6;
+const uint32_t kHistogramSubBucketCount = 1 << kHistogramSubBucketBits;
+const uint32_t kHistogramSubBucketHalfCount = kHistogramSubBucketCount / 2;
+const uint64_t kHistogramMaxValue = 60000000; // 60s
+const uint32_t kHistogramBucketNum = 704;
+
+struct HistogramMonitorStatus {
+    uint64_t total_count;
+    uint64_t total_time;
+    uint64_t max_time;
+    uint64_t bucket_count[kHistogramBucketNum];
+};
+
+inline uint32_t HistogramBucketIndex(uint64_t value) {
+    if (value < kHistogramSubBucketCount) {
+        return value;
+    }
+    if (value > kHistogramMaxValue) {
+        value = kHistogramMaxValue;
+    }
+    uint32_t shift = 63 - __builtin_clzll(value) - (kHistogramSubBucketBits - 1);
+    return kHistogramSubBucketCount + (shift - 1) * kHistogramSubBucketHalfCount
+        + (value >> shift) - kHistogramSubBucketHalfCount;
+}
+
+// the lowest value of bucket, width of bucket is returned by width
+inline uint64_t HistogramBucketLowest(uint32_t index, uint64_t *width) {
+    if (index < kHistogramSubBucketCount) {
+        *width = 1;
+        return index;
+    }
+    uint32_t shift = (index - kHistogramSubBucketCount) / kHistogramSubBucketHalfCount + 1;
+    uint64_t sub_bucket = (index - kHistogramSubBucketCount) % kHistogramSubBucketHalfCount
+        + kHistogramSubBucketHalfCount;
+    *width = 1ULL << shift;
+    return sub_bucket << shift;
+}
+
+// value at percentile (0, 100] of histogram, in us
+inline uint64_t HistogramPercentile(const HistogramMonitorStatus &status, double percentile) {
+    uint64_t total_count = 0;
+    for (uint32_t i = 0; i < kHistogramBucketNum; ++i) {
+        total_count += status.bucket_count[i];
+    }
+    if (total_count == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(percentile / 100 * total_count + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t count = 0;
+    for (uint32_t i = 0; i < kHistogramBucketNum; ++i) {
+        count += status.bucket_count[i];
+        if (count >= rank) {
+            uint64_t width = 0;
+            uint64_t value = HistogramBucketLowest(i, &width) + width / 2;
+            return (status.max_time != 0 && value > status.max_time) ? status.max_time : value;
+        }
+    }
+    return status.max_time;
+}
+
+// histogram of samples between old_status and status, max_time of diff is the
+// max of the interval: the lifetime max if it grew in the interval, otherwise
+// the highest value of the highest non-empty bucket
+inline void HistogramDiff(const HistogramMonitorStatus &status,
+                          const HistogramMonitorStatus &old_status,
+                          HistogramMonitorStatus *diff) {
+    diff->total_count = status.total_count - old_status.total_count;
+    diff->total_time = status.total_time - old_status.total_time;
+    diff->max_time = 0;
+    for (uint32_t i = 0; i < kHistogramBucketNum; ++i) {
+        diff->bucket_count[i] = status.bucket_count[i] - old_status.bucket_count[i];
+        if (diff->bucket_count[i] != 0) {
+            uint64_t width = 0;
+            diff->max_time = HistogramBucketLowest(i, &width) + width - 1;
+        }
+    }
+    if (status.max_time > old_status.max_time || diff->max_time > status.max_time) {
+        diff->max_time = diff->max_time == 0 ? 0 : status.max_time;
+    }
+}
+
+//
+// 分片模式: 每个线程写入按 cache line 对齐的一个分片, 避免线程间 cache line 争用,
+// 读取时(GetAllCounters/GetAllTimerCounters)汇总所有分片.
+// 分片由进程内的分片表分配给当前负载最小的分片, 线程退出时归还;
+// 分片可能被多个线程或共享文件的多个进程写入, 所以写入仍为原子操作.
+//
+const uint32_t kMonitorStatusShardNum = 64;
+const uint32_t kMonitorStatusCacheLine = 64;
+
+struct CounterMonitorStatusShard {
+    uint64_t count;
+    uint8_t padding[kMonitorStatusCacheLine - sizeof(uint64_t)];
+};
+
+struct TimerMonitorStatusShard {
+    TimerMonitorStatus status;
+    uint8_t padding[AlignN(sizeof(TimerMonitorStatus), kMonitorStatusCacheLine) - sizeof(TimerMonitorStatus)];
+};
+
 //
 // 二值类型的监控统计状态数据
 //
@@ -41,6 +150,15 @@ struct BinaryMonitorStatus {
     uint32_t true_count; 
 };
 
+//
+// 调用点级别的线程局部缓存, 缓存最近查找到的监控项, 由 MONITOR_STATUS_NORMAL_* 宏使用
+//
+struct MonitorStatusCache {
+    static const uint32_t kSize = 4;
+    uint64_t hash[kSize];
+    void *entry[kSize];
+};
+
 class MonitorStatus {
 public:
     virtual bool Init(const std::string &monitor_stats_file) = 0;
@@ -50,6 +168,36 @@ public:
     virtual volatile uint64_t *GetCounter(const char * module_name, const char * counter_key) = 0;
     virtual volatile TimerMonitorStatus *GetTimerCounter(const char * module_name, const char * timer_key) = 0;
     virtual volatile BinaryMonitorStatus *GetBinaryCounter(const char * module_name, const char * timer_key) = 0;
+    // sharded counters, return the first of kMonitorStatusShardNum shards
+    virtual volatile CounterMonitorStatusShard *GetShardedCounter(const char * module_name, const char * counter_key,
+                                                                 MonitorStatusCache * cache) {
+        return NULL;
+    }
+    virtual volatile TimerMonitorStatusShard *GetShardedTimerCounter(const char * module_name, const char * timer_key,
+                                                                     MonitorStatusCache * cache) {
+        return NULL;
+    }
+    // histogram timer counter
+    virtual volatile HistogramMonitorStatus *GetHistogramCounter(const char * module_name, const char * timer_key,
+                                                                 MonitorStatusCache * cache) {
+        return NULL;
+    }
+    virtual void GetAllHistogramCounters(std::map<std::string, HistogramMonitorStatus> *all_histogram_counter) {
+        all_histogram_counter->clear();
+    }
+    // lookup with the call site cache of current thread
+    virtual volatile uint64_t *GetCounter(const char * module_name, const char * counter_key,
+                                          MonitorStatusCache * cache) {
+        return GetCounter(module_name, counter_key);
+    }
+    virtual volatile TimerMonitorStatus *GetTimerCounter(const char * module_name, const char * timer_key,
+                                                         MonitorStatusCache * cache) {
+        return GetTimerCounter(module_name, timer_key);
+    }
+    virtual volatile BinaryMonitorStatus *GetBinaryCounter(const char * module_name, const char * timer_key,
+                                                           MonitorStatusCache * cache) {
+        return GetBinaryCounter(module_name, timer_key);
+    }
     virtual void GetAllCounters(std::map<std::string, uint64_t> *all_counters) = 0;
     virtual void GetAllTimerCounters(std::map<std::string, TimerMonitorStatus> *all_timer_counter) = 0;
     virtual void GetAllBinaryCounters(std::map<std::string, BinaryMonitorStatus> *all_binary_counter) = 0;
@@ -88,6 +236,76 @@ struct TimerCounterUpdater{
     }
 };
 
+// allocate the least loaded shard of the process to current thread,
+// it's released when the thread exits
+uint32_t AllocMonitorStatusShardId();
+
+// shard of current thread, allocated on first use
+inline uint32_t MonitorStatusShardId() {
+    static __thread uint32_t shard_id = 0;
+    if (__builtin_expect(shard_id == 0, 0)) {
+        shard_id = AllocMonitorStatusShardId() + 1;
+    }
+    return shard_id - 1;
+}
+
+struct ShardedCounterUpdater {
+    inline ShardedCounterUpdater(volatile CounterMonitorStatusShard *shards, uint64_t inc_count) {
+        if (shards == NULL) {
+            return;
+        }
+        __sync_fetch_and_add(&shards[MonitorStatusShardId()].count, inc_count);
+    }
+};
+
+struct ShardedTimerCounterUpdater {
+    inline ShardedTimerCounterUpdater(volatile TimerMonitorStatusShard *shards, uint32_t total_time, uint32_t total_count) {
+        if (shards == NULL) {
+            return;
+        }
+        ::common::TimerCounterUpdater(&shards[MonitorStatusShardId()].status, total_time, total_count);
+    }
+};
+
+struct HistogramCounterUpdater {
+    inline HistogramCounterUpdater(volatile HistogramMonitorStatus *histogram_monitor_stats,
+                                   uint64_t total_time, uint32_t total_count) {
+        if (histogram_monitor_stats == NULL || total_count == 0) {
+            return;
+        }
+        uint64_t time = total_time / total_count;
+        __sync_fetch_and_add(&histogram_monitor_stats->total_count, total_count);
+        __sync_fetch_and_add(&histogram_monitor_stats->total_time, total_time);
+        __sync_fetch_and_add(&histogram_monitor_stats->bucket_count[HistogramBucketIndex(time)], total_count);
+        uint64_t max_time = histogram_monitor_stats->max_time;
+        while (time > max_time) {
+            uint64_t prev = __sync_val_compare_and_swap(&histogram_monitor_stats->max_time, max_time, time);
+            if (prev == max_time) {
+                break;
+            }
+            max_time = prev;
+        }
+    }
+};
+
+//
+// 时钟周期计数, x86 上为 rdtsc, 其它平台为 CLOCK_MONOTONIC 纳秒
+//
+inline uint64_t MonitorStatusCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t lo, hi;
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return (static_cast<uint64_t>(hi) << 32) | lo;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+// cycles per us, calibrated once against CLOCK_MONOTONIC
+extern double MonitorStatusCyclesPerUs();
+
 struct BinaryCounterUpdater{
     inline BinaryCounterUpdater(volatile BinaryMonitorStatus *binary_monitor_status, uint32_t flag){
         if(binary_monitor_status == NULL){
@@ -124,6 +342,21 @@ private:
     volatile TimerMonitorStatus *timer_monitor_stats_;
 };
 
+struct MonitorStatusHistogramTimer {
+    MonitorStatusHistogramTimer(volatile HistogramMonitorStatus *histogram_monitor_stats):
+        start_(MonitorStatusCycles()), histogram_monitor_stats_(histogram_monitor_stats) {
+    }
+    ~MonitorStatusHistogramTimer() {
+        uint64_t cycles = MonitorStatusCycles() - start_;
+        uint64_t len = static_cast<uint64_t>(cycles / MonitorStatusCyclesPerUs());
+        ::common::HistogramCounterUpdater(histogram_monitor_stats_, len, 1);
+    }
+
+private:
+    uint64_t start_;
+    volatile HistogramMonitorStatus *histogram_monitor_stats_;
+};
+
 }//end namespace common
 
 // __builtin_expect() required  GCC (version >= 2.96）
@@ -148,14 +381,18 @@ private:
        if(unlikely(monitor_counter_ptr == NULL)){\
            monitor_counter_ptr = ::common::MonitorStatus::Instance()->GetCounter((module_name), (counter_name));\
        }\
-       __sync_fetch_and_add(monitor_counter_ptr, inc_count);\
+       if(likely(monitor_counter_ptr != NULL)) {\
+           __sync_fetch_and_add(monitor_counter_ptr, inc_count);\
+       }\
     })
 
 #define MONITOR_STATUS_COUNTER(module_name, counter_name) MONITOR_STATUS_COUNTER_BY(module_name, counter_name, 1)
 
 #define MONITOR_STATUS_NORMAL_COUNTER_BY(module_name, counter_name, inc_count)\
     ({\
-       volatile uint64_t *monitor_counter_ptr = ::common::MonitorStatus::Instance()->GetCounter((module_name), (counter_name));\
+       static __thread ::common::MonitorStatusCache monitor_status_cache;\
+       volatile uint64_t *monitor_counter_ptr = ::common::MonitorStatus::Instance()->GetCounter(\
+             (module_name), (counter_name), &monitor_status_cache);\
        if(monitor_counter_ptr) {\
             __sync_fetch_and_add(monitor_counter_ptr, inc_count);\
        }\
@@ -175,8 +412,9 @@ private:
 
 #define MONITOR_STATUS_NORMAL_GET_TIMER_PTR(module_name, timer_name)\
     ({\
+          static __thread ::common::MonitorStatusCache monitor_status_cache;\
           volatile ::common::TimerMonitorStatus *monitor_timer_counter_ptr = \
-                ::common::MonitorStatus::Instance()->GetTimerCounter((module_name), (timer_name));\
+                ::common::MonitorStatus::Instance()->GetTimerCounter((module_name), (timer_name), &monitor_status_cache);\
           monitor_timer_counter_ptr;\
      })
 
@@ -191,12 +429,48 @@ private:
 
 #define MONITOR_STATUS_NORMAL_GET_BINARY_COUNTER_PTR(module_name, timer_name)\
     ({\
+          static __thread ::common::MonitorStatusCache monitor_status_cache;\
           volatile ::common::BinaryMonitorStatus *monitor_binary_counter_ptr = \
-                ::common::MonitorStatus::Instance()->GetBinaryCounter((module_name), (timer_name));\
+                ::common::MonitorStatus::Instance()->GetBinaryCounter((module_name), (timer_name), &monitor_status_cache);\
           monitor_binary_counter_ptr;\
      })
 
 #define MONITOR_STATUS_NORMAL_BINARY_BY(module_name, item_name, flag)\
         ::common::BinaryCounterUpdater( MONITOR_STATUS_NORMAL_GET_BINARY_COUNTER_PTR((module_name), (item_name)), flag)
 
+#define MONITOR_STATUS_SHARDED_COUNTER_BY(module_name, counter_name, inc_count)\
+    ({\
+       static __thread ::common::MonitorStatusCache monitor_status_cache;\
+       ::common::ShardedCounterUpdater(::common::MonitorStatus::Instance()->GetShardedCounter(\
+             (module_name), (counter_name), &monitor_status_cache), inc_count);\
+    })
+
+#define MONITOR_STATUS_SHARDED_COUNTER(module_name, counter_name) \
+     MONITOR_STATUS_SHARDED_COUNTER_BY(module_name, counter_name, 1)
+
+#define MONITOR_STATUS_SHARDED_GET_TIMER_PTR(module_name, timer_name)\
+    ({\
+          static __thread ::common::MonitorStatusCache monitor_status_cache;\
+          volatile ::common::TimerMonitorStatusShard *monitor_timer_shards_ptr = \
+                ::common::MonitorStatus::Instance()->GetShardedTimerCounter((module_name), (timer_name), &monitor_status_cache);\
+          monitor_timer_shards_ptr;\
+     })
+
+#define MONITOR_STATUS_SHARDED_TIMER_BY(module_name, timer_name, total_time, total_count)\
+        ::common::ShardedTimerCounterUpdater( MONITOR_STATUS_SHARDED_GET_TIMER_PTR((module_name), (timer_name)), total_time, total_count)
+
+#define MONITOR_STATUS_GET_HISTOGRAM_PTR(module_name, timer_name)\
+    ({\
+          static __thread ::common::MonitorStatusCache monitor_status_cache;\
+          volatile ::common::HistogramMonitorStatus *monitor_histogram_counter_ptr = \
+                ::common::MonitorStatus::Instance()->GetHistogramCounter((module_name), (timer_name), &monitor_status_cache);\
+          monitor_histogram_counter_ptr;\
+     })
+
+#define MONITOR_STATUS_HISTOGRAM_BY(module_name, timer_name, total_time, total_count)\
+        ::common::HistogramCounterUpdater( MONITOR_STATUS_GET_HISTOGRAM_PTR((module_name), (timer_name)), total_time, total_count)
+
+#define MONITOR_STATUS_HISTOGRAM_TIMER(module_name, timer_name)\
+        ::common::MonitorStatusHistogramTimer CONCATENATE(monitor_status_histogram_timer, __LINE__ )(MONITOR_STATUS_GET_HISTOGRAM_PTR((module_name), (timer_name)))
+
 #endif /* COM_MONITOR_MONITORSTATUSIMPL_H_ */
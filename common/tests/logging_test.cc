@@ -0,0 +1,68 @@
+/*
+ * \file logging_test.cc
+ * \brief The logging test unit
+ */
+#include "gtest/gtest.h"
+
+#include <thread>
+#include <vector>
+
+#include "common/logging.h"
+
+namespace common {
+
+TEST(LogSite, EveryN) {
+  LogSite site;
+  int passed = 0;
+  for (int i = 0; i < 100; ++i) {
+    if (site.EveryN(10, __FILE__, __LINE__, kLogDebug)) ++passed;
+  }
+  EXPECT_EQ(10, passed);
+}
+
+TEST(LogSite, FirstN) {
+  LogSite site;
+  std::vector<std::thread> threads;
+  std::atomic<int> passed(0);
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&site, &passed]() {
+      for (int j = 0; j < 1000; ++j) {
+        if (site.FirstN(5)) ++passed;
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  EXPECT_EQ(5, passed.load());
+}
+
+TEST(LogSite, EveryT) {
+  LogSite site;
+  int passed = 0;
+  for (int i = 0; i < 1000; ++i) {
+    if (site.EveryT(60, __FILE__, __LINE__, kLogDebug)) ++passed;
+  }
+  EXPECT_EQ(1, passed);
+}
+
+TEST(LogSite, Macros) {
+  int evaluated = 0;
+  for (int i = 0; i < 100; ++i) {
+    LOG_EVERY_N(DEBUG, 50) << "every n " << ++evaluated;
+  }
+  EXPECT_EQ(2, evaluated);
+
+  for (int i = 0; i < 100; ++i) {
+    LOG_FIRST_N(DEBUG, 3) << "first n " << ++evaluated;
+  }
+  EXPECT_EQ(5, evaluated);
+
+  for (int i = 0; i < 100; ++i) {
+    if (i % 2 == 0)
+      LOG_EVERY_T(DEBUG, 60) << "every t " << ++evaluated;
+    else
+      ++evaluated;
+  }
+  EXPECT_EQ(56, evaluated);
+}
+
+}  // namespace common
@@ -1,5 +1,12 @@
 #include "common/monitor/monitor_status.h"
 
+#include <sys/stat.h>
+#include <atomic>
+#include <fstream>
+#include <set>
+#include <thread>
+#include <vector>
+
 #include "gtest/gtest.h"
 
 using namespace std;
@@ -11,6 +18,10 @@ class MonitorStatusTest : public testing::Test {
 public:
     static void SetUpTestCase() {
         remove(monitor_status_file);
+        // a file of an older format, replaced by a full sized one on init
+        std::ofstream old_file(monitor_status_file);
+        old_file << std::string(64 * 1024, 'x');
+        old_file.close();
         bool ret = MONITOR_STATUS_INIT(monitor_status_file);
     }
     static void TearDownTestCase() {
@@ -18,6 +29,9 @@ public:
 };
 
 TEST_F(MonitorStatusTest, Init) {
+    struct stat st;
+    ASSERT_EQ(0, stat(monitor_status_file, &st));
+    EXPECT_EQ(4 * 1024 * 1024, st.st_size);
 }
 
 TEST_F(MonitorStatusTest, MONITOR_STATUS_COUNTER_BY) {
@@ -114,6 +128,191 @@ TEST_F(MonitorStatusTest, MONITOR_STATUS_NORMAL_BINARY_BY) {
     EXPECT_NE(all_binary_counter.find("TEST#normal_binary2_by"), all_binary_counter.end());
 }
 
+TEST_F(MonitorStatusTest, MANY_KEYS) {
+    char name[32];
+    for (int i = 0; i < 1000; ++i) {
+        snprintf(name, sizeof(name), "many_timer%d", i);
+        MONITOR_STATUS_NORMAL_TIMER_BY("TESTMANY", name, i, 1);
+    }
+    for (int i = 0; i < 1000; ++i) {
+        snprintf(name, sizeof(name), "many_timer%d", i);
+        MONITOR_STATUS_NORMAL_TIMER_BY("TESTMANY", name, i, 1);
+    }
+    std::map<std::string, TimerMonitorStatus> all_timer_counter;
+    MonitorStatus::Instance()->GetAllTimerCounters(&all_timer_counter);
+    for (int i = 0; i < 1000; ++i) {
+        snprintf(name, sizeof(name), "TESTMANY#many_timer%d", i);
+        ASSERT_NE(all_timer_counter.find(name), all_timer_counter.end());
+        EXPECT_EQ(2u, all_timer_counter[name].total_count);
+        EXPECT_EQ(2u * i, all_timer_counter[name].total_time);
+    }
+}
+
+TEST_F(MonitorStatusTest, CONCURRENT_NORMAL_COUNTER) {
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; ++i) {
+        threads.emplace_back([]() {
+            char name[32];
+            for (int j = 0; j < 10000; ++j) {
+                snprintf(name, sizeof(name), "concurrent%d", j % 16);
+                MONITOR_STATUS_NORMAL_COUNTER("TESTCONCURRENT", name);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    std::map<std::string, uint64_t> all_counters;
+    MonitorStatus::Instance()->GetAllCounters(&all_counters);
+    for (int i = 0; i < 16; ++i) {
+        char name[64];
+        snprintf(name, sizeof(name), "TESTCONCURRENT#concurrent%d", i);
+        EXPECT_EQ(5000u, all_counters[name]);
+    }
+}
+
+TEST_F(MonitorStatusTest, MONITOR_STATUS_SHARDED_COUNTER_BY) {
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; ++i) {
+        threads.emplace_back([]() {
+            for (int j = 0; j < 10000; ++j) {
+                MONITOR_STATUS_SHARDED_COUNTER_BY("TESTSHARDED", "counter_by1", 2);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    std::map<std::string, uint64_t> all_counters;
+    MonitorStatus::Instance()->GetAllCounters(&all_counters);
+    EXPECT_EQ(160000u, all_counters["TESTSHARDED#counter_by1"]);
+}
+
+TEST_F(MonitorStatusTest, SHARD_ID) {
+    // live threads get distinct shards
+    const int kLiveThreads = 32;
+    std::atomic<int> started(0);
+    std::atomic<bool> stop(false);
+    std::vector<uint32_t> live_ids(kLiveThreads);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kLiveThreads; ++i) {
+        threads.emplace_back([&, i]() {
+            live_ids[i] = MonitorStatusShardId();
+            ++started;
+            while (!stop) {
+                std::this_thread::yield();
+            }
+        });
+    }
+    while (started < kLiveThreads) {
+        std::this_thread::yield();
+    }
+    std::set<uint32_t> live_set(live_ids.begin(), live_ids.end());
+    EXPECT_EQ(static_cast<size_t>(kLiveThreads), live_set.size());
+
+    // shards of exited threads are reused, never those of live threads
+    for (int i = 0; i < 200; ++i) {
+        uint32_t shard_id = kMonitorStatusShardNum;
+        std::thread([&shard_id]() { shard_id = MonitorStatusShardId(); }).join();
+        ASSERT_LT(shard_id, kMonitorStatusShardNum);
+        EXPECT_EQ(0u, live_set.count(shard_id));
+    }
+    stop = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+TEST_F(MonitorStatusTest, MONITOR_STATUS_SHARDED_TIMER_BY) {
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 100; ++i) {
+        threads.emplace_back([]() {
+            for (int j = 0; j < 1000; ++j) {
+                MONITOR_STATUS_SHARDED_TIMER_BY("TESTSHARDED", "timer_by1", 600, 1);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    std::map<std::string, TimerMonitorStatus> all_timer_counter;
+    MonitorStatus::Instance()->GetAllTimerCounters(&all_timer_counter);
+    ASSERT_NE(all_timer_counter.find("TESTSHARDED#timer_by1"), all_timer_counter.end());
+    TimerMonitorStatus& status = all_timer_counter["TESTSHARDED#timer_by1"];
+    EXPECT_EQ(100000u, status.total_count);
+    EXPECT_EQ(60000000u, status.total_time);
+    EXPECT_EQ(100000u, status.time_slice_count[1]);
+}
+
+TEST_F(MonitorStatusTest, HISTOGRAM_BUCKET) {
+    uint64_t width = 0;
+    for (uint64_t value = 0; value < kHistogramMaxValue; value += value / 7 + 1) {
+        uint32_t index = HistogramBucketIndex(value);
+        ASSERT_LT(index, kHistogramBucketNum);
+        uint64_t lowest = HistogramBucketLowest(index, &width);
+        EXPECT_LE(lowest, value);
+        EXPECT_GT(lowest + width, value);
+        EXPECT_LE(width / 2.0, value * 0.016 + 0.5);
+    }
+    EXPECT_EQ(HistogramBucketIndex(kHistogramMaxValue), HistogramBucketIndex(kHistogramMaxValue * 10));
+}
+
+TEST_F(MonitorStatusTest, MONITOR_STATUS_HISTOGRAM_BY) {
+    for (uint64_t i = 1; i <= 1000; ++i) {
+        MONITOR_STATUS_HISTOGRAM_BY("TEST", "histogram_by1", i * 100, 1);
+    }
+    std::map<std::string, HistogramMonitorStatus> all_histogram_counter;
+    MonitorStatus::Instance()->GetAllHistogramCounters(&all_histogram_counter);
+    ASSERT_NE(all_histogram_counter.find("TEST#histogram_by1"), all_histogram_counter.end());
+    HistogramMonitorStatus& status = all_histogram_counter["TEST#histogram_by1"];
+    EXPECT_EQ(1000u, status.total_count);
+    EXPECT_EQ(100000u, status.max_time);
+    EXPECT_NEAR(50000, HistogramPercentile(status, 50), 50000 * 0.02);
+    EXPECT_NEAR(99000, HistogramPercentile(status, 99), 99000 * 0.02);
+    EXPECT_NEAR(99900, HistogramPercentile(status, 99.9), 99900 * 0.02);
+}
+
+TEST_F(MonitorStatusTest, HISTOGRAM_DIFF) {
+    HistogramMonitorStatus old_status = {};
+    old_status.max_time = 100000;
+    old_status.bucket_count[HistogramBucketIndex(100000)] = 1;
+    HistogramMonitorStatus status = old_status;
+    status.bucket_count[HistogramBucketIndex(1000)] += 2;
+    status.total_count = 2;
+    status.total_time = 2000;
+
+    // the lifetime max isn't of the interval
+    HistogramMonitorStatus diff;
+    HistogramDiff(status, old_status, &diff);
+    EXPECT_EQ(2u, diff.total_count);
+    EXPECT_EQ(2000u, diff.total_time);
+    uint64_t width = 0;
+    uint64_t lowest = HistogramBucketLowest(HistogramBucketIndex(1000), &width);
+    EXPECT_EQ(lowest + width - 1, diff.max_time);
+
+    // the lifetime max grew in the interval
+    status.max_time = 200000;
+    status.bucket_count[HistogramBucketIndex(200000)] += 1;
+    HistogramDiff(status, old_status, &diff);
+    EXPECT_EQ(200000u, diff.max_time);
+
+    HistogramDiff(status, status, &diff);
+    EXPECT_EQ(0u, diff.max_time);
+}
+
+TEST_F(MonitorStatusTest, MONITOR_STATUS_HISTOGRAM_TIMER) {
+    {
+        MONITOR_STATUS_HISTOGRAM_TIMER("TEST", "histogram_timer1");
+        usleep(20000);
+    }
+    std::map<std::string, HistogramMonitorStatus> all_histogram_counter;
+    MonitorStatus::Instance()->GetAllHistogramCounters(&all_histogram_counter);
+    HistogramMonitorStatus& status = all_histogram_counter["TEST#histogram_timer1"];
+    EXPECT_EQ(1u, status.total_count);
+    EXPECT_GE(status.total_time, 20000u);
+    EXPECT_LT(status.total_time, 200000u);
+}
+
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -10,8 +10,16 @@ class HelloWorkflowRouter : public WorkflowRouter {
   HelloWorkflowRouter() = default;
   virtual ~HelloWorkflowRouter() = default;
 
-  bool Init(const YAML::Node& config) override { return true; }
+  bool Init(const YAML::Node& config) override {
+    id_ = ExecutionGraphMgr::Instance()->GetGraphId("default");
+    return true;
+  }
+
   std::string Route(SessionBase* session) override { return "default"; }
+  int32_t RouteId(SessionBase* session) override { return id_; }
+
+ private:
+  int32_t id_;
 };
 
 ORC_REGISTER_WORKFLOW_ROUTER(HelloWorkflowRouter);
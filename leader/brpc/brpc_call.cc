@@ -6,19 +6,17 @@
 
 namespace leader {
 
-void BrpcPingCall::Ping(BrpcChannelPool* channel_pool,
-                        BRPCChannel* channel,
-                        const std::string& spec) {
-  BrpcPingCall* call = new BrpcPingCall(channel_pool, channel, spec);
+void BrpcPingCall::Ping(BrpcChannelGroup* channel_group,
+                        BRPCChannel* channel) {
+  BrpcPingCall* call = new BrpcPingCall(channel_group, channel);
   call->PingImpl(channel);
 }
 
-void BrpcCheckerPingCall::Ping(BrpcChannelPool* channel_pool,
+void BrpcCheckerPingCall::Ping(BrpcChannelGroup* channel_group,
                                BRPCChannel* channel,
-                               const std::string& spec,
                                common::Waiter* waiter,
                                std::atomic<uint32_t>* bad) {
-  BrpcCheckerPingCall* call = new BrpcCheckerPingCall(channel_pool, channel, spec, waiter, bad);
+  BrpcCheckerPingCall* call = new BrpcCheckerPingCall(channel_group, channel, waiter, bad);
   call->PingImpl(channel);
 }
 
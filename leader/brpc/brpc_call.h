@@ -20,17 +20,14 @@ namespace leader {
 
 class BrpcPingCall {
  public:
-  explicit BrpcPingCall(BrpcChannelPool* channel_pool,
-                        BRPCChannel* channel,
-                        const std::string& spec) :
-      channel_pool_(channel_pool),
+  explicit BrpcPingCall(BrpcChannelGroup* channel_group,
+                        BRPCChannel* channel) :
+      channel_group_(channel_group),
       channel_(channel),
-      spec_(spec),
       status_(false) { }
 
-  static void Ping(BrpcChannelPool* channel_pool,
-                   BRPCChannel* channel,
-                   const std::string& spec);
+  static void Ping(BrpcChannelGroup* channel_group,
+                   BRPCChannel* channel);
 
  protected:
   // Clieng Ping implementation.
@@ -56,30 +53,28 @@ class BrpcPingCall {
     std::unique_ptr<PingResponse> response_guard(response);
 
     if (!cntl->Failed() && response->id() == kMaskCode) {
-      channel_pool_->MoveFromBad2Good(spec_, channel_);
+      channel_group_->MoveChannelToGood(channel_);
       status_ = true;
     } else {
-      channel_pool_->MoveFromGood2Bad(spec_, channel_);
+      channel_group_->MoveChannelToBad(channel_);
       LOG(ERROR) << "Ping ErrorText:" << cntl->ErrorText()
           << " ErrorCode:" << cntl->ErrorCode();
     }
   }
 
-  BrpcChannelPool *channel_pool_;
+  BrpcChannelGroup *channel_group_;
   BRPCChannel *channel_;
-  std::string spec_;
   bool status_;
   const int kMaskCode = 0x08;
 };
 
 class BrpcCheckerPingCall : public BrpcPingCall {
  public:
-  explicit BrpcCheckerPingCall(BrpcChannelPool* channel_pool,
+  explicit BrpcCheckerPingCall(BrpcChannelGroup* channel_group,
                                BRPCChannel* channel,
-                               const std::string& spec,
                                common::Waiter* waiter,
                                std::atomic<uint32_t>* bad) :
-      BrpcPingCall(channel_pool, channel, spec),
+      BrpcPingCall(channel_group, channel),
       waiter_(waiter),
       bad_(bad) { }
 
@@ -92,9 +87,8 @@ class BrpcCheckerPingCall : public BrpcPingCall {
     delete this;
   }
 
-  static void Ping(BrpcChannelPool* channel_pool,
+  static void Ping(BrpcChannelGroup* channel_group,
                    BRPCChannel* channel,
-                   const std::string& spec,
                    common::Waiter* waiter,
                    std::atomic<uint32_t>* bad);
  
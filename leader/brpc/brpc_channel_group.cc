@@ -75,9 +75,8 @@ bool BrpcChannelGroup::CheckChannels(int timeout) {
   common::Waiter waiter(channels.size());
   std::atomic<uint32_t> bad(0);
   for (auto& channel : channels) {
-    BrpcCheckerPingCall::Ping(channel_pool_,
+    BrpcCheckerPingCall::Ping(this,
                               channel,
-                              spec_,
                               &waiter,
                               &bad);
   }
@@ -10,8 +10,10 @@
 #include <string>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "common/logging.h"
+#include "common/waiter.h"
 #include "leader/brpc/brpc_call.h"
 
 using std::map;
@@ -23,12 +25,12 @@ namespace leader {
 BrpcChannelPool::BrpcChannelPool(uint32_t comm_timeout,
                                  uint32_t build_conn_timeout)
     : timeout_(comm_timeout),
-      build_conn_timeout_(build_conn_timeout) {
+      build_conn_timeout_(build_conn_timeout),
+      connection_type_("single") {
 }
 
 BrpcChannelPool::~BrpcChannelPool() {
   common::ScopedWriteLock writeLock(channel_lock_);
-  channel_group_cache_.clear();
   for (auto& pair : channel_pool_) {
     delete pair.second;
     pair.second = nullptr;
@@ -54,6 +56,10 @@ bool BrpcChannelPool::Init(int32_t work_thread_num,
 }
 
 BRPCChannel* BrpcChannelPool::GetChannel(const string& spec) {
+  return GetChannel(GetChannelGroup(spec));
+}
+
+BrpcChannelGroup* BrpcChannelPool::GetChannelGroup(const string& spec) {
   BrpcChannelGroup* channelGroup = nullptr;
   channel_lock_.rdlock();
   auto iter = channel_pool_.find(spec);
@@ -75,92 +81,86 @@ BRPCChannel* BrpcChannelPool::GetChannel(const string& spec) {
       channelGroup = newChannelGroup;
     }
   }
+  return channelGroup;
+}
+
+BRPCChannel* BrpcChannelPool::GetChannel(BrpcChannelGroup* channelGroup) {
   if (channelGroup == nullptr) {
     LOG(ERROR) << "Unexpected error, null channel group found";
     return nullptr;
   }
-  if (!channelGroup->IsFull()) {
-    OpenNewChannel(spec, channelGroup);
-  }
+  // the channels are opened by WarmUp, not on the request path
   return channelGroup->PickChannel();
 }
 
-void BrpcChannelPool::OpenNewChannel(const string& spec,
-                                     BrpcChannelGroup* channelGroup) {
+bool BrpcChannelPool::SetConnectionType(const string& type) {
+  if (type != "single" && type != "pooled" && type != "short") {
+    LOG(ERROR) << "Unknown connection type: " << type;
+    return false;
+  }
+  connection_type_ = type;
+  return true;
+}
+
+size_t BrpcChannelPool::WarmUp(const std::vector<BrpcChannelGroup*>& channelGroups) {
+  std::vector<std::pair<BrpcChannelGroup*, BRPCChannel*>> channels;
+  for (auto channelGroup : channelGroups) {
+    BRPCChannel* channel = nullptr;
+    while (channelGroup != nullptr && !channelGroup->IsFull()
+           && (channel = OpenNewChannel(channelGroup)) != nullptr) {
+      channels.push_back(std::make_pair(channelGroup, channel));
+    }
+  }
+  if (channels.empty()) {
+    return 0;
+  }
+  // the connections are set up by the pings, all at once
+  common::Waiter waiter(channels.size());
+  std::atomic<uint32_t> bad(0);
+  for (const auto& pair : channels) {
+    BrpcCheckerPingCall::Ping(pair.first, pair.second, &waiter, &bad);
+  }
+  waiter.Wait();
+  LOG(INFO) << "Warmed up " << channels.size() << " channels of "
+            << channelGroups.size() << " channel groups, " << bad.load()
+            << " bad";
+  return channels.size() - bad.load();
+}
+
+BRPCChannel* BrpcChannelPool::OpenNewChannel(BrpcChannelGroup* channelGroup) {
   // try take a slot by add null channel
   auto slot = channelGroup->AddChannel();
   if (slot == nullptr) {
     // all slots are taken
-    LOG(WARNING) << "channel group[" << spec << "] is full now.";
-    return;
+    DLOG(INFO) << "channel group[" << channelGroup->spec() << "] is full now.";
+    return nullptr;
   }
 
-  //brpc::ChannelArguments channel_arguments;
   auto channel = new brpc::Channel();
-  if (channel == nullptr) {
-    LOG(ERROR) << "Open channel failed, spec[" << spec << "].";
-    return;
-  }
   brpc::ChannelOptions options;
   options.connect_timeout_ms = build_conn_timeout_;
   options.timeout_ms = timeout_;
   options.max_retry = 3;
   options.protocol = "baidu_std";
-  options.connection_type = "single";
-  if (channel->Init(spec.c_str(), "", &options) != 0) {
-    LOG(ERROR) << "Failed to initialize channel";
-    return;
+  options.connection_type = connection_type_;
+  if (channel->Init(channelGroup->spec().c_str(), "", &options) != 0) {
+    LOG(ERROR) << "Failed to initialize channel, spec["
+               << channelGroup->spec() << "].";
+    delete channel;
+    return nullptr;
   }
-  
-  channel_lock_.wrlock();
-  channel_group_cache_[channel] = channelGroup;
-  channel_lock_.unlock();
 
   (*slot).reset(channel);
 
-  // do Ping now, we don't care about result.
-  // just use this to trigger MoveGood/Bad then set channel state.
-  BrpcPingCall::Ping(this, channel, spec);
-
-  DLOG(INFO) << "Open channel successfully spec:[" << spec << "] channel:" << channel;
+  DLOG(INFO) << "Open channel successfully spec:[" << channelGroup->spec()
+             << "] channel:" << channel;
+  return channel;
 }
 
 uint32_t BrpcChannelPool::GetLogicCpuNum() {
   return sysconf(_SC_NPROCESSORS_ONLN);
 }
 
-BrpcChannelGroup* BrpcChannelPool::FindChannelGroup(const std::string& spec,
-                                                    BRPCChannel* channel) {
-  BrpcChannelGroup* channelGroup = nullptr;
-  common::ScopedReadLock guard(channel_lock_);
-  auto iter = channel_group_cache_.find(channel);
-  CHECK(iter != channel_group_cache_.end()) << "channel is not found in channel_cache.";
-  channelGroup = iter->second;
-  
-  if (channelGroup == nullptr) {
-    LOG(ERROR) << "Find channel group " << spec << " failed";
-  }
-  return channelGroup;
-}
-
-void BrpcChannelPool::MoveFromGood2Bad(const std::string& spec,
-                                       BRPCChannel* channel) {
-  auto channelGroup = FindChannelGroup(spec, channel);
-  if (channelGroup == nullptr) {
-    return;
-  }
-  channelGroup->MoveChannelToBad(channel);
-}
-
-void BrpcChannelPool::MoveFromBad2Good(const std::string& spec,
-                                       BRPCChannel* channel) {
-  auto channelGroup = FindChannelGroup(spec, channel);
-  if (channelGroup == nullptr) {
-    return;
-  }
-  channelGroup->MoveChannelToGood(channel);
-}
-
 void BrpcChannelPool::CheckAndGetBadNodeSpecs(set<string>& blackList) {
   blackList.clear();
   channel_lock_.rdlock();
@@ -43,9 +43,36 @@ class BrpcChannelPool {
 
   BRPCChannel* GetChannel(const std::string& spec);
 
-  void MoveFromGood2Bad(const std::string& spec, BRPCChannel* channel);
+  /**
+   * @brief Get the channel group of spec, it's created if not found and
+   *        lives as long as the pool
+   * @param spec
+   * @return the channel group
+   */
+  BrpcChannelGroup* GetChannelGroup(const std::string& spec);
 
-  void MoveFromBad2Good(const std::string& spec, BRPCChannel* channel);
+  /**
+   * @brief Get a good channel of the group, it doesn't lock or open channels,
+   *        see WarmUp
+   * @param channelGroup got by GetChannelGroup
+   * @return nullptr if no good channel
+   */
+  BRPCChannel* GetChannel(BrpcChannelGroup* channelGroup);
+
+  /**
+   * @brief Set the connection type of the channels opened after it
+   * @param type "single" (default), "pooled" or "short", see brpc
+   * @return false if type is unknown
+   */
+  bool SetConnectionType(const std::string& type);
+
+  /**
+   * @brief Open all channels of the groups not full and ping them in
+   *        parallel, blocking until all pings are done
+   * @param channelGroups got by GetChannelGroup
+   * @return count of the channels opened and good
+   */
+  size_t WarmUp(const std::vector<BrpcChannelGroup*>& channelGroups);
 
   /**
    * @brief blocking check for bad nodes,
@@ -59,22 +86,21 @@ class BrpcChannelPool {
  private:
   uint32_t GetLogicCpuNum();
 
-  BrpcChannelGroup* FindChannelGroup(const std::string& spec,
-                                     BRPCChannel* channel);
-
-  void OpenNewChannel(const std::string& spec,
-                      BrpcChannelGroup* channelGroup);
+  /**
+   * @brief Open a channel in a free slot of the group, it's not pinged
+   * @return nullptr if the group is full or the channel fails to init
+   */
+  BRPCChannel* OpenNewChannel(BrpcChannelGroup* channelGroup);
 
   /// communicate timeout
   uint32_t timeout_;
   /// build connet timeout
   uint32_t build_conn_timeout_;
   uint32_t channel_count_;
+  std::string connection_type_;
 
   common::ReadWriteLock channel_lock_;
   mutable std::map<std::string, BrpcChannelGroup*> channel_pool_;
-  /// this object is used for increase channel group lookup speed
-  std::map<BRPCChannel*, BrpcChannelGroup*> channel_group_cache_;
 };
 
 }  // namespace leader
@@ -4,34 +4,101 @@
  */
 #include "leader/brpc/brpc_server_subscriber.h"
 
+#include <chrono>
+#include <set>
+
 #include "leader/node_collection_impl.h"
 #include "leader/brpc/brpc_bad_node_detector.h"
 #include "leader/brpc/brpc_call.h"
 
 namespace {
 const int GET_CHANNEL_RETRY_TIMES = 3;
+/// the wake up may be missed, so it's checked at least every interval
+const int WARM_UP_INTERVAL_MS = 100;
 }  // namespace
 
 namespace leader {
 
 BrpcServerSubscriber::BrpcServerSubscriber() :
     ServerSubscriber(),
-    channel_pool_(nullptr) { }
+    channel_pool_(nullptr),
+    warm_up_pending_(0) { }
 
 BrpcServerSubscriber::~BrpcServerSubscriber() {
+  // the channel groups resolved go with the pool
+  node_collection_->SetNodeResolver(nullptr);
+  StopWarmUp();
+}
+
+void BrpcServerSubscriber::Close() {
+  StopWarmUp();
+  ServerSubscriber::Close();
+}
+
+bool BrpcServerSubscriber::SetConnectionType(const std::string& type) {
+  if (channel_pool_ == nullptr) {
+    LOG(ERROR) << "Set connection type before Init";
+    return false;
+  }
+  return channel_pool_->SetConnectionType(type);
+}
+
+bool BrpcServerSubscriber::WaitWarmUp(uint32_t timeout) {
+  std::unique_lock<std::mutex> lock(warm_up_mutex_);
+  return warm_up_cv_.wait_for(lock, std::chrono::milliseconds(timeout),
+                              [this]() { return warm_up_pending_ == 0; });
+}
+
+void BrpcServerSubscriber::AddWarmUp(BrpcChannelGroup* channelGroup) {
+  {
+    std::lock_guard<std::mutex> guard(warm_up_mutex_);
+    if (!warm_up_queue_.insert(channelGroup).second) {
+      return;
+    }
+    warm_up_pending_++;
+  }
+  warm_up_running_.WakeUp();
+}
+
+void BrpcServerSubscriber::StopWarmUp() {
+  warm_up_running_.Stop();
+  if (warm_up_thread_.joinable()) {
+    warm_up_thread_.join();
+  }
+}
+
+BRPCChannel* BrpcServerSubscriber::GetChannel(const std::string& path,
+                                              std::shared_ptr<NodeStat>* stat) {
+  return DoGetChannel(path, nullptr, stat);
 }
 
-BRPCChannel* BrpcServerSubscriber::GetChannel(const std::string& path) {
-  std::string msg;
+BRPCChannel* BrpcServerSubscriber::GetChannelByKey(const std::string& path,
+                                                   uint64_t key,
+                                                   std::shared_ptr<NodeStat>* stat) {
+  return DoGetChannel(path, &key, stat);
+}
+
+BRPCChannel* BrpcServerSubscriber::DoGetChannel(const std::string& path,
+                                                const uint64_t* key,
+                                                std::shared_ptr<NodeStat>* stat) {
   for (uint32_t i = 0; i < GET_CHANNEL_RETRY_TIMES; i++) {
-    if (!node_collection_->PickOneNode(msg, path)) {
-      LOG(ERROR) << "No valid server spec for " << path;
+    auto channelGroup = static_cast<BrpcChannelGroup*>(
+        node_collection_->PickOneHandle(path, key, stat));
+    if (channelGroup == nullptr) {
+      LOG_EVERY_T(ERROR, 1) << "No valid server spec for " << path;
       return nullptr;
     }
-    BRPCChannel* channel = channel_pool_->GetChannel(msg);
+    BRPCChannel* channel = channel_pool_->GetChannel(channelGroup);
     if (channel != nullptr) {
       return channel;
     }
+    if (!channelGroup->IsFull()) {
+      // opened in the background, e.g. it failed to open on the warm up
+      AddWarmUp(channelGroup);
+    }
+  }
+  if (stat != nullptr) {
+    stat->reset();
   }
   return nullptr;
 }
@@ -46,6 +113,34 @@ bool BrpcServerSubscriber::SharedInitializer(uint32_t timeout,
     LOG(ERROR) << ("Init channel pool failed.");
     return false;
   }
+  // resolved once the nodes are published, so picking a channel is lock free,
+  // and the channels of the new nodes are opened before they're picked
+  node_collection_->SetNodeResolver([this](const std::string& node) {
+    auto channelGroup = channel_pool_->GetChannelGroup(node);
+    if (!channelGroup->IsFull()) {
+      AddWarmUp(channelGroup);
+    }
+    return static_cast<void*>(channelGroup);
+  });
+  warm_up_running_.Start();
+  warm_up_thread_ = std::thread([this]() {
+    while (warm_up_running_.IsRunning()) {
+      std::set<BrpcChannelGroup*> queue;
+      {
+        std::lock_guard<std::mutex> guard(warm_up_mutex_);
+        queue.swap(warm_up_queue_);
+      }
+      if (queue.empty()) {
+        warm_up_running_.Sleep(WARM_UP_INTERVAL_MS);
+        continue;
+      }
+      channel_pool_->WarmUp(std::vector<BrpcChannelGroup*>(queue.begin(),
+                                                           queue.end()));
+      std::lock_guard<std::mutex> guard(warm_up_mutex_);
+      warm_up_pending_ -= queue.size();
+      warm_up_cv_.notify_all();
+    }
+  });
   bad_node_detector_.reset(new BrpcBadNodeDetector(node_collection_.get(),
                                                    channel_pool_.get()));
   return true;
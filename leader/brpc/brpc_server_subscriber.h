@@ -5,6 +5,14 @@
 #ifndef LEADER_BRPC_BRPC_SERVER_SUBSCRIBER_H_
 #define LEADER_BRPC_BRPC_SERVER_SUBSCRIBER_H_
 
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "common/thread_running_checker.h"
+#include "leader/load_balancer.h"
 #include "leader/server_subscriber.h"
 #include "leader/brpc/brpc_channel_pool.h"
 
@@ -18,9 +26,43 @@ class BrpcServerSubscriber : public ServerSubscriber {
   /**
    * @brief Get RPC channel from listening path
    * @param path
+   * @param stat if not nullptr, set to the stat of the server picked, which
+   *        should be fed back by the call, see NodeStat
+   * @return nullptr if no matching channel found
+   */
+  BRPCChannel* GetChannel(const std::string& path,
+                          std::shared_ptr<NodeStat>* stat = nullptr);
+
+  /**
+   * @brief Get RPC channel of key from listening path, it's the channel of
+   *        the same server for the same key if the load balancer is "chash"
+   * @param path
+   * @param key e.g. id of the user or item
+   * @param stat same as GetChannel
    * @return nullptr if no matching channel found
    */
-  BRPCChannel* GetChannel(const std::string& path);
+  BRPCChannel* GetChannelByKey(const std::string& path,
+                               uint64_t key,
+                               std::shared_ptr<NodeStat>* stat = nullptr);
+
+  /**
+   * @brief Set the connection type of the channels, it's called after Init
+   *        and before AddPath
+   * @param type "single" (default), "pooled" or "short"
+   * @return false if type is unknown
+   */
+  bool SetConnectionType(const std::string& type);
+
+  /**
+   * @brief Wait until the channels of the servers got are warmed up, they're
+   *        warmed up in the background once the servers are got, and queued
+   *        before they're counted by GetServerCount
+   * @param timeout in milliseconds
+   * @return false if timeout
+   */
+  bool WaitWarmUp(uint32_t timeout);
+
+  void Close() override;
 
  protected:
   bool SharedInitializer(uint32_t timeout,
@@ -29,6 +71,28 @@ class BrpcServerSubscriber : public ServerSubscriber {
                          uint32_t channel_count) override;
 
   std::unique_ptr<BrpcChannelPool> channel_pool_;
+
+ private:
+  BRPCChannel* DoGetChannel(const std::string& path,
+                            const uint64_t* key,
+                            std::shared_ptr<NodeStat>* stat);
+
+  /**
+   * @brief Queue the group to be warmed up, called by the node resolver
+   */
+  void AddWarmUp(BrpcChannelGroup* channelGroup);
+
+  void StopWarmUp();
+
+  /// channels are opened off the request path, by this thread
+  std::thread warm_up_thread_;
+  common::ThreadRunningChecker warm_up_running_;
+  std::mutex warm_up_mutex_;
+  std::condition_variable warm_up_cv_;
+  /// a group is queued on every publish until it's full
+  std::set<BrpcChannelGroup*> warm_up_queue_;
+  /// queued or being warmed up
+  size_t warm_up_pending_;
 };
 
 }  // namespace leader
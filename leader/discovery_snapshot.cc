@@ -0,0 +1,102 @@
+/*!
+ * \file discovery_snapshot.cc
+ * \brief The nodes of the paths saved to a local file
+ */
+#include "leader/discovery_snapshot.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "common/logging.h"
+
+namespace {
+/// first line of the file, a file without it is not loaded
+const char SNAPSHOT_HEADER[] = "# leader discovery snapshot v1";
+}  // namespace
+
+namespace leader {
+
+DiscoverySnapshot::DiscoverySnapshot(const std::string& file)
+    : file_(file) { }
+
+bool DiscoverySnapshot::Load() {
+  std::ifstream input(file_);
+  if (!input) {
+    LOG(INFO) << "Discovery snapshot " << file_ << " not found";
+    return false;
+  }
+  std::string line;
+  if (!std::getline(input, line) || line != SNAPSHOT_HEADER) {
+    LOG(ERROR) << "Discovery snapshot " << file_ << " is corrupted";
+    return false;
+  }
+  // one path a line, followed by its nodes
+  std::map<std::string, std::vector<std::string>> paths;
+  while (std::getline(input, line)) {
+    std::istringstream stream(line);
+    std::string path, node;
+    if (!(stream >> path)) {
+      continue;
+    }
+    auto& nodes = paths[path];
+    while (stream >> node) {
+      nodes.push_back(node);
+    }
+  }
+  std::lock_guard<std::mutex> guard(mutex_);
+  paths_.swap(paths);
+  LOG(INFO) << "Loaded " << paths_.size() << " paths from discovery snapshot "
+            << file_;
+  return true;
+}
+
+bool DiscoverySnapshot::GetNodes(const std::string& path,
+                                 std::vector<std::string>* nodes) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto iter = paths_.find(path);
+  if (iter == paths_.end()) {
+    return false;
+  }
+  *nodes = iter->second;
+  return true;
+}
+
+bool DiscoverySnapshot::Update(const std::string& path,
+                               const std::vector<std::string>& nodes) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto iter = paths_.find(path);
+  if (iter != paths_.end() && iter->second == nodes) {
+    return true;
+  }
+  paths_[path] = nodes;
+  return SaveLocked();
+}
+
+bool DiscoverySnapshot::SaveLocked() {
+  // renamed once written, so the file is never seen half written
+  std::string temp = file_ + ".tmp";
+  {
+    std::ofstream output(temp, std::ios::trunc);
+    output << SNAPSHOT_HEADER << "\n";
+    for (const auto& pair : paths_) {
+      output << pair.first;
+      for (const auto& node : pair.second) {
+        output << " " << node;
+      }
+      output << "\n";
+    }
+    output.flush();
+    if (!output) {
+      LOG(ERROR) << "Write discovery snapshot " << temp << " failed";
+      return false;
+    }
+  }
+  if (std::rename(temp.c_str(), file_.c_str()) != 0) {
+    LOG(ERROR) << "Rename discovery snapshot " << temp << " failed";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace leader
@@ -0,0 +1,57 @@
+/*!
+ * \file discovery_snapshot.h
+ * \brief The nodes of the paths saved to a local file
+ */
+#ifndef LEADER_DISCOVERY_SNAPSHOT_H_
+#define LEADER_DISCOVERY_SNAPSHOT_H_
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace leader {
+
+/**
+ * @brief Nodes of the paths last known, saved to a local file so a process
+ *        restarting can serve before zk is reachable
+ */
+class DiscoverySnapshot {
+ public:
+  explicit DiscoverySnapshot(const std::string& file);
+
+  DiscoverySnapshot(const DiscoverySnapshot&) = delete;
+
+  DiscoverySnapshot& operator=(const DiscoverySnapshot&) = delete;
+
+  /**
+   * @brief Load the nodes saved in the file
+   * @return false if the file is not found or corrupted
+   */
+  bool Load();
+
+  /**
+   * @brief Get the nodes of path
+   * @return false if path is not found
+   */
+  bool GetNodes(const std::string& path, std::vector<std::string>* nodes);
+
+  /**
+   * @brief Update the nodes of path, the file is saved if they're changed
+   * @return false if the file failed to be saved
+   */
+  bool Update(const std::string& path, const std::vector<std::string>& nodes);
+
+  const std::string& file() const { return file_; }
+
+ private:
+  bool SaveLocked();
+
+  std::string file_;
+  std::mutex mutex_;
+  std::map<std::string, std::vector<std::string>> paths_;
+};
+
+}  // namespace leader
+
+#endif  // LEADER_DISCOVERY_SNAPSHOT_H_
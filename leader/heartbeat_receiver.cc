@@ -8,27 +8,25 @@
 #include <vector>
 #include <string>
 #include <mutex>
-#include <chrono>
 
 #include "common/logging.h"
 
 namespace leader {
 
 #define INVALID_CHILDVERSION  -1
-
-static uint64_t CurrentUTCEpoch() {
-  return std::chrono::duration_cast<std::chrono::milliseconds>(
-      std::chrono::system_clock::now().time_since_epoch()
-  ).count();
-}
-
 HeartbeatReceiver::HeartbeatReceiver()
     : zk_(nullptr), shared_zk_(false),
       node_collection_(nullptr), running_checker_(false),
-      heartbeat_interval_(0), skip_sleep_(false) {
+      heartbeat_interval_(0), skip_sleep_(false),
+      watch_context_(std::make_shared<WatchContext<HeartbeatReceiver>>()) {
+  watch_context_->owner = this;
 }
 
 HeartbeatReceiver::~HeartbeatReceiver() {
+  {
+    std::lock_guard<std::mutex> guard(watch_context_->mutex);
+    watch_context_->owner = nullptr;
+  }
   Close();
   if (!shared_zk_) {
     delete (zk_);
@@ -166,7 +164,8 @@ void HeartbeatReceiver::Close() {
 }
 
 void HeartbeatReceiver::Receive(const std::string& path,
-                                NodeStatus& node_status) {
+                                const std::shared_ptr<NodeStatus>& status_ptr) {
+  NodeStatus& node_status = *status_ptr;
   if (node_status.next_scan_time > CurrentUTCEpoch()) {
     return;
   }
@@ -191,6 +190,7 @@ void HeartbeatReceiver::Receive(const std::string& path,
         LOG(ERROR) << exception.what();
         return;
       }
+      ResetWatches();
       break;
   }
 
@@ -206,24 +206,66 @@ void HeartbeatReceiver::Receive(const std::string& path,
   }
   int32_t cversion = node_status.cversion;
   uint64_t next_scan_time = node_status.next_scan_time;
-  if (cversion == INVALID_CHILDVERSION || cversion != status.cversion) {
-    // New path or watcher triggered, need update children and re-register watcher
+  if (cversion == INVALID_CHILDVERSION || cversion != status.cversion
+      || !node_status.watching) {
+    // New path or watcher triggered, need update children and re-register watcher.
+    // A pending watcher isn't set twice, it's triggered once anyway.
     thread_local static std::vector<std::string> children;
-    rc = zk_->GetChildren(path, &children, &status, true);
+    bool watch = !node_status.watching.exchange(true);
+    if (watch) {
+      std::weak_ptr<NodeStatus> weakStatus = status_ptr;
+      auto context = watch_context_;
+      rc = zk_->GetChildren(path, &children,
+                            [weakStatus, context](ZKWrapper::ZKEvent event,
+                                                  ZKWrapper::ZKState state,
+                                                  const char* path) {
+                              auto nodeStatus = weakStatus.lock();
+                              if (nodeStatus == nullptr) {
+                                return;
+                              }
+                              nodeStatus->watching = false;
+                              if (nodeStatus->next_scan_time != UINT64_MAX) {
+                                nodeStatus->next_scan_time = 0;
+                              }
+                              std::lock_guard<std::mutex> guard(context->mutex);
+                              if (context->owner != nullptr) {
+                                context->owner->WakeUp();
+                              }
+                            },
+                            &status);
+    } else {
+      rc = zk_->GetChildren(path, &children, &status, false);
+    }
     if (rc != ZKWrapper::ZK_OK) {
       // unexpected error, recheck after next scan
+      if (watch) {
+        node_status.watching = false;
+      }
       LOG(ERROR) << "Get children failed:" << ZKWrapper::GetMessage(rc) << "("
                  << rc << ").";
       return;
     }
-    node_collection_->UpdateHeartbeat(children, path);
+    std::set<std::string> current(children.begin(), children.end());
+    if (cversion == INVALID_CHILDVERSION || current != node_status.children) {
+      size_t added = 0;
+      for (const auto& child : current) {
+        added += node_status.children.count(child) == 0 ? 1 : 0;
+      }
+      size_t removed = node_status.children.size() + added - current.size();
+      LOG(INFO) << path << " children updated, " << added << " added, "
+                << removed << " removed, " << current.size() << " in total";
+      node_collection_->UpdateHeartbeat(children, path);
+      node_status.children.swap(current);
+    }
     if (node_status.cversion.compare_exchange_strong(cversion,
                                                      status.cversion)) {
       // update success, cversion not changed during update,
-      // check again after 5 secs
+      // scan again after the safety net interval
       bool next_scan_time_changed = !node_status.next_scan_time
-          .compare_exchange_strong(next_scan_time,
-                                   CurrentUTCEpoch() + 5 * 1000);
+          .compare_exchange_strong(
+              next_scan_time,
+              CurrentUTCEpoch()
+                  + heartbeat_interval_ * SAFETY_NET_INTERVALS * 1000ULL);
       // if next scan time modified to not forever, watcher must be triggered
       // do skip sleep and rescan ASAP
       if (next_scan_time_changed
@@ -238,9 +280,23 @@ void HeartbeatReceiver::Receive(const std::string& path,
         skip_sleep_ = true;
       }
     }
+  } else if (node_status.next_scan_time != UINT64_MAX) {
+    // nothing missed, the watcher is still set
+    node_status.next_scan_time.compare_exchange_strong(
+        next_scan_time,
+        CurrentUTCEpoch() + heartbeat_interval_ * SAFETY_NET_INTERVALS * 1000ULL);
   }
 }
 
+void HeartbeatReceiver::ResetWatches() {
+  common::ScopedReadLock guard(paths_lock_);
+  for (const auto& pair : paths_) {
+    pair.second->watching = false;
+    pair.second->next_scan_time = 0;
+  }
+  skip_sleep_ = true;
+}
+
 bool HeartbeatReceiver::StartReceive() {
   if (running_checker_) {
     LOG(WARNING) << "Heartbeat Receive thread is already running.";
@@ -260,8 +316,13 @@ bool HeartbeatReceiver::StartReceive() {
           common::ScopedReadLock guard(paths_lock_);
           pathMap = paths_;
         }
+        // checked locally, the scans reconnect then
+        bool connected = zk_->GetState() == ZKWrapper::ZKSTATE_CONNECTED;
         for (const auto& pair : pathMap) {
-          Receive(pair.first, *pair.second);
+          if (!connected && pair.second->next_scan_time != UINT64_MAX) {
+            pair.second->next_scan_time = 0;
+          }
+          Receive(pair.first, pair.second);
         }
         auto skipSleep = skip_sleep_.exchange(false);
         if (skipSleep) {
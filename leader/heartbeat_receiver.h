@@ -6,6 +6,7 @@
 #define LEADER_HEARTBEAT_RECEIVER_H_
 
 #include <map>
+#include <set>
 #include <vector>
 #include <string>
 #include <memory>
@@ -14,13 +15,17 @@
 #include <atomic>
 
 #include "common/thread_running_checker.h"
+#include "leader/heartbeat_watch.h"
 #include "leader/node_collection_interface.h"
 #include "leader/zkwrapper.h"
 
 namespace leader {
 
 /**
- * @brief heartbeat receiver, detect heartbeats
+ * @brief heartbeat receiver, detect heartbeats. The children of a path are
+ *        watched by one-shot watchers and got again once changed, the scan
+ *        of every path is only a safety net every SAFETY_NET_INTERVALS
+ *        intervals, in case an event is missed.
  */
 class HeartbeatReceiver {
  public:
@@ -36,7 +41,8 @@ class HeartbeatReceiver {
    * @brief init receiver
    * @param host zk host address
    * @param nodeCollection node collection instance
-   * @param hbInterval interval between checks in seconds
+   * @param hbInterval interval between checks in seconds, a path unchanged is
+   *        scanned every SAFETY_NET_INTERVALS intervals only
    * @return true if success
    */
   bool Init(const std::string& host, NodeCollectionInterface* nodeCollection,
@@ -47,7 +53,8 @@ class HeartbeatReceiver {
    * @param zk shared zk object, receiver does not take ownership of this object,
    *           but global watcher will be set to a new one
    * @param nodeCollection node collection instance
-   * @param hbInterval interval between checks in seconds
+   * @param hbInterval interval between checks in seconds, a path unchanged is
+   *        scanned every SAFETY_NET_INTERVALS intervals only
    * @return true if success
    */
   bool Init(ZKWrapper* zk, NodeCollectionInterface* nodeCollection,
@@ -100,12 +107,24 @@ class HeartbeatReceiver {
 
   class NodeStatus {
    public:
-    NodeStatus(int32_t cversion) : cversion(cversion), next_scan_time(0) {}
+    NodeStatus(int32_t cversion)
+        : cversion(cversion), next_scan_time(0), watching(false) {}
     std::atomic<int32_t> cversion;
     std::atomic<uint64_t> next_scan_time;
+    /// a child watcher is set and not triggered yet
+    std::atomic<bool> watching;
+    /// children updated last time, only accessed by the receiving thread
+    std::set<std::string> children;
   };
 
-  void Receive(const std::string& path, NodeStatus& status);
+  void Receive(const std::string& path,
+               const std::shared_ptr<NodeStatus>& status);
+
+  /**
+   * @brief Rescan all paths and set the watchers again, the watchers of the
+   *        last session are gone
+   */
+  void ResetWatches();
 
   NodeCollectionInterface* node_collection_;
   ZKWrapper* zk_;
@@ -120,6 +139,7 @@ class HeartbeatReceiver {
   std::mutex update_lock_;
   std::thread heartbeat_thread_;
   uint32_t heartbeat_interval_;
+  std::shared_ptr<WatchContext<HeartbeatReceiver>> watch_context_;
 };
 
 }  // namespace leader
@@ -12,10 +12,17 @@
 namespace leader {
 
 HeartbeatReporter::HeartbeatReporter()
-    : zk_(nullptr), shared_zk_(false), heartbeat_interval_seconds_(0) { }
+    : zk_(nullptr), shared_zk_(false), heartbeat_interval_seconds_(0),
+      watch_context_(std::make_shared<WatchContext<HeartbeatReporter>>()) {
+  watch_context_->owner = this;
+}
 
 HeartbeatReporter::~HeartbeatReporter() {
   DLOG(INFO) << "Quit heartbeat.";
+  {
+    std::lock_guard<std::mutex> guard(watch_context_->mutex);
+    watch_context_->owner = nullptr;
+  }
   Close();
   if (!shared_zk_) {
     delete zk_;
@@ -80,9 +87,10 @@ void HeartbeatReporter::AddPathToReport(const std::string& p) {
     common::ScopedWriteLock guard(node_path_lock_);
     auto iter = node_path_map_.find(path);
     if (iter == node_path_map_.end()) {
-      node_path_map_[path] = std::make_shared<std::atomic<bool>>(false);
+      node_path_map_[path] = std::make_shared<ReportStatus>();
     } else {
-      *(iter->second) = false;
+      iter->second->force = false;
+      iter->second->next_check_time = 0;
     }
   }
   DLOG(INFO) << "Wake up to add " << path;
@@ -132,10 +140,37 @@ void HeartbeatReporter::RemovePath(const std::string& remove,
 }
 
 bool HeartbeatReporter::Report(const std::string& path,
-                               const std::shared_ptr<std::atomic<bool>>& force) {
+                               const std::shared_ptr<ReportStatus>& reportStatus) {
   ZKWrapper::ZKStatus status;
-  // call sync Exists first to make sure ZK init complete
-  auto rc = zk_->Exists(path, &status);
+  // call sync Exists first to make sure ZK init complete, and watch the node
+  // unless watched, the watcher is set even if the node doesn't exist
+  ZKWrapper::ZKCode rc;
+  bool watch = !reportStatus->watching.exchange(true);
+  if (watch) {
+    std::weak_ptr<ReportStatus> weakStatus = reportStatus;
+    auto context = watch_context_;
+    rc = zk_->Exists(path,
+                     [weakStatus, context](ZKWrapper::ZKEvent event,
+                                           ZKWrapper::ZKState state,
+                                           const char* path) {
+                       auto status = weakStatus.lock();
+                       if (status == nullptr) {
+                         return;
+                       }
+                       status->watching = false;
+                       status->next_check_time = 0;
+                       std::lock_guard<std::mutex> guard(context->mutex);
+                       if (context->owner != nullptr) {
+                         context->owner->WakeUp();
+                       }
+                     },
+                     &status);
+    if (rc != ZKWrapper::ZK_OK && rc != ZKWrapper::ZK_NONODE) {
+      reportStatus->watching = false;
+    }
+  } else {
+    rc = zk_->Exists(path, &status);
+  }
   switch (zk_->GetState()) {
     case
         ZKWrapper::ZKSTATE_CONNECTED:
@@ -157,6 +192,15 @@ bool HeartbeatReporter::Report(const std::string& path,
       LOG(ERROR) << exception.what();
       return false;
     }
+    // the watchers are gone with the last session
+    {
+      common::ScopedReadLock guard(node_path_lock_);
+      for (const auto& pair : node_path_map_) {
+        pair.second->watching = false;
+        pair.second->next_check_time = 0;
+      }
+    }
+    skip_sleep_ = true;
     break;
   }
   bool isNewSession = true;
@@ -176,7 +220,7 @@ bool HeartbeatReporter::Report(const std::string& path,
             << "(" << rc << ")";
       }
     } else {
-      if (!*force) {  // everything looks good, return if not forced
+      if (!reportStatus->force) {  // everything looks good, return if not forced
         return true;
       }
       isNewSession = false;
@@ -277,9 +321,23 @@ bool HeartbeatReporter::StartReport() {
                                               }
                                               });
                                   }
+                                  // checked locally, the reports reconnect then
+                                  bool connected = zk_->GetState() == ZKWrapper::ZKSTATE_CONNECTED;
+                                  uint64_t now = CurrentUTCEpoch();
                                   for (const auto& pair : pathMap) {
-                                    if(!Report(pair.first, pair.second)) {
-                                      pair.second->store(true);
+                                    const auto& reportStatus = pair.second;
+                                    if (connected && !reportStatus->force
+                                        && reportStatus->watching
+                                        && reportStatus->next_check_time > now) {
+                                      continue;
+                                    }
+                                    if (!Report(pair.first, reportStatus)) {
+                                      reportStatus->force = true;
+                                      reportStatus->next_check_time = 0;
+                                    } else {
+                                      reportStatus->force = false;
+                                      reportStatus->next_check_time =
+                                          now + heartbeat_interval_seconds_ * SAFETY_NET_INTERVALS * 1000ULL;
                                     }
                                   }
                                   if (!skip_sleep_) {
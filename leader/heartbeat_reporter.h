@@ -18,6 +18,7 @@
 #include "common/thread_running_checker.h"
 #include "common/lock.h"
 #include "heartbeat_message.pb.h"
+#include "leader/heartbeat_watch.h"
 #include "leader/zkwrapper.h"
 
 namespace leader {
@@ -25,7 +26,10 @@ namespace leader {
 using std::shared_ptr;
 
 /**
- * @brief Heartbeat reporter, can report to multiple path
+ * @brief Heartbeat reporter, can report to multiple path. The nodes are
+ *        ephemeral, kept alive by the zk session and watched by one-shot
+ *        watchers, so they are only checked again once changed, the session
+ *        is lost, or every SAFETY_NET_INTERVALS intervals as a safety net.
  */
 class HeartbeatReporter {
  public:
@@ -88,14 +92,23 @@ class HeartbeatReporter {
 
   bool StopReport();
 
+  struct ReportStatus {
+    ReportStatus() : force(false), watching(false), next_check_time(0) {}
+    /// set the node again even if it exists
+    std::atomic<bool> force;
+    /// a watcher of the node is set and not triggered yet
+    std::atomic<bool> watching;
+    std::atomic<uint64_t> next_check_time;
+  };
+
   bool Report(const std::string& path,
-              const shared_ptr<std::atomic<bool>>& force);
+              const shared_ptr<ReportStatus>& reportStatus);
 
   HeartbeatMessage heartbeat_message_;
 
   common::ReadWriteLock node_path_lock_;
-  /// path : force report
-  std::map<std::string, shared_ptr<std::atomic<bool>>> node_path_map_;
+  /// path : report status
+  std::map<std::string, shared_ptr<ReportStatus>> node_path_map_;
   std::mutex node_path_removed_mutex_;
   std::map<std::string, shared_ptr<std::pair<shared_ptr<std::promise<void>>,
       std::shared_future<void>>>>
@@ -108,6 +121,7 @@ class HeartbeatReporter {
   std::thread heartbeat_thread_;
   std::atomic<bool> skip_sleep_;
   common::ThreadRunningChecker running_checker_;
+  std::shared_ptr<WatchContext<HeartbeatReporter>> watch_context_;
 };
 
 }  // namespace leader
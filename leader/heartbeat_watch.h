@@ -0,0 +1,37 @@
+/*!
+ * \file heartbeat_watch.h
+ * \brief Helpers shared by the watchers of heartbeat reporter and receiver
+ */
+#ifndef LEADER_HEARTBEAT_WATCH_H_
+#define LEADER_HEARTBEAT_WATCH_H_
+
+#include <stdint.h>
+#include <chrono>
+#include <mutex>
+
+namespace leader {
+
+/// nodes and paths are checked every this many heartbeat intervals besides
+/// the watchers
+#define SAFETY_NET_INTERVALS  12
+
+inline uint64_t CurrentUTCEpoch() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::system_clock::now().time_since_epoch()
+  ).count();
+}
+
+/**
+ * @brief Shared with the watchers, which may be triggered after the owner is
+ *        gone, the owner is reset under the mutex once destructed
+ */
+template<typename T>
+struct WatchContext {
+  WatchContext() : owner(nullptr) {}
+  std::mutex mutex;
+  T* owner;
+};
+
+}  // namespace leader
+
+#endif  // LEADER_HEARTBEAT_WATCH_H_
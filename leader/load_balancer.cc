@@ -0,0 +1,263 @@
+/*!
+ * \file load_balancer.cc
+ * \brief The load balancers picking a node of a path
+ */
+#include "leader/load_balancer.h"
+
+#include <algorithm>
+
+namespace leader {
+
+namespace {
+
+/// weight of the previous samples is 7/8
+const int64_t EWMA_SHIFT = 3;
+/// so the nodes of no sample yet are not flooded
+const int64_t MIN_SCORE_US = 100;
+/// the smooth schedule is at most this long
+const uint64_t MAX_SCHEDULE_SIZE = 4096;
+/// virtual nodes of weight 1 on the ring
+const uint32_t VIRTUAL_NODES = 100;
+/// the ring has at most this many virtual nodes
+const uint64_t MAX_RING_SIZE = 1 << 20;
+/// a node takes at most 125% of the average in-flight calls, unless it's
+/// the only one
+const uint64_t LOAD_FACTOR_PERCENT = 125;
+
+/// fmix64 of murmurhash3, so the close keys are spread over the ring
+uint64_t Mix(uint64_t key) {
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  key *= 0xc4ceb9fe1a85ec53ULL;
+  key ^= key >> 33;
+  return key;
+}
+
+/// FNV-1a, it's the same in all processes so they route a key to the same node
+uint64_t Hash(const std::string& text) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (unsigned char c : text) {
+    hash ^= c;
+    hash *= 0x100000001b3ULL;
+  }
+  return Mix(hash);
+}
+
+uint64_t FastRand() {
+  thread_local uint64_t seed =
+      reinterpret_cast<uint64_t>(&seed) ^ 0x9E3779B97F4A7C15ULL;
+  // xorshift64*
+  seed ^= seed >> 12;
+  seed ^= seed << 25;
+  seed ^= seed >> 27;
+  return seed * 0x2545F4914F6CDD1DULL;
+}
+
+class RoundRobinBalancer : public LoadBalancer {
+ public:
+  RoundRobinBalancer() : index_(0) {}
+
+  size_t Pick(const NodeSnapshot& snapshot) override {
+    return index_.fetch_add(1, std::memory_order_relaxed) % snapshot.nodes.size();
+  }
+
+ private:
+  std::atomic<uint64_t> index_;
+};
+
+class WeightedRoundRobinBalancer : public LoadBalancer {
+ public:
+  WeightedRoundRobinBalancer() : index_(0) {}
+
+  /**
+   * @brief Smooth weighted round robin, e.g. weights {5, 1, 1} are picked as
+   *        {a, a, b, a, c, a, a}, not {a, a, a, a, a, b, c}
+   */
+  void Prepare(NodeSnapshot* snapshot) override {
+    std::vector<uint64_t> weights;
+    uint64_t total = 0;
+    for (auto weight : snapshot->weights) {
+      weights.push_back(std::max<uint32_t>(weight, 1));
+      total += weights.back();
+    }
+    // Scaled down if too long, the light nodes keep one turn at least.
+    if (total > MAX_SCHEDULE_SIZE) {
+      uint64_t scaled = 0;
+      for (auto& weight : weights) {
+        weight = std::max<uint64_t>(weight * MAX_SCHEDULE_SIZE / total, 1);
+        scaled += weight;
+      }
+      total = scaled;
+    }
+
+    std::vector<int64_t> current(weights.size(), 0);
+    snapshot->schedule.reserve(total);
+    for (uint64_t i = 0; i < total; ++i) {
+      size_t best = 0;
+      for (size_t j = 0; j < weights.size(); ++j) {
+        current[j] += weights[j];
+        if (current[j] > current[best]) {
+          best = j;
+        }
+      }
+      current[best] -= total;
+      snapshot->schedule.push_back(best);
+    }
+  }
+
+  size_t Pick(const NodeSnapshot& snapshot) override {
+    const auto& schedule = snapshot.schedule;
+    if (schedule.empty()) {
+      return index_.fetch_add(1, std::memory_order_relaxed) % snapshot.nodes.size();
+    }
+    return schedule[index_.fetch_add(1, std::memory_order_relaxed) % schedule.size()];
+  }
+
+ private:
+  std::atomic<uint64_t> index_;
+};
+
+class P2CBalancer : public LoadBalancer {
+ public:
+  size_t Pick(const NodeSnapshot& snapshot) override {
+    size_t size = snapshot.nodes.size();
+    if (size == 1) {
+      return 0;
+    }
+    uint64_t rand = FastRand();
+    size_t a = rand % size;
+    // another one, never the same
+    size_t b = (a + 1 + (rand >> 32) % (size - 1)) % size;
+    return snapshot.stats[a]->Score() <= snapshot.stats[b]->Score() ? a : b;
+  }
+};
+
+/**
+ * @brief Consistent hashing over a ring of virtual nodes, so only the keys of
+ *        the nodes added or removed are moved. The node of a key is skipped
+ *        for the next one on the ring if it's overloaded, i.e. consistent
+ *        hashing with bounded loads.
+ */
+class ConsistentHashBalancer : public LoadBalancer {
+ public:
+  ConsistentHashBalancer() : index_(0) {}
+
+  void Prepare(NodeSnapshot* snapshot) override {
+    uint64_t total = 0;
+    for (auto weight : snapshot->weights) {
+      total += std::max<uint32_t>(weight, 1) * VIRTUAL_NODES;
+    }
+    uint64_t scale = (total + MAX_RING_SIZE - 1) / MAX_RING_SIZE;
+
+    auto& ring = snapshot->ring;
+    for (size_t i = 0; i < snapshot->nodes.size(); i++) {
+      uint64_t count = std::max<uint64_t>(
+          std::max<uint32_t>(snapshot->weights[i], 1) * VIRTUAL_NODES / scale, 1);
+      // the points of a node depend on its spec only
+      uint64_t hash = Hash(snapshot->nodes[i]);
+      for (uint64_t j = 0; j < count; j++) {
+        ring.emplace_back(Mix(hash + j), i);
+      }
+    }
+    std::sort(ring.begin(), ring.end());
+  }
+
+  size_t Pick(const NodeSnapshot& snapshot) override {
+    return index_.fetch_add(1, std::memory_order_relaxed) % snapshot.nodes.size();
+  }
+
+  size_t Pick(const NodeSnapshot& snapshot, uint64_t key) override {
+    const auto& ring = snapshot.ring;
+    size_t size = snapshot.nodes.size();
+    if (ring.empty() || size == 1) {
+      return ring.empty() ? Pick(snapshot) : ring[0].second;
+    }
+
+    uint64_t inFlight = 0;
+    for (const auto& stat : snapshot.stats) {
+      inFlight += std::max(stat->in_flight(), 0);
+    }
+    // ceil(c * (m + 1) / n), m is the in-flight calls, n is the nodes
+    uint64_t capacity =
+        (LOAD_FACTOR_PERCENT * (inFlight + 1) + 100 * size - 1) / (100 * size);
+
+    auto iter = std::lower_bound(ring.begin(), ring.end(),
+                                 std::make_pair(Mix(key), uint32_t(0)));
+    size_t start = iter - ring.begin();
+    for (size_t i = 0; i < ring.size(); i++) {
+      uint32_t index = ring[(start + i) % ring.size()].second;
+      if (static_cast<uint64_t>(std::max(snapshot.stats[index]->in_flight(), 0)) < capacity) {
+        return index;
+      }
+    }
+    return ring[start % ring.size()].second;
+  }
+
+ private:
+  std::atomic<uint64_t> index_;
+};
+
+}  // namespace
+
+NodeStat::NodeStat()
+    : ewma_us_(0),
+      in_flight_(0),
+      calls_(0),
+      failures_(0),
+      consecutive_failures_(0) { }
+
+void NodeStat::Start() {
+  in_flight_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void NodeStat::Done(int64_t latency_us, bool failed) {
+  in_flight_.fetch_sub(1, std::memory_order_relaxed);
+  if (latency_us < 0) {
+    return;
+  }
+  calls_.fetch_add(1, std::memory_order_relaxed);
+  if (failed) {
+    failures_.fetch_add(1, std::memory_order_relaxed);
+    consecutive_failures_.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    consecutive_failures_.store(0, std::memory_order_relaxed);
+  }
+  // Lost updates under races are fine, it's an estimate.
+  int64_t ewma = ewma_us_.load(std::memory_order_relaxed);
+  if (failed) {
+    latency_us = std::max(latency_us, 2 * ewma);
+  }
+  if (ewma == 0) {
+    ewma = std::max<int64_t>(latency_us, 1);
+  } else {
+    ewma += (latency_us - ewma) >> EWMA_SHIFT;
+  }
+  ewma_us_.store(std::max<int64_t>(ewma, 1), std::memory_order_relaxed);
+}
+
+uint64_t NodeStat::Score() const {
+  int32_t inFlight = std::max(in_flight(), 0);
+  return static_cast<uint64_t>(ewma_us() + MIN_SCORE_US) * (inFlight + 1);
+}
+
+void NodeStat::TakeWindow(uint32_t* calls, uint32_t* failures) {
+  // failures first, so they never outnumber the calls
+  *failures = failures_.exchange(0, std::memory_order_relaxed);
+  *calls = std::max(calls_.exchange(0, std::memory_order_relaxed), *failures);
+}
+
+std::unique_ptr<LoadBalancer> LoadBalancer::Create(const std::string& name) {
+  if (name == "rr") {
+    return std::unique_ptr<LoadBalancer>(new RoundRobinBalancer());
+  } else if (name == "wrr") {
+    return std::unique_ptr<LoadBalancer>(new WeightedRoundRobinBalancer());
+  } else if (name == "p2c") {
+    return std::unique_ptr<LoadBalancer>(new P2CBalancer());
+  } else if (name == "chash") {
+    return std::unique_ptr<LoadBalancer>(new ConsistentHashBalancer());
+  }
+  return nullptr;
+}
+
+}  // namespace leader
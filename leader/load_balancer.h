@@ -0,0 +1,122 @@
+/*!
+ * \file load_balancer.h
+ * \brief The load balancers picking a node of a path
+ */
+#ifndef LEADER_LOAD_BALANCER_H_
+#define LEADER_LOAD_BALANCER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace leader {
+
+/**
+ * @brief Load of a node, fed back by the calls on it
+ */
+class NodeStat {
+ public:
+  NodeStat();
+
+  NodeStat(const NodeStat&) = delete;
+
+  NodeStat& operator=(const NodeStat&) = delete;
+
+  /**
+   * @brief A call is sent to the node
+   */
+  void Start();
+
+  /**
+   * @brief The call is done
+   * @param latency_us negative if the call is canceled, it's not sampled then
+   * @param failed the failed calls are sampled as twice the average at least
+   */
+  void Done(int64_t latency_us, bool failed);
+
+  /**
+   * @brief The smaller, the more preferred
+   */
+  uint64_t Score() const;
+
+  /**
+   * @brief Take the calls done since the last time, for outlier detection
+   * @param calls the calls not canceled
+   * @param failures the failed ones of calls
+   */
+  void TakeWindow(uint32_t* calls, uint32_t* failures);
+
+  int64_t ewma_us() const { return ewma_us_.load(std::memory_order_relaxed); }
+  int32_t in_flight() const { return in_flight_.load(std::memory_order_relaxed); }
+  uint32_t consecutive_failures() const {
+    return consecutive_failures_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  /// 0 before the first sample
+  std::atomic<int64_t> ewma_us_;
+  std::atomic<int32_t> in_flight_;
+  std::atomic<uint32_t> calls_;
+  std::atomic<uint32_t> failures_;
+  /// reset by a successful call
+  std::atomic<uint32_t> consecutive_failures_;
+};
+
+/**
+ * @brief Immutable nodes of a path, replaced as a whole on updates
+ */
+struct NodeSnapshot {
+  std::vector<std::string> nodes;
+  std::vector<std::shared_ptr<NodeStat>> stats;
+  std::vector<uint32_t> weights;
+  /// objects resolved for nodes, e.g. the channel groups, nullptr if not
+  /// resolved
+  std::vector<void*> handles;
+  /// indexes of nodes in the order of picking, for the weighted balancer
+  std::vector<uint32_t> schedule;
+  /// hashes of the virtual nodes to indexes of nodes, sorted by hash, for
+  /// the consistent hashing balancer
+  std::vector<std::pair<uint64_t, uint32_t>> ring;
+};
+
+/**
+ * @brief Picks a node of the snapshot, it's called concurrently
+ */
+class LoadBalancer {
+ public:
+  virtual ~LoadBalancer() {}
+
+  /**
+   * @brief Create the balancer by name
+   * @param name "rr", "wrr" (weighted round robin), "p2c" (power of two
+   *        choices over the latency and in-flight calls) or "chash"
+   *        (consistent hashing with bounded load)
+   * @return nullptr if name is unknown
+   */
+  static std::unique_ptr<LoadBalancer> Create(const std::string& name);
+
+  /**
+   * @brief Prepare the snapshot before it's published
+   */
+  virtual void Prepare(NodeSnapshot* snapshot) {}
+
+  /**
+   * @brief Pick one of the nodes, the snapshot is never empty
+   * @return index of the node
+   */
+  virtual size_t Pick(const NodeSnapshot& snapshot) = 0;
+
+  /**
+   * @brief Pick the node of key, the same one for the same key if the
+   *        balancer hashes by key, otherwise key is ignored
+   */
+  virtual size_t Pick(const NodeSnapshot& snapshot, uint64_t key) {
+    return Pick(snapshot);
+  }
+};
+
+}  // namespace leader
+
+#endif  // LEADER_LOAD_BALANCER_H_
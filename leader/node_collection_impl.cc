@@ -4,28 +4,31 @@
  */
 #include "leader/node_collection_impl.h"
 
+#include <algorithm>
 #include <set>
 #include <map>
 #include <vector>
 #include <string>
+#include <memory>
 
 #include "leader/heartbeat_message_helper.h"
 #include "common/logging.h"
 
 namespace leader {
 
+NodeCollectionImpl::NodeCollectionImpl()
+    : path_map_(std::make_shared<const PathMap>()),
+      balancer_name_("rr"),
+      listener_seq_(0),
+      listener_done_(0) { }
+
 NodeCollectionImpl::~NodeCollectionImpl() {
-  round_robin_map_lock_.wrlock();
-  for (const auto& pair : round_robin_index_map_) {
-    delete pair.second;
-  }
-  round_robin_map_lock_.unlock();
 }
 
 void NodeCollectionImpl::UpdateHeartbeat(const std::vector<std::string>& nodes,
                                          const std::string& path) {
   auto validNodes = std::make_shared<std::vector<std::string>>();
-  std::lock_guard<std::mutex> updateLock(update_mutex_);
+  std::unique_lock<std::mutex> updateLock(update_mutex_);
   for (const auto& node : nodes) {
     if (black_list_.find(node) == black_list_.end()) {
       validNodes->push_back(node);
@@ -45,13 +48,23 @@ void NodeCollectionImpl::UpdateHeartbeat(const std::vector<std::string>& nodes,
     }
     valid_nodes_[path] = validNodes;
   }
-  {
-    common::ScopedWriteLock writeLock(round_robin_map_lock_);
-    if (round_robin_index_map_.find(path) == round_robin_index_map_.end()) {
-      round_robin_index_map_.insert(std::make_pair(path,
-                                                   new RoundRobinIndex()));
-    }
+  PublishLocked({path});
+  if (!listener_) {
+    return;
   }
+  // e.g. the snapshot file is written, not blocking the other updates, but
+  // the listeners are called in the order of the updates
+  auto listener = listener_;
+  auto seq = ++listener_seq_;
+  updateLock.unlock();
+  std::unique_lock<std::mutex> listenerLock(listener_mutex_);
+  listener_cv_.wait(listenerLock,
+                    [this, seq]() { return listener_done_ + 1 == seq; });
+  listenerLock.unlock();
+  listener(path, nodes);
+  listenerLock.lock();
+  listener_done_ = seq;
+  listener_cv_.notify_all();
 }
 
 void NodeCollectionImpl::RemovePath(const std::string& path) {
@@ -67,17 +80,8 @@ void NodeCollectionImpl::RemovePath(const std::string& path) {
   if (removePaths.empty()) {
     return;
   }
-  round_robin_map_lock_.wrlock();
-  for (const auto& remove : removePaths) {
-    auto iter = round_robin_index_map_.find(remove);
-    if (iter == round_robin_index_map_.end()) {
-      LOG(WARNING) << remove << "not found in index map";
-      continue;
-    }
-    delete iter->second;
-    round_robin_index_map_.erase(iter);
-  }
-  round_robin_map_lock_.unlock();
+  UnpublishLocked(std::vector<std::string>(removePaths.begin(),
+                                           removePaths.end()));
 
   std::vector<std::string> removedNodes;
   common::ScopedWriteLock guard(node_lock_);
@@ -120,17 +124,8 @@ void NodeCollectionImpl::RemovePath(const std::vector<std::string>& paths) {
   if (removePaths.empty()) {
     return;
   }
-  round_robin_map_lock_.wrlock();
-  for (const auto& remove : removePaths) {
-    auto iter = round_robin_index_map_.find(remove);
-    if (iter == round_robin_index_map_.end()) {
-      LOG(WARNING) << remove << "not found in index map";
-      continue;
-    }
-    delete iter->second;
-    round_robin_index_map_.erase(iter);
-  }
-  round_robin_map_lock_.unlock();
+  UnpublishLocked(std::vector<std::string>(removePaths.begin(),
+                                           removePaths.end()));
 
   std::vector<std::string> removedNodes;
   common::ScopedWriteLock guard(node_lock_);
@@ -186,6 +181,7 @@ void NodeCollectionImpl::UpdateBadNode(std::set<std::string>& blackList) {
     }
     nodes_iindex_.erase(ii);
   }
+  PublishLocked({});
 }
 
 void NodeCollectionImpl::FindNodesBySpec(const std::set<std::string>& specLists,
@@ -199,37 +195,247 @@ void NodeCollectionImpl::FindNodesBySpec(const std::set<std::string>& specLists,
   }
 }
 
-size_t NodeCollectionImpl::RoundRobinIndex::next(size_t base) {
-  std::lock_guard<std::mutex> guard(mutex_);
-  index_ = (index_ + 1) % base;
-  return index_;
+bool NodeCollectionImpl::PickOneNode(std::string& node,
+                                     const std::string& path) {
+  return PickOneNode(node, path, nullptr);
 }
 
 bool NodeCollectionImpl::PickOneNode(std::string& node,
-                                     const std::string& path) {
-  common::ScopedReadLock rrmGuard(round_robin_map_lock_);
-  auto rri = round_robin_index_map_.find(path);
-  if (rri == round_robin_index_map_.end()) {
-    LOG(ERROR) << "Path: " << path << " not added";
+                                     const std::string& path,
+                                     std::shared_ptr<NodeStat>* stat) {
+  size_t index = 0;
+  auto snapshot = DoPickOneNode(path, nullptr, &index);
+  if (snapshot == nullptr) {
     return false;
   }
-  common::ScopedReadLock guard(node_lock_);
-  auto iValid = valid_nodes_.find(path);
-  if (iValid == valid_nodes_.end() || iValid->second->empty()) {
-    LOG(ERROR) << "Path: " << path << " iValid is empty";
+  node = snapshot->nodes[index];
+  if (stat != nullptr) {
+    *stat = snapshot->stats[index];
+  }
+  return true;
+}
+
+bool NodeCollectionImpl::PickOneNodeByKey(std::string& node,
+                                          const std::string& path,
+                                          uint64_t key,
+                                          std::shared_ptr<NodeStat>* stat) {
+  size_t index = 0;
+  auto snapshot = DoPickOneNode(path, &key, &index);
+  if (snapshot == nullptr) {
+    return false;
+  }
+  node = snapshot->nodes[index];
+  if (stat != nullptr) {
+    *stat = snapshot->stats[index];
+  }
+  return true;
+}
+
+void* NodeCollectionImpl::PickOneHandle(const std::string& path,
+                                        const uint64_t* key,
+                                        std::shared_ptr<NodeStat>* stat) {
+  size_t index = 0;
+  auto snapshot = DoPickOneNode(path, key, &index);
+  if (snapshot == nullptr || snapshot->handles[index] == nullptr) {
+    return nullptr;
+  }
+  if (stat != nullptr) {
+    *stat = snapshot->stats[index];
+  }
+  return snapshot->handles[index];
+}
+
+std::shared_ptr<const NodeSnapshot> NodeCollectionImpl::DoPickOneNode(
+    const std::string& path, const uint64_t* key, size_t* index) {
+  auto pathMap = std::atomic_load(&path_map_);
+  auto iter = pathMap->find(path);
+  if (iter == pathMap->end()) {
+    LOG_EVERY_T(ERROR, 1) << "Path: " << path << " not added";
+    return nullptr;
+  }
+  const PathState& state = *iter->second;
+  const NodeSnapshot& snapshot = *state.snapshot;
+  if (snapshot.nodes.empty()) {
+    LOG_EVERY_T(ERROR, 1) << "Path: " << path << " iValid is empty";
+    return nullptr;
+  }
+  *index = key == nullptr ? state.balancer->Pick(snapshot)
+                          : state.balancer->Pick(snapshot, *key);
+  return state.snapshot;
+}
+
+void NodeCollectionImpl::DetectOutliers(OutlierDetector* detector,
+                                        int64_t now_us,
+                                        const std::vector<std::string>& paths) {
+  std::lock_guard<std::mutex> updateLock(update_mutex_);
+  std::vector<std::string> detected;
+  std::vector<OutlierDetector::NodeGroup> groups;
+  for (const auto& pair : valid_nodes_) {
+    if (!paths.empty()
+        && std::find(paths.begin(), paths.end(), pair.first) == paths.end()) {
+      continue;
+    }
+    detected.push_back(pair.first);
+    groups.emplace_back();
+    for (const auto& node : *pair.second) {
+      auto iter = stats_.find(node);
+      groups.back().emplace_back(
+          node, iter == stats_.end() ? nullptr : iter->second.lock());
+    }
+  }
+  auto ejected = detector->Detect(groups, now_us);
+  std::vector<std::string> changed;
+  for (const auto& path : detected) {
+    auto& pathEjected = ejected_[path];
+    if (pathEjected != ejected) {
+      pathEjected = ejected;
+      changed.push_back(path);
+    }
+  }
+  if (!changed.empty()) {
+    PublishLocked(changed);
+  }
+}
+
+void NodeCollectionImpl::SetUpdateListener(const UpdateListener& listener) {
+  std::lock_guard<std::mutex> updateLock(update_mutex_);
+  listener_ = listener;
+}
+
+void NodeCollectionImpl::SetNodeResolver(const NodeResolver& resolver) {
+  std::lock_guard<std::mutex> updateLock(update_mutex_);
+  resolver_ = resolver;
+  PublishLocked({});
+}
+
+bool NodeCollectionImpl::SetLoadBalancer(const std::string& name) {
+  if (LoadBalancer::Create(name) == nullptr) {
+    LOG(ERROR) << "Unknown load balancer: " << name;
     return false;
   }
-  node = iValid->second->at(rri->second->next(iValid->second->size()));
+  std::lock_guard<std::mutex> updateLock(update_mutex_);
+  balancer_name_ = name;
+  PublishLocked({}, true);
   return true;
 }
 
+bool NodeCollectionImpl::SetLoadBalancer(const std::string& path,
+                                         const std::string& name) {
+  if (LoadBalancer::Create(name) == nullptr) {
+    LOG(ERROR) << "Unknown load balancer: " << name;
+    return false;
+  }
+  std::lock_guard<std::mutex> updateLock(update_mutex_);
+  path_balancer_names_[path] = name;
+  PublishLocked({path}, true);
+  return true;
+}
+
+void NodeCollectionImpl::SetNodeWeights(
+    const std::map<std::string, uint32_t>& weights) {
+  std::lock_guard<std::mutex> updateLock(update_mutex_);
+  weights_ = weights;
+  PublishLocked({});
+}
+
+void NodeCollectionImpl::SetNodeWeights(
+    const std::string& path,
+    const std::map<std::string, uint32_t>& weights) {
+  std::lock_guard<std::mutex> updateLock(update_mutex_);
+  path_weights_[path] = weights;
+  PublishLocked({path});
+}
+
+void NodeCollectionImpl::PublishLocked(const std::vector<std::string>& paths,
+                                       bool renew_balancer) {
+  // copy on write, the pickers keep reading the old one
+  auto pathMap = std::make_shared<PathMap>(*std::atomic_load(&path_map_));
+  std::vector<std::string> allPaths;
+  if (paths.empty()) {
+    for (const auto& pair : valid_nodes_) {
+      allPaths.push_back(pair.first);
+    }
+  }
+  for (const auto& path : paths.empty() ? allPaths : paths) {
+    auto iValid = valid_nodes_.find(path);
+    if (iValid == valid_nodes_.end()) {
+      continue;
+    }
+    auto state = std::make_shared<PathState>();
+    auto old = pathMap->find(path);
+    if (old != pathMap->end() && !renew_balancer) {
+      state->balancer = old->second->balancer;
+    } else {
+      auto name = path_balancer_names_.find(path);
+      state->balancer = LoadBalancer::Create(
+          name == path_balancer_names_.end() ? balancer_name_ : name->second);
+    }
+    auto pathWeights = path_weights_.find(path);
+    const auto& weights = pathWeights == path_weights_.end()
+        ? weights_ : pathWeights->second;
+
+    // all of them if all are ejected, the detector keeps some anyway
+    const auto* nodes = iValid->second.get();
+    std::vector<std::string> kept;
+    auto ejected = ejected_.find(path);
+    if (ejected != ejected_.end() && !ejected->second.empty()) {
+      for (const auto& node : *nodes) {
+        if (ejected->second.find(node) == ejected->second.end()) {
+          kept.push_back(node);
+        }
+      }
+      if (!kept.empty()) {
+        nodes = &kept;
+      }
+    }
+
+    auto snapshot = std::make_shared<NodeSnapshot>();
+    for (const auto& node : *nodes) {
+      auto& weakStat = stats_[node];
+      auto stat = weakStat.lock();
+      if (stat == nullptr) {
+        stat = std::make_shared<NodeStat>();
+        weakStat = stat;
+      }
+      auto weight = weights.find(node);
+      snapshot->nodes.push_back(node);
+      snapshot->stats.push_back(stat);
+      snapshot->weights.push_back(weight == weights.end() ? 1 : weight->second);
+      snapshot->handles.push_back(resolver_ ? resolver_(node) : nullptr);
+    }
+    state->balancer->Prepare(snapshot.get());
+    state->snapshot = snapshot;
+    (*pathMap)[path] = state;
+  }
+  std::atomic_store(&path_map_, std::shared_ptr<const PathMap>(pathMap));
+
+  for (auto iter = stats_.begin(); iter != stats_.end();) {
+    if (iter->second.expired()) {
+      iter = stats_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+}
+
+void NodeCollectionImpl::UnpublishLocked(const std::vector<std::string>& paths) {
+  auto pathMap = std::make_shared<PathMap>(*std::atomic_load(&path_map_));
+  for (const auto& path : paths) {
+    if (pathMap->erase(path) == 0) {
+      LOG(WARNING) << path << " not found in path map";
+    }
+    ejected_.erase(path);
+  }
+  std::atomic_store(&path_map_, std::shared_ptr<const PathMap>(pathMap));
+}
+
 size_t NodeCollectionImpl::GetNodeCount(const std::string& path) {
-  common::ScopedReadLock guard(node_lock_);
-  auto iValid = valid_nodes_.find(path);
-  if (iValid == valid_nodes_.end()) {
+  auto pathMap = std::atomic_load(&path_map_);
+  auto iter = pathMap->find(path);
+  if (iter == pathMap->end()) {
     return 0;
   }
-  return iValid->second->size();
+  return iter->second->snapshot->nodes.size();
 }
 
 }  // namespace leader
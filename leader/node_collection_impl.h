@@ -5,13 +5,17 @@
 #ifndef LEADER_NODE_COLLECTION_IMPL_H_
 #define LEADER_NODE_COLLECTION_IMPL_H_
 
+#include <condition_variable>
 #include <string>
+#include <functional>
 #include <map>
 #include <set>
 #include <vector>
 #include <mutex>
 #include <memory>
 
+#include "leader/load_balancer.h"
+#include "leader/outlier_detector.h"
 #include "leader/node_collection_interface.h"
 #include "common/lock.h"
 
@@ -19,7 +23,7 @@ namespace leader {
 
 class NodeCollectionImpl : public NodeCollectionInterface {
  public:
-  NodeCollectionImpl() = default;
+  NodeCollectionImpl();
 
   ~NodeCollectionImpl() override;
 
@@ -38,6 +42,104 @@ class NodeCollectionImpl : public NodeCollectionInterface {
 
   bool PickOneNode(std::string& node, const std::string& path) override;
 
+  /**
+   * @brief Pick one node of path, it doesn't lock
+   * @param stat if not nullptr, set to the stat of the node picked, which
+   *        should be fed back by the call
+   * @return false if no valid node
+   */
+  bool PickOneNode(std::string& node,
+                   const std::string& path,
+                   std::shared_ptr<NodeStat>* stat);
+
+  /**
+   * @brief Pick the node of key, it's the same one for the same key unless
+   *        the nodes change or it's overloaded, if the balancer is "chash"
+   * @param key e.g. id of the user or item
+   * @param stat same as PickOneNode
+   * @return false if no valid node
+   */
+  bool PickOneNodeByKey(std::string& node,
+                        const std::string& path,
+                        uint64_t key,
+                        std::shared_ptr<NodeStat>* stat);
+
+  /**
+   * @brief Pick one node of path without copying its spec, it doesn't lock
+   * @param key nullptr if not picked by key, see PickOneNodeByKey
+   * @param stat same as PickOneNode
+   * @return the handle resolved for the node, nullptr if no valid node or
+   *         it's not resolved
+   */
+  void* PickOneHandle(const std::string& path,
+                      const uint64_t* key,
+                      std::shared_ptr<NodeStat>* stat);
+
+  /**
+   * @brief Resolves a node spec to the handle of it, e.g. its channel group,
+   *        it's called on publishing under the update lock, not on picking
+   */
+  typedef std::function<void*(const std::string& node)> NodeResolver;
+
+  /**
+   * @brief Set the resolver of the nodes of all paths, the handles must live
+   *        until the resolver is reset
+   */
+  void SetNodeResolver(const NodeResolver& resolver);
+
+  /**
+   * @brief Called with the nodes of path once updated by heartbeat, before the
+   *        bad nodes are excluded, in the order of the updates but not under
+   *        the update lock, so it must not call UpdateHeartbeat
+   */
+  typedef std::function<void(const std::string& path,
+                             const std::vector<std::string>& nodes)>
+      UpdateListener;
+
+  void SetUpdateListener(const UpdateListener& listener);
+
+  /**
+   * @brief Set the balancer of the paths without their own, "rr" by default
+   * @param name see LoadBalancer::Create
+   * @return false if name is unknown
+   */
+  bool SetLoadBalancer(const std::string& name);
+
+  /**
+   * @brief Set the balancer of path, it's kept if path is removed
+   * @param name see LoadBalancer::Create
+   * @return false if name is unknown
+   */
+  bool SetLoadBalancer(const std::string& path, const std::string& name);
+
+  /**
+   * @brief Set weights of the nodes of the paths without their own for "wrr",
+   *        1 if not set
+   * @param weights node spec to weight
+   */
+  void SetNodeWeights(const std::map<std::string, uint32_t>& weights);
+
+  /**
+   * @brief Set weights of the nodes of path, see SetNodeWeights
+   */
+  void SetNodeWeights(const std::string& path,
+                      const std::map<std::string, uint32_t>& weights);
+
+  /**
+   * @brief Evaluate the calls on the nodes of paths by detector, the outliers
+   *        are not picked from the paths until they're back, but the nodes of
+   *        the bad node detector are excluded first, see UpdateBadNode
+   * @param detector called under the update lock
+   * @param now_us monotonic time
+   * @param paths all paths if empty
+   */
+  void DetectOutliers(OutlierDetector* detector, int64_t now_us,
+                      const std::vector<std::string>& paths = {});
+
+  /**
+   * @brief Count the nodes of path published, which are resolved already,
+   *        it doesn't lock
+   */
   size_t GetNodeCount(const std::string& path) override;
 
   /**
@@ -53,6 +155,15 @@ class NodeCollectionImpl : public NodeCollectionInterface {
   void RemovePath(const std::vector<std::string>& path) override;
 
  private:
+  /**
+   * @param key nullptr if not picked by key
+   * @param index set to the index of the node picked
+   * @return the snapshot picked from, nullptr if no valid node
+   */
+  std::shared_ptr<const NodeSnapshot> DoPickOneNode(const std::string& path,
+                                                    const uint64_t* key,
+                                                    size_t* index);
+
   common::ReadWriteLock node_lock_;
   std::mutex update_mutex_;
 
@@ -62,16 +173,46 @@ class NodeCollectionImpl : public NodeCollectionInterface {
   std::map<std::string, std::shared_ptr<std::vector<std::string>>>
       valid_nodes_;
 
-  class RoundRobinIndex {
-   public:
-    size_t next(size_t base);
-   private:
-    std::mutex mutex_;
-    size_t index_;
+  /**
+   * @brief Nodes of a path and its balancer, immutable once published
+   */
+  struct PathState {
+    std::shared_ptr<const NodeSnapshot> snapshot;
+    std::shared_ptr<LoadBalancer> balancer;
   };
-  // only implement round robin lb for now
-  mutable std::map<std::string, RoundRobinIndex*> round_robin_index_map_;
-  common::ReadWriteLock round_robin_map_lock_;
+  typedef std::map<std::string, std::shared_ptr<const PathState>> PathMap;
+
+  /**
+   * @brief Publish the valid nodes of paths, update_mutex_ should be held
+   * @param paths all paths if empty
+   * @param renew_balancer replace the balancers of the paths
+   */
+  void PublishLocked(const std::vector<std::string>& paths,
+                     bool renew_balancer = false);
+
+  /**
+   * @brief Unpublish paths, update_mutex_ should be held
+   */
+  void UnpublishLocked(const std::vector<std::string>& paths);
+
+  /// updated under update_mutex_, read by atomic_load
+  std::shared_ptr<const PathMap> path_map_;
+  std::string balancer_name_;
+  std::map<std::string, uint32_t> weights_;
+  /// of the paths with their own
+  std::map<std::string, std::string> path_balancer_names_;
+  std::map<std::string, std::map<std::string, uint32_t>> path_weights_;
+  NodeResolver resolver_;
+  UpdateListener listener_;
+  /// the listener calls are numbered under update_mutex_, and called in order
+  uint64_t listener_seq_;
+  std::mutex listener_mutex_;
+  std::condition_variable listener_cv_;
+  uint64_t listener_done_;
+  /// outliers of the live calls of every path, not published
+  std::map<std::string, std::set<std::string>> ejected_;
+  /// kept while any snapshot refers to the node, so the stats survive updates
+  std::map<std::string, std::weak_ptr<NodeStat>> stats_;
 };
 
 }  // namespace leader
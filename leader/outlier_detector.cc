@@ -0,0 +1,156 @@
+/*!
+ * \file outlier_detector.cc
+ * \brief The outlier detector ejecting nodes by the outcomes of live calls
+ */
+#include "leader/outlier_detector.h"
+
+#include <algorithm>
+
+#include "common/logging.h"
+
+namespace {
+/// the latency isn't compared with fewer peers
+const size_t MIN_LATENCY_PEERS = 3;
+/// the backoff stops doubling after it
+const uint32_t MAX_BACKOFF_SHIFT = 20;
+}  // namespace
+
+namespace leader {
+
+OutlierDetector::OutlierDetector(const Option& option)
+    : option_(option) { }
+
+std::set<std::string> OutlierDetector::Detect(
+    const std::vector<NodeGroup>& groups, int64_t now_us) {
+  struct Sample {
+    const std::string* node;
+    NodeState* state;
+    uint32_t calls;
+    uint32_t failures;
+    uint32_t consecutiveFailures;
+    int64_t ewmaUs;
+  };
+
+  std::set<std::string> ejected;
+  std::set<std::string> seen;
+  for (const auto& group : groups) {
+    std::vector<Sample> samples;
+    std::vector<int64_t> latencies;
+    size_t ejectedCount = 0;
+    for (const auto& pair : group) {
+      seen.insert(pair.first);
+      auto& state = states_[pair.first];
+      if (state.ejected_until_us != 0) {
+        if (now_us < state.ejected_until_us) {
+          ejectedCount++;
+          continue;
+        }
+        // half-open, it's in rotation again from the next publish
+        state.ejected_until_us = 0;
+        state.decay_at_us = now_us + option_.base_ejection_ms * 1000LL;
+        state.probing = true;
+        LOG(INFO) << "Node " << pair.first << " is back from ejection";
+        // the calls done while ejected, e.g. the hedges, aren't probes
+        if (pair.second != nullptr) {
+          uint32_t calls, failures;
+          pair.second->TakeWindow(&calls, &failures);
+        }
+        continue;
+      }
+      if (pair.second == nullptr) {
+        continue;
+      }
+      Sample sample;
+      sample.node = &pair.first;
+      sample.state = &state;
+      pair.second->TakeWindow(&sample.calls, &sample.failures);
+      sample.consecutiveFailures = pair.second->consecutive_failures();
+      sample.ewmaUs = pair.second->ewma_us();
+      samples.push_back(sample);
+      if (sample.calls >= option_.min_calls && sample.ewmaUs > 0) {
+        latencies.push_back(sample.ewmaUs);
+      }
+    }
+
+    int64_t medianUs = 0;
+    if (latencies.size() >= MIN_LATENCY_PEERS) {
+      auto middle = latencies.begin() + latencies.size() / 2;
+      std::nth_element(latencies.begin(), middle, latencies.end());
+      medianUs = *middle;
+    }
+    size_t maxEjected = group.size() * option_.max_ejection_percent / 100;
+    for (auto& sample : samples) {
+      auto& state = *sample.state;
+      if (!IsOutlier(state, sample.calls, sample.failures,
+                     sample.consecutiveFailures, sample.ewmaUs, medianUs)) {
+        if (sample.calls > 0) {
+          state.probing = false;
+        }
+        if (!state.probing && state.ejections > 0 && now_us >= state.decay_at_us) {
+          state.ejections--;
+          state.decay_at_us = now_us + option_.base_ejection_ms * 1000LL;
+        }
+        continue;
+      }
+      if (ejectedCount >= maxEjected) {
+        LOG_EVERY_T(WARNING, 1) << "Outlier " << *sample.node
+                                << " is kept, too many nodes ejected";
+        continue;
+      }
+      Eject(*sample.node, &state, now_us);
+      ejectedCount++;
+    }
+  }
+
+  for (auto iter = states_.begin(); iter != states_.end();) {
+    if (seen.find(iter->first) == seen.end()) {
+      iter = states_.erase(iter);
+      continue;
+    }
+    if (iter->second.ejected_until_us != 0) {
+      ejected.insert(iter->first);
+    }
+    ++iter;
+  }
+  return ejected;
+}
+
+bool OutlierDetector::IsOutlier(const NodeState& state,
+                                uint32_t calls,
+                                uint32_t failures,
+                                uint32_t consecutiveFailures,
+                                int64_t ewmaUs,
+                                int64_t medianUs) const {
+  if (state.probing) {
+    return failures > 0;
+  }
+  if (option_.consecutive_failures > 0
+      && consecutiveFailures >= option_.consecutive_failures) {
+    return true;
+  }
+  if (calls < option_.min_calls) {
+    return false;
+  }
+  if (option_.failure_rate_percent > 0
+      && static_cast<uint64_t>(failures) * 100
+          >= static_cast<uint64_t>(calls) * option_.failure_rate_percent) {
+    return true;
+  }
+  return option_.latency_factor_percent > 0 && medianUs > 0
+      && ewmaUs * 100 > medianUs * option_.latency_factor_percent;
+}
+
+void OutlierDetector::Eject(const std::string& node,
+                            NodeState* state,
+                            int64_t now_us) {
+  uint32_t shift = std::min(state->ejections, MAX_BACKOFF_SHIFT);
+  int64_t ejectionMs = std::min<int64_t>(
+      static_cast<int64_t>(option_.base_ejection_ms) << shift,
+      option_.max_ejection_ms);
+  state->ejections++;
+  state->ejected_until_us = now_us + ejectionMs * 1000;
+  state->probing = false;
+  LOG(WARNING) << "Eject node " << node << " for " << ejectionMs << "ms";
+}
+
+}  // namespace leader
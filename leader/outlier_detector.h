@@ -0,0 +1,108 @@
+/*!
+ * \file outlier_detector.h
+ * \brief The outlier detector ejecting nodes by the outcomes of live calls
+ */
+#ifndef LEADER_OUTLIER_DETECTOR_H_
+#define LEADER_OUTLIER_DETECTOR_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "leader/load_balancer.h"
+
+namespace leader {
+
+/**
+ * @brief Ejects the nodes failing or much slower than their peers on the live
+ *        calls, which the pings of the bad node detector may not catch. An
+ *        ejected node is back after a backoff doubled on every ejection, and
+ *        it's ejected again on its first failure then, i.e. half-open.
+ */
+class OutlierDetector {
+ public:
+  struct Option {
+    Option()
+        : interval_ms(1000),
+          consecutive_failures(5),
+          failure_rate_percent(50),
+          min_calls(20),
+          latency_factor_percent(300),
+          base_ejection_ms(10000),
+          max_ejection_ms(300000),
+          max_ejection_percent(50) { }
+
+    /// how often the calls are evaluated
+    uint32_t interval_ms;
+    /// 0 to disable
+    uint32_t consecutive_failures;
+    /// of the calls in an interval, 0 to disable
+    uint32_t failure_rate_percent;
+    /// calls in an interval for the failure rate and the latency
+    uint32_t min_calls;
+    /// of the median latency of peers, 0 to disable
+    uint32_t latency_factor_percent;
+    uint32_t base_ejection_ms;
+    uint32_t max_ejection_ms;
+    /// of the nodes of a path, the others are kept even if they're outliers
+    uint32_t max_ejection_percent;
+  };
+
+  /// nodes of a path and their stats, nullptr if not in rotation
+  typedef std::vector<std::pair<std::string, std::shared_ptr<NodeStat>>>
+      NodeGroup;
+
+  explicit OutlierDetector(const Option& option);
+
+  OutlierDetector(const OutlierDetector&) = delete;
+
+  OutlierDetector& operator=(const OutlierDetector&) = delete;
+
+  /**
+   * @brief Evaluate the calls done since the last time, it's not thread safe
+   * @param groups nodes of every path
+   * @param now_us monotonic time
+   * @return all nodes ejected now
+   */
+  std::set<std::string> Detect(const std::vector<NodeGroup>& groups,
+                               int64_t now_us);
+
+  const Option& option() const { return option_; }
+
+ private:
+  struct NodeState {
+    NodeState()
+        : ejections(0), ejected_until_us(0), decay_at_us(0), probing(false) { }
+
+    /// times ejected, decayed by one every base_ejection_ms being healthy
+    uint32_t ejections;
+    /// 0 if not ejected
+    int64_t ejected_until_us;
+    int64_t decay_at_us;
+    /// back from an ejection, not healthy yet
+    bool probing;
+  };
+
+  /**
+   * @return true if the node should be ejected
+   */
+  bool IsOutlier(const NodeState& state,
+                 uint32_t calls,
+                 uint32_t failures,
+                 uint32_t consecutiveFailures,
+                 int64_t ewmaUs,
+                 int64_t medianUs) const;
+
+  void Eject(const std::string& node, NodeState* state, int64_t now_us);
+
+  Option option_;
+  std::map<std::string, NodeState> states_;
+};
+
+}  // namespace leader
+
+#endif  // LEADER_OUTLIER_DETECTOR_H_
@@ -7,6 +7,8 @@
 #include "leader/node_collection_impl.h"
 #include "leader/bad_node_detector.h"
 
+#include <algorithm>
+#include <chrono>
 #include <vector>
 #include <string>
 
@@ -14,10 +16,20 @@ namespace leader {
 
 const int GET_CHANNEL_RETRY_TIMES = 3;
 
+namespace {
+
+int64_t MonotonicUs() {
+  auto now = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+}
+
+}  // namespace
+
 ServerSubscriber::ServerSubscriber()
-    : bad_node_detector_(nullptr),
-    node_collection_(new NodeCollectionImpl()),
-    heartbeat_receiver_(new HeartbeatReceiver()) { }
+    : node_collection_(new NodeCollectionImpl()),
+    bad_node_detector_(nullptr),
+    heartbeat_receiver_(new HeartbeatReceiver()),
+    started_(false) { }
 
 ServerSubscriber::~ServerSubscriber() {
   Close();
@@ -29,10 +41,53 @@ bool ServerSubscriber::Start() {
   }
   bad_node_detector_->StartDetect();
   heartbeat_receiver_->StartReceive();
+  std::lock_guard<std::mutex> guard(outlier_mutex_);
+  started_ = true;
+  if (!outlier_detectors_.empty()) {
+    StartOutlierDetectionLocked();
+  }
   return true;
 }
 
+void ServerSubscriber::StartOutlierDetectionLocked() {
+  if (outlier_running_) {
+    return;
+  }
+  outlier_running_.Start();
+  outlier_thread_ = std::thread([this]() { DetectOutliers(); });
+}
+
+void ServerSubscriber::DetectOutliers() {
+  while (outlier_running_.IsRunning()) {
+    auto now = MonotonicUs();
+    // woken up by a detector enabled then
+    int64_t next = now + 1000 * 1000;
+    {
+      std::lock_guard<std::mutex> guard(outlier_mutex_);
+      for (auto& pair : outlier_detectors_) {
+        auto& detector = pair.second;
+        if (detector.next_detect_us <= now) {
+          node_collection_->DetectOutliers(detector.detector.get(), now,
+                                           {pair.first});
+          detector.next_detect_us =
+              now + detector.detector->option().interval_ms * 1000LL;
+        }
+        next = std::min(next, detector.next_detect_us);
+      }
+    }
+    outlier_running_.Sleep(static_cast<int>((next - now + 999) / 1000));
+  }
+}
+
 void ServerSubscriber::Close() {
+  {
+    std::lock_guard<std::mutex> guard(outlier_mutex_);
+    started_ = false;
+  }
+  outlier_running_.Stop();
+  if (outlier_thread_.joinable()) {
+    outlier_thread_.join();
+  }
   heartbeat_receiver_->Close();
   if (bad_node_detector_ != nullptr) {
     bad_node_detector_->StopDetect();
@@ -66,25 +121,112 @@ bool ServerSubscriber::Init(ZKWrapper* zk,
 }
 
 void ServerSubscriber::AddPath(const std::string& path) {
+  ServeSnapshot({path});
   heartbeat_receiver_->AddPath(path);
 }
 
 void ServerSubscriber::AddPaths(const std::vector<std::string>& paths) {
+  ServeSnapshot(paths);
   heartbeat_receiver_->AddPaths(paths);
 }
 
 void ServerSubscriber::RemovePath(const std::string& path) {
-  heartbeat_receiver_->RemovePath(path);
-  node_collection_->RemovePath(path);
+  RemovePath(std::vector<std::string>({path}));
 }
 
 void ServerSubscriber::RemovePath(const std::vector<std::string>& paths) {
   heartbeat_receiver_->RemovePath(paths);
   node_collection_->RemovePath(paths);
+  std::lock_guard<std::mutex> guard(snapshot_mutex_);
+  for (const auto& path : paths) {
+    for (auto iter = added_paths_.lower_bound(path);
+         iter != added_paths_.end()
+             && iter->compare(0, path.size(), path) == 0;) {
+      if (iter->size() == path.size() || (*iter)[path.size()] == '/') {
+        iter = added_paths_.erase(iter);
+      } else {
+        ++iter;
+      }
+    }
+  }
+}
+
+bool ServerSubscriber::SetSnapshotFile(const std::string& file) {
+  std::unique_ptr<DiscoverySnapshot> snapshot(new DiscoverySnapshot(file));
+  bool loaded = snapshot->Load();
+  auto snapshotPtr = snapshot.get();
+  {
+    std::lock_guard<std::mutex> guard(snapshot_mutex_);
+    if (snapshot_ != nullptr) {
+      LOG(ERROR) << "Snapshot file is already set to " << snapshot_->file();
+      return false;
+    }
+    snapshot_ = std::move(snapshot);
+  }
+  node_collection_->SetUpdateListener(
+      [snapshotPtr](const std::string& path,
+                    const std::vector<std::string>& nodes) {
+        snapshotPtr->Update(path, nodes);
+      });
+  return loaded;
+}
+
+void ServerSubscriber::ServeSnapshot(const std::vector<std::string>& paths) {
+  std::vector<std::pair<std::string, std::vector<std::string>>> served;
+  {
+    std::lock_guard<std::mutex> guard(snapshot_mutex_);
+    for (const auto& path : paths) {
+      // the nodes got from zk may be there already
+      if (!added_paths_.insert(path).second || snapshot_ == nullptr) {
+        continue;
+      }
+      std::vector<std::string> nodes;
+      if (snapshot_->GetNodes(path, &nodes)) {
+        served.emplace_back(path, nodes);
+      }
+    }
+  }
+  // not under snapshot_mutex_, the update listener may be called
+  for (const auto& pair : served) {
+    LOG(INFO) << "Serve " << pair.first << " by " << pair.second.size()
+              << " nodes of the snapshot";
+    node_collection_->UpdateHeartbeat(pair.second, pair.first);
+  }
 }
 
 size_t ServerSubscriber::GetServerCount(const std::string& path) {
   return node_collection_->GetNodeCount(path);
 }
 
+bool ServerSubscriber::SetLoadBalancer(const std::string& name) {
+  return node_collection_->SetLoadBalancer(name);
+}
+
+bool ServerSubscriber::SetLoadBalancer(const std::string& path,
+                                       const std::string& name) {
+  return node_collection_->SetLoadBalancer(path, name);
+}
+
+void ServerSubscriber::EnableOutlierDetection(
+    const std::string& path, const OutlierDetector::Option& option) {
+  std::lock_guard<std::mutex> guard(outlier_mutex_);
+  auto& detector = outlier_detectors_[path];
+  detector.detector.reset(new OutlierDetector(option));
+  detector.next_detect_us = MonotonicUs() + option.interval_ms * 1000LL;
+  if (started_) {
+    StartOutlierDetectionLocked();
+    outlier_running_.WakeUp();
+  }
+}
+
+void ServerSubscriber::SetServerWeights(
+    const std::map<std::string, uint32_t>& weights) {
+  node_collection_->SetNodeWeights(weights);
+}
+
+void ServerSubscriber::SetServerWeights(
+    const std::string& path, const std::map<std::string, uint32_t>& weights) {
+  node_collection_->SetNodeWeights(path, weights);
+}
+
 }  // namespace leader
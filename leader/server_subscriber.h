@@ -1,10 +1,18 @@
 #ifndef LEADER_SERVER_SUBSCRIBER_H_
 #define LEADER_SERVER_SUBSCRIBER_H_
 
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
 #include <string>
 #include <vector>
 #include <memory>
+#include <thread>
 
+#include "common/thread_running_checker.h"
+#include "leader/discovery_snapshot.h"
+#include "leader/outlier_detector.h"
 #include "leader/zkwrapper.h"
 
 namespace leader {
@@ -94,6 +102,56 @@ class ServerSubscriber {
    */
   size_t GetServerCount(const std::string& path);
 
+  /**
+   * @brief Set the load balancer of the paths without their own, "rr" by
+   *        default
+   * @param name "rr", "wrr", "p2c" or "chash"
+   * @return false if name is unknown
+   */
+  bool SetLoadBalancer(const std::string& name);
+
+  /**
+   * @brief Set the load balancer of path, e.g. the paths of the users sharing
+   *        the subscriber have their own
+   * @param path
+   * @param name same as SetLoadBalancer
+   * @return false if name is unknown
+   */
+  bool SetLoadBalancer(const std::string& path, const std::string& name);
+
+  /**
+   * @brief Set weights of the servers of the paths without their own for
+   *        "wrr", 1 if not set
+   * @param weights server spec to weight
+   */
+  void SetServerWeights(const std::map<std::string, uint32_t>& weights);
+
+  /**
+   * @brief Set weights of the servers of path, see SetServerWeights
+   */
+  void SetServerWeights(const std::string& path,
+                        const std::map<std::string, uint32_t>& weights);
+
+  /**
+   * @brief Eject the servers of path failing or slow on the live calls, which
+   *        should be fed back to the stats of the channels picked, see
+   *        GetChannel of the subscribers. It replaces the option of path, and
+   *        it can be called after Start.
+   * @param path
+   * @param option
+   */
+  void EnableOutlierDetection(const std::string& path,
+                              const OutlierDetector::Option& option);
+
+  /**
+   * @brief Serve the paths added by the nodes saved in file until they're
+   *        got from zk, and save the nodes got to it. It's called before
+   *        AddPath.
+   * @param file
+   * @return false if the file is not loaded, the nodes are still saved to it
+   */
+  bool SetSnapshotFile(const std::string& file);
+
  protected:
   virtual bool SharedInitializer(uint32_t timeout,
                                  int32_t work_thread_num,
@@ -103,6 +161,34 @@ class ServerSubscriber {
   std::unique_ptr<NodeCollectionImpl> node_collection_;
   std::unique_ptr<BadNodeDetector> bad_node_detector_;
   std::unique_ptr<HeartbeatReceiver> heartbeat_receiver_;
+
+ private:
+  struct PathOutlierDetector {
+    std::unique_ptr<OutlierDetector> detector;
+    /// monotonic time
+    int64_t next_detect_us;
+  };
+
+  /**
+   * @brief Start the thread detecting the outliers of the paths enabled,
+   *        outlier_mutex_ should be held
+   */
+  void StartOutlierDetectionLocked();
+
+  void DetectOutliers();
+
+  std::mutex outlier_mutex_;
+  /// path : detector
+  std::map<std::string, PathOutlierDetector> outlier_detectors_;
+  bool started_;
+  std::thread outlier_thread_;
+  common::ThreadRunningChecker outlier_running_;
+  std::unique_ptr<DiscoverySnapshot> snapshot_;
+  std::mutex snapshot_mutex_;
+  /// paths added, which are not served by the snapshot again
+  std::set<std::string> added_paths_;
+
+  void ServeSnapshot(const std::vector<std::string>& paths);
 };
 
 }  // namespace leader
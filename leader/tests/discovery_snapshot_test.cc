@@ -0,0 +1,101 @@
+#include <unistd.h>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "leader/discovery_snapshot.h"
+#include "leader/node_collection_impl.h"
+#include "common/logging.h"
+#define GTEST_HAS_TR1_TUPLE 0
+#define GTEST_USE_OWN_TR1_TUPLE 0
+#include "gtest/gtest.h"
+
+using namespace leader;
+
+namespace {
+
+std::string SnapshotFile(const std::string& name) {
+  return "/tmp/discovery_snapshot_test." + std::to_string(getpid()) + "." + name;
+}
+
+}  // namespace
+
+TEST(DiscoverySnapshotTest, SaveLoadTest) {
+  auto file = SnapshotFile("save");
+  {
+    DiscoverySnapshot snapshot(file);
+    EXPECT_FALSE(snapshot.Load());
+    EXPECT_TRUE(snapshot.Update("/a", {"a:1", "a:2"}));
+    EXPECT_TRUE(snapshot.Update("/b", {}));
+  }
+
+  DiscoverySnapshot snapshot(file);
+  EXPECT_TRUE(snapshot.Load());
+  std::vector<std::string> nodes;
+  EXPECT_TRUE(snapshot.GetNodes("/a", &nodes));
+  EXPECT_EQ((std::vector<std::string>{"a:1", "a:2"}), nodes);
+  EXPECT_TRUE(snapshot.GetNodes("/b", &nodes));
+  EXPECT_TRUE(nodes.empty());
+  EXPECT_FALSE(snapshot.GetNodes("/c", &nodes));
+  unlink(file.c_str());
+}
+
+TEST(DiscoverySnapshotTest, CorruptedTest) {
+  auto file = SnapshotFile("corrupted");
+  {
+    std::ofstream output(file);
+    output << "/a a:1\n";
+  }
+  DiscoverySnapshot snapshot(file);
+  EXPECT_FALSE(snapshot.Load());
+  std::vector<std::string> nodes;
+  EXPECT_FALSE(snapshot.GetNodes("/a", &nodes));
+  unlink(file.c_str());
+}
+
+TEST(DiscoverySnapshotTest, UnchangedTest) {
+  auto file = SnapshotFile("unchanged");
+  DiscoverySnapshot snapshot(file);
+  EXPECT_TRUE(snapshot.Update("/a", {"a:1"}));
+  unlink(file.c_str());
+
+  // not saved again if the nodes are the same
+  EXPECT_TRUE(snapshot.Update("/a", {"a:1"}));
+  EXPECT_NE(0, access(file.c_str(), F_OK));
+  EXPECT_TRUE(snapshot.Update("/a", {"a:2"}));
+  EXPECT_EQ(0, access(file.c_str(), F_OK));
+  unlink(file.c_str());
+}
+
+TEST(DiscoverySnapshotTest, UpdateListenerTest) {
+  auto file = SnapshotFile("listener");
+  DiscoverySnapshot snapshot(file);
+  NodeCollectionImpl collection;
+  collection.SetUpdateListener(
+      [&snapshot](const std::string& path, const std::vector<std::string>& nodes) {
+        snapshot.Update(path, nodes);
+      });
+  collection.UpdateHeartbeat({"a:1", "a:2"}, "/a");
+
+  DiscoverySnapshot loaded(file);
+  EXPECT_TRUE(loaded.Load());
+  std::vector<std::string> nodes;
+  EXPECT_TRUE(loaded.GetNodes("/a", &nodes));
+  EXPECT_EQ(2u, nodes.size());
+  unlink(file.c_str());
+}
+
+TEST(DiscoverySnapshotTest, UpdateListenerUnlockedTest) {
+  NodeCollectionImpl collection;
+  std::vector<std::string> updated;
+  // not called under the update lock, the collection can be set by it
+  collection.SetUpdateListener(
+      [&collection, &updated](const std::string& path,
+                              const std::vector<std::string>& nodes) {
+        collection.SetNodeWeights(path, {{nodes.front(), 2}});
+        updated.push_back(path);
+      });
+  collection.UpdateHeartbeat({"a:1"}, "/a");
+  collection.UpdateHeartbeat({"b:1"}, "/b");
+  EXPECT_EQ((std::vector<std::string>{"/a", "/b"}), updated);
+  EXPECT_EQ(1u, collection.GetNodeCount("/b"));
+}
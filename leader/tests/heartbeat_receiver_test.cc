@@ -0,0 +1,185 @@
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "leader/heartbeat_receiver.h"
+#include "leader/node_collection_impl.h"
+#include "common/logging.h"
+#define GTEST_HAS_TR1_TUPLE 0
+#define GTEST_USE_OWN_TR1_TUPLE 0
+#include "gtest/gtest.h"
+
+using namespace leader;
+
+namespace {
+
+const char* PATH = "/heartbeat_receiver_test";
+
+// Serves the children of one path, and keeps the child watcher set last.
+class FakeZKWrapper : public ZKWrapper {
+ public:
+  FakeZKWrapper()
+      : state_(ZKSTATE_CONNECTED), cversion_(0), watch_count_(0), connect_count_(0) {}
+
+  using ZKWrapper::Exists;
+  using ZKWrapper::GetChildren;
+
+  void Connect() override {
+    std::lock_guard<std::mutex> guard(mutex_);
+    state_ = ZKSTATE_CONNECTED;
+    ++connect_count_;
+  }
+
+  ZKState GetState() override {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return state_;
+  }
+
+  ZKCode Exists(const std::string& path, ZKStatus* stat, bool watch) override {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (stat != nullptr) stat->cversion = cversion_;
+    return ZK_OK;
+  }
+
+  ZKCode GetChildren(const std::string& path,
+                     std::vector<std::string>* children,
+                     ZKStatus* stat,
+                     bool watch) override {
+    std::lock_guard<std::mutex> guard(mutex_);
+    *children = children_;
+    if (stat != nullptr) stat->cversion = cversion_;
+    return ZK_OK;
+  }
+
+  ZKCode GetChildren(const std::string& path,
+                     std::vector<std::string>* children,
+                     WatcherLambda&& watcher,
+                     ZKStatus* stat) override {
+    std::lock_guard<std::mutex> guard(mutex_);
+    watcher_ = std::move(watcher);
+    ++watch_count_;
+    *children = children_;
+    if (stat != nullptr) stat->cversion = cversion_;
+    return ZK_OK;
+  }
+
+  // Changes the children by |changes| times and fires the child watcher.
+  void SetChildren(const std::vector<std::string>& children, int changes) {
+    WatcherLambda watcher;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      children_ = children;
+      cversion_ += changes;
+      watcher.swap(watcher_);
+    }
+    if (watcher) watcher(ZKEVENT_CHILD, ZKSTATE_CONNECTED, PATH);
+  }
+
+  void Expire() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    state_ = ZKSTATE_EXPIRED_SESSION;
+  }
+
+  int watch_count() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return watch_count_;
+  }
+
+  int connect_count() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return connect_count_;
+  }
+
+ private:
+  std::mutex mutex_;
+  ZKState state_;
+  std::vector<std::string> children_;
+  int32_t cversion_;
+  WatcherLambda watcher_;
+  int watch_count_;
+  int connect_count_;
+};
+
+class RecordingNodeCollection : public NodeCollectionImpl {
+ public:
+  void UpdateHeartbeat(const std::vector<std::string>& nodes,
+                       const std::string& path) override {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      updates_.push_back(nodes);
+    }
+    NodeCollectionImpl::UpdateHeartbeat(nodes, path);
+  }
+
+  std::vector<std::vector<std::string>> updates() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return updates_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<std::vector<std::string>> updates_;
+};
+
+bool WaitFor(const std::function<bool()>& done) {
+  for (int i = 0; i < 300; ++i) {
+    if (done()) return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return done();
+}
+
+}  // namespace
+
+TEST(HeartbeatReceiverTest, ChildWatcherTest) {
+  FakeZKWrapper zk;
+  zk.SetChildren({"a:1"}, 1);
+  RecordingNodeCollection collection;
+  HeartbeatReceiver receiver;
+  // a long interval, the scans are triggered by the watcher only
+  ASSERT_TRUE(receiver.Init(&zk, &collection, 60));
+  receiver.AddPath(PATH);
+  ASSERT_TRUE(receiver.StartReceive());
+  ASSERT_TRUE(WaitFor([&collection]() { return collection.updates().size() == 1; }));
+  EXPECT_EQ(1, zk.watch_count());
+
+  // removed and added back, the children are the same
+  zk.SetChildren({"a:1"}, 2);
+  ASSERT_TRUE(WaitFor([&zk]() { return zk.watch_count() == 2; }));
+  zk.SetChildren({"a:1", "a:2"}, 1);
+  ASSERT_TRUE(WaitFor([&zk]() { return zk.watch_count() == 3; }));
+  ASSERT_TRUE(WaitFor([&collection]() { return collection.updates().size() >= 2; }));
+
+  auto updates = collection.updates();
+  ASSERT_EQ(2u, updates.size());
+  EXPECT_EQ((std::vector<std::string>{"a:1"}), updates[0]);
+  EXPECT_EQ((std::vector<std::string>{"a:1", "a:2"}), updates[1]);
+  EXPECT_EQ(2u, collection.GetNodeCount(PATH));
+  receiver.Close();
+}
+
+TEST(HeartbeatReceiverTest, ResetWatchesTest) {
+  FakeZKWrapper zk;
+  zk.SetChildren({"a:1"}, 1);
+  RecordingNodeCollection collection;
+  HeartbeatReceiver receiver;
+  ASSERT_TRUE(receiver.Init(&zk, &collection, 60));
+  receiver.AddPath(PATH);
+  ASSERT_TRUE(receiver.StartReceive());
+  ASSERT_TRUE(WaitFor([&zk]() { return zk.watch_count() == 1; }));
+
+  // the watchers of the expired session are gone, they're set again after
+  // reconnecting, but the nodes are not updated since unchanged
+  zk.Expire();
+  receiver.AddPath(PATH);
+  ASSERT_TRUE(WaitFor([&zk]() { return zk.watch_count() == 2; }));
+  EXPECT_EQ(1, zk.connect_count());
+  EXPECT_EQ(1u, collection.updates().size());
+
+  zk.SetChildren({"a:2"}, 1);
+  ASSERT_TRUE(WaitFor([&collection]() { return collection.updates().size() == 2; }));
+  EXPECT_EQ((std::vector<std::string>{"a:2"}), collection.updates()[1]);
+  receiver.Close();
+}
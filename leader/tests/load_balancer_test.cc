@@ -0,0 +1,350 @@
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include "leader/load_balancer.h"
+#include "leader/node_collection_impl.h"
+#include "common/logging.h"
+#define GTEST_HAS_TR1_TUPLE 0
+#define GTEST_USE_OWN_TR1_TUPLE 0
+#include "gtest/gtest.h"
+
+using namespace leader;
+
+namespace {
+
+NodeSnapshot MakeSnapshot(const std::vector<uint32_t>& weights) {
+  NodeSnapshot snapshot;
+  for (size_t i = 0; i < weights.size(); i++) {
+    snapshot.nodes.push_back("node" + std::to_string(i));
+    snapshot.stats.push_back(std::make_shared<NodeStat>());
+    snapshot.weights.push_back(weights[i]);
+  }
+  return snapshot;
+}
+
+}  // namespace
+
+TEST(LoadBalancerTest, CreateTest) {
+  EXPECT_TRUE(LoadBalancer::Create("rr") != nullptr);
+  EXPECT_TRUE(LoadBalancer::Create("wrr") != nullptr);
+  EXPECT_TRUE(LoadBalancer::Create("p2c") != nullptr);
+  EXPECT_TRUE(LoadBalancer::Create("chash") != nullptr);
+  EXPECT_TRUE(LoadBalancer::Create("random") == nullptr);
+}
+
+TEST(LoadBalancerTest, WeightedRoundRobinTest) {
+  auto balancer = LoadBalancer::Create("wrr");
+  auto snapshot = MakeSnapshot({5, 1, 1});
+  balancer->Prepare(&snapshot);
+  EXPECT_EQ(std::vector<uint32_t>({0, 0, 1, 0, 2, 0, 0}), snapshot.schedule);
+
+  std::vector<int> picked(3, 0);
+  for (int i = 0; i < 700; i++) {
+    picked[balancer->Pick(snapshot)]++;
+  }
+  EXPECT_EQ(500, picked[0]);
+  EXPECT_EQ(100, picked[1]);
+  EXPECT_EQ(100, picked[2]);
+}
+
+TEST(LoadBalancerTest, NodeStatTest) {
+  NodeStat stat;
+  stat.Start();
+  EXPECT_EQ(1, stat.in_flight());
+  stat.Done(800, false);
+  EXPECT_EQ(0, stat.in_flight());
+  EXPECT_EQ(800, stat.ewma_us());
+
+  stat.Start();
+  stat.Done(1600, false);
+  EXPECT_EQ(900, stat.ewma_us());
+
+  // canceled, not sampled
+  stat.Start();
+  stat.Done(-1, false);
+  EXPECT_EQ(900, stat.ewma_us());
+
+  // a fast failure is sampled as twice the average
+  stat.Start();
+  stat.Done(10, true);
+  EXPECT_EQ(1012, stat.ewma_us());
+}
+
+TEST(LoadBalancerTest, P2CTest) {
+  auto balancer = LoadBalancer::Create("p2c");
+  auto snapshot = MakeSnapshot({1, 1, 1});
+  snapshot.stats[0]->Start();
+  snapshot.stats[0]->Done(10000, false);
+  snapshot.stats[1]->Start();
+  snapshot.stats[1]->Done(1000, false);
+  snapshot.stats[2]->Start();
+  snapshot.stats[2]->Done(1000, false);
+
+  std::vector<int> picked(3, 0);
+  for (int i = 0; i < 3000; i++) {
+    picked[balancer->Pick(snapshot)]++;
+  }
+  // the slow one loses every comparison
+  EXPECT_EQ(0, picked[0]);
+  EXPECT_GT(picked[1], 0);
+  EXPECT_GT(picked[2], 0);
+
+  // the in-flight calls count
+  for (int i = 0; i < 20; i++) {
+    snapshot.stats[1]->Start();
+    snapshot.stats[2]->Start();
+  }
+  picked.assign(3, 0);
+  for (int i = 0; i < 3000; i++) {
+    picked[balancer->Pick(snapshot)]++;
+  }
+  EXPECT_GT(picked[0], 1000);
+}
+
+TEST(LoadBalancerTest, ConsistentHashTest) {
+  auto balancer = LoadBalancer::Create("chash");
+  auto snapshot = MakeSnapshot({1, 1, 1});
+  balancer->Prepare(&snapshot);
+  EXPECT_EQ(300u, snapshot.ring.size());
+
+  std::vector<size_t> nodes;
+  std::vector<int> picked(3, 0);
+  for (uint64_t key = 0; key < 3000; key++) {
+    nodes.push_back(balancer->Pick(snapshot, key));
+    EXPECT_EQ(nodes.back(), balancer->Pick(snapshot, key));
+    picked[nodes.back()]++;
+  }
+  for (auto count : picked) {
+    EXPECT_GT(count, 600);
+  }
+
+  // only the keys of the new node move
+  auto added = MakeSnapshot({1, 1, 1, 1});
+  auto newBalancer = LoadBalancer::Create("chash");
+  newBalancer->Prepare(&added);
+  int moved = 0;
+  for (uint64_t key = 0; key < 3000; key++) {
+    auto node = newBalancer->Pick(added, key);
+    if (node != nodes[key]) {
+      EXPECT_EQ(3u, node);
+      moved++;
+    }
+  }
+  EXPECT_GT(moved, 400);
+  EXPECT_LT(moved, 1200);
+}
+
+TEST(LoadBalancerTest, BoundedLoadTest) {
+  auto balancer = LoadBalancer::Create("chash");
+  auto snapshot = MakeSnapshot({1, 1, 1});
+  balancer->Prepare(&snapshot);
+
+  uint64_t key = 12345;
+  auto node = balancer->Pick(snapshot, key);
+  // over 125% of the average
+  for (int i = 0; i < 10; i++) {
+    snapshot.stats[node]->Start();
+  }
+  auto other = balancer->Pick(snapshot, key);
+  EXPECT_NE(node, other);
+  EXPECT_EQ(other, balancer->Pick(snapshot, key));
+
+  for (int i = 0; i < 10; i++) {
+    snapshot.stats[node]->Done(100, false);
+  }
+  EXPECT_EQ(node, balancer->Pick(snapshot, key));
+}
+
+TEST(NodeCollectionImplTest, PickOneNodeTest) {
+  NodeCollectionImpl collection;
+  std::string node;
+  EXPECT_FALSE(collection.PickOneNode(node, "/path"));
+
+  collection.UpdateHeartbeat({"a:1", "b:1"}, "/path");
+  std::map<std::string, int> picked;
+  std::shared_ptr<NodeStat> stat;
+  for (int i = 0; i < 10; i++) {
+    EXPECT_TRUE(collection.PickOneNode(node, "/path", &stat));
+    EXPECT_TRUE(stat != nullptr);
+    picked[node]++;
+  }
+  EXPECT_EQ(5, picked["a:1"]);
+  EXPECT_EQ(5, picked["b:1"]);
+
+  // the stats survive updates
+  EXPECT_TRUE(collection.PickOneNode(node, "/path", &stat));
+  auto oldStat = stat;
+  auto oldNode = node;
+  collection.UpdateHeartbeat({"a:1", "b:1", "c:1"}, "/path");
+  for (int i = 0; i < 3; i++) {
+    EXPECT_TRUE(collection.PickOneNode(node, "/path", &stat));
+    if (node == oldNode) {
+      EXPECT_EQ(oldStat, stat);
+    }
+  }
+
+  std::set<std::string> blackList{"a:1", "c:1"};
+  collection.UpdateBadNode(blackList);
+  for (int i = 0; i < 3; i++) {
+    EXPECT_TRUE(collection.PickOneNode(node, "/path"));
+    EXPECT_EQ("b:1", node);
+  }
+
+  collection.RemovePath("/path");
+  EXPECT_FALSE(collection.PickOneNode(node, "/path"));
+}
+
+TEST(NodeCollectionImplTest, SetLoadBalancerTest) {
+  NodeCollectionImpl collection;
+  EXPECT_FALSE(collection.SetLoadBalancer("random"));
+  collection.UpdateHeartbeat({"a:1", "b:1"}, "/path");
+  EXPECT_TRUE(collection.SetLoadBalancer("wrr"));
+  collection.SetNodeWeights({{"a:1", 3}});
+
+  std::map<std::string, int> picked;
+  std::string node;
+  for (int i = 0; i < 40; i++) {
+    EXPECT_TRUE(collection.PickOneNode(node, "/path"));
+    picked[node]++;
+  }
+  EXPECT_EQ(30, picked["a:1"]);
+  EXPECT_EQ(10, picked["b:1"]);
+}
+
+TEST(NodeCollectionImplTest, PathLoadBalancerTest) {
+  NodeCollectionImpl collection;
+  EXPECT_FALSE(collection.SetLoadBalancer("/a", "random"));
+  EXPECT_TRUE(collection.SetLoadBalancer("/a", "wrr"));
+  collection.SetNodeWeights("/a", {{"a:1", 3}});
+  collection.UpdateHeartbeat({"a:1", "b:1"}, "/a");
+  collection.UpdateHeartbeat({"a:1", "b:1"}, "/b");
+  // not of the paths with their own
+  EXPECT_TRUE(collection.SetLoadBalancer("p2c"));
+  collection.SetNodeWeights({{"b:1", 3}});
+  EXPECT_TRUE(collection.SetLoadBalancer("rr"));
+
+  std::map<std::string, int> pickedA;
+  std::map<std::string, int> pickedB;
+  std::string node;
+  for (int i = 0; i < 40; i++) {
+    EXPECT_TRUE(collection.PickOneNode(node, "/a"));
+    pickedA[node]++;
+    EXPECT_TRUE(collection.PickOneNode(node, "/b"));
+    pickedB[node]++;
+  }
+  EXPECT_EQ(30, pickedA["a:1"]);
+  EXPECT_EQ(10, pickedA["b:1"]);
+  EXPECT_EQ(20, pickedB["a:1"]);
+  EXPECT_EQ(20, pickedB["b:1"]);
+}
+
+TEST(NodeCollectionImplTest, PickOneNodeByKeyTest) {
+  NodeCollectionImpl collection;
+  collection.UpdateHeartbeat({"a:1", "b:1", "c:1"}, "/path");
+  EXPECT_TRUE(collection.SetLoadBalancer("chash"));
+
+  std::string node, again;
+  std::shared_ptr<NodeStat> stat;
+  for (uint64_t key = 0; key < 100; key++) {
+    EXPECT_TRUE(collection.PickOneNodeByKey(node, "/path", key, &stat));
+    EXPECT_TRUE(collection.PickOneNodeByKey(again, "/path", key, nullptr));
+    EXPECT_EQ(node, again);
+  }
+
+  // the keys of the nodes left stay
+  std::map<uint64_t, std::string> nodes;
+  for (uint64_t key = 0; key < 100; key++) {
+    EXPECT_TRUE(collection.PickOneNodeByKey(nodes[key], "/path", key, nullptr));
+  }
+  collection.UpdateHeartbeat({"a:1", "b:1"}, "/path");
+  for (uint64_t key = 0; key < 100; key++) {
+    EXPECT_TRUE(collection.PickOneNodeByKey(node, "/path", key, nullptr));
+    if (nodes[key] != "c:1") {
+      EXPECT_EQ(nodes[key], node);
+    }
+  }
+}
+
+TEST(NodeCollectionImplTest, PickOneHandleTest) {
+  NodeCollectionImpl collection;
+  collection.UpdateHeartbeat({"a:1", "b:1"}, "/path");
+  EXPECT_TRUE(collection.PickOneHandle("/path", nullptr, nullptr) == nullptr);
+
+  std::map<std::string, int> handles{{"a:1", 0}, {"b:1", 0}, {"c:1", 0}};
+  std::atomic<int> resolved(0);
+  collection.SetNodeResolver([&](const std::string& node) {
+    resolved++;
+    return static_cast<void*>(&handles[node]);
+  });
+  EXPECT_EQ(2, resolved);
+
+  std::shared_ptr<NodeStat> stat;
+  for (int i = 0; i < 10; i++) {
+    auto handle = static_cast<int*>(collection.PickOneHandle("/path", nullptr, &stat));
+    EXPECT_TRUE(handle != nullptr);
+    EXPECT_TRUE(stat != nullptr);
+    (*handle)++;
+  }
+  EXPECT_EQ(5, handles["a:1"]);
+  EXPECT_EQ(5, handles["b:1"]);
+  // resolved on publishing only
+  EXPECT_EQ(2, resolved);
+
+  collection.UpdateHeartbeat({"c:1"}, "/path");
+  uint64_t key = 1;
+  EXPECT_EQ(&handles["c:1"], collection.PickOneHandle("/path", &key, nullptr));
+  EXPECT_TRUE(collection.PickOneHandle("/other", nullptr, nullptr) == nullptr);
+
+  collection.SetNodeResolver(nullptr);
+  EXPECT_TRUE(collection.PickOneHandle("/path", nullptr, nullptr) == nullptr);
+}
+
+TEST(NodeCollectionImplTest, NodeCountResolvedTest) {
+  NodeCollectionImpl collection;
+  std::vector<size_t> counts;
+  int handle = 0;
+  // e.g. the channels are queued to warm up before the nodes are counted
+  collection.SetNodeResolver([&](const std::string& node) {
+    counts.push_back(collection.GetNodeCount("/path"));
+    return static_cast<void*>(&handle);
+  });
+  collection.UpdateHeartbeat({"a:1", "b:1"}, "/path");
+  EXPECT_EQ((std::vector<size_t>{0, 0}), counts);
+  EXPECT_EQ(2u, collection.GetNodeCount("/path"));
+  collection.RemovePath("/path");
+  EXPECT_EQ(0u, collection.GetNodeCount("/path"));
+}
+
+TEST(NodeCollectionImplTest, ConcurrentTest) {
+  NodeCollectionImpl collection;
+  EXPECT_TRUE(collection.SetLoadBalancer("p2c"));
+  collection.UpdateHeartbeat({"a:1", "b:1"}, "/path");
+
+  std::atomic<bool> running(true);
+  std::atomic<int> failed(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&]() {
+      std::string node;
+      std::shared_ptr<NodeStat> stat;
+      while (running) {
+        if (!collection.PickOneNode(node, "/path", &stat)) {
+          failed++;
+          continue;
+        }
+        stat->Start();
+        stat->Done(100, false);
+      }
+    });
+  }
+  for (int i = 0; i < 1000; i++) {
+    collection.UpdateHeartbeat({"a:1", "b:1", "c:" + std::to_string(i % 10)}, "/path");
+  }
+  running = false;
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(0, failed);
+}
@@ -0,0 +1,198 @@
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include "leader/outlier_detector.h"
+#include "leader/node_collection_impl.h"
+#include "common/logging.h"
+#define GTEST_HAS_TR1_TUPLE 0
+#define GTEST_USE_OWN_TR1_TUPLE 0
+#include "gtest/gtest.h"
+
+using namespace leader;
+
+namespace {
+
+const int64_t SECOND_US = 1000 * 1000;
+
+OutlierDetector::NodeGroup MakeGroup(size_t size) {
+  OutlierDetector::NodeGroup group;
+  for (size_t i = 0; i < size; i++) {
+    group.emplace_back("node" + std::to_string(i), std::make_shared<NodeStat>());
+  }
+  return group;
+}
+
+void Call(NodeStat* stat, int count, int64_t latency_us, bool failed) {
+  for (int i = 0; i < count; i++) {
+    stat->Start();
+    stat->Done(latency_us, failed);
+  }
+}
+
+OutlierDetector::Option MakeOption() {
+  OutlierDetector::Option option;
+  option.base_ejection_ms = 1000;
+  option.max_ejection_ms = 3000;
+  return option;
+}
+
+}  // namespace
+
+TEST(OutlierDetectorTest, ConsecutiveFailuresTest) {
+  OutlierDetector detector(MakeOption());
+  auto group = MakeGroup(4);
+  Call(group[0].second.get(), 4, 100, true);
+  EXPECT_TRUE(detector.Detect({group}, 0).empty());
+
+  Call(group[0].second.get(), 1, 100, true);
+  EXPECT_EQ(std::set<std::string>{"node0"}, detector.Detect({group}, 0));
+  // until the ejection is over
+  EXPECT_EQ(std::set<std::string>{"node0"},
+            detector.Detect({group}, SECOND_US - 1));
+  EXPECT_TRUE(detector.Detect({group}, SECOND_US).empty());
+}
+
+TEST(OutlierDetectorTest, FailureRateTest) {
+  OutlierDetector detector(MakeOption());
+  auto group = MakeGroup(4);
+  for (int i = 0; i < 10; i++) {
+    Call(group[1].second.get(), 1, 100, true);
+    Call(group[1].second.get(), 1, 100, false);
+  }
+  for (size_t i = 0; i < group.size(); i++) {
+    Call(group[i].second.get(), 5, 100, false);
+  }
+  // 10 of 25 calls failed
+  EXPECT_TRUE(detector.Detect({group}, 0).empty());
+
+  for (int i = 0; i < 15; i++) {
+    Call(group[1].second.get(), 1, 100, true);
+    Call(group[1].second.get(), 1, 100, false);
+  }
+  EXPECT_EQ(std::set<std::string>{"node1"}, detector.Detect({group}, 0));
+}
+
+TEST(OutlierDetectorTest, LatencyTest) {
+  OutlierDetector detector(MakeOption());
+  auto group = MakeGroup(4);
+  Call(group[0].second.get(), 20, 1000, false);
+  Call(group[1].second.get(), 20, 1000, false);
+  Call(group[2].second.get(), 20, 2000, false);
+  Call(group[3].second.get(), 20, 7000, false);
+  EXPECT_EQ(std::set<std::string>{"node3"}, detector.Detect({group}, 0));
+
+  // too few calls to compare
+  OutlierDetector other(MakeOption());
+  Call(group[0].second.get(), 20, 1000, false);
+  Call(group[1].second.get(), 20, 1000, false);
+  Call(group[2].second.get(), 20, 1000, false);
+  Call(group[3].second.get(), 19, 7000, false);
+  EXPECT_TRUE(other.Detect({group}, 0).empty());
+}
+
+TEST(OutlierDetectorTest, MaxEjectionTest) {
+  OutlierDetector detector(MakeOption());
+  auto group = MakeGroup(3);
+  for (auto& pair : group) {
+    Call(pair.second.get(), 5, 100, true);
+  }
+  // 50% of 3 nodes
+  EXPECT_EQ(1u, detector.Detect({group}, 0).size());
+
+  auto single = MakeGroup(1);
+  single[0].first = "single";
+  Call(single[0].second.get(), 5, 100, true);
+  EXPECT_TRUE(detector.Detect({single}, 0).empty());
+}
+
+TEST(OutlierDetectorTest, BackoffTest) {
+  OutlierDetector detector(MakeOption());
+  auto group = MakeGroup(2);
+  auto stat = group[0].second.get();
+  Call(stat, 5, 100, true);
+  EXPECT_EQ(1u, detector.Detect({group}, 0).size());
+
+  // back after 1s, and the first failure ejects it again for 2s
+  EXPECT_TRUE(detector.Detect({group}, SECOND_US).empty());
+  Call(stat, 1, 100, true);
+  EXPECT_EQ(1u, detector.Detect({group}, 2 * SECOND_US).size());
+  EXPECT_EQ(1u, detector.Detect({group}, 4 * SECOND_US - 1).size());
+  EXPECT_TRUE(detector.Detect({group}, 4 * SECOND_US).empty());
+
+  // 3s at most
+  Call(stat, 1, 100, true);
+  EXPECT_EQ(1u, detector.Detect({group}, 5 * SECOND_US).size());
+  EXPECT_EQ(1u, detector.Detect({group}, 8 * SECOND_US - 1).size());
+  EXPECT_TRUE(detector.Detect({group}, 8 * SECOND_US).empty());
+
+  // healthy again, the backoff decays
+  Call(stat, 1, 100, false);
+  EXPECT_TRUE(detector.Detect({group}, 9 * SECOND_US).empty());
+  for (int i = 10; i < 20; i++) {
+    Call(stat, 1, 100, false);
+    EXPECT_TRUE(detector.Detect({group}, i * SECOND_US).empty());
+  }
+  Call(stat, 5, 100, true);
+  EXPECT_EQ(1u, detector.Detect({group}, 20 * SECOND_US).size());
+  EXPECT_TRUE(detector.Detect({group}, 21 * SECOND_US).empty());
+}
+
+TEST(OutlierDetectorTest, NodeCollectionTest) {
+  NodeCollectionImpl collection;
+  OutlierDetector detector(MakeOption());
+  collection.UpdateHeartbeat({"a:1", "b:1", "c:1"}, "/path");
+
+  std::string node;
+  std::shared_ptr<NodeStat> stat;
+  for (int i = 0; i < 3; i++) {
+    EXPECT_TRUE(collection.PickOneNode(node, "/path", &stat));
+    if (node == "b:1") {
+      Call(stat.get(), 5, 100, true);
+    }
+  }
+  stat.reset();
+  collection.DetectOutliers(&detector, 0);
+  for (int i = 0; i < 6; i++) {
+    EXPECT_TRUE(collection.PickOneNode(node, "/path"));
+    EXPECT_NE("b:1", node);
+  }
+
+  // probed again once it's back
+  collection.DetectOutliers(&detector, SECOND_US);
+  std::set<std::string> picked;
+  for (int i = 0; i < 3; i++) {
+    EXPECT_TRUE(collection.PickOneNode(node, "/path"));
+    picked.insert(node);
+  }
+  EXPECT_EQ(3u, picked.size());
+}
+
+TEST(OutlierDetectorTest, PathNodeCollectionTest) {
+  NodeCollectionImpl collection;
+  OutlierDetector detector(MakeOption());
+  collection.UpdateHeartbeat({"a:1", "b:1"}, "/a");
+  collection.UpdateHeartbeat({"a:1", "b:1"}, "/b");
+
+  std::string node;
+  std::shared_ptr<NodeStat> stat;
+  for (int i = 0; i < 2; i++) {
+    EXPECT_TRUE(collection.PickOneNode(node, "/a", &stat));
+    if (node == "b:1") {
+      Call(stat.get(), 5, 100, true);
+    }
+  }
+  stat.reset();
+  // ejected from the paths detected only
+  collection.DetectOutliers(&detector, 0, {"/a"});
+  std::set<std::string> pickedA;
+  std::set<std::string> pickedB;
+  for (int i = 0; i < 4; i++) {
+    EXPECT_TRUE(collection.PickOneNode(node, "/a"));
+    pickedA.insert(node);
+    EXPECT_TRUE(collection.PickOneNode(node, "/b"));
+    pickedB.insert(node);
+  }
+  EXPECT_EQ(std::set<std::string>{"a:1"}, pickedA);
+  EXPECT_EQ(2u, pickedB.size());
+}
@@ -276,6 +276,12 @@ ZKWrapper::ZKWrapper(const std::string& remote,
       Connect();
 }
 
+ZKWrapper::ZKWrapper()
+  : zrecv_timeout_(0),
+    zhandle_(nullptr),
+    context_id_count_(0) {
+}
+
 ZKWrapper::~ZKWrapper() {
   {
     std::lock_guard<std::mutex> guard(finalize_thread_mutex_);
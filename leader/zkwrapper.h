@@ -142,13 +142,13 @@ class ZKWrapper {
   /**
    * @brief Destructor, ZK connection will be closed if not closed by Shutdown
    */
-  ~ZKWrapper();
+  virtual ~ZKWrapper();
 
   /**
    * @brief Reconnect to server, should be used when ZK_SESSIONEXPIRED
    * @throws ZKException Error happened during connect, may caused by OOM or network issue
    */
-  void Connect();
+  virtual void Connect();
 
   /**
    * @brief Shutdown ZK connection
@@ -318,9 +318,9 @@ class ZKWrapper {
    *         ZK_OK node exists.<br/>
    *         ZK_NONODE the node does not exist.
    */
-  ZKCode Exists(const std::string& path,
-                ZKStatus* stat = nullptr,
-                bool watch = false);
+  virtual ZKCode Exists(const std::string& path,
+                        ZKStatus* stat = nullptr,
+                        bool watch = false);
 
   /**
    * @brief Checks the existence of a node in zookeeper synchronously
@@ -376,10 +376,10 @@ class ZKWrapper {
    *         ZK_OK operation completed successfully.<br/>
    *         ZK_NONODE the node does not exist.
    */
-  ZKCode GetChildren(const std::string& path,
-                     std::vector<std::string>* children = nullptr,
-                     ZKStatus* stat = nullptr,
-                     bool watch = false);
+  virtual ZKCode GetChildren(const std::string& path,
+                             std::vector<std::string>* children = nullptr,
+                             ZKStatus* stat = nullptr,
+                             bool watch = false);
 
   /**
    * @brief Get the children of a node synchronously
@@ -390,10 +390,10 @@ class ZKWrapper {
    *         ZK_OK operation completed successfully.<br/>
    *         ZK_NONODE the node does not exist.
    */
-  ZKCode GetChildren(const std::string& path,
-                     std::vector<std::string>* children,
-                     WatcherLambda&& watcher,
-                     ZKStatus* stat = nullptr);
+  virtual ZKCode GetChildren(const std::string& path,
+                             std::vector<std::string>* children,
+                             WatcherLambda&& watcher,
+                             ZKStatus* stat = nullptr);
 
   /**
    * @brief Get the children and stat of a node asynchronously
@@ -422,13 +422,19 @@ class ZKWrapper {
    * @brief Get current state
    * @return ZKSTATE_UNDEFINED if not ShutDown() was called
    */
-  ZKState GetState();
+  virtual ZKState GetState();
 
   static const char* GetMessage(ZKCode code);
 
   static std::string JoinPath(const std::string& path1,
                               const std::string& path2);
 
+ protected:
+  /**
+   * @brief Create a ZKWrapper not connected, for fakes overriding the calls
+   */
+  ZKWrapper();
+
  private:
   template<typename U>
   friend class ZKWrapperContext;
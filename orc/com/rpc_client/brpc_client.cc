@@ -1,12 +1,25 @@
 #include "orc/com/rpc_client/brpc_client.h"
 
+#include <unistd.h>
+
+#include <map>
+
+#include "orc/com/rpc_client/discovery_registry.h"
 #include "orc/util/utils.h"
 #include "orc/util/log.h"
 
 namespace orc {
 
+namespace {
+
+// Bounds each of waiting for the nodes and their channels on warming up.
+const uint32_t kWarmUpWaitMs = 1000;
+
+}  // anonymous namespace
+
 BrpcClient::BrpcClient(const std::string& name, int32_t id)
-  : RpcClient(name, RpcClient::Type::Brpc, id) {}
+  : RpcClient(name, RpcClient::Type::Brpc, id),
+    max_retry_(3) {}
 
 BrpcClient::~BrpcClient() {}
 
@@ -15,23 +28,42 @@ bool BrpcClient::Init(const YAML::Node& config) {
     ORC_ERROR("RpcClient Init fail.");
     return false;
   }
-
-  brpc_server_subscriber_.reset(new leader::BrpcServerSubscriber());
+  CONFIG_OR_DEFAULT(config, "max_retry", max_retry_, 3);
 
   auto const pos = leader_server_path_.find_last_of('/');
   path_ = leader_server_path_.substr(pos);
-  auto zkHost = leader_server_path_.substr(0, pos);
 
-  if (!brpc_server_subscriber_->Init(zkHost,
-                                     leader_request_timeout_ms_,
-                                     leader_channel_count_,
-                                     leader_hb_interval_s_)) {
-    ORC_ERROR("BrpcServerSubscriber Init fail.");
+  DiscoveryRegistry::Option option;
+  option.zk_host = leader_server_path_.substr(0, pos);
+  option.timeout_ms = leader_request_timeout_ms_;
+  option.channel_count = leader_channel_count_;
+  option.hb_interval_s = leader_hb_interval_s_;
+  CONFIG_OR_DEFAULT(config, "connection_type", option.connection_type, "single");
+  // Round robin by default.
+  CONFIG_OR_DEFAULT(config, "lb_policy", option.lb_policy, "rr");
+  GetConfig(config, "node_weights", &option.node_weights);
+
+  // Passive, by the calls fed back to the node stats.
+  CONFIG_OR_DEFAULT(config, "outlier_detection", option.outlier_detection, false);
+  if (option.outlier_detection) {
+    auto& outlier = option.outlier;
+    CONFIG_OR_DEFAULT(config, "outlier_interval_ms", outlier.interval_ms, 1000);
+    CONFIG_OR_DEFAULT(config, "outlier_consecutive_failures", outlier.consecutive_failures, 5);
+    CONFIG_OR_DEFAULT(config, "outlier_failure_rate_percent", outlier.failure_rate_percent, 50);
+    CONFIG_OR_DEFAULT(config, "outlier_min_calls", outlier.min_calls, 20);
+    CONFIG_OR_DEFAULT(config, "outlier_latency_factor_percent", outlier.latency_factor_percent, 300);
+    CONFIG_OR_DEFAULT(config, "outlier_base_ejection_ms", outlier.base_ejection_ms, 10000);
+    CONFIG_OR_DEFAULT(config, "outlier_max_ejection_ms", outlier.max_ejection_ms, 300000);
+    CONFIG_OR_DEFAULT(config, "outlier_max_ejection_percent", outlier.max_ejection_percent, 50);
+  }
+  CONFIG_OR_DEFAULT(config, "discovery_snapshot_dir", option.snapshot_dir, "");
+
+  // Shared by the clients of the same zk host and connection type.
+  brpc_server_subscriber_ = DiscoveryRegistry::Subscribe(option, path_);
+  if (brpc_server_subscriber_ == nullptr) {
     return false;
   }
-  brpc_server_subscriber_->Start();
-  brpc_server_subscriber_->AddPath(path_);
-  ORC_INFO("brpc subscriber: %s %s inited", zkHost.c_str(), path_.c_str());
+  ORC_INFO("brpc subscriber: %s %s inited", option.zk_host.c_str(), path_.c_str());
   return true;
 }
 
@@ -39,15 +71,36 @@ google::protobuf::RpcChannel* BrpcClient::GetChannel() {
   return brpc_server_subscriber_->GetChannel(path_);
 }
 
+google::protobuf::RpcChannel* BrpcClient::PickChannel(const uint64_t* routing_key,
+                                                      std::shared_ptr<leader::NodeStat>* stat) {
+  if (routing_key != nullptr) {
+    return brpc_server_subscriber_->GetChannelByKey(path_, *routing_key, stat);
+  }
+  return brpc_server_subscriber_->GetChannel(path_, stat);
+}
+
 void BrpcClient::FreeChannel(google::protobuf::RpcChannel* channel) {
   // erpc don't need to free channel.
   (void) channel;
 }
 
-google::protobuf::RpcController* BrpcClient::GetController() {
+void BrpcClient::WarmUpChannel() {
+  // the nodes are got from zk in the background, or from the snapshot
+  for (uint32_t i = 0; i < kWarmUpWaitMs / 10; ++i) {
+    if (brpc_server_subscriber_->GetServerCount(path_) > 0) {
+      break;
+    }
+    usleep(10 * 1000);
+  }
+  if (!brpc_server_subscriber_->WaitWarmUp(kWarmUpWaitMs)) {
+    ORC_WARN("Channels of %s aren't warmed up in %u ms.", name().c_str(), kWarmUpWaitMs);
+  }
+}
+
+google::protobuf::RpcController* BrpcClient::GetController(int64_t timeout_ms) {
   auto controller = new brpc::Controller();
-  controller->set_timeout_ms(leader_request_timeout_ms_);
-  controller->set_max_retry(3);
+  controller->set_timeout_ms(timeout_ms);
+  controller->set_max_retry(max_retry_);
   return controller;
 }
 
@@ -55,4 +108,24 @@ void BrpcClient::FreeController(google::protobuf::RpcController* controller) {
   delete controller;
 }
 
+uint32_t BrpcClient::RetriedCount(google::protobuf::RpcController* controller) const {
+  return static_cast<uint32_t>(static_cast<brpc::Controller*>(controller)->retried_count());
+}
+
+void BrpcClient::SetRequestAttachment(google::protobuf::RpcController* controller,
+                                      const butil::IOBuf& attachment) {
+  // Refers to the blocks of 'attachment', which are sent without copying.
+  static_cast<brpc::Controller*>(controller)->request_attachment().append(attachment);
+}
+
+void BrpcClient::TakeResponseAttachment(google::protobuf::RpcController* controller,
+                                        butil::IOBuf* attachment) {
+  attachment->swap(static_cast<brpc::Controller*>(controller)->response_attachment());
+}
+
+void BrpcClient::StartCancel(google::protobuf::RpcController* controller) {
+  // brpc::Controller::StartCancel() isn't supported, cancel by the call id.
+  brpc::StartCancel(static_cast<brpc::Controller*>(controller)->call_id());
+}
+
 }  // namespace orc
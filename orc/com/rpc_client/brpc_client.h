@@ -19,14 +19,28 @@ class BrpcClient : public RpcClient {
   bool Init(const YAML::Node& config) override;
 
   google::protobuf::RpcChannel* GetChannel() override;
+  google::protobuf::RpcChannel* PickChannel(const uint64_t* routing_key,
+                                            std::shared_ptr<leader::NodeStat>* stat) override;
   void FreeChannel(google::protobuf::RpcChannel* channel) override;
 
-  google::protobuf::RpcController* GetController() override;
+  // The channels are warmed up in parallel by the subscriber once the nodes
+  // are got, it waits for them.
+  void WarmUpChannel() override;
+
+  google::protobuf::RpcController* GetController(int64_t timeout_ms) override;
   void FreeController(google::protobuf::RpcController* controller) override;
+  uint32_t RetriedCount(google::protobuf::RpcController* controller) const override;
+  void StartCancel(google::protobuf::RpcController* controller) override;
+  bool SupportsAttachment() const override { return true; }
+  void SetRequestAttachment(google::protobuf::RpcController* controller,
+                            const butil::IOBuf& attachment) override;
+  void TakeResponseAttachment(google::protobuf::RpcController* controller,
+                              butil::IOBuf* attachment) override;
 
  private:
-  std::unique_ptr<leader::BrpcServerSubscriber> brpc_server_subscriber_;
+  std::shared_ptr<leader::BrpcServerSubscriber> brpc_server_subscriber_;
   std::string path_;
+  int32_t max_retry_;
 
  private:
   ORC_DISALLOW_COPY_AND_ASSIGN(BrpcClient);
@@ -0,0 +1,97 @@
+#include "orc/com/rpc_client/discovery_registry.h"
+
+#include <cctype>
+#include <mutex>
+#include <utility>
+
+#include "orc/util/log.h"
+
+namespace orc {
+
+namespace {
+
+struct Subscription {
+  // Expired once all clients of the subscriber are gone.
+  std::weak_ptr<leader::BrpcServerSubscriber> subscriber;
+  // Of the first client.
+  DiscoveryRegistry::Option option;
+};
+
+std::mutex registry_mutex;
+// zk host, connection type : subscription
+std::map<std::pair<std::string, std::string>, Subscription> registry;
+
+bool SameSubscriberOption(const DiscoveryRegistry::Option& a,
+                          const DiscoveryRegistry::Option& b) {
+  return a.timeout_ms == b.timeout_ms && a.channel_count == b.channel_count &&
+         a.hb_interval_s == b.hb_interval_s &&
+         (a.snapshot_dir == b.snapshot_dir || b.snapshot_dir.empty());
+}
+
+std::shared_ptr<leader::BrpcServerSubscriber> NewSubscriber(
+    const DiscoveryRegistry::Option& option) {
+  auto subscriber = std::make_shared<leader::BrpcServerSubscriber>();
+  if (!subscriber->Init(option.zk_host, option.timeout_ms, option.channel_count,
+                        option.hb_interval_s)) {
+    ORC_ERROR("BrpcServerSubscriber Init fail.");
+    return nullptr;
+  }
+  if (!subscriber->SetConnectionType(option.connection_type)) {
+    ORC_ERROR("Unknown connection_type: %s.", option.connection_type.c_str());
+    return nullptr;
+  }
+  if (!option.snapshot_dir.empty()) {
+    // The paths are served by the nodes saved until they're got from zk.
+    auto file = DiscoveryRegistry::SnapshotFile(option);
+    if (!subscriber->SetSnapshotFile(file)) {
+      ORC_WARN("Discovery snapshot %s isn't loaded.", file.c_str());
+    }
+  }
+  subscriber->Start();
+  return subscriber;
+}
+
+}  // anonymous namespace
+
+std::string DiscoveryRegistry::SnapshotFile(const Option& option) {
+  std::string host = option.zk_host;
+  for (auto& c : host) {
+    if (!isalnum(static_cast<unsigned char>(c)) && c != '.' && c != '-') c = '_';
+  }
+  return option.snapshot_dir + "/" + host + ".snapshot";
+}
+
+std::shared_ptr<leader::BrpcServerSubscriber> DiscoveryRegistry::Subscribe(
+    const Option& option, const std::string& path) {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  // The channels of a pool are all of one connection type.
+  auto& subscription = registry[std::make_pair(option.zk_host, option.connection_type)];
+  auto subscriber = subscription.subscriber.lock();
+  if (subscriber == nullptr) {
+    subscriber = NewSubscriber(option);
+    if (subscriber == nullptr) {
+      return nullptr;
+    }
+    subscription.subscriber = subscriber;
+    subscription.option = option;
+  } else if (!SameSubscriberOption(subscription.option, option)) {
+    ORC_WARN("brpc subscriber of %s is shared by %s with the options of the first client.",
+             option.zk_host.c_str(), path.c_str());
+  } else {
+    ORC_INFO("brpc subscriber of %s is shared by %s.", option.zk_host.c_str(), path.c_str());
+  }
+
+  // Before the path is added, so its nodes are published with them.
+  if (!subscriber->SetLoadBalancer(path, option.lb_policy)) {
+    ORC_ERROR("Unknown lb_policy: %s.", option.lb_policy.c_str());
+    return nullptr;
+  }
+  subscriber->SetServerWeights(path, option.node_weights);
+  if (option.outlier_detection) {
+    subscriber->EnableOutlierDetection(path, option.outlier);
+  }
+  subscriber->AddPath(path);
+  return subscriber;
+}
+
+}  // namespace orc
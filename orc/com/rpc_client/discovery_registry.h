@@ -0,0 +1,60 @@
+#ifndef ORC_COM_RPC_CLIENT_DISCOVERY_REGISTRY_H_
+#define ORC_COM_RPC_CLIENT_DISCOVERY_REGISTRY_H_
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "leader/brpc/brpc_server_subscriber.h"
+#include "leader/outlier_detector.h"
+
+namespace orc {
+
+// The subscribers shared by the BrpcClients of the process, so the clients of
+// a zk host and connection type share one zk session, heartbeat receiver,
+// channel pool and bad node detector. The balancer, weights and outlier
+// detection are of the path of a client, the other options are of the first
+// client of the host and connection type.
+class DiscoveryRegistry {
+ public:
+  struct Option {
+    Option()
+        : timeout_ms(0),
+          channel_count(1),
+          hb_interval_s(5),
+          connection_type("single"),
+          lb_policy("rr"),
+          outlier_detection(false) {}
+
+    // Of the subscriber of the host, which is not shared by the clients of
+    // another connection type.
+    std::string zk_host;
+    uint32_t timeout_ms;
+    uint32_t channel_count;
+    uint32_t hb_interval_s;
+    // "single", "pooled" or "short" connections to a node.
+    std::string connection_type;
+    // The nodes are saved to a snapshot file in it and served from it on
+    // start until zk is reachable, disabled if empty.
+    std::string snapshot_dir;
+
+    // Of the path.
+    std::string lb_policy;
+    std::map<std::string, uint32_t> node_weights;
+    bool outlier_detection;
+    leader::OutlierDetector::Option outlier;
+  };
+
+  // Get the subscriber of the zk host and connection type of 'option', which
+  // is created and started if not shared yet, and subscribe 'path' with the path options.
+  // Return nullptr if it fails to init.
+  static std::shared_ptr<leader::BrpcServerSubscriber> Subscribe(const Option& option,
+                                                                 const std::string& path);
+
+  // Name of the snapshot file of 'option' in its snapshot_dir.
+  static std::string SnapshotFile(const Option& option);
+};
+
+}  // namespace orc
+
+#endif  // ORC_COM_RPC_CLIENT_DISCOVERY_REGISTRY_H_
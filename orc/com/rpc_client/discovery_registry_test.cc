@@ -0,0 +1,104 @@
+#include <sstream>
+
+#define private public
+#define protected public
+#include "orc/com/rpc_client/discovery_registry.h"
+#include "leader/node_collection_impl.h"
+#undef protected
+#undef private
+
+#include "gtest/gtest.h"
+
+namespace orc {
+
+namespace {
+
+// Not reachable, the subscribers keep retrying in the background.
+const char* kHost = "127.0.0.1:1";
+const char* kOtherHost = "127.0.0.1:2";
+
+DiscoveryRegistry::Option MakeOption(const std::string& host) {
+  DiscoveryRegistry::Option option;
+  option.zk_host = host;
+  option.timeout_ms = 100;
+  option.hb_interval_s = 1;
+  return option;
+}
+
+}  // anonymous namespace
+
+TEST(DiscoveryRegistryTest, SharedByHost) {
+  auto option = MakeOption(kHost);
+  auto a = DiscoveryRegistry::Subscribe(option, "/a");
+  ASSERT_NE(nullptr, a);
+
+  // The pool options of the first client are taken.
+  option.timeout_ms = 200;
+  option.channel_count = 2;
+  option.lb_policy = "chash";
+  auto b = DiscoveryRegistry::Subscribe(option, "/b");
+  EXPECT_EQ(a, b);
+
+  auto other = DiscoveryRegistry::Subscribe(MakeOption(kOtherHost), "/a");
+  ASSERT_NE(nullptr, other);
+  EXPECT_NE(a, other);
+
+  // Released with the last client.
+  std::weak_ptr<leader::BrpcServerSubscriber> released = a;
+  a.reset();
+  b.reset();
+  EXPECT_TRUE(released.expired());
+  auto again = DiscoveryRegistry::Subscribe(MakeOption(kHost), "/a");
+  ASSERT_NE(nullptr, again);
+  EXPECT_NE(other, again);
+}
+
+TEST(DiscoveryRegistryTest, ConnectionType) {
+  auto option = MakeOption(kHost);
+  auto single = DiscoveryRegistry::Subscribe(option, "/a");
+  ASSERT_NE(nullptr, single);
+
+  // Not shared with the pool of another connection type of the host.
+  option.connection_type = "pooled";
+  auto pooled = DiscoveryRegistry::Subscribe(option, "/b");
+  ASSERT_NE(nullptr, pooled);
+  EXPECT_NE(single, pooled);
+  EXPECT_EQ(pooled, DiscoveryRegistry::Subscribe(option, "/c"));
+  EXPECT_EQ("single", single->channel_pool_->connection_type_);
+  EXPECT_EQ("pooled", pooled->channel_pool_->connection_type_);
+
+  option.connection_type = "unknown";
+  EXPECT_EQ(nullptr, DiscoveryRegistry::Subscribe(option, "/d"));
+}
+
+TEST(DiscoveryRegistryTest, PathOption) {
+  auto option = MakeOption(kHost);
+  option.lb_policy = "wrr";
+  option.node_weights = {{"a:1", 3}};
+  option.outlier_detection = true;
+  auto subscriber = DiscoveryRegistry::Subscribe(option, "/a");
+  ASSERT_NE(nullptr, subscriber);
+  option = MakeOption(kHost);
+  option.lb_policy = "chash";
+  EXPECT_EQ(subscriber, DiscoveryRegistry::Subscribe(option, "/b"));
+
+  auto collection = subscriber->node_collection_.get();
+  EXPECT_EQ("wrr", collection->path_balancer_names_["/a"]);
+  EXPECT_EQ(3u, collection->path_weights_["/a"]["a:1"]);
+  EXPECT_EQ("chash", collection->path_balancer_names_["/b"]);
+  EXPECT_TRUE(collection->path_weights_["/b"].empty());
+  EXPECT_EQ(1u, subscriber->outlier_detectors_.count("/a"));
+  EXPECT_EQ(0u, subscriber->outlier_detectors_.count("/b"));
+
+  option.lb_policy = "random";
+  EXPECT_EQ(nullptr, DiscoveryRegistry::Subscribe(option, "/c"));
+}
+
+TEST(DiscoveryRegistryTest, SnapshotFile) {
+  auto option = MakeOption("10.0.0.1:2181,10.0.0.2:2181");
+  option.snapshot_dir = "/tmp";
+  EXPECT_EQ("/tmp/10.0.0.1_2181_10.0.0.2_2181.snapshot",
+            DiscoveryRegistry::SnapshotFile(option));
+}
+
+}  // namespace orc
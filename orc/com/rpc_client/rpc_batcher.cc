@@ -0,0 +1,224 @@
+#include "orc/com/rpc_client/rpc_batcher.h"
+
+#include <map>
+#include <tuple>
+
+#include "orc/framework/trace_recorder.h"
+#include "orc/util/log.h"
+#include "orc/util/utils.h"
+
+#include "common/monitor/monitor_status_impl.h"
+
+namespace orc {
+
+namespace {
+
+using BatcherKey = std::tuple<RpcClient*, const google::protobuf::MethodDescriptor*,
+                              const RpcBatchHook*>;
+
+std::mutex batchers_mutex;
+std::map<BatcherKey, std::unique_ptr<RpcBatcher>> batchers;
+
+}  // anonymous namespace
+
+class RpcBatcher::BatchClosure : public google::protobuf::Closure {
+ public:
+  BatchClosure(RpcClient* client, const RpcBatchHook* hook, std::vector<Call>* calls)
+      : client_(client), hook_(hook), success_(false) {
+    calls_.swap(*calls);
+  }
+
+  // Return false if the requests can't be merged, the calls are given back
+  // to 'calls' then.
+  bool Merge(std::vector<Call>* calls) {
+    std::vector<const google::protobuf::Message*> requests;
+    requests.reserve(calls_.size());
+    for (const auto& call : calls_) requests.emplace_back(call.request);
+
+    request_.reset(calls_[0].request->New());
+    if (!hook_->Merge(requests, request_.get())) {
+      calls->swap(calls_);
+      return false;
+    }
+    response_.reset(calls_[0].response->New());
+    return true;
+  }
+
+  const google::protobuf::Message* request() const { return request_.get(); }
+  google::protobuf::Message* response() const { return response_.get(); }
+  bool* success() { return &success_; }
+
+  // The earliest deadline of the calls, -1 if none has.
+  int64_t deadline_us() const {
+    int64_t deadline_us = -1;
+    for (const auto& call : calls_) {
+      if (call.deadline_us > 0 && (deadline_us < 0 || call.deadline_us < deadline_us)) {
+        deadline_us = call.deadline_us;
+      }
+    }
+    return deadline_us;
+  }
+
+  void Run() override {
+    bool success = success_;
+    if (success) {
+      std::vector<google::protobuf::Message*> responses;
+      responses.reserve(calls_.size());
+      for (const auto& call : calls_) responses.emplace_back(call.response);
+      success = hook_->Split(*response_, responses);
+      if (!success) {
+        ORC_WARN_RATELIMITED("Split batched response for (%s) fail.",
+                             client_->name().c_str());
+        MONITOR_STATUS_NORMAL_COUNTER_BY(client_->name().c_str(), "batch_split_fail", 1);
+      }
+    }
+
+    for (const auto& call : calls_) {
+      *call.success = success;
+      call.closure->Run();
+    }
+    delete this;
+  }
+
+ private:
+  RpcClient* client_;
+  const RpcBatchHook* hook_;
+  std::vector<Call> calls_;
+  std::unique_ptr<google::protobuf::Message> request_;
+  std::unique_ptr<google::protobuf::Message> response_;
+  bool success_;
+};
+
+RpcBatcher::RpcBatcher(RpcClient* client,
+                       const google::protobuf::MethodDescriptor* method,
+                       const RpcBatchHook* hook,
+                       const Option& option)
+    : client_(client),
+      method_(method),
+      hook_(hook),
+      option_(option),
+      first_us_(0),
+      running_(true) {
+  if (option_.max_size == 0) option_.max_size = 1;
+  worker_ = std::thread([this]() { WorkLoop(); });
+}
+
+RpcBatcher::~RpcBatcher() {
+  Stop();
+}
+
+RpcBatcher* RpcBatcher::Get(RpcClient* client,
+                            const google::protobuf::MethodDescriptor* method,
+                            const RpcBatchHook* hook,
+                            const Option& option) {
+  std::lock_guard<std::mutex> lock(batchers_mutex);
+  auto& batcher = batchers[BatcherKey(client, method, hook)];
+  if (!batcher) {
+    batcher.reset(new RpcBatcher(client, method, hook, option));
+    ORC_INFO("RpcBatcher for (%s) created, window: %ld us, max size: %u.",
+             client->name().c_str(), option.window_us, option.max_size);
+  }
+  return batcher.get();
+}
+
+void RpcBatcher::StopAll() {
+  std::lock_guard<std::mutex> lock(batchers_mutex);
+  for (auto& it : batchers) it.second->Stop();
+}
+
+void RpcBatcher::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+  }
+  cond_.notify_all();
+  if (worker_.joinable()) worker_.join();
+}
+
+void RpcBatcher::CallMethod(const google::protobuf::Message* request,
+                            google::protobuf::Message* response,
+                            google::protobuf::Closure* closure,
+                            bool* success,
+                            int64_t deadline_us) {
+  std::vector<Call> calls;
+  bool queued = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) {
+      queued = true;
+      pending_.push_back(Call{request, response, closure, success, deadline_us});
+      if (pending_.size() == 1) {
+        first_us_ = NowUs();
+        cond_.notify_one();
+      }
+      if (pending_.size() >= option_.max_size) calls.swap(pending_);
+
+      // Under the lock, so it's counted before the call is done.
+      auto trace_stat = TraceRecorder::CurrentRpcStat();
+      if (trace_stat != nullptr) trace_stat->count.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  if (!queued) {
+    // Stopped.
+    client_->CallMethod(method_, request, response, closure, success, deadline_us);
+    return;
+  }
+  if (!calls.empty()) Flush(&calls);
+}
+
+void RpcBatcher::WorkLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (running_) {
+    if (pending_.empty()) {
+      cond_.wait(lock);
+      continue;
+    }
+
+    int64_t wait_us = first_us_ + option_.window_us - NowUs();
+    if (wait_us > 0) {
+      cond_.wait_for(lock, std::chrono::microseconds(wait_us));
+      continue;
+    }
+
+    std::vector<Call> calls;
+    calls.swap(pending_);
+    lock.unlock();
+    Flush(&calls);
+    lock.lock();
+  }
+
+  std::vector<Call> calls;
+  calls.swap(pending_);
+  lock.unlock();
+  if (!calls.empty()) Flush(&calls);
+}
+
+void RpcBatcher::Flush(std::vector<Call>* calls) {
+  // The calls are counted by CallMethod, not the merged one.
+  auto trace_stat = TraceRecorder::CurrentRpcStat();
+  TraceRecorder::SetCurrentRpcStat(nullptr);
+  MONITOR_STATUS_NORMAL_TIMER_BY(client_->name().c_str(), "batch_size",
+                                 calls->size() * 1000, 1);
+
+  if (calls->size() > 1) {
+    auto batch = new BatchClosure(client_, hook_, calls);
+    if (batch->Merge(calls)) {
+      client_->CallMethod(method_, batch->request(), batch->response(), batch,
+                          batch->success(), batch->deadline_us());
+    } else {
+      ORC_WARN_RATELIMITED("Merge batched request for (%s) fail, call one by one.",
+                           client_->name().c_str());
+      MONITOR_STATUS_NORMAL_COUNTER_BY(client_->name().c_str(), "batch_merge_fail", 1);
+      delete batch;
+    }
+  }
+
+  for (const auto& call : *calls) {
+    client_->CallMethod(method_, call.request, call.response, call.closure,
+                        call.success, call.deadline_us);
+  }
+  TraceRecorder::SetCurrentRpcStat(trace_stat);
+}
+
+}  // namespace orc
@@ -0,0 +1,106 @@
+#ifndef ORC_COM_RPC_CLIENT_RPC_BATCHER_H_
+#define ORC_COM_RPC_CLIENT_RPC_BATCHER_H_
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "orc/com/rpc_client/rpc_client.h"
+#include "orc/util/macros.h"
+
+namespace orc {
+
+// Merges the requests of several calls of a method into one request and
+// splits the response of the merged call, in the order of the requests. It's
+// shared by the handlers and called from any thread, so it must be stateless
+// and live as long as the process, e.g. a static object.
+class RpcBatchHook {
+ public:
+  virtual ~RpcBatchHook() = default;
+
+  // 'batch_request' is a new message of the request type.
+  virtual bool Merge(const std::vector<const google::protobuf::Message*>& requests,
+                     google::protobuf::Message* batch_request) const = 0;
+
+  // Return false if the response doesn't match the requests, all calls of
+  // the batch fail then.
+  virtual bool Split(const google::protobuf::Message& batch_response,
+                     const std::vector<google::protobuf::Message*>& responses) const = 0;
+};
+
+// Coalesces the async calls of a method on a RpcClient: the calls arriving in
+// 'window_us' since the first one are sent as one call, or sooner once there
+// are 'max_size' calls. The window is closed by the calling thread when it's
+// full, otherwise by the flusher thread of the batcher.
+class RpcBatcher {
+ public:
+  struct Option {
+    Option() : window_us(200), max_size(32) {}
+
+    int64_t window_us;
+    uint32_t max_size;
+  };
+
+  ~RpcBatcher();
+
+  // The batcher of the method on 'client', it's created by the first handler
+  // and shared by the others with the same 'hook', the option of the first
+  // one is used.
+  static RpcBatcher* Get(RpcClient* client,
+                         const google::protobuf::MethodDescriptor* method,
+                         const RpcBatchHook* hook,
+                         const Option& option);
+
+  // Flush the pending calls and stop the flusher threads of all batchers.
+  static void StopAll();
+
+  // Same as RpcClient::CallMethod, but 'closure' must not be nullptr. The
+  // merged call is bounded by the earliest deadline of the batch.
+  void CallMethod(const google::protobuf::Message* request,
+                  google::protobuf::Message* response,
+                  google::protobuf::Closure* closure,
+                  bool* success,
+                  int64_t deadline_us);
+
+ private:
+  RpcBatcher(RpcClient* client,
+             const google::protobuf::MethodDescriptor* method,
+             const RpcBatchHook* hook,
+             const Option& option);
+
+  struct Call {
+    const google::protobuf::Message* request;
+    google::protobuf::Message* response;
+    google::protobuf::Closure* closure;
+    bool* success;
+    int64_t deadline_us;
+  };
+
+  class BatchClosure;
+
+  void Stop();
+  void WorkLoop();
+  void Flush(std::vector<Call>* calls);
+
+ private:
+  RpcClient* client_;
+  const google::protobuf::MethodDescriptor* method_;
+  const RpcBatchHook* hook_;
+  Option option_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::vector<Call> pending_;
+  // Arrival of the first pending call.
+  int64_t first_us_;
+  bool running_;
+  std::thread worker_;
+
+  ORC_DISALLOW_COPY_AND_ASSIGN(RpcBatcher);
+};
+
+}  // namespace orc
+
+#endif  // ORC_COM_RPC_CLIENT_RPC_BATCHER_H_
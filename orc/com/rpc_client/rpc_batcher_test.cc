@@ -0,0 +1,269 @@
+#include "gtest/gtest.h"
+#include "orc/com/rpc_client/rpc_batcher.h"
+
+#include <unistd.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "common/monitor/monitor_status.h"
+#include "google/protobuf/struct.pb.h"
+
+namespace orc {
+
+namespace {
+
+using google::protobuf::ListValue;
+
+class FakeController : public google::protobuf::RpcController {
+ public:
+  void Reset() override {}
+  bool Failed() const override { return false; }
+  std::string ErrorText() const override { return ""; }
+  void StartCancel() override {}
+  void SetFailed(const std::string& reason) override {}
+  bool IsCanceled() const override { return false; }
+  void NotifyOnCancel(google::protobuf::Closure* callback) override {}
+};
+
+// Echoes the values of the request with a '!', the callback runs in another
+// thread.
+class FakeChannel : public google::protobuf::RpcChannel {
+ public:
+  FakeChannel() : calls(0), values(0) {}
+
+  void Join() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& thread : threads) thread.join();
+    threads.clear();
+  }
+
+  void CallMethod(const google::protobuf::MethodDescriptor* method,
+                  google::protobuf::RpcController* controller,
+                  const google::protobuf::Message* request,
+                  google::protobuf::Message* response,
+                  google::protobuf::Closure* done) override {
+    auto req = static_cast<const ListValue*>(request);
+    auto resp = static_cast<ListValue*>(response);
+    ++calls;
+    values += req->values_size();
+    for (const auto& value : req->values()) {
+      resp->add_values()->set_string_value(value.string_value() + "!");
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    threads.emplace_back([done]() { done->Run(); });
+  }
+
+  std::atomic<int> calls;
+  std::atomic<int> values;
+  std::mutex mutex;
+  std::vector<std::thread> threads;
+};
+
+class FakeClient : public RpcClient {
+ public:
+  FakeClient() : RpcClient("fake_service", RpcClient::Type::Brpc, 0) {
+    leader_request_timeout_ms_ = 1000;
+  }
+
+  ~FakeClient() { channel.Join(); }
+
+  google::protobuf::RpcChannel* GetChannel() override { return &channel; }
+  void FreeChannel(google::protobuf::RpcChannel* channel) override {}
+  google::protobuf::RpcController* GetController(int64_t timeout_ms) override {
+    return new FakeController();
+  }
+  void FreeController(google::protobuf::RpcController* controller) override {
+    delete controller;
+  }
+
+  FakeChannel channel;
+};
+
+// Every request has one value.
+class ListHook : public RpcBatchHook {
+ public:
+  bool Merge(const std::vector<const google::protobuf::Message*>& requests,
+             google::protobuf::Message* batch_request) const override {
+    auto batch = static_cast<ListValue*>(batch_request);
+    for (auto request : requests) {
+      auto req = static_cast<const ListValue*>(request);
+      if (req->values_size() != 1) return false;
+      *batch->add_values() = req->values(0);
+    }
+    return true;
+  }
+
+  bool Split(const google::protobuf::Message& batch_response,
+             const std::vector<google::protobuf::Message*>& responses) const override {
+    auto& batch = static_cast<const ListValue&>(batch_response);
+    if (batch.values_size() != static_cast<int>(responses.size()) ||
+        batch.values(0).string_value() == "bad!") {
+      return false;
+    }
+    for (size_t i = 0; i < responses.size(); ++i) {
+      *static_cast<ListValue*>(responses[i])->add_values() = batch.values(i);
+    }
+    return true;
+  }
+};
+
+class CountClosure : public google::protobuf::Closure {
+ public:
+  CountClosure() : count(0) {}
+  void Run() override { ++count; }
+
+  void Wait(int n) {
+    for (int i = 0; i < 1000 && count < n; ++i) usleep(1000);
+  }
+
+  std::atomic<int> count;
+};
+
+struct TestCall {
+  ListValue request;
+  ListValue response;
+  bool success = false;
+};
+
+}  // anonymous namespace
+
+// The clients and hooks are static, the batchers are kept by their addresses.
+class RpcBatcherTest : public ::testing::Test {
+ public:
+  static void SetUpTestCase() {
+    remove("/tmp/rpc_batcher_test.dat");
+    MONITOR_STATUS_INIT("/tmp/rpc_batcher_test.dat");
+  }
+
+  static void Call(RpcBatcher* batcher, TestCall* call, const std::string& value,
+                   CountClosure* closure) {
+    call->request.add_values()->set_string_value(value);
+    batcher->CallMethod(&call->request, &call->response, closure, &call->success, -1);
+  }
+};
+
+TEST_F(RpcBatcherTest, MaxSize) {
+  static FakeClient client;
+  static ListHook hook;
+  RpcBatcher::Option option;
+  option.window_us = 10 * 1000 * 1000;
+  option.max_size = 4;
+  auto batcher = RpcBatcher::Get(&client, nullptr, &hook, option);
+
+  CountClosure closure;
+  TestCall calls[4];
+  for (int i = 0; i < 4; ++i) {
+    Call(batcher, &calls[i], std::to_string(i), &closure);
+  }
+  closure.Wait(4);
+  ASSERT_EQ(4, closure.count);
+  ASSERT_EQ(1, client.channel.calls);
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(calls[i].success);
+    ASSERT_EQ(std::to_string(i) + "!", calls[i].response.values(0).string_value());
+  }
+
+  // The same one is shared.
+  option.max_size = 2;
+  ASSERT_EQ(batcher, RpcBatcher::Get(&client, nullptr, &hook, option));
+  RpcBatcher::StopAll();
+}
+
+TEST_F(RpcBatcherTest, Window) {
+  static FakeClient client;
+  static ListHook hook;
+  RpcBatcher::Option option;
+  option.window_us = 1000;
+  option.max_size = 100;
+  auto batcher = RpcBatcher::Get(&client, nullptr, &hook, option);
+
+  CountClosure closure;
+  TestCall calls[3];
+  for (int i = 0; i < 3; ++i) {
+    Call(batcher, &calls[i], std::to_string(i), &closure);
+  }
+  closure.Wait(3);
+  ASSERT_EQ(3, closure.count);
+  ASSERT_EQ(1, client.channel.calls);
+  ASSERT_EQ("2!", calls[2].response.values(0).string_value());
+
+  // Called directly once stopped.
+  RpcBatcher::StopAll();
+  TestCall call;
+  Call(batcher, &call, "x", &closure);
+  closure.Wait(4);
+  ASSERT_EQ(2, client.channel.calls);
+  ASSERT_TRUE(call.success);
+}
+
+TEST_F(RpcBatcherTest, HookFail) {
+  static FakeClient client;
+  static ListHook hook;
+  RpcBatcher::Option option;
+  option.window_us = 10 * 1000 * 1000;
+  option.max_size = 2;
+  auto batcher = RpcBatcher::Get(&client, nullptr, &hook, option);
+
+  // Can't be merged, called one by one.
+  CountClosure closure;
+  TestCall calls[2];
+  calls[0].request.add_values()->set_string_value("a");
+  Call(batcher, &calls[0], "b", &closure);
+  Call(batcher, &calls[1], "c", &closure);
+  closure.Wait(2);
+  ASSERT_EQ(2, client.channel.calls);
+  ASSERT_TRUE(calls[0].success);
+  ASSERT_TRUE(calls[1].success);
+
+  // Can't be split, all fail.
+  TestCall bad_calls[2];
+  Call(batcher, &bad_calls[0], "bad", &closure);
+  Call(batcher, &bad_calls[1], "d", &closure);
+  closure.Wait(4);
+  ASSERT_EQ(4, closure.count);
+  ASSERT_EQ(3, client.channel.calls);
+  ASSERT_FALSE(bad_calls[0].success);
+  ASSERT_FALSE(bad_calls[1].success);
+  RpcBatcher::StopAll();
+}
+
+TEST_F(RpcBatcherTest, Concurrent) {
+  static FakeClient client;
+  static ListHook hook;
+  RpcBatcher::Option option;
+  option.window_us = 200;
+  option.max_size = 16;
+  auto batcher = RpcBatcher::Get(&client, nullptr, &hook, option);
+
+  const int kThreads = 8, kCalls = 200;
+  std::vector<std::thread> threads;
+  std::atomic<int> failed(0);
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([batcher, t, &failed]() {
+                           CountClosure closure;
+                           std::vector<TestCall> calls(kCalls);
+                           for (int i = 0; i < kCalls; ++i) {
+                             Call(batcher, &calls[i], std::to_string(t * kCalls + i),
+                                  &closure);
+                             if (i % 8 == 7) closure.Wait(i + 1);
+                           }
+                           closure.Wait(kCalls);
+                           for (int i = 0; i < kCalls; ++i) {
+                             if (!calls[i].success || calls[i].response.values(0).string_value() !=
+                                 std::to_string(t * kCalls + i) + "!") {
+                               ++failed;
+                             }
+                           }
+                         });
+  }
+  for (auto& thread : threads) thread.join();
+
+  ASSERT_EQ(0, failed);
+  ASSERT_EQ(kThreads * kCalls, client.channel.values);
+  ASSERT_LT(client.channel.calls, kThreads * kCalls);
+  RpcBatcher::StopAll();
+}
+
+}  // namespace orc
@@ -1,8 +1,11 @@
 #include "orc/com/rpc_client/rpc_client.h"
 
 #include <sys/time.h>
-#include <unistd.h>
 
+#include <mutex>
+#include <utility>
+
+#include "orc/framework/trace_recorder.h"
 #include "orc/util/log.h"
 #include "orc/util/utils.h"
 
@@ -22,6 +25,19 @@ bool RpcClient::Init(const YAML::Node& config) {
   CONFIG_OR_FAIL(config, "leader_request_timeout", leader_request_timeout_ms_);
   CONFIG_OR_FAIL(config, "leader_channel_count", leader_channel_count_);
   CONFIG_OR_FAIL(config, "leader_hb_interval", leader_hb_interval_s_);
+
+  // Hedged if either of the delays is set.
+  RpcHedger::Option option;
+  int64_t hedge_delay_ms;
+  CONFIG_OR_DEFAULT(config, "hedge_delay_ms", hedge_delay_ms, 0);
+  CONFIG_OR_DEFAULT(config, "hedge_percentile", option.percentile, 0);
+  CONFIG_OR_DEFAULT(config, "hedge_budget_percent", option.budget_percent, 5);
+  option.delay_us = hedge_delay_ms * 1000;
+  if (option.delay_us > 0 || option.percentile > 0) {
+    hedger_.reset(new RpcHedger(option));
+    ORC_INFO("RpcClient (%s) hedged, delay: %ld ms, percentile: %u, budget: %u%%.",
+             name_.c_str(), hedge_delay_ms, option.percentile, option.budget_percent);
+  }
   return true;
 }
 
@@ -35,14 +51,22 @@ class RpcClosure : public google::protobuf::Closure {
              google::protobuf::Closure* closure,
              const google::protobuf::Message* request,
              const google::protobuf::Message* response,
-             bool* success)
+             bool* success,
+             TraceRpcStat* trace_stat,
+             RpcHedger* hedger,
+             std::shared_ptr<leader::NodeStat> node_stat,
+             butil::IOBuf* response_attachment)
       : client_(client),
         channel_(channel),
         controller_(controller),
         closure_(closure),
         request_(request),
         response_(response),
-        success_(success) {
+        success_(success),
+        trace_stat_(trace_stat),
+        hedger_(hedger),
+        node_stat_(std::move(node_stat)),
+        response_attachment_(response_attachment) {
     gettimeofday(&start_time_, NULL);
   }
 
@@ -57,14 +81,25 @@ class RpcClosure : public google::protobuf::Closure {
 
     if (controller_->Failed()) {
       *success_ = false;
-      ORC_WARN("Rpc Call for (%s) fail for: %s.",
-               client_->name().c_str(), controller_->ErrorText().c_str());
+      ORC_WARN_RATELIMITED("Rpc Call for (%s) fail for: %s.",
+                           client_->name().c_str(),
+                           controller_->ErrorText().c_str());
       MONITOR_STATUS_NORMAL_TIMER_BY(client_->name().c_str(), "cb_fail", EscapeTime(), 1);
       MONITOR_STATUS_NORMAL_TIMER_BY(client_->name().c_str(), "cb_fail_rate", 100 * 1000, 1);
     } else {
       *success_ = true;
+      if (response_attachment_ != nullptr) {
+        client_->TakeResponseAttachment(controller_, response_attachment_);
+      }
       Benchmark();
       MONITOR_STATUS_NORMAL_TIMER_BY(client_->name().c_str(), "cb_fail_rate", 0 * 1000, 1);
+      if (hedger_ != nullptr) hedger_->Record(EscapeTime());
+    }
+    if (node_stat_ != nullptr) node_stat_->Done(EscapeTime(), controller_->Failed());
+    // Before resuming the step, which takes the stat.
+    if (trace_stat_ != nullptr) {
+      trace_stat_->retries.fetch_add(client_->RetriedCount(controller_),
+                                     std::memory_order_relaxed);
     }
 
     closure_->Run();
@@ -105,21 +140,351 @@ class RpcClosure : public google::protobuf::Closure {
   const google::protobuf::Message* request_;
   const google::protobuf::Message* response_;
   bool* success_;
+  // Of the step issuing the call, nullptr if not traced.
+  TraceRpcStat* trace_stat_;
+  // For the latency observed, nullptr if not hedged.
+  RpcHedger* hedger_;
+  // Of the node called, nullptr if not balanced by it.
+  std::shared_ptr<leader::NodeStat> node_stat_;
+  // nullptr if the response attachment isn't taken.
+  butil::IOBuf* response_attachment_;
   struct timeval start_time_;
 };
 
+// The call sent to a second node if it's not done after the hedge delay. The
+// first successful response wins and the other call is canceled. It's shared
+// by the callbacks of the calls and the hedge timer, and the controllers are
+// kept until all of them are done, so the other call can be canceled safely.
+class HedgedCall : public std::enable_shared_from_this<HedgedCall> {
+ public:
+  HedgedCall(RpcClient* client,
+             RpcHedger* hedger,
+             const google::protobuf::MethodDescriptor* method,
+             const google::protobuf::Message* request,
+             google::protobuf::Message* response,
+             google::protobuf::Closure* closure,
+             bool* success,
+             int64_t timeout_ms,
+             TraceRpcStat* trace_stat,
+             const butil::IOBuf* request_attachment,
+             butil::IOBuf* response_attachment)
+      : client_(client),
+        hedger_(hedger),
+        method_(method),
+        request_(request),
+        response_(response),
+        closure_(closure),
+        success_(success),
+        timeout_ms_(timeout_ms),
+        trace_stat_(trace_stat),
+        response_attachment_(response_attachment),
+        started_(0),
+        finished_(false),
+        deferred_(-1) {
+    // Shared by both calls, and the caller's may be gone before the hedge.
+    if (request_attachment != nullptr) request_attachment_ = *request_attachment;
+  }
+
+  ~HedgedCall() {
+    for (int i = 0; i < started_; ++i) {
+      client_->FreeChannel(attempts_[i].channel);
+      client_->FreeController(attempts_[i].controller);
+    }
+  }
+
+  void Start(google::protobuf::RpcChannel* channel,
+             std::shared_ptr<leader::NodeStat> node_stat,
+             int64_t delay_us) {
+    auto& attempt = attempts_[0];
+    attempt.channel = channel;
+    attempt.node_stat = std::move(node_stat);
+    attempt.controller = client_->GetController(timeout_ms_);
+    if (!request_attachment_.empty()) {
+      client_->SetRequestAttachment(attempt.controller, request_attachment_);
+    }
+    attempt.response.reset(response_->New());
+    attempt.start_us = NowUs();
+    started_ = 1;
+
+    auto self = shared_from_this();
+    RpcHedger::Schedule(delay_us, [self]() { self->Hedge(); });
+    channel->CallMethod(method_, attempt.controller, request_,
+                        attempt.response.get(), new AttemptClosure(self, 0));
+    Sent(0);
+  }
+
+ private:
+  struct Attempt {
+    Attempt()
+        : channel(nullptr), controller(nullptr), start_us(0), end_us(0),
+          sent(false), cancel(false), done(false) {}
+
+    google::protobuf::RpcChannel* channel;
+    google::protobuf::RpcController* controller;
+    std::shared_ptr<leader::NodeStat> node_stat;
+    std::unique_ptr<google::protobuf::Message> response;
+    int64_t start_us;
+    int64_t end_us;
+    // The controller can be canceled only once CallMethod returns.
+    bool sent;
+    bool cancel;
+    bool done;
+  };
+
+  class AttemptClosure : public google::protobuf::Closure {
+   public:
+    AttemptClosure(std::shared_ptr<HedgedCall> call, int index)
+        : call_(std::move(call)), index_(index) {}
+
+    void Run() override {
+      call_->Done(index_);
+      delete this;
+    }
+
+   private:
+    std::shared_ptr<HedgedCall> call_;
+    int index_;
+  };
+
+  void Hedge() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (finished_) return;
+    }
+
+    // Another node. A node has several channels picked in turn, so the node
+    // is told by its stat, or by the channel if the client has no stats.
+    google::protobuf::RpcChannel* channel = nullptr;
+    std::shared_ptr<leader::NodeStat> node_stat;
+    for (int i = 0; i < 3 && channel == nullptr; ++i) {
+      node_stat.reset();
+      channel = client_->PickChannel(nullptr, &node_stat);
+      bool same = node_stat != nullptr ? node_stat == attempts_[0].node_stat
+                                       : channel == attempts_[0].channel;
+      if (same) {
+        client_->FreeChannel(channel);
+        channel = nullptr;
+      }
+    }
+    if (channel == nullptr) {
+      MONITOR_STATUS_NORMAL_COUNTER_BY(client_->name().c_str(), "hedge_no_channel", 1);
+      return;
+    }
+
+    int64_t remain_ms = timeout_ms_ - (NowUs() - attempts_[0].start_us) / 1000;
+    auto& attempt = attempts_[1];
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (finished_ || remain_ms <= 0) {
+        client_->FreeChannel(channel);
+        return;
+      }
+      if (!hedger_->Acquire()) {
+        client_->FreeChannel(channel);
+        MONITOR_STATUS_NORMAL_COUNTER_BY(client_->name().c_str(), "hedge_no_budget", 1);
+        return;
+      }
+      attempt.channel = channel;
+      attempt.node_stat = std::move(node_stat);
+      if (attempt.node_stat != nullptr) attempt.node_stat->Start();
+      attempt.controller = client_->GetController(remain_ms);
+      if (!request_attachment_.empty()) {
+        client_->SetRequestAttachment(attempt.controller, request_attachment_);
+      }
+      attempt.response.reset(response_->New());
+      attempt.start_us = NowUs();
+      started_ = 2;
+      // Under the lock, the stat is gone once the call is done.
+      if (trace_stat_ != nullptr) trace_stat_->count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    channel->CallMethod(method_, attempt.controller, request_, attempt.response.get(),
+                        new AttemptClosure(shared_from_this(), 1));
+    Sent(1);
+  }
+
+  // Cancels the call if the other one finished before it was sent, and
+  // finishes the other one which waits for the request to be sent.
+  void Sent(int index) {
+    auto& attempt = attempts_[index];
+    bool cancel = false;
+    int deferred = -1;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      attempt.sent = true;
+      cancel = attempt.cancel;
+      std::swap(deferred, deferred_);
+    }
+    if (cancel) client_->StartCancel(attempt.controller);
+    if (deferred >= 0) Finish(deferred);
+  }
+
+  void Done(int index) {
+    auto& attempt = attempts_[index];
+    bool failed = attempt.controller->Failed();
+    bool canceled = false;
+    bool finish = false;
+    Attempt* loser = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      attempt.done = true;
+      attempt.end_us = NowUs();
+      canceled = finished_;
+      int other = 1 - index;
+      bool other_pending = other < started_ && !attempts_[other].done;
+      // Unless the other one may still succeed.
+      if (!finished_ && (!failed || !other_pending)) {
+        finished_ = finish = true;
+        if (other_pending) {
+          if (attempts_[other].sent) {
+            loser = &attempts_[other];
+          } else {
+            attempts_[other].cancel = true;
+          }
+        }
+        // The request is the caller's once the closure runs, but the other
+        // call may still be sending it.
+        if (other < started_ && !attempts_[other].sent) {
+          deferred_ = index;
+          finish = false;
+        }
+      }
+    }
+    if (loser != nullptr) client_->StartCancel(loser->controller);
+    if (attempt.node_stat != nullptr) {
+      // The loser is likely canceled, not sampled.
+      attempt.node_stat->Done(canceled ? -1 : attempt.end_us - attempt.start_us, failed);
+    }
+    if (finish) Finish(index);
+  }
+
+  void Finish(int index) {
+    auto& attempt = attempts_[index];
+    const char* name = client_->name().c_str();
+    if (attempt.controller->Failed()) {
+      *success_ = false;
+      ORC_WARN_RATELIMITED("Rpc Call for (%s) fail for: %s.",
+                           name, attempt.controller->ErrorText().c_str());
+      MONITOR_STATUS_NORMAL_TIMER_BY(name, "cb_fail_rate", 100 * 1000, 1);
+    } else {
+      *success_ = true;
+      response_->GetReflection()->Swap(response_, attempt.response.get());
+      if (response_attachment_ != nullptr) {
+        client_->TakeResponseAttachment(attempt.controller, response_attachment_);
+      }
+      hedger_->Record(attempt.end_us - attempt.start_us);
+      MONITOR_STATUS_NORMAL_TIMER_BY(name, "cb_fail_rate", 0 * 1000, 1);
+    }
+    MONITOR_STATUS_NORMAL_TIMER_BY(name, "hedge_rate", (started_ > 1 ? 100 : 0) * 1000, 1);
+    if (started_ > 1) {
+      MONITOR_STATUS_NORMAL_TIMER_BY(name, "hedge_win_rate", (index == 1 ? 100 : 0) * 1000, 1);
+    }
+    MONITOR_STATUS_NORMAL_TIMER_BY(name, "all", NowUs() - attempts_[0].start_us, 1);
+    if (trace_stat_ != nullptr) {
+      trace_stat_->retries.fetch_add(client_->RetriedCount(attempt.controller),
+                                     std::memory_order_relaxed);
+    }
+
+    closure_->Run();
+  }
+
+  RpcClient* client_;
+  RpcHedger* hedger_;
+  const google::protobuf::MethodDescriptor* method_;
+  const google::protobuf::Message* request_;
+  google::protobuf::Message* response_;
+  google::protobuf::Closure* closure_;
+  bool* success_;
+  int64_t timeout_ms_;
+  TraceRpcStat* trace_stat_;
+  butil::IOBuf request_attachment_;
+  butil::IOBuf* response_attachment_;
+
+  std::mutex mutex_;
+  Attempt attempts_[2];
+  // Calls sent, the second one is set under the lock.
+  int started_;
+  bool finished_;
+  // The call finished first, but waits for the other one to be sent.
+  int deferred_;
+};
+
 }  // anonymous namespace
 
 void RpcClient::CallMethod(const google::protobuf::MethodDescriptor* method,
                            const google::protobuf::Message* request,
                            google::protobuf::Message* response,
                            google::protobuf::Closure* closure,
-                           bool* success) {
-  google::protobuf::RpcChannel* channel = nullptr;
-  channel = GetChannel();
+                           bool* success,
+                           int64_t deadline_us) {
+  DoCallMethod(nullptr, method, request, response, closure, success, deadline_us);
+}
+
+void RpcClient::CallMethod(uint64_t routing_key,
+                           const google::protobuf::MethodDescriptor* method,
+                           const google::protobuf::Message* request,
+                           google::protobuf::Message* response,
+                           google::protobuf::Closure* closure,
+                           bool* success,
+                           int64_t deadline_us) {
+  DoCallMethod(&routing_key, method, request, response, closure, success, deadline_us);
+}
+
+void RpcClient::CallMethod(const google::protobuf::MethodDescriptor* method,
+                           const google::protobuf::Message* request,
+                           const butil::IOBuf& request_attachment,
+                           google::protobuf::Message* response,
+                           butil::IOBuf* response_attachment,
+                           google::protobuf::Closure* closure,
+                           bool* success,
+                           int64_t deadline_us,
+                           const uint64_t* routing_key) {
+  DoCallMethod(routing_key, method, request, response, closure, success, deadline_us,
+               &request_attachment, response_attachment);
+}
+
+void RpcClient::DoCallMethod(const uint64_t* routing_key,
+                             const google::protobuf::MethodDescriptor* method,
+                             const google::protobuf::Message* request,
+                             google::protobuf::Message* response,
+                             google::protobuf::Closure* closure,
+                             bool* success,
+                             int64_t deadline_us,
+                             const butil::IOBuf* request_attachment,
+                             butil::IOBuf* response_attachment) {
+  if (request_attachment != nullptr && !request_attachment->empty() &&
+      !SupportsAttachment()) {
+    // Not dropped silently.
+    *success = false;
+    ORC_WARN_RATELIMITED("Rpc Call for (%s) fail for: attachment isn't supported.",
+                         name_.c_str());
+    if (closure != nullptr) closure->Run();
+    return;
+  }
+
+  // Never wait longer than the remaining budget of the request.
+  int64_t timeout_ms = leader_request_timeout_ms_;
+  if (deadline_us > 0) {
+    int64_t remain_ms = (deadline_us - NowUs()) / 1000;
+    if (remain_ms <= 0) {
+      *success = false;
+      ORC_WARN_RATELIMITED("Rpc Call for (%s) skipped for deadline exceeded.",
+                           name_.c_str());
+      MONITOR_STATUS_NORMAL_TIMER_BY(
+          name_.c_str(), "deadline_rate", 100 * 1000, 1);
+      if (closure != nullptr) closure->Run();
+      return;
+    }
+    if (remain_ms < timeout_ms) timeout_ms = remain_ms;
+  }
+  MONITOR_STATUS_NORMAL_TIMER_BY(name_.c_str(), "deadline_rate", 0, 1);
+
+  std::shared_ptr<leader::NodeStat> node_stat;
+  google::protobuf::RpcChannel* channel = PickChannel(routing_key, &node_stat);
 
   if (channel == nullptr) {
-    ORC_WARN("Get Rpc channel fail for service: %s.", name_.c_str());
+    ORC_WARN_RATELIMITED("Get Rpc channel fail for service: %s.",
+                         name_.c_str());
     MONITOR_STATUS_NORMAL_TIMER_BY(
         name_.c_str(), "no_channel_rate", 100 * 1000, 1);
     if (closure != nullptr) closure->Run();
@@ -127,32 +492,52 @@ void RpcClient::CallMethod(const google::protobuf::MethodDescriptor* method,
   }
   MONITOR_STATUS_NORMAL_TIMER_BY(
       name_.c_str(), "no_channel_rate", 0, 1);
+  if (node_stat != nullptr) node_stat->Start();
+
+  auto trace_stat = TraceRecorder::CurrentRpcStat();
+  if (trace_stat != nullptr) trace_stat->count.fetch_add(1, std::memory_order_relaxed);
+
+  if (closure != nullptr && hedger_ != nullptr) {
+    int64_t delay_us = hedger_->DelayUs();
+    if (delay_us >= 0 && delay_us < timeout_ms * 1000) {
+      auto call = std::make_shared<HedgedCall>(this, hedger_.get(), method, request,
+                                               response, closure, success,
+                                               timeout_ms, trace_stat,
+                                               request_attachment, response_attachment);
+      call->Start(channel, std::move(node_stat), delay_us);
+      return;
+    }
+  }
 
-  google::protobuf::RpcController* ctrl = GetController();
+  google::protobuf::RpcController* ctrl = GetController(timeout_ms);
+  if (request_attachment != nullptr && !request_attachment->empty()) {
+    SetRequestAttachment(ctrl, *request_attachment);
+  }
   if (closure == nullptr) {
     // sync
+    int64_t start_us = NowUs();
     channel->CallMethod(method, ctrl, request, response, nullptr);
+    if (node_stat != nullptr) node_stat->Done(NowUs() - start_us, ctrl->Failed());
+    if (trace_stat != nullptr) {
+      trace_stat->retries.fetch_add(RetriedCount(ctrl), std::memory_order_relaxed);
+    }
     if (!ctrl->Failed()) {
       *success = true;
+      if (response_attachment != nullptr) TakeResponseAttachment(ctrl, response_attachment);
     } else {
-      ORC_WARN("Rpc Call for (%s) fail for: %s.",
-               name().c_str(), ctrl->ErrorText().c_str());
+      ORC_WARN_RATELIMITED("Rpc Call for (%s) fail for: %s.",
+                           name().c_str(), ctrl->ErrorText().c_str());
     }
     FreeController(ctrl);
     FreeChannel(channel);
   } else {
     // async
     RpcClosure* rpc_closure = new RpcClosure(this, channel, ctrl, closure,
-                                             request, response, success);
+                                             request, response, success,
+                                             trace_stat, hedger_.get(),
+                                             std::move(node_stat), response_attachment);
     channel->CallMethod(method, ctrl, request, response, rpc_closure);
   }
 }
 
-void RpcClient::WarmUpChannel() {
-  sleep(1);
-  for (int32_t i = 0; i < 500; ++i) {
-    GetChannel();
-  }
-}
-
 }  // namespace orc
@@ -1,11 +1,15 @@
 #ifndef ORC_COM_RPC_CLIENT_RPC_CLIENT_H_
 #define ORC_COM_RPC_CLIENT_RPC_CLIENT_H_
 
+#include <memory>
 #include <string>
 
+#include "leader/load_balancer.h"
+#include "orc/com/rpc_client/rpc_hedger.h"
 #include "orc/util/macros.h"
 #include "yaml-cpp/node/node.h"
 
+#include "butil/iobuf.h"
 #include "google/protobuf/service.h"
 #include "google/protobuf/message.h"
 
@@ -23,18 +27,75 @@ class RpcClient {
 
   virtual google::protobuf::RpcChannel* GetChannel() = 0;
 
+  // Same as GetChannel(), 'stat' is set to the stat of the node picked if the
+  // client balances by it, and CallMethod feeds the call back to it. The node
+  // is picked by 'routing_key' unless it's nullptr.
+  virtual google::protobuf::RpcChannel* PickChannel(const uint64_t* routing_key,
+                                                    std::shared_ptr<leader::NodeStat>* stat) {
+    return GetChannel();
+  }
+
   virtual void FreeChannel(google::protobuf::RpcChannel* channel) = 0;
 
-  virtual google::protobuf::RpcController* GetController() = 0;
+  // The 'timeout_ms' is the budget of the whole call, including retries.
+  virtual google::protobuf::RpcController* GetController(int64_t timeout_ms) = 0;
   virtual void FreeController(google::protobuf::RpcController* controller) = 0;
+  // Retries of the finished call, for tracing.
+  virtual uint32_t RetriedCount(google::protobuf::RpcController* controller) const { return 0; }
+  // Cancel the call in flight, it's done with failure then. 'controller' is
+  // valid until the call is done.
+  virtual void StartCancel(google::protobuf::RpcController* controller) {
+    controller->StartCancel();
+  }
+  // Whether the client carries attachments, the calls with a request
+  // attachment fail if not.
+  virtual bool SupportsAttachment() const { return false; }
+  // Send 'attachment' beside the request of the call, the blocks are shared,
+  // not copied.
+  virtual void SetRequestAttachment(google::protobuf::RpcController* controller,
+                                    const butil::IOBuf& attachment) {}
+  // Move the attachment of the finished call to 'attachment', it's cleared if
+  // the client doesn't carry attachments.
+  virtual void TakeResponseAttachment(google::protobuf::RpcController* controller,
+                                      butil::IOBuf* attachment) {
+    attachment->clear();
+  }
 
   virtual void CallMethod(const google::protobuf::MethodDescriptor* method,
                           const google::protobuf::Message* request,
                           google::protobuf::Message* response,
                           google::protobuf::Closure* closure,
-                          bool* success);
-
-  void WarmUpChannel();
+                          bool* success,
+                          int64_t deadline_us = -1);
+
+  // Same as above, but the calls of 'routing_key', e.g. id of the user or
+  // item, go to the same node if the client hashes by it, i.e. its
+  // 'lb_policy' is "chash".
+  void CallMethod(uint64_t routing_key,
+                  const google::protobuf::MethodDescriptor* method,
+                  const google::protobuf::Message* request,
+                  google::protobuf::Message* response,
+                  google::protobuf::Closure* closure,
+                  bool* success,
+                  int64_t deadline_us = -1);
+
+  // Same as above, but the binary blobs, e.g. embedding vectors, are sent and
+  // received beside the messages as attachments, which are neither serialized
+  // nor copied. 'response_attachment' is set once the call succeeds, it refers
+  // to the receive buffer. Routed by 'routing_key' unless it's nullptr.
+  void CallMethod(const google::protobuf::MethodDescriptor* method,
+                  const google::protobuf::Message* request,
+                  const butil::IOBuf& request_attachment,
+                  google::protobuf::Message* response,
+                  butil::IOBuf* response_attachment,
+                  google::protobuf::Closure* closure,
+                  bool* success,
+                  int64_t deadline_us = -1,
+                  const uint64_t* routing_key = nullptr);
+
+  // Open the channels before the first call, blocking. Nothing by default,
+  // the channels are opened by the first calls then.
+  virtual void WarmUpChannel() {}
 
   const std::string& name() const { return name_; }
 
@@ -51,7 +112,20 @@ class RpcClient {
   uint32_t leader_request_timeout_ms_;
   uint32_t leader_hb_interval_s_;
 
+  // nullptr if the calls aren't hedged.
+  std::unique_ptr<RpcHedger> hedger_;
+
  private:
+  void DoCallMethod(const uint64_t* routing_key,
+                    const google::protobuf::MethodDescriptor* method,
+                    const google::protobuf::Message* request,
+                    google::protobuf::Message* response,
+                    google::protobuf::Closure* closure,
+                    bool* success,
+                    int64_t deadline_us,
+                    const butil::IOBuf* request_attachment = nullptr,
+                    butil::IOBuf* response_attachment = nullptr);
+
   ORC_DISALLOW_COPY_AND_ASSIGN(RpcClient);
 };
 
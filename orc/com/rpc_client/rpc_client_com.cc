@@ -1,4 +1,5 @@
 #include "orc/com/component_mgr.h"
+#include "orc/com/rpc_client/rpc_batcher.h"
 #include "orc/com/rpc_client/rpc_client_factory.h"
 #include "orc/util/log.h"
 
@@ -16,7 +17,10 @@ class RpcClientCom : public orc::Component {
     return true;
   }
 
-  void Release() override {}
+  void Release() override {
+    RpcBatcher::StopAll();
+    RpcHedger::StopTimer();
+  }
 };
 
 ORC_REGISTER_COM(RpcClientCom);
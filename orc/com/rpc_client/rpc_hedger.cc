@@ -0,0 +1,161 @@
+#include "orc/com/rpc_client/rpc_hedger.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "orc/util/utils.h"
+
+namespace orc {
+
+namespace {
+
+// The timer thread of the hedges of all clients.
+class HedgeTimer {
+ public:
+  static HedgeTimer* Instance() {
+    static HedgeTimer timer;
+    return &timer;
+  }
+
+  ~HedgeTimer() { Stop(); }
+
+  void Schedule(int64_t delay_us, std::function<void()> task) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopped_) return;
+    if (!worker_.joinable()) {
+      worker_ = std::thread([this]() { WorkLoop(); });
+    }
+    auto it = tasks_.emplace(NowUs() + delay_us, std::move(task));
+    if (it == tasks_.begin()) cond_.notify_one();
+  }
+
+  void Stop() {
+    std::multimap<int64_t, std::function<void()>> tasks;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopped_ = true;
+      tasks.swap(tasks_);
+    }
+    cond_.notify_all();
+    if (worker_.joinable()) worker_.join();
+  }
+
+ private:
+  HedgeTimer() : stopped_(false) {}
+
+  void WorkLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopped_) {
+      if (tasks_.empty()) {
+        cond_.wait(lock);
+        continue;
+      }
+
+      int64_t wait_us = tasks_.begin()->first - NowUs();
+      if (wait_us > 0) {
+        cond_.wait_for(lock, std::chrono::microseconds(wait_us));
+        continue;
+      }
+
+      auto task = std::move(tasks_.begin()->second);
+      tasks_.erase(tasks_.begin());
+      lock.unlock();
+      task();
+      // Released out of the lock too.
+      task = nullptr;
+      lock.lock();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::multimap<int64_t, std::function<void()>> tasks_;
+  bool stopped_;
+  std::thread worker_;
+};
+
+}  // anonymous namespace
+
+RpcHedger::RpcHedger(const Option& option)
+    : option_(option),
+      delay_us_(option.percentile == 0 ? option.delay_us : -1),
+      tokens_(kMaxTokens),
+      samples_(0) {
+  if (option_.percentile > 100) option_.percentile = 100;
+  for (auto& bucket : buckets_) bucket.store(0, std::memory_order_relaxed);
+}
+
+int64_t RpcHedger::DelayUs() {
+  // Every call earns its share of budget.
+  int64_t earned = option_.budget_percent * kCallTokens / 100;
+  if (tokens_.fetch_add(earned, std::memory_order_relaxed) + earned > kMaxTokens) {
+    tokens_.fetch_sub(earned, std::memory_order_relaxed);
+  }
+  return delay_us_.load(std::memory_order_relaxed);
+}
+
+bool RpcHedger::Acquire() {
+  int64_t tokens = tokens_.load(std::memory_order_relaxed);
+  while (tokens >= kCallTokens) {
+    if (tokens_.compare_exchange_weak(tokens, tokens - kCallTokens,
+                                      std::memory_order_relaxed)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void RpcHedger::Record(int64_t latency_us) {
+  if (option_.percentile == 0) return;
+  buckets_[Bucket(latency_us)].fetch_add(1, std::memory_order_relaxed);
+  if (samples_.fetch_add(1, std::memory_order_relaxed) % kWindow == kWindow - 1) {
+    UpdateDelay();
+  }
+}
+
+void RpcHedger::Schedule(int64_t delay_us, std::function<void()> task) {
+  HedgeTimer::Instance()->Schedule(delay_us, std::move(task));
+}
+
+void RpcHedger::StopTimer() {
+  HedgeTimer::Instance()->Stop();
+}
+
+int RpcHedger::Bucket(int64_t latency_us) {
+  if (latency_us < 16) return latency_us < 0 ? 0 : static_cast<int>(latency_us);
+  int exp = 63 - __builtin_clzll(static_cast<uint64_t>(latency_us));
+  int bucket = 16 + (exp - 4) * 4 + static_cast<int>((latency_us >> (exp - 2)) & 3);
+  return bucket < kBuckets ? bucket : kBuckets - 1;
+}
+
+int64_t RpcHedger::BucketUpperUs(int bucket) {
+  if (bucket < 16) return bucket + 1;
+  int exp = (bucket - 16) / 4 + 4;
+  return static_cast<int64_t>(4 + (bucket - 16) % 4 + 1) << (exp - 2);
+}
+
+void RpcHedger::UpdateDelay() {
+  // The latencies of the last window only.
+  int64_t counts[kBuckets];
+  int64_t total = 0;
+  for (int i = 0; i < kBuckets; ++i) {
+    counts[i] = buckets_[i].exchange(0, std::memory_order_relaxed);
+    total += counts[i];
+  }
+  if (total == 0) return;
+
+  int64_t rank = (total * option_.percentile + 99) / 100;
+  int64_t seen = 0;
+  for (int i = 0; i < kBuckets; ++i) {
+    seen += counts[i];
+    if (seen >= rank) {
+      delay_us_.store(BucketUpperUs(i), std::memory_order_relaxed);
+      return;
+    }
+  }
+}
+
+}  // namespace orc
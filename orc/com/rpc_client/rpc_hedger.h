@@ -0,0 +1,75 @@
+#ifndef ORC_COM_RPC_CLIENT_RPC_HEDGER_H_
+#define ORC_COM_RPC_CLIENT_RPC_HEDGER_H_
+
+#include <atomic>
+#include <functional>
+#include <string>
+
+#include "orc/util/macros.h"
+
+namespace orc {
+
+// Decides when a call of a RpcClient is hedged, i.e. a duplicate call is sent
+// to another node and the first response wins. The delay is either fixed or
+// a percentile of the latencies observed, and the duplicate calls are bounded
+// by a budget, which is a percent of the calls.
+class RpcHedger {
+ public:
+  struct Option {
+    Option() : delay_us(0), percentile(0), budget_percent(5) {}
+
+    // Fixed delay, used if 'percentile' is 0.
+    int64_t delay_us;
+    // e.g. 95 to hedge the calls slower than the observed p95.
+    uint32_t percentile;
+    uint32_t budget_percent;
+  };
+
+  explicit RpcHedger(const Option& option);
+
+  // Called once for every call, which earns its share of the budget. Return
+  // the delay of the call, -1 if it isn't hedged, e.g. there are not enough
+  // latencies observed yet.
+  int64_t DelayUs();
+
+  // Take the budget for one duplicate call.
+  bool Acquire();
+
+  // Latency of a successful call.
+  void Record(int64_t latency_us);
+
+  // Run 'task' in the timer thread after 'delay_us', it's dropped without
+  // running once the timer is stopped.
+  static void Schedule(int64_t delay_us, std::function<void()> task);
+
+  // Drop the tasks not run and stop the timer thread.
+  static void StopTimer();
+
+ private:
+  // Latencies below 16us have their own bucket, the others are bucketed by
+  // the highest 3 bits, i.e. the error is within 25%.
+  static const int kBuckets = 128;
+  // Calls observed for every update of the percentile delay.
+  static const int64_t kWindow = 1024;
+  // The budget is counted in 1/1000 of a call, and at most 10 calls can be
+  // saved for bursts.
+  static const int64_t kCallTokens = 1000;
+  static const int64_t kMaxTokens = 10 * kCallTokens;
+
+  static int Bucket(int64_t latency_us);
+  static int64_t BucketUpperUs(int bucket);
+
+  void UpdateDelay();
+
+  Option option_;
+  std::atomic<int64_t> delay_us_;
+  std::atomic<int64_t> tokens_;
+  std::atomic<int64_t> samples_;
+  std::atomic<int64_t> buckets_[kBuckets];
+
+  ORC_DISALLOW_COPY_AND_ASSIGN(RpcHedger);
+};
+
+}  // namespace orc
+
+#endif  // ORC_COM_RPC_CLIENT_RPC_HEDGER_H_
@@ -0,0 +1,443 @@
+#include "gtest/gtest.h"
+#include "orc/com/rpc_client/rpc_hedger.h"
+
+#include <unistd.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common/monitor/monitor_status.h"
+#include "google/protobuf/struct.pb.h"
+#include "orc/com/rpc_client/rpc_client.h"
+#include "orc/util/utils.h"
+#include "yaml-cpp/yaml.h"
+
+namespace orc {
+
+namespace {
+
+using google::protobuf::Value;
+
+class FakeController : public google::protobuf::RpcController {
+ public:
+  FakeController() : failed(false), canceled(false) {}
+
+  void Reset() override {}
+  bool Failed() const override { return failed; }
+  std::string ErrorText() const override { return failed ? "canceled" : ""; }
+  void StartCancel() override { canceled = true; }
+  void SetFailed(const std::string& reason) override { failed = true; }
+  bool IsCanceled() const override { return canceled; }
+  void NotifyOnCancel(google::protobuf::Closure* callback) override {}
+
+  std::atomic<bool> failed;
+  std::atomic<bool> canceled;
+  butil::IOBuf request_attachment;
+  butil::IOBuf response_attachment;
+};
+
+// Responds with its value after 'delay_ms', or fails once it's canceled. The
+// request attachment is echoed after the value. It's blocking if 'done' is
+// nullptr. CallMethod takes 'send_ms' to send the request.
+class FakeChannel : public google::protobuf::RpcChannel {
+ public:
+  FakeChannel(int64_t delay_ms, const std::string& value)
+      : delay_ms_(delay_ms), value_(value), send_ms(0), sending(false), calls(0), canceled(0) {}
+
+  void CallMethod(const google::protobuf::MethodDescriptor* method,
+                  google::protobuf::RpcController* controller,
+                  const google::protobuf::Message* request,
+                  google::protobuf::Message* response,
+                  google::protobuf::Closure* done) override {
+    ++calls;
+    auto ctrl = static_cast<FakeController*>(controller);
+    auto resp = static_cast<Value*>(response);
+    sending = true;
+    usleep(send_ms * 1000);
+    if (done == nullptr) {
+      Respond(ctrl, resp);
+    } else {
+      std::lock_guard<std::mutex> lock(mutex_);
+      threads_.emplace_back([this, ctrl, resp, done]() {
+                              Respond(ctrl, resp);
+                              done->Run();
+                            });
+    }
+    sending = false;
+  }
+
+  void Respond(FakeController* ctrl, Value* resp) {
+    int64_t end_us = NowUs() + delay_ms_ * 1000;
+    while (!ctrl->canceled && NowUs() < end_us) usleep(1000);
+    if (ctrl->canceled) {
+      ++canceled;
+      ctrl->SetFailed("canceled");
+    } else {
+      resp->set_string_value(value_);
+      ctrl->response_attachment.append(value_);
+      ctrl->response_attachment.append(ctrl->request_attachment);
+    }
+  }
+
+  void Join() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& thread : threads_) thread.join();
+    threads_.clear();
+  }
+
+ private:
+  int64_t delay_ms_;
+  std::string value_;
+  std::mutex mutex_;
+  std::vector<std::thread> threads_;
+
+ public:
+  std::atomic<int64_t> send_ms;
+  std::atomic<bool> sending;
+  std::atomic<int> calls;
+  std::atomic<int> canceled;
+};
+
+// The channels are picked in turn.
+class FakeClient : public RpcClient {
+ public:
+  FakeClient(int64_t first_delay_ms, int64_t second_delay_ms, bool attachment = true)
+      : RpcClient("fake_service", RpcClient::Type::Brpc, 0),
+        index(0),
+        freed(0),
+        first(first_delay_ms, "first"),
+        second(second_delay_ms, "second"),
+        third(first_delay_ms, "third"),
+        attachment_(attachment) {}
+
+  ~FakeClient() { Wait(); }
+
+  // Until all calls are done and freed, which may be in the hedge timer.
+  void Wait() {
+    first.Join();
+    second.Join();
+    third.Join();
+    for (int i = 0; i < 1000 && freed < first.calls + second.calls + third.calls; ++i) {
+      usleep(1000);
+    }
+  }
+
+  google::protobuf::RpcChannel* GetChannel() override {
+    return index++ % 2 == 0 ? &first : &second;
+  }
+  void FreeChannel(google::protobuf::RpcChannel* channel) override {}
+  google::protobuf::RpcController* GetController(int64_t timeout_ms) override {
+    return new FakeController();
+  }
+  void FreeController(google::protobuf::RpcController* controller) override {
+    delete controller;
+    ++freed;
+  }
+  bool SupportsAttachment() const override { return attachment_; }
+  void SetRequestAttachment(google::protobuf::RpcController* controller,
+                            const butil::IOBuf& attachment) override {
+    static_cast<FakeController*>(controller)->request_attachment.append(attachment);
+  }
+  void TakeResponseAttachment(google::protobuf::RpcController* controller,
+                              butil::IOBuf* attachment) override {
+    attachment->swap(static_cast<FakeController*>(controller)->response_attachment);
+  }
+
+  std::atomic<int> index;
+  std::atomic<int> freed;
+  FakeChannel first;
+  FakeChannel second;
+  // Another channel to the node of 'first'.
+  FakeChannel third;
+
+ private:
+  bool attachment_;
+};
+
+// Two channels to the first node as with 'leader_channel_count: 2', they're
+// picked in turn before the second node.
+class NodeClient : public FakeClient {
+ public:
+  NodeClient(int64_t first_delay_ms, int64_t second_delay_ms)
+      : FakeClient(first_delay_ms, second_delay_ms),
+        picks(0),
+        first_node(std::make_shared<leader::NodeStat>()),
+        second_node(std::make_shared<leader::NodeStat>()) {}
+
+  google::protobuf::RpcChannel* PickChannel(const uint64_t* routing_key,
+                                            std::shared_ptr<leader::NodeStat>* stat) override {
+    int pick = picks++;
+    if (pick < 2) {
+      *stat = first_node;
+      return pick == 0 ? &first : &third;
+    }
+    *stat = second_node;
+    return &second;
+  }
+
+  std::atomic<int> picks;
+  std::shared_ptr<leader::NodeStat> first_node;
+  std::shared_ptr<leader::NodeStat> second_node;
+};
+
+class WaitClosure : public google::protobuf::Closure {
+ public:
+  explicit WaitClosure(std::function<void()> on_run = nullptr)
+      : on_run_(std::move(on_run)), done(false) {}
+  void Run() override {
+    if (on_run_) on_run_();
+    done = true;
+  }
+
+  void Wait() {
+    for (int i = 0; i < 1000 && !done; ++i) usleep(1000);
+  }
+
+ private:
+  std::function<void()> on_run_;
+
+ public:
+  std::atomic<bool> done;
+};
+
+}  // anonymous namespace
+
+class RpcHedgerTest : public ::testing::Test {
+ public:
+  static void SetUpTestCase() {
+    remove("/tmp/rpc_hedger_test.dat");
+    MONITOR_STATUS_INIT("/tmp/rpc_hedger_test.dat");
+  }
+
+  static YAML::Node Config(int64_t hedge_delay_ms) {
+    YAML::Node config;
+    config["leader_server_path"] = "127.0.0.1:2181/fake";
+    config["leader_request_timeout"] = 1000;
+    config["leader_channel_count"] = 1;
+    config["leader_hb_interval"] = 1;
+    config["hedge_delay_ms"] = hedge_delay_ms;
+    return config;
+  }
+};
+
+TEST_F(RpcHedgerTest, Percentile) {
+  RpcHedger::Option option;
+  option.percentile = 95;
+  RpcHedger hedger(option);
+  ASSERT_EQ(-1, hedger.DelayUs());
+
+  for (int i = 1; i <= 1024; ++i) hedger.Record(i);
+  // p95 is 973us, in the bucket of [896, 1024).
+  ASSERT_EQ(1024, hedger.DelayUs());
+
+  // Updated by the next window.
+  for (int i = 0; i < 1024; ++i) hedger.Record(i % 2 == 0 ? 10 : 100000);
+  ASSERT_EQ(114688, hedger.DelayUs());
+}
+
+TEST_F(RpcHedgerTest, Budget) {
+  RpcHedger::Option option;
+  option.delay_us = 1000;
+  option.budget_percent = 10;
+  RpcHedger hedger(option);
+  ASSERT_EQ(1000, hedger.DelayUs());
+
+  // 10 calls are saved at most.
+  for (int i = 0; i < 10; ++i) ASSERT_TRUE(hedger.Acquire());
+  ASSERT_FALSE(hedger.Acquire());
+
+  for (int i = 0; i < 9; ++i) hedger.DelayUs();
+  ASSERT_FALSE(hedger.Acquire());
+  hedger.DelayUs();
+  ASSERT_TRUE(hedger.Acquire());
+  ASSERT_FALSE(hedger.Acquire());
+}
+
+TEST_F(RpcHedgerTest, Schedule) {
+  std::atomic<int> order(0), first(0), second(0);
+  RpcHedger::Schedule(20 * 1000, [&]() { second = ++order; });
+  RpcHedger::Schedule(1000, [&]() { first = ++order; });
+  for (int i = 0; i < 1000 && order < 2; ++i) usleep(1000);
+  ASSERT_EQ(1, first);
+  ASSERT_EQ(2, second);
+}
+
+TEST_F(RpcHedgerTest, Hedged) {
+  FakeClient client(500, 0);
+  ASSERT_TRUE(client.RpcClient::Init(Config(10)));
+
+  Value request, response;
+  bool success = false;
+  WaitClosure closure;
+  int64_t start_us = NowUs();
+  client.CallMethod(nullptr, &request, &response, &closure, &success);
+  closure.Wait();
+  ASSERT_TRUE(closure.done);
+  ASSERT_TRUE(success);
+  ASSERT_EQ("second", response.string_value());
+  ASSERT_LT(NowUs() - start_us, 400 * 1000);
+
+  // The slow one is canceled.
+  client.Wait();
+  ASSERT_EQ(1, client.first.calls);
+  ASSERT_EQ(1, client.first.canceled);
+  ASSERT_EQ(1, client.second.calls);
+}
+
+TEST_F(RpcHedgerTest, HedgedNode) {
+  NodeClient client(500, 0);
+  auto config = Config(10);
+  config["leader_channel_count"] = 2;
+  ASSERT_TRUE(client.RpcClient::Init(config));
+
+  // Not sent to the other channel of the slow node.
+  Value request, response;
+  bool success = false;
+  WaitClosure closure;
+  client.CallMethod(nullptr, &request, &response, &closure, &success);
+  closure.Wait();
+  ASSERT_TRUE(success);
+  ASSERT_EQ("second", response.string_value());
+
+  client.Wait();
+  ASSERT_EQ(1, client.first.calls);
+  ASSERT_EQ(1, client.first.canceled);
+  ASSERT_EQ(0, client.third.calls);
+  ASSERT_EQ(1, client.second.calls);
+}
+
+TEST_F(RpcHedgerTest, HedgeSending) {
+  FakeClient client(30, 500);
+  client.second.send_ms = 100;
+  ASSERT_TRUE(client.RpcClient::Init(Config(10)));
+
+  // The first one is done while the hedge is sending the request, which is
+  // the caller's once the closure runs.
+  Value request, response;
+  bool success = false;
+  std::atomic<bool> sending(true);
+  WaitClosure closure([&client, &sending]() { sending = client.second.sending.load(); });
+  client.CallMethod(nullptr, &request, &response, &closure, &success);
+  closure.Wait();
+  ASSERT_TRUE(closure.done);
+  ASSERT_FALSE(sending);
+  ASSERT_TRUE(success);
+  ASSERT_EQ("first", response.string_value());
+
+  // Canceled once sent.
+  client.Wait();
+  ASSERT_EQ(1, client.second.calls);
+  ASSERT_EQ(1, client.second.canceled);
+}
+
+TEST_F(RpcHedgerTest, NotHedged) {
+  FakeClient client(0, 0);
+  ASSERT_TRUE(client.RpcClient::Init(Config(50)));
+
+  Value request, response;
+  bool success = false;
+  WaitClosure closure;
+  client.CallMethod(nullptr, &request, &response, &closure, &success);
+  closure.Wait();
+  ASSERT_TRUE(success);
+  ASSERT_EQ("first", response.string_value());
+
+  // The hedge is dropped once the call is done.
+  usleep(100 * 1000);
+  client.Wait();
+  ASSERT_EQ(1, client.first.calls);
+  ASSERT_EQ(0, client.second.calls);
+}
+
+TEST_F(RpcHedgerTest, Disabled) {
+  FakeClient client(30, 0);
+  ASSERT_TRUE(client.RpcClient::Init(Config(0)));
+
+  Value request, response;
+  bool success = false;
+  WaitClosure closure;
+  client.CallMethod(nullptr, &request, &response, &closure, &success);
+  closure.Wait();
+  ASSERT_TRUE(success);
+  ASSERT_EQ("first", response.string_value());
+  client.Wait();
+  ASSERT_EQ(0, client.second.calls);
+}
+
+TEST_F(RpcHedgerTest, Attachment) {
+  FakeClient client(500, 0);
+  ASSERT_TRUE(client.RpcClient::Init(Config(10)));
+
+  // Sent by both calls, and taken from the winner.
+  Value request, response;
+  butil::IOBuf request_attachment, response_attachment;
+  request_attachment.append("blob");
+  bool success = false;
+  WaitClosure closure;
+  client.CallMethod(nullptr, &request, request_attachment, &response,
+                    &response_attachment, &closure, &success);
+  closure.Wait();
+  ASSERT_TRUE(success);
+  ASSERT_EQ("secondblob", response_attachment.to_string());
+  ASSERT_EQ("blob", request_attachment.to_string());
+  client.Wait();
+
+  FakeClient plain(0, 0);
+  ASSERT_TRUE(plain.RpcClient::Init(Config(0)));
+  WaitClosure plain_closure;
+  response_attachment.clear();
+  plain.CallMethod(nullptr, &request, request_attachment, &response,
+                   &response_attachment, &plain_closure, &success);
+  plain_closure.Wait();
+  ASSERT_TRUE(success);
+  ASSERT_EQ("firstblob", response_attachment.to_string());
+}
+
+TEST_F(RpcHedgerTest, SyncAttachment) {
+  // Not hedged without a closure.
+  FakeClient client(0, 0);
+  ASSERT_TRUE(client.RpcClient::Init(Config(10)));
+
+  Value request, response;
+  butil::IOBuf request_attachment, response_attachment;
+  request_attachment.append("blob");
+  bool success = false;
+  client.CallMethod(nullptr, &request, request_attachment, &response,
+                    &response_attachment, nullptr, &success);
+  ASSERT_TRUE(success);
+  ASSERT_EQ("first", response.string_value());
+  ASSERT_EQ("firstblob", response_attachment.to_string());
+  ASSERT_EQ(1, client.freed);
+  ASSERT_EQ(0, client.second.calls);
+}
+
+TEST_F(RpcHedgerTest, AttachmentUnsupported) {
+  FakeClient client(0, 0, false);
+  ASSERT_TRUE(client.RpcClient::Init(Config(0)));
+
+  // Failed instead of dropping the attachment.
+  Value request, response;
+  butil::IOBuf request_attachment, response_attachment;
+  request_attachment.append("blob");
+  bool success = true;
+  WaitClosure closure;
+  client.CallMethod(nullptr, &request, request_attachment, &response,
+                    &response_attachment, &closure, &success);
+  ASSERT_TRUE(closure.done);
+  ASSERT_FALSE(success);
+  ASSERT_EQ(0, client.first.calls);
+
+  // Not failed by an empty one.
+  request_attachment.clear();
+  success = false;
+  client.CallMethod(nullptr, &request, request_attachment, &response,
+                    &response_attachment, nullptr, &success);
+  ASSERT_TRUE(success);
+  ASSERT_EQ(1, client.first.calls);
+}
+
+}  // namespace orc
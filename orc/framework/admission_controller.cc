@@ -0,0 +1,115 @@
+#include "orc/framework/admission_controller.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+#include "orc/util/log.h"
+
+#include "common/monitor/monitor_status_impl.h"
+
+namespace orc {
+
+namespace {
+
+// The latency of a window may grow up to this times of the long-term latency
+// before the limit shrinks.
+const double kTolerance = 1.5;
+// Weight of a window in the long-term latency.
+const double kLongLatencyWeight = 0.05;
+// Weight of the new estimation in the limit.
+const double kSmoothing = 0.2;
+
+}  // anonymous namespace
+
+AdmissionController::AdmissionController(const Option& option)
+    : option_(option),
+      limit_(option.init_limit),
+      inflight_(0),
+      first_above_us_(0),
+      estimated_limit_(option.init_limit),
+      long_latency_us_(0),
+      window_sum_us_(0),
+      window_count_(0),
+      window_max_inflight_(0) {
+  if (option_.priority_ratio.empty()) option_.priority_ratio.push_back(1.0);
+  if (option_.window == 0) option_.window = 1;
+}
+
+bool AdmissionController::Acquire(int32_t priority) {
+  if (priority < 0) priority = 0;
+  size_t idx = std::min(static_cast<size_t>(priority), option_.priority_ratio.size() - 1);
+  double ratio = option_.priority_ratio[idx];
+  int32_t cap = std::max(1, static_cast<int32_t>(limit() * ratio));
+
+  if (inflight_.fetch_add(1) >= cap) {
+    --inflight_;
+    MONITOR_STATUS_NORMAL_COUNTER_BY("admission", "reject", 1);
+    return false;
+  }
+  return true;
+}
+
+void AdmissionController::Release(int64_t latency_us) {
+  int32_t inflight = inflight_.fetch_sub(1);
+  if (latency_us < 0) return;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  window_sum_us_ += latency_us;
+  window_max_inflight_ = std::max(window_max_inflight_, inflight);
+  if (++window_count_ < option_.window) return;
+
+  UpdateLimit(window_sum_us_ / window_count_, window_max_inflight_);
+  window_sum_us_ = 0;
+  window_count_ = 0;
+  window_max_inflight_ = 0;
+}
+
+void AdmissionController::UpdateLimit(int64_t avg_latency_us, int32_t max_inflight) {
+  double latency = std::max<double>(avg_latency_us, 1);
+  if (long_latency_us_ == 0) {
+    long_latency_us_ = latency;
+  } else {
+    long_latency_us_ = long_latency_us_ * (1 - kLongLatencyWeight) + latency * kLongLatencyWeight;
+    // Recovered from a long time overload, forget the high latency sooner.
+    if (long_latency_us_ > latency * 2) long_latency_us_ *= 0.9;
+  }
+
+  double gradient = std::max(0.5, std::min(1.0, kTolerance * long_latency_us_ / latency));
+  double new_limit = estimated_limit_ * gradient + sqrt(estimated_limit_);
+
+  // Don't grow the limit when the load doesn't reach it.
+  if (max_inflight < estimated_limit_ / 2) {
+    new_limit = std::min(new_limit, estimated_limit_);
+  }
+
+  estimated_limit_ = estimated_limit_ * (1 - kSmoothing) + new_limit * kSmoothing;
+  estimated_limit_ = std::max<double>(option_.min_limit, estimated_limit_);
+  estimated_limit_ = std::min<double>(option_.max_limit, estimated_limit_);
+
+  limit_.store(static_cast<uint32_t>(estimated_limit_), std::memory_order_relaxed);
+  MONITOR_STATUS_NORMAL_TIMER_BY("admission", "limit", limit() * 1000, 1);
+  ORC_DEBUG("Admission limit: %u, latency: %ld, long latency: %.0f.",
+            limit(), avg_latency_us, long_latency_us_);
+}
+
+bool AdmissionController::ShouldDrop(int32_t priority, int64_t queue_delay_us,
+                                     int64_t now_us) {
+  if (queue_delay_us < option_.queue_target_us) {
+    first_above_us_.store(0, std::memory_order_relaxed);
+    return false;
+  }
+
+  int64_t first_above_us = first_above_us_.load(std::memory_order_relaxed);
+  if (first_above_us == 0) {
+    first_above_us_.compare_exchange_strong(first_above_us, now_us + option_.queue_interval_us);
+    return false;
+  }
+
+  if (now_us < first_above_us || priority <= 0) return false;
+
+  MONITOR_STATUS_NORMAL_COUNTER_BY("admission", "drop", 1);
+  return true;
+}
+
+}  // namespace orc
@@ -0,0 +1,82 @@
+#ifndef ORC_FRAMEWORK_ADMISSION_CONTROLLER_H_
+#define ORC_FRAMEWORK_ADMISSION_CONTROLLER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "orc/util/macros.h"
+
+namespace orc {
+
+// Admission control in front of the worker ThreadPool.
+//
+// The concurrency limit adapts to the measured workflow latency (gradient
+// algorithm): every 'window' samples, the limit is scaled by the ratio of the
+// long-term latency to the latency of the window, so the limit shrinks as soon
+// as requests begin to queue up and grows back slowly when latency recovers.
+//
+// The queue delay is checked again when the request is dequeued (CoDel): once
+// the delay stays above 'queue_target_us' for 'queue_interval_us', requests
+// are dropped until the delay goes below the target.
+//
+// Priority 0 is the highest one. A request of priority 'p' is admitted while
+// inflight requests are under 'limit * priority_ratio[p]', and the highest
+// priority is never dropped by the queue delay.
+class AdmissionController {
+ public:
+  struct Option {
+    uint32_t init_limit;
+    uint32_t min_limit;
+    uint32_t max_limit;
+    uint32_t window;
+    int64_t queue_target_us;
+    int64_t queue_interval_us;
+    std::vector<double> priority_ratio;
+  };
+
+  explicit AdmissionController(const Option& option);
+  ~AdmissionController() = default;
+
+  // Take a slot for a new request, return false if it should be rejected.
+  bool Acquire(int32_t priority);
+
+  // Give back the slot, 'latency_us' < 0 means the request isn't finished
+  // normally and is not sampled.
+  void Release(int64_t latency_us);
+
+  // Called when the request is dequeued by a worker.
+  bool ShouldDrop(int32_t priority, int64_t queue_delay_us, int64_t now_us);
+
+  uint32_t limit() const { return limit_.load(std::memory_order_relaxed); }
+  int32_t inflight() const { return inflight_.load(std::memory_order_relaxed); }
+
+ private:
+  void UpdateLimit(int64_t avg_latency_us, int32_t max_inflight);
+
+ private:
+  Option option_;
+
+  std::atomic<uint32_t> limit_;
+  std::atomic<int32_t> inflight_;
+
+  // Time the queue delay stays above target until dropping, 0 means the delay
+  // is below target.
+  std::atomic<int64_t> first_above_us_;
+
+  std::mutex mutex_;
+  // All guarded by 'mutex_'.
+  double estimated_limit_;
+  double long_latency_us_;
+  int64_t window_sum_us_;
+  uint32_t window_count_;
+  int32_t window_max_inflight_;
+
+  ORC_DISALLOW_COPY_AND_ASSIGN(AdmissionController);
+};
+
+}  // namespace orc
+
+#endif  // ORC_FRAMEWORK_ADMISSION_CONTROLLER_H_
@@ -0,0 +1,95 @@
+#include "gtest/gtest.h"
+#include "orc/framework/admission_controller.h"
+#include "common/monitor/monitor_status.h"
+
+namespace orc {
+
+class AdmissionControllerTest : public ::testing::Test {
+ public:
+  static void SetUpTestCase() {
+    MONITOR_STATUS_INIT("/tmp/admission_controller_test.dat");
+  }
+
+  static AdmissionController::Option DefaultOption() {
+    AdmissionController::Option option;
+    option.init_limit = 10;
+    option.min_limit = 2;
+    option.max_limit = 100;
+    option.window = 10;
+    option.queue_target_us = 5000;
+    option.queue_interval_us = 100000;
+    option.priority_ratio = {1.0, 0.5};
+    return option;
+  }
+};
+
+TEST_F(AdmissionControllerTest, Priority) {
+  AdmissionController admission(DefaultOption());
+
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_TRUE(admission.Acquire(1));
+  }
+  // Lower priority only takes half of the limit.
+  ASSERT_FALSE(admission.Acquire(1));
+  ASSERT_FALSE(admission.Acquire(2));
+
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_TRUE(admission.Acquire(0));
+  }
+  ASSERT_FALSE(admission.Acquire(0));
+  ASSERT_EQ(10, admission.inflight());
+
+  admission.Release(-1);
+  ASSERT_TRUE(admission.Acquire(0));
+}
+
+TEST_F(AdmissionControllerTest, Gradient) {
+  AdmissionController admission(DefaultOption());
+
+  // Saturated with stable latency, the limit grows.
+  for (int round = 0; round < 10; ++round) {
+    for (int i = 0; i < 10; ++i) ASSERT_TRUE(admission.Acquire(0));
+    for (int i = 0; i < 10; ++i) admission.Release(1000);
+  }
+  uint32_t grown = admission.limit();
+  ASSERT_GT(grown, 10u);
+  ASSERT_LE(grown, 100u);
+
+  // Latency goes up, the limit shrinks.
+  for (int round = 0; round < 10; ++round) {
+    int n = 0;
+    while (n < 10 && admission.Acquire(0)) ++n;
+    for (int i = 0; i < n; ++i) admission.Release(10000);
+  }
+  ASSERT_LT(admission.limit(), grown);
+  ASSERT_GE(admission.limit(), 2u);
+
+  // Not saturated, the limit doesn't grow.
+  uint32_t limit = admission.limit();
+  for (int round = 0; round < 10; ++round) {
+    ASSERT_TRUE(admission.Acquire(0));
+    admission.Release(100);
+  }
+  ASSERT_LE(admission.limit(), limit);
+}
+
+TEST_F(AdmissionControllerTest, QueueDelay) {
+  AdmissionController admission(DefaultOption());
+
+  int64_t now = 1000000;
+  ASSERT_FALSE(admission.ShouldDrop(1, 1000, now));
+
+  // Above target, but not for a whole interval.
+  ASSERT_FALSE(admission.ShouldDrop(1, 6000, now));
+  ASSERT_FALSE(admission.ShouldDrop(1, 6000, now + 50000));
+
+  ASSERT_TRUE(admission.ShouldDrop(1, 6000, now + 100000));
+  // The highest priority is never dropped.
+  ASSERT_FALSE(admission.ShouldDrop(0, 6000, now + 100000));
+
+  // Below target, stop dropping.
+  ASSERT_FALSE(admission.ShouldDrop(1, 1000, now + 110000));
+  ASSERT_FALSE(admission.ShouldDrop(1, 6000, now + 120000));
+}
+
+}  // namespace orc
@@ -226,11 +226,16 @@ bool Application::Start() {
   // Setup log perameters.
   uint32_t max_log_length;
   std::string log_level;
+  uint32_t log_rate_limit;
+  uint32_t log_rate_burst;
   GetOrcConfig(Options::OrcLogMaxLength, &max_log_length);
   GetOrcConfig(Options::OrcLogLevel, &log_level);
+  GetOrcConfig(Options::OrcLogRateLimit, &log_rate_limit);
+  GetOrcConfig(Options::OrcLogRateBurst, &log_rate_burst);
 
   SetLogMaxLength(max_log_length);
   SetLogLevel(log_level);
+  SetLogRateLimit(log_rate_limit, log_rate_burst);
 
   // Daemonize
   bool daemon = true;;
@@ -22,6 +22,8 @@ static void DefaultConfig() {
   DEFAULT_CONFIG(Options::OrcErrFile,         "/dev/null");
   DEFAULT_CONFIG(Options::OrcLogMaxLength,    1024);
   DEFAULT_CONFIG(Options::OrcLogLevel,        "info");
+  DEFAULT_CONFIG(Options::OrcLogRateLimit,    10);
+  DEFAULT_CONFIG(Options::OrcLogRateBurst,    20);
 
   DEFAULT_CONFIG(Options::SvrIP,                      "0.0.0.0");
   DEFAULT_CONFIG(Options::SvrMaxRestartIntensity,     5);
@@ -33,6 +35,9 @@ static void DefaultConfig() {
   DEFAULT_CONFIG(Options::SvrWorkerQueueNum, 1);
   DEFAULT_CONFIG(Options::SvrWorkerQueueSize, 1024);
   DEFAULT_CONFIG(Options::SvrMonitorStatusFile, "/tmp/monitor_status.dat");
+  DEFAULT_CONFIG(Options::SvrMonitorExportInterval, 10000);
+  DEFAULT_CONFIG(Options::SvrMonitorExportPath, "/monitor_status/metrics");
+  DEFAULT_CONFIG(Options::SvrTraceExportPath, "/orc/trace");
 
 #undef DEFAULT_CONFIG
 }
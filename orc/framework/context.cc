@@ -15,22 +15,79 @@ namespace orc {
 Context::Context(SessionBase* session)
     : session_(session),
       node_(ExecutionNode::EndNode()),
-      next_edge_(false), is_async_(false),
+      end_node_(ExecutionNode::EndNode()),
+      next_edge_(false),
+      tracing_(false),
+      begin_us_(0),
+      async_begin_us_(0),
+      async_wait_us_(0),
+      deadline_us_(-1),
+      expired_(false),
+      is_async_(false),
       async_state_(AsyncState::Before),
       async_counter_(0),
       async_closure_(nullptr),
       schedule_hint_(-1),
       graph_(nullptr),
-      workflow_(nullptr) {}
+      workflow_(nullptr),
+      parent_(nullptr),
+      branch_index_(0),
+      fork_node_(nullptr),
+      join_counter_(0),
+      pending_size_(0) {}
 
 void Context::Setup(Workflow* workflow, ExecutionGraph* graph) {
   workflow_ = workflow;
   graph_ = graph;
   node_ = graph->entry();
+  end_node_ = ExecutionNode::EndNode();
+  parent_ = nullptr;
   walked_path_.clear();
   StepReset();
   gettimeofday(&start_time_, nullptr);
   lives_ = 1;
+
+  tracing_ = TraceRecorder::Instance()->enabled();
+  begin_us_ = static_cast<int64_t>(start_time_.tv_sec) * 1000000 + start_time_.tv_usec;
+  async_begin_us_ = 0;
+  async_wait_us_ = 0;
+  rpc_stat_.Reset();
+  spans_.clear();
+
+  expired_ = false;
+  deadline_us_ = -1;
+  if (graph->deadline_ms() > 0) {
+    deadline_us_ = static_cast<int64_t>(start_time_.tv_sec) * 1000000 +
+        start_time_.tv_usec + graph->deadline_ms() * 1000;
+  }
+  auto closure = session_->service_closure();
+  if (closure != nullptr && closure->deadline_us() > 0 &&
+      (deadline_us_ < 0 || closure->deadline_us() < deadline_us_)) {
+    deadline_us_ = closure->deadline_us();
+  }
+}
+
+void Context::SetupBranch(Context* parent, size_t index, ExecutionNode* entry,
+                          ExecutionNode* join) {
+  workflow_ = parent->workflow_;
+  graph_ = parent->graph_;
+  node_ = entry;
+  end_node_ = join;
+  parent_ = parent;
+  branch_index_ = index;
+  schedule_hint_ = parent->schedule_hint_;
+  deadline_us_ = parent->deadline_us_;
+  expired_ = false;
+  walked_path_.clear();
+  StepReset();
+  gettimeofday(&start_time_, nullptr);
+  lives_ = 1;
+
+  tracing_ = parent->tracing_;
+  async_begin_us_ = 0;
+  async_wait_us_ = 0;
+  rpc_stat_.Reset();
+  spans_.clear();
 }
 
 void Context::Reset() {
@@ -38,6 +95,7 @@ void Context::Reset() {
   graph_ = nullptr;
   node_ = nullptr;
   walked_path_.clear();
+  spans_.clear();
   schedule_hint_ = -1;
   StepReset();
   --lives_;
@@ -48,6 +106,97 @@ void Context::Callback() {
   workflow_->Run(this);
 }
 
+bool Context::Fork(ExecutionNode* node) {
+  if (async_state() == AsyncState::After) {
+    // Resumed by the last branch.
+    set_async_state(AsyncState::Finish);
+    MergeBranchSpans();
+    return true;
+  }
+
+  const auto& entries = node->branches();
+  while (branches_.size() < entries.size()) {
+    branches_.emplace_back(new Context(session_));
+  }
+
+  for (size_t i = 0; i < entries.size(); ++i) {
+    branches_[i]->SetupBranch(this, i, entries[i], node->true_next());
+  }
+
+  bool is_dag = (node->type() == ExecutionNode::Type::Dag);
+  if (is_dag) {
+    if (pending_size_ < entries.size()) {
+      pending_.reset(new std::atomic<int32_t>[entries.size()]);
+      pending_size_ = entries.size();
+    }
+    for (size_t i = 0; i < entries.size(); ++i) {
+      pending_[i] = node->in_degree(i);
+    }
+  }
+
+  fork_node_ = node;
+
+  // One more for this Context, so no branch can resume it before all
+  // branches are started.
+  join_counter_ = static_cast<int32_t>(entries.size()) + 1;
+  SetAsync(true);
+
+  // The last ready branch runs in current thread.
+  Context* ready = nullptr;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    if (is_dag && node->in_degree(i) != 0) continue;
+    if (ready != nullptr) workflow_->RunBranch(ready, false);
+    ready = branches_[i].get();
+  }
+  workflow_->RunBranch(ready, true);
+
+  if (Join()) {
+    // All branches are finished in current thread.
+    SetAsync(false);
+    MergeBranchSpans();
+  }
+
+  return true;
+}
+
+Context* Context::JoinBranch(Context* branch) {
+  // Like 'Fork', the last ready branch continues in current thread. It's run
+  // by the caller rather than here, so a long chain of 'Dag' branches doesn't
+  // grow the stack.
+  Context* ready = nullptr;
+  if (fork_node_->type() == ExecutionNode::Type::Dag) {
+    for (auto idx : fork_node_->successors(branch->branch_index_)) {
+      if ((--pending_[idx]) != 0) continue;
+      if (ready != nullptr) workflow_->RunBranch(ready, false);
+      ready = branches_[idx].get();
+    }
+  }
+
+  // Not the last one if a branch is ready, it's joined later.
+  if (Join()) {
+    // The last branch resumes this Context.
+    Callback();
+  }
+  return ready;
+}
+
+void Context::MergeBranchSpans() {
+  if (!tracing_) return;
+
+  for (size_t i = 0; i < fork_node_->branches().size(); ++i) {
+    for (auto span : branches_[i]->spans_) {
+      // The nested branches keep their lanes.
+      if (span.lane == 0) span.lane = static_cast<uint32_t>(i + 1);
+      spans_.emplace_back(span);
+    }
+  }
+}
+
+void Context::CommitTrace() {
+  if (!tracing_) return;
+  TraceRecorder::Instance()->Commit(graph_->name(), begin_us_, NowUs(), spans_);
+}
+
 bool Context::IsAsync() {
   return is_async_ && ((async_counter_--) > 0);
 }
@@ -60,11 +209,55 @@ void Context::SetAsync(bool async) {
   is_async_ = async;
 }
 
+void Context::Expire() {
+  expired_ = true;
+  MONITOR_STATUS_NORMAL_COUNTER_BY("deadline", graph_->name().c_str(), 1);
+
+  if (parent_ != nullptr) {
+    // The root Context decides what to do after all branches are joined.
+    set_node(end_node_);
+    return;
+  }
+
+  auto fallback = graph_->fallback();
+  if (fallback != nullptr) {
+    set_node(fallback);
+    return;
+  }
+
+  set_node(ExecutionNode::EndNode());
+  auto closure = session_->service_closure();
+  if (closure != nullptr) {
+    closure->set_ret_code(ServiceClosure::RetCode::Timeout);
+    closure->set_message(std::string("Orc deadline exceeded"));
+  }
+}
+
 void Context::Step() {
+  // Don't interrupt the node waiting for its async callback. Once expired, the
+  // rest steps (i.e. the fallback node) run to the end.
+  if (deadline_us_ > 0 && !expired_ &&
+      async_state() == AsyncState::Before && NowUs() >= deadline_us_) {
+    Expire();
+    return;
+  }
+
+  if (tracing_) {
+    if (async_begin_us_ > 0 && async_state() == AsyncState::After) {
+      async_wait_us_ += NowUs() - async_begin_us_;
+      async_begin_us_ = 0;
+    }
+    TraceRecorder::SetCurrentRpcStat(&rpc_stat_);
+  }
+
   node()->Run(session_, this);
 
+  if (tracing_) TraceRecorder::SetCurrentRpcStat(nullptr);
   if ((!is_async_) || (async_state() == AsyncState::Finish)) {
     NextStep();
+  } else if (tracing_) {
+    // Written before 'IsAsync', so it's seen by the thread resuming it.
+    async_begin_us_ = NowUs();
   }
 }
 
@@ -77,7 +270,21 @@ void Context::NextStep() {
   int64_t escape = (now.tv_sec - start_time_.tv_sec) * 1000000;
   escape += now.tv_usec - start_time_.tv_usec;
 
-  MONITOR_STATUS_NORMAL_TIMER_BY("handler", node()->name().c_str(), escape, 1);
+  MONITOR_STATUS_SHARDED_TIMER_BY("handler", node()->name().c_str(), escape, 1);
+
+  if (tracing_) {
+    TraceSpan span;
+    span.name = &node()->name();
+    span.lane = 0;
+    span.start_us = static_cast<int64_t>(start_time_.tv_sec) * 1000000 + start_time_.tv_usec;
+    span.end_us = span.start_us + escape;
+    span.wait_us = async_wait_us_;
+    span.rpc_count = rpc_stat_.count.load(std::memory_order_relaxed);
+    span.rpc_retries = rpc_stat_.retries.load(std::memory_order_relaxed);
+    spans_.emplace_back(span);
+    async_wait_us_ = 0;
+    rpc_stat_.Reset();
+  }
 
   memcpy(&start_time_, &now, sizeof(now));
 
@@ -101,7 +308,7 @@ void Context::StepReset() {
 }
 
 bool Context::IsDone() {
-  return node_ == ExecutionNode::EndNode();
+  return node_ == end_node_ || node_ == ExecutionNode::EndNode();
 }
 
 }  // namespace orc
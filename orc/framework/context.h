@@ -4,9 +4,11 @@
 #include <sys/time.h>
 
 #include <atomic>
+#include <memory>
 #include <vector>
 #include <functional>
 
+#include "orc/framework/trace_recorder.h"
 #include "orc/util/closure.h"
 
 namespace orc {
@@ -25,6 +27,22 @@ class Context {
   void Setup(Workflow* workflow, ExecutionGraph* graph);
   void Reset();
 
+  // Start the branches of the 'Fork' or 'Dag' node, each branch walks in its
+  // own Context from the branch entry until the join node. The Context stays
+  // async until the last branch reaches the join node.
+  // All branches share the SessionBase of the request and may run at the same
+  // time in different workers, so the handlers of the branches must not write
+  // the same session data, see the inputs and outputs of handler config.
+  bool Fork(ExecutionNode* node);
+
+  // Called when the 'branch' reaches the join node. For 'Dag' node, the
+  // branches depend on it are started if they are ready, the last ready one is
+  // returned to continue in current thread, nullptr if none.
+  Context* JoinBranch(Context* branch);
+
+  // Not nullptr for branch Context.
+  Context* parent() const { return parent_; }
+
   void Callback();
 
   void set_schedule_hint(int32_t hint) { schedule_hint_ = hint; }
@@ -36,6 +54,11 @@ class Context {
 
   void Step();
 
+  // Deadline of the request since the Epoch in microseconds, -1 means no
+  // deadline. It's the earlier one of the deadline from ServiceClosure and the
+  // deadline configured for the workflow.
+  int64_t deadline_us() const { return deadline_us_; }
+
   Workflow* workflow() const { return workflow_; }
 
   ExecutionNode* node() const { return node_; }
@@ -57,18 +80,50 @@ class Context {
 
   const std::vector<ExecutionNode*>& walked_path() const { return walked_path_; }
 
+  // Steps of the request, recorded if TraceRecorder is enabled when the
+  // request starts. The spans of the branches are merged when they are joined.
+  const std::vector<TraceSpan>& spans() const { return spans_; }
+  // Called by the root Context when the request ends, before the
+  // ExecutionGraph is released.
+  void CommitTrace();
+
  private:
+  void SetupBranch(Context* parent, size_t index, ExecutionNode* entry,
+                   ExecutionNode* join);
+
+  // Called once by every branch of the current Fork, and once by the Context
+  // itself after all branches are started. Return true for the last one.
+  bool Join() { return (--join_counter_) == 0; }
+
+  // Called by 'Step' when the deadline is exceeded. The branch Context jumps to
+  // the join node, the root Context jumps to the fallback node or ends.
+  void Expire();
   void StepReset();
   void NextStep();
+  // Take the spans of the branches of the current Fork.
+  void MergeBranchSpans();
 
  private:
   SessionBase* session_;
 
   ExecutionNode* node_;
+  // 'EndNode' for the root Context, the join node for branch Context.
+  ExecutionNode* end_node_;
   bool next_edge_;
   std::vector<ExecutionNode*> walked_path_;
   struct timeval start_time_;
 
+  bool tracing_;
+  int64_t begin_us_;
+  // Set when the node goes async, the wait is added when it's resumed.
+  int64_t async_begin_us_;
+  int64_t async_wait_us_;
+  TraceRpcStat rpc_stat_;
+  std::vector<TraceSpan> spans_;
+
+  int64_t deadline_us_;
+  bool expired_;
+
   bool is_async_;
   std::atomic<AsyncState> async_state_;
   std::atomic<int32_t> async_counter_;
@@ -79,6 +134,16 @@ class Context {
   Workflow* workflow_;
 
   int32_t lives_;
+
+  Context* parent_;
+  size_t branch_index_;
+  ExecutionNode* fork_node_;
+  std::atomic<int32_t> join_counter_;
+  // Reused by the Fork nodes of this Context.
+  std::vector<std::unique_ptr<Context>> branches_;
+  // Count of the unfinished dependencies of each 'Dag' branch.
+  std::unique_ptr<std::atomic<int32_t>[]> pending_;
+  size_t pending_size_;
 };
 
 }  // namespace orc
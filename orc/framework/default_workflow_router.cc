@@ -8,8 +8,16 @@ class DefaultWorkflowRouter : public WorkflowRouter {
   DefaultWorkflowRouter() = default;
   virtual ~DefaultWorkflowRouter() = default;
 
-  bool Init(const YAML::Node& config) override { return true; }
+  bool Init(const YAML::Node& config) override {
+    id_ = ExecutionGraphMgr::Instance()->GetGraphId("default");
+    return true;
+  }
+
   std::string Route(SessionBase* session) override { return "default"; }
+  int32_t RouteId(SessionBase* session) override { return id_; }
+
+ private:
+  int32_t id_;
 };
 
 ORC_REGISTER_WORKFLOW_ROUTER(DefaultWorkflowRouter);
@@ -1,52 +1,129 @@
 #include "orc/framework/execution_graph.h"
 #include "orc/framework/execution_node.h"
+#include "orc/framework/handler_mgr.h"
 
 #include "orc/util/log.h"
 
 namespace orc {
 
-std::unique_ptr<ExecutionGraph> ExecutionGraph::Clone() const {
-  auto graph = std::unique_ptr<ExecutionGraph>(new ExecutionGraph(name_));
-  for (const auto& entry : nodes_) {
-    auto node = entry.second->Clone();
-    if (!node) {
-      ORC_ERROR("Clone fail for can't node: %s clone fail.", entry.first.c_str());
+void ExecutionTopology::AddNode(const std::string& name,
+                                std::unique_ptr<ExecutionNode> node) {
+  nodes_[name] = std::move(node);
+}
+
+ExecutionNode* ExecutionTopology::GetNode(const std::string& name) const {
+  auto it = nodes_.find(name);
+  if (it == nodes_.end()) return nullptr;
+  return it->second.get();
+}
+
+int32_t ExecutionTopology::AddHandler(const std::string& handler_name) {
+  handler_names_.emplace_back(handler_name);
+  return static_cast<int32_t>(handler_names_.size() - 1);
+}
+
+std::unique_ptr<ExecutionGraph> ExecutionGraph::New(
+    const std::shared_ptr<const ExecutionTopology>& topology) {
+  std::unique_ptr<ExecutionGraph> graph(new ExecutionGraph(topology));
+  for (const auto& name : topology->handler_names()) {
+    auto handler = HandlerMgr::Instance()->GetHandler(name);
+    if (!handler) {
+      ORC_ERROR("New ExecutionGraph: %s fail for can't get handler by name: %s",
+                topology->name().c_str(), name.c_str());
       return nullptr;
     }
-    graph->nodes_.emplace(entry.first, std::move(node));
+    graph->handlers_.emplace_back(std::move(handler));
   }
+  return graph;
+}
 
-  for (const auto& entry : nodes_) {
-    auto true_next = entry.second->true_next();
-    auto false_next = entry.second->false_next();
+bool ExecutionGraphPool::Init(std::unique_ptr<ExecutionGraph> graph, size_t size,
+                              bool shared) {
+  shared_ = shared;
+  if (shared_) size = 1;
 
-    if (true_next == ExecutionNode::EndNode()) {
-      graph->nodes_[entry.first]->set_true_next(ExecutionNode::EndNode());
-    } else {
-      graph->nodes_[entry.first]->set_true_next(graph->nodes_[true_next->name()].get());
-    }
+  graphs_.reserve(size);
+  for (size_t i = 1; i < size; ++i) {
+    auto cl_graph = graph->Clone();
+    if (!cl_graph) return false;
+    graphs_.emplace_back(std::move(cl_graph));
+  }
+  graphs_.emplace_back(std::move(graph));
 
-    if (false_next == ExecutionNode::EndNode()) {
-      graph->nodes_[entry.first]->set_false_next(ExecutionNode::EndNode());
-    } else {
-      graph->nodes_[entry.first]->set_false_next(graph->nodes_[false_next->name()].get());
-    }
+  for (size_t i = 0; i < graphs_.size(); ++i) {
+    graphs_[i]->pool_ = this;
+    graphs_[i]->slot_ = static_cast<uint32_t>(i);
   }
 
-  graph->version_ = version_;
-  graph->entry_ = graph->nodes_[entry_->name()].get();
+  // Pushed in reverse order, so the first instance is on the top.
+  for (size_t i = graphs_.size(); i > 0; --i) {
+    Push(graphs_[i - 1].get());
+  }
+  return true;
+}
+
+const uint64_t ExecutionGraphPool::kRetired;
+
+ExecutionGraph* ExecutionGraphPool::Get() {
+  auto graph = shared_ ? graphs_[0].get() : Pop();
+  if (graph != nullptr) refs_.fetch_add(1, std::memory_order_relaxed);
   return graph;
 }
 
-void ExecutionGraph::AddNode(const std::string& name,
-                             std::unique_ptr<ExecutionNode> node) {
-  nodes_[name] = std::move(node);
+void ExecutionGraphPool::Release(ExecutionGraph* graph) {
+  if (!shared_) Push(graph);
+
+  if (refs_.fetch_sub(1, std::memory_order_acq_rel) == kRetired + 1) {
+    // The last instance of a retired pool.
+    delete this;
+  }
 }
 
-ExecutionNode* ExecutionGraph::GetNode(const std::string& name) const {
-  auto it = nodes_.find(name);
-  if (it == nodes_.end()) return nullptr;
-  return it->second.get();
+void ExecutionGraphPool::Retire() {
+  if (refs_.fetch_add(kRetired, std::memory_order_acq_rel) == 0) {
+    delete this;
+  }
+}
+
+ExecutionGraph* ExecutionGraphPool::Pop() {
+  uint64_t head = head_.load(std::memory_order_acquire);
+  while (true) {
+    uint32_t top = static_cast<uint32_t>(head);
+    if (top == 0) return nullptr;
+
+    ExecutionGraph* graph = graphs_[top - 1].get();
+    // 'next_' may be stale if the top is taken by others, then the tag has
+    // been changed and the CAS fails.
+    uint64_t next = ((head >> 32) + 1) << 32 | graph->next_.load(std::memory_order_relaxed);
+    if (head_.compare_exchange_weak(head, next, std::memory_order_acquire,
+                                    std::memory_order_acquire)) {
+      return graph;
+    }
+  }
+}
+
+void ExecutionGraphPool::Push(ExecutionGraph* graph) {
+  uint64_t head = head_.load(std::memory_order_relaxed);
+  while (true) {
+    graph->next_.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+    uint64_t next = ((head >> 32) + 1) << 32 | (graph->slot_ + 1);
+    if (head_.compare_exchange_weak(head, next, std::memory_order_release,
+                                    std::memory_order_relaxed)) {
+      return;
+    }
+  }
+}
+
+size_t ExecutionGraphPool::FreeSize() const {
+  if (shared_) return 1;
+
+  size_t n = 0;
+  uint32_t top = static_cast<uint32_t>(head_.load());
+  while (top != 0) {
+    ++n;
+    top = graphs_[top - 1]->next_.load();
+  }
+  return n;
 }
 
 }  // namespace orc
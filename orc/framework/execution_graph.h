@@ -1,43 +1,159 @@
 #ifndef ORC_FRAMEWORK_EXECUTION_GRAPH_H_
 #define ORC_FRAMEWORK_EXECUTION_GRAPH_H_
 
+#include <atomic>
 #include <map>
 #include <string>
 #include <memory>
+#include <vector>
 
 #include "orc/util/macros.h"
 #include "orc/framework/execution_node.h"
+#include "orc/framework/handler_base.h"
 
 namespace orc {
 
-class ExecutionGraph {
+// The immutable part of a workflow: the nodes and edges, built once and shared
+// by all ExecutionGraph instances of the workflow.
+class ExecutionTopology {
  public:
-  explicit ExecutionGraph(const std::string& name) : name_(name), entry_(nullptr) {}
-  ~ExecutionGraph() = default;
-
-  std::unique_ptr<ExecutionGraph> Clone() const;
-
-  ExecutionNode* entry() const { return entry_; }
-  void set_entry(ExecutionNode* entry) { entry_ = entry; }
+  explicit ExecutionTopology(const std::string& name)
+      : name_(name), id_(-1), version_(0), deadline_ms_(0),
+        entry_(nullptr), fallback_(nullptr) {}
+  ~ExecutionTopology() = default;
 
   const std::string& name() const { return name_; }
 
+  void set_id(int32_t id) { id_ = id; }
+  int32_t id() const { return id_; }
+
   void set_version(uint32_t version) { version_ = version; }
   uint32_t version() const { return version_; }
 
+  // Time budget of a request in milliseconds, 0 means no limit.
+  void set_deadline_ms(int64_t deadline_ms) { deadline_ms_ = deadline_ms; }
+  int64_t deadline_ms() const { return deadline_ms_; }
+
+  ExecutionNode* entry() const { return entry_; }
+  void set_entry(ExecutionNode* entry) { entry_ = entry; }
+
+  // Run once when the deadline is exceeded, nullptr means ending the workflow
+  // directly.
+  ExecutionNode* fallback() const { return fallback_; }
+  void set_fallback(ExecutionNode* fallback) { fallback_ = fallback; }
+
   void AddNode(const std::string& name, std::unique_ptr<ExecutionNode> node);
   ExecutionNode* GetNode(const std::string& name) const;
 
+  // Number a handler node, return the index of its handler in ExecutionGraph.
+  int32_t AddHandler(const std::string& handler_name);
+  const std::vector<std::string>& handler_names() const { return handler_names_; }
+
  private:
   std::string name_;
+  int32_t id_;
   uint32_t version_;
+  int64_t deadline_ms_;
 
   ExecutionNode* entry_;
+  ExecutionNode* fallback_;
   std::map<std::string, std::unique_ptr<ExecutionNode>> nodes_;
+  std::vector<std::string> handler_names_;
+
+  ORC_DISALLOW_COPY_AND_ASSIGN(ExecutionTopology);
+};
+
+class ExecutionGraphPool;
+
+// An instance of workflow used by one request at a time (or by all requests
+// in singleton mode), it only keeps the handlers, which may have per request
+// state.
+class ExecutionGraph {
+ public:
+  ~ExecutionGraph() = default;
+
+  // Return nullptr if any handler can't be created.
+  static std::unique_ptr<ExecutionGraph> New(
+      const std::shared_ptr<const ExecutionTopology>& topology);
+
+  std::unique_ptr<ExecutionGraph> Clone() const { return New(topology_); }
+
+  const ExecutionTopology* topology() const { return topology_.get(); }
+
+  const std::string& name() const { return topology_->name(); }
+  int32_t id() const { return topology_->id(); }
+  uint32_t version() const { return topology_->version(); }
+  int64_t deadline_ms() const { return topology_->deadline_ms(); }
+  ExecutionNode* entry() const { return topology_->entry(); }
+  ExecutionNode* fallback() const { return topology_->fallback(); }
+  ExecutionNode* GetNode(const std::string& name) const { return topology_->GetNode(name); }
+
+  HandlerBase* handler(int32_t index) const { return handlers_[index].get(); }
+
+  ExecutionGraphPool* pool() const { return pool_; }
+
+ private:
+  explicit ExecutionGraph(const std::shared_ptr<const ExecutionTopology>& topology)
+      : topology_(topology), pool_(nullptr), slot_(0), next_(0) {}
+
+  friend class ExecutionGraphPool;
+
+  std::shared_ptr<const ExecutionTopology> topology_;
+  std::vector<std::unique_ptr<HandlerBase>> handlers_;
+
+  ExecutionGraphPool* pool_;
+  // Index in the pool and the link of the free list, see ExecutionGraphPool.
+  uint32_t slot_;
+  std::atomic<uint32_t> next_;
 
   ORC_DISALLOW_COPY_AND_ASSIGN(ExecutionGraph);
 };
 
+// Fixed size pool of ExecutionGraph instances of a workflow. The free
+// instances are kept in a lock-free stack, the head packs the slot of the top
+// instance and a tag bumped by every update against ABA.
+class ExecutionGraphPool {
+ public:
+  ExecutionGraphPool() : shared_(false), head_(0), refs_(0) {}
+  ~ExecutionGraphPool() = default;
+
+  // Clone 'graph' to 'size' instances. If 'shared' (singleton mode), 'graph'
+  // is the only instance and it's shared by all requests.
+  bool Init(std::unique_ptr<ExecutionGraph> graph, size_t size, bool shared);
+
+  // Return nullptr if all instances are in use.
+  ExecutionGraph* Get();
+  // The pool may be deleted by the release of its last instance, see Retire.
+  void Release(ExecutionGraph* graph);
+
+  // Called when no one can Get from the pool any more, i.e. it's replaced by
+  // reload and the readers are gone. The pool deletes itself once all
+  // instances are released, now or by the last Release.
+  void Retire();
+
+  size_t size() const { return graphs_.size(); }
+  // Requests running on the instances, counted in singleton mode too.
+  uint32_t InUse() const { return static_cast<uint32_t>(refs_.load()); }
+  // Not thread-safe, for debug only.
+  size_t FreeSize() const;
+
+ private:
+  ExecutionGraph* Pop();
+  void Push(ExecutionGraph* graph);
+
+  static const uint64_t kRetired = 1ull << 32;
+
+ private:
+  bool shared_;
+  std::vector<std::unique_ptr<ExecutionGraph>> graphs_;
+  // Low 32 bits: slot + 1 of the top instance, 0 for empty. High 32 bits: tag.
+  std::atomic<uint64_t> head_;
+  // Low 32 bits: instances in use. kRetired is added by Retire.
+  std::atomic<uint64_t> refs_;
+
+  ORC_DISALLOW_COPY_AND_ASSIGN(ExecutionGraphPool);
+};
+
 }  // namespace orc
 
 
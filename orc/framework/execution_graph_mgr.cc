@@ -1,8 +1,11 @@
 #include "orc/framework/execution_graph_mgr.h"
 
 #include <map>
+#include <set>
 #include <string>
 #include <memory>
+#include <thread>
+#include <vector>
 
 #include "orc/workflow/graph.h"
 #include "orc/workflow/compiler.h"
@@ -15,10 +18,26 @@
 
 namespace orc {
 
-thread_local ExecutionGraphMgr::ExeGraphsMap ExecutionGraphMgr::tls_exe_graphs_;
+const int32_t ExecutionGraphMgr::kMaxGraphNum;
+const uint32_t ExecutionGraphMgr::kReaderShards;
 
 ExecutionGraphMgr::ExecutionGraphMgr()
-    : version_(0) {}
+    : optimize_(false), dump_(false), version_(0), graph_ids_(new GraphIds()), epoch_(0) {
+  for (int32_t i = 0; i < kMaxGraphNum; ++i) {
+    pools_[i].store(nullptr);
+  }
+  for (auto& shards : readers_) {
+    for (auto& shard : shards) shard.count.store(0);
+  }
+}
+
+ExecutionGraphMgr::~ExecutionGraphMgr() {
+  for (int32_t i = 0; i < kMaxGraphNum; ++i) {
+    auto pool = pools_[i].exchange(nullptr);
+    if (pool != nullptr) pool->Retire();
+  }
+  delete graph_ids_.exchange(nullptr);
+}
 
 ExecutionGraphMgr* ExecutionGraphMgr::Instance() {
   static ExecutionGraphMgr mgr;
@@ -51,181 +70,403 @@ bool ExecutionGraphMgr::Setup(const YAML::Node& config) {
   std::string file;
   ORC_CONFIG_OR_FAIL(config, Options::SvrWorkflowFile, file);
 
-  size_t worker_num;
-  ORC_CONFIG_OR_FAIL(config, Options::SvrWorkerNum, worker_num);
-  size_t tls_size = pool_size / worker_num;
-
+  ORC_CONFIG_OR_DEFAULT(config, Options::SvrWorkflowDeadline, deadlines_,
+                        (std::map<std::string, int64_t>()));
+  ORC_CONFIG_OR_DEFAULT(config, Options::SvrWorkflowFallback, fallbacks_,
+                        (std::map<std::string, std::string>()));
+  ORC_CONFIG_OR_DEFAULT(config, Options::SvrWorkflowOptimize, optimize_, false);
+  ORC_CONFIG_OR_DEFAULT(config, Options::SvrWorkflowDump, dump_, false);
 
   bool use_tls = false;
-  ORC_CONFIG_OR_DEFAULT(config, Options::SvrWorkflowUseTls, use_tls, false);
+  if (GetOrcConfig(config, Options::SvrWorkflowUseTls, &use_tls)) {
+    ORC_WARN("Option '%s' is deprecated and ignored, the graph pools are shared lock-free.",
+             Options::SvrWorkflowUseTls.c_str());
+  }
+
+  bool hot_reload;
+  ORC_CONFIG_OR_DEFAULT(config, Options::SvrWorkflowHotReload, hot_reload, false);
+
+  if (!ReloadGraph(mode, pool_size, file)) return false;
+  if (!hot_reload) return true;
+
+  std::string handler_file;
+  ORC_CONFIG_OR_FAIL(config, Options::SvrHandlerFile, handler_file);
+  return Watch(file, handler_file);
+}
+
+void ExecutionGraphMgr::Stop() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto cookie : cookies_) {
+    FileMonitor::Instance()->Forget(cookie);
+  }
+  cookies_.clear();
+}
+
+bool ExecutionGraphMgr::Watch(const std::string& workflow_file,
+                              const std::string& handler_file) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Watched by the former Setup.
+  if (!cookies_.empty()) return true;
+
+  auto action = [this](const std::string& file, FileMonitor::Event event) {
+    OnFileChange(file, event);
+  };
+  for (const auto& file : {workflow_file, handler_file}) {
+    auto cookie = FileMonitor::Instance()->Observe(file, action);
+    if (cookie == nullptr) {
+      ORC_ERROR("Watch file: %s fail.", file.c_str());
+      return false;
+    }
+    cookies_.emplace_back(cookie);
+  }
+
+  handler_file_ = handler_file;
+  ORC_INFO("Hot reload is enabled for %s and %s.",
+           workflow_file.c_str(), handler_file.c_str());
+  return true;
+}
+
+void ExecutionGraphMgr::OnFileChange(const std::string& file,
+                                     FileMonitor::Event event) {
+  if (event != FileMonitor::Event::Create && event != FileMonitor::Event::Modify) {
+    return;
+  }
+
+  Mode mode;
+  size_t pool_size;
+  std::string src_file;
+  std::string handler_file;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    mode = mode_;
+    pool_size = pool_size_;
+    src_file = src_file_;
+    handler_file = handler_file_;
+  }
+
+  // A half written file fails to load and is ignored, the next event of the
+  // file reloads it again. Replacing the file by rename avoids it.
+  bool reload_handler = (file == handler_file);
+  auto handler_snapshot = HandlerMgr::Instance()->SnapshotConfigs();
+  if (reload_handler &&
+      !HandlerMgr::Instance()->ReloadConfigFile(handler_file, true)) {
+    ORC_ERROR("Hot reload handler config: %s fail, keep the old one.", file.c_str());
+    MONITOR_STATUS_NORMAL_COUNTER_BY("ExeGraphReload", "fail", 1);
+    return;
+  }
 
-  return ReloadGraph(mode, pool_size, use_tls, tls_size, file);
+  if (!ReloadGraph(mode, pool_size, src_file)) {
+    // The running workflows are built with the old configs, so are the
+    // instances cloned from them later.
+    if (reload_handler) HandlerMgr::Instance()->RestoreConfigs(handler_snapshot);
+    ORC_ERROR("Hot reload workflow: %s fail, keep the old one.", src_file.c_str());
+    MONITOR_STATUS_NORMAL_COUNTER_BY("ExeGraphReload", "fail", 1);
+    return;
+  }
+
+  ORC_INFO("Hot reload for %s success, version: %u.", file.c_str(), version());
+  MONITOR_STATUS_NORMAL_COUNTER_BY("ExeGraphReload", "success", 1);
 }
 
-bool ExecutionGraphMgr::ReloadGraph(Mode mode, size_t pool_size, bool use_tls,
-                                    size_t tls_size, const std::string& file) {
+bool ExecutionGraphMgr::ReloadGraph(Mode mode, size_t pool_size,
+                                    const std::string& file) {
+  wf::Compiler::Option option;
+  option.optimize = optimize_;
+  option.dump = dump_;
+  option.optimizer.is_sync = [](const std::string& name) {
+    return HandlerMgr::Instance()->IsSyncHandler(name);
+  };
+  option.optimizer.get_io = [](const std::string& name,
+                               std::set<std::string>* inputs,
+                               std::set<std::string>* outputs) {
+    HandlerIO io;
+    if (!HandlerMgr::Instance()->GetHandlerIO(name, &io)) return false;
+    inputs->insert(io.inputs.begin(), io.inputs.end());
+    outputs->insert(io.outputs.begin(), io.outputs.end());
+    return true;
+  };
+
   GraphsMap graphs;
-  wf::Compiler compiler;
+  wf::Compiler compiler(option);
 
   if (!compiler.Compile(file, &graphs)) {
     ORC_ERROR("Setup fail for Compile file: %s error.", file.c_str());
     return false;
   }
 
-  ExeGraphsMap exe_graphs;
+  // The pools are built without 'mutex_', GetGraphId isn't blocked.
+  std::lock_guard<std::mutex> reload_lock(reload_mutex_);
   uint32_t version = version_.load() + 1;
 
-  if (!ReloadExeGraph(version, pool_size, graphs, &exe_graphs)) {
-    ORC_ERROR("RloadExeGraph fail for config file: %s.", file.c_str());
-    return false;
+  // A workflow keeps its id, the new ones take the next ids. Only replaced
+  // under 'reload_mutex_'.
+  GraphIds graph_ids = *graph_ids_.load();
+  std::vector<std::unique_ptr<ExecutionGraphPool>> pools;
+  std::vector<int32_t> ids;
+  for (const auto& p : graphs) {
+    auto topology = BuildGraph(p.second.get());
+    if (!topology) {
+      ORC_ERROR("BuildGraph: %s error.", p.first.c_str());
+      return false;
+    }
+
+    auto it = graph_ids.find(p.first);
+    if (it == graph_ids.end()) {
+      it = graph_ids.emplace(p.first, static_cast<int32_t>(graph_ids.size())).first;
+    }
+    if (it->second >= kMaxGraphNum) {
+      ORC_ERROR("Too many workflows, the max is %d.", kMaxGraphNum);
+      return false;
+    }
+    topology->set_id(it->second);
+    topology->set_version(version);
+
+    std::shared_ptr<const ExecutionTopology> shared_topology(topology.release());
+    auto exe_graph = ExecutionGraph::New(shared_topology);
+    std::unique_ptr<ExecutionGraphPool> pool(new ExecutionGraphPool());
+    if (!exe_graph || !pool->Init(std::move(exe_graph), pool_size, mode == Mode::Singleton)) {
+      ORC_ERROR("Create ExecutionGraph: %s fail.", p.first.c_str());
+      return false;
+    }
+    pools.emplace_back(std::move(pool));
+    ids.emplace_back(it->second);
   }
 
+  // All workflows are built, publish them.
+  std::vector<ExecutionGraphPool*> retired;
+  const GraphIds* old_ids = nullptr;
   {
     std::lock_guard<std::mutex> lock(mutex_);
     mode_ = mode;
-    use_tls_ = use_tls;
     pool_size_ = pool_size;
-    tls_size_ = tls_size;
     src_file_ = file;
     version_.store(version);
-    exe_graphs_.swap(exe_graphs);
+
+    for (const auto& p : graph_ids) {
+      if (graphs.find(p.first) == graphs.end()) {
+        // Removed by this reload.
+        auto old_pool = pools_[p.second].exchange(nullptr);
+        if (old_pool != nullptr) retired.emplace_back(old_pool);
+      }
+    }
+    for (size_t i = 0; i < pools.size(); ++i) {
+      auto old_pool = pools_[ids[i]].exchange(pools[i].release());
+      if (old_pool != nullptr) retired.emplace_back(old_pool);
+    }
+    old_ids = graph_ids_.exchange(new GraphIds(std::move(graph_ids)));
+  }
+
+  // The requests got the old instances still run on them, the old pools are
+  // freed after they finish.
+  Synchronize();
+  delete old_ids;
+  for (auto old_pool : retired) {
+    old_pool->Retire();
   }
 
   return true;
 }
 
-bool ExecutionGraphMgr::ReloadExeGraph(
-    uint32_t version, size_t pool_size,
-    const ExecutionGraphMgr::GraphsMap& graphs,
-    ExecutionGraphMgr::ExeGraphsMap* exe_graphs) {
-  for (const auto& p : graphs) {
-    auto exe_graph = BuildGraph(p.second.get());
-    if (!exe_graph) {
-      ORC_ERROR("BuildGraph: %s error.", p.first.c_str());
-      return false;
+void ExecutionGraphMgr::Synchronize() {
+  // New readers count in the other shards, the ones of the former epoch
+  // drain soon, for a reader only takes an instance or an id.
+  uint32_t epoch = epoch_.fetch_add(1);
+  for (auto& shard : readers_[epoch & 1]) {
+    while (shard.count.load() != 0) {
+      std::this_thread::yield();
     }
-    exe_graph->set_version(version);
-
-    for (uint32_t i = 1; i < pool_size; ++i) {
-      auto cl_graph = exe_graph->Clone();
-      if (!cl_graph) {
-        return false;
-      }
-      (*exe_graphs)[p.first].emplace(std::move(cl_graph));
-    }
-
-    (*exe_graphs)[p.first].emplace(std::move(exe_graph));
   }
+}
 
-  return true;
+uint32_t ExecutionGraphMgr::ReaderShard() {
+  static std::atomic<uint32_t> next_shard(0);
+  static thread_local uint32_t shard = next_shard.fetch_add(1) % kReaderShards;
+  return shard;
 }
 
-ExecutionNode* ExecutionGraphMgr::BuildNode(const wf::Node* node, ExecutionGraph* exe_graph) {
+ExecutionNode* ExecutionGraphMgr::BuildNode(const wf::Node* node, ExecutionTopology* topology) {
   if (node == wf::Node::EndNode()) return ExecutionNode::EndNode();
 
   // If this node has been built already.
-  auto already_node = exe_graph->GetNode(node->name());
+  auto already_node = topology->GetNode(node->name());
   if (already_node != nullptr) return already_node;
 
   // If this node hasn't been built.
-  std::unique_ptr<ExecutionNode> exe_node{new ExecutionNode(node->name())};
+  std::unique_ptr<ExecutionNode> exe_node;
 
-  auto handler = HandlerMgr::Instance()->GetHandler(node->name());
-  if (!handler) {
-    ORC_ERROR("BuildNode fail for can't get handler by name: %s", node->name().c_str());
-    return nullptr;
+  switch (node->type()) {
+    case wf::Node::Type::Fork:
+      exe_node.reset(new ExecutionNode(node->name(), ExecutionNode::Type::Fork));
+      break;
+
+    case wf::Node::Type::Join:
+      exe_node.reset(new ExecutionNode(node->name(), ExecutionNode::Type::Join));
+      break;
+
+    case wf::Node::Type::Dag:
+      exe_node.reset(new ExecutionNode(node->name(), ExecutionNode::Type::Dag));
+      break;
+
+    case wf::Node::Type::Fused:
+      exe_node.reset(new ExecutionNode(node->name(), ExecutionNode::Type::Fused));
+      for (const auto& name : node->handlers()) {
+        exe_node->AddFusedHandler(topology->AddHandler(name), name);
+      }
+      break;
+
+    default:
+      // The handlers are created by 'ExecutionGraph::New'.
+      exe_node.reset(new ExecutionNode(node->name()));
+      exe_node->set_handler_index(topology->AddHandler(node->name()));
+      break;
   }
 
   auto r = exe_node.get();
-  exe_graph->AddNode(node->name(), std::move(exe_node));
+  topology->AddNode(node->name(), std::move(exe_node));
+
+  for (auto branch : node->branches()) {
+    auto branch_entry = BuildNode(branch, topology);
+    if (branch_entry == nullptr) return nullptr;
+    r->AddBranch(branch_entry);
+  }
+
+  if (r->type() == ExecutionNode::Type::Dag) {
+    BuildDependency(r);
+  }
 
-  auto true_next = BuildNode(node->true_edge(), exe_graph);
+  auto true_next = BuildNode(node->true_edge(), topology);
   if (true_next == nullptr) return nullptr;
 
-  auto false_next = BuildNode(node->false_edge(), exe_graph);
+  auto false_next = BuildNode(node->false_edge(), topology);
   if (false_next == nullptr) return nullptr;
 
-  r->set_handler(std::move(handler));
   r->set_true_next(true_next);
   r->set_false_next(false_next);
 
   return r;
 }
 
-std::unique_ptr<ExecutionGraph> ExecutionGraphMgr::BuildGraph(const wf::Graph* graph) {
-  std::unique_ptr<ExecutionGraph> exe_graph{new ExecutionGraph(graph->name())};
-  auto entry = BuildNode(graph->entry(), exe_graph.get());
+namespace {
+
+bool Intersect(const std::set<std::string>& a, const std::set<std::string>& b) {
+  for (const auto& field : a) {
+    if (b.find(field) != b.end()) return true;
+  }
+  return false;
+}
+
+}  // anonymous namespace
+
+void ExecutionGraphMgr::BuildDependency(ExecutionNode* node) {
+  struct Fields {
+    bool declared;
+    std::set<std::string> inputs;
+    std::set<std::string> outputs;
+  };
+
+  const auto& branches = node->branches();
+  std::vector<Fields> fields(branches.size());
+  for (size_t i = 0; i < branches.size(); ++i) {
+    HandlerIO io;
+    fields[i].declared = HandlerMgr::Instance()->GetHandlerIO(branches[i]->name(), &io);
+    fields[i].inputs.insert(io.inputs.begin(), io.inputs.end());
+    fields[i].outputs.insert(io.outputs.begin(), io.outputs.end());
+  }
+
+  // Keep the result of running the handlers one by one in the written order:
+  // a handler waits for the former ones which write the fields it reads or
+  // writes, or read the fields it writes. A handler doesn't declare its fields
+  // is a barrier.
+  size_t dependency_num = 0;
+  for (size_t to = 0; to < branches.size(); ++to) {
+    for (size_t from = 0; from < to; ++from) {
+      if (!fields[from].declared || !fields[to].declared ||
+          Intersect(fields[from].outputs, fields[to].inputs) ||
+          Intersect(fields[from].outputs, fields[to].outputs) ||
+          Intersect(fields[from].inputs, fields[to].outputs)) {
+        node->AddDependency(from, to);
+        ++dependency_num;
+      }
+    }
+  }
+
+  ORC_INFO("Dag %s has %zu handlers, %zu dependencies.",
+           node->name().c_str(), branches.size(), dependency_num);
+}
+
+std::unique_ptr<ExecutionTopology> ExecutionGraphMgr::BuildGraph(const wf::Graph* graph) {
+  std::unique_ptr<ExecutionTopology> topology{new ExecutionTopology(graph->name())};
+  auto entry = BuildNode(graph->entry(), topology.get());
   if (entry == nullptr) {
     ORC_ERROR("BuildGraph: %s fail.", graph->name().c_str());
     return nullptr;
   }
 
-  exe_graph->set_entry(entry);
-  return exe_graph;
+  topology->set_entry(entry);
+
+  auto it = deadlines_.find(graph->name());
+  if (it == deadlines_.end()) it = deadlines_.find("default");
+  if (it != deadlines_.end() && it->second > 0) {
+    topology->set_deadline_ms(it->second);
+  }
+
+  BuildFallback(topology.get());
+  return topology;
 }
 
-ExecutionGraph* ExecutionGraphMgr::GetExeGraphFromPool(
-    const std::string& name, ExecutionGraphMgr::ExeGraphsMap* graphs_map, int idx) {
-  auto it = graphs_map->find(name);
+void ExecutionGraphMgr::BuildFallback(ExecutionTopology* topology) {
+  auto it = fallbacks_.find(topology->name());
+  if (it == fallbacks_.end()) return;
 
-  if (it == graphs_map->end()) return nullptr;
+  // Named apart from the nodes of workflow, the same handler may be used in
+  // the workflow too.
+  std::string name = "fallback:" + it->second;
+  std::unique_ptr<ExecutionNode> exe_node(new ExecutionNode(name));
+  exe_node->set_handler_index(topology->AddHandler(it->second));
+  exe_node->set_true_next(ExecutionNode::EndNode());
+  exe_node->set_false_next(ExecutionNode::EndNode());
 
-  MONITOR_STATUS_NORMAL_TIMER_BY("ExeGraphsMap",  ((idx == 1) ? "tls" : "glb"), it->second.size() * 1000, 1);
+  topology->set_fallback(exe_node.get());
+  topology->AddNode(name, std::move(exe_node));
+}
 
-  if (it->second.empty()) return nullptr;
+int32_t ExecutionGraphMgr::GetGraphId(const std::string& name) {
+  // Counted as a reader like GetExeGraph, so the map isn't freed under it.
+  auto& readers = readers_[epoch_.load() & 1][ReaderShard()].count;
+  readers.fetch_add(1);
 
-  auto p_graph = std::move(it->second.front());
-  it->second.pop();
+  auto graph_ids = graph_ids_.load();
+  auto it = graph_ids->find(name);
+  int32_t id = (it == graph_ids->end()) ? -1 : it->second;
 
-  return p_graph.release();
+  readers.fetch_sub(1, std::memory_order_release);
+  return id;
 }
 
-ExecutionGraph* ExecutionGraphMgr::GetExeGraphFromSingleton(
-    const std::string& name, ExecutionGraphMgr::ExeGraphsMap* graphs_map) {
-  auto it = graphs_map->find(name);
+ExecutionGraph* ExecutionGraphMgr::GetExeGraph(int32_t id) {
+  if (id < 0 || id >= kMaxGraphNum) return nullptr;
 
-  if (it == graphs_map->end()) return nullptr;
-  if (it->second.empty()) return nullptr;
+  // Counted as a reader until the instance is taken, so the pool isn't
+  // retired under it. Sequentially consistent with the publish in reload.
+  auto& readers = readers_[epoch_.load() & 1][ReaderShard()].count;
+  readers.fetch_add(1);
 
-  return it->second.front().get();
-}
+  auto pool = pools_[id].load();
+  ExecutionGraph* graph = nullptr;
+  if (pool != nullptr) graph = pool->Get();
 
-ExecutionGraph* ExecutionGraphMgr::GetExeGraph(const std::string& name) {
-  if (mode_ == Mode::Singleton) {
-    // Singleton mode, ExecutionGraph is thread-safe, all worker threads use the
-    // same ExecutionGraph. There is no lock, so the 'hot reload' feature is not
-    // supported.
-    return GetExeGraphFromSingleton(name, &exe_graphs_);
-  } else {
-    if (use_tls_) {
-      auto graph = GetExeGraphFromPool(name, &tls_exe_graphs_, 1);
-      if (graph) return graph;
-    }
+  readers.fetch_sub(1, std::memory_order_release);
 
-    std::lock_guard<std::mutex> lock(mutex_);
-    return GetExeGraphFromPool(name, &exe_graphs_, 0);
+  if (pool != nullptr && graph == nullptr) {
+    MONITOR_STATUS_NORMAL_COUNTER_BY("ExeGraphPool", "empty", 1);
   }
+  return graph;
 }
 
 void ExecutionGraphMgr::ReleaseExeGraph(ExecutionGraph* graph) {
-  if (mode_ == Mode::Singleton) {
-    // For graph is singleton, no need to Release.
-  } else {
-    if (graph->version() != version()) {
-      delete graph;
-      return;
-    }
-
-    if (use_tls_) {
-      if (tls_exe_graphs_[graph->name()].size() < tls_size_) {
-        tls_exe_graphs_[graph->name()].emplace(graph);
-        return;
-      }
-    }
-
-    std::lock_guard<std::mutex> lock(mutex_);
-    exe_graphs_[graph->name()].emplace(graph);
-  }
+  // Back to the pool it comes from, which may be replaced by reload already
+  // and freed by this release.
+  graph->pool()->Release(graph);
 }
 
 }  // namespace orc
@@ -1,12 +1,15 @@
 #ifndef ORC_FRAMEWORK_EXECUTION_GRAPH_MGR_H_
 #define ORC_FRAMEWORK_EXECUTION_GRAPH_MGR_H_
 
+#include <map>
 #include <string>
 #include <memory>
-#include <queue>
+#include <vector>
 #include <mutex>
+#include <atomic>
 
 #include "orc/util/macros.h"
+#include "orc/util/file_monitor.h"
 #include "orc/workflow/graph.h"
 #include "orc/framework/execution_graph.h"
 #include "yaml-cpp/yaml.h"
@@ -15,50 +18,91 @@ namespace orc {
 
 class ExecutionGraphMgr {
  public:
-  ~ExecutionGraphMgr() = default;
+  ~ExecutionGraphMgr();
 
   static ExecutionGraphMgr* Instance();
 
+  // With 'svr.workflow.hot.reload', the workflow file and the handler config
+  // file are watched, a change of either rebuilds all workflows.
   bool Setup(const YAML::Node& config);
+  void Stop();
 
-  ExecutionGraph* GetExeGraph(const std::string& name);
+  // Id of the workflow, -1 if not found. The id of a workflow name never
+  // changes, so WorkflowRouter can resolve it once. Lock free.
+  int32_t GetGraphId(const std::string& name);
+
+  ExecutionGraph* GetExeGraph(int32_t id);
+  ExecutionGraph* GetExeGraph(const std::string& name) { return GetExeGraph(GetGraphId(name)); }
   void ReleaseExeGraph(ExecutionGraph* graph);
 
   using GraphsMap = std::map<std::string, std::unique_ptr<wf::Graph>>;
-  using ExeGraphsMap = std::map<std::string, std::queue<std::unique_ptr<ExecutionGraph>>>;
+
+  static const int32_t kMaxGraphNum = 1024;
 
  private:
   ExecutionGraphMgr();
 
   enum class Mode { Pool, Singleton };
 
-  bool ReloadGraph(Mode mode, size_t pool_size, bool use_tls,
-                   size_t tls_size, const std::string& file);
+  // Build the new pools, then publish them. The replaced pools are retired
+  // after the readers which may see them are gone.
+  bool ReloadGraph(Mode mode, size_t pool_size, const std::string& file);
 
-  bool ReloadExeGraph(uint32_t version, size_t pool_size,
-                      const GraphsMap& graphs, ExeGraphsMap* exe_graphs);
+  bool Watch(const std::string& workflow_file, const std::string& handler_file);
+  // Run in the FileMonitor thread, off the request path.
+  void OnFileChange(const std::string& file, FileMonitor::Event event);
 
-  uint32_t version() const { return version_; }
+  // Wait until the GetExeGraph calls started before are finished.
+  void Synchronize();
+  static uint32_t ReaderShard();
 
-  std::unique_ptr<ExecutionGraph> BuildGraph(const wf::Graph* graph);
-  ExecutionNode* BuildNode(const wf::Node* node, ExecutionGraph* exe_graph);
+  uint32_t version() const { return version_; }
 
-  ExecutionGraph* GetExeGraphFromPool(const std::string& name, ExeGraphsMap* graph_map, int idx);
-  ExecutionGraph* GetExeGraphFromSingleton(const std::string& name, ExeGraphsMap* graph_map);
+  std::unique_ptr<ExecutionTopology> BuildGraph(const wf::Graph* graph);
+  ExecutionNode* BuildNode(const wf::Node* node, ExecutionTopology* topology);
+  void BuildDependency(ExecutionNode* node);
+  void BuildFallback(ExecutionTopology* topology);
 
  private:
   Mode mode_;
   size_t pool_size_;
-  size_t tls_size_;
-  bool use_tls_;
 
   std::string src_file_;
+  // Run the wf::Optimizer passes, and dump the graphs.
+  bool optimize_;
+  bool dump_;
   std::atomic<uint32_t> version_;
 
-  std::mutex mutex_;
-  ExeGraphsMap exe_graphs_;
+  // Workflow name to the deadline in milliseconds, the 'default' one is used
+  // by workflows not listed.
+  std::map<std::string, int64_t> deadlines_;
+  // Workflow name to the name of the fallback handler.
+  std::map<std::string, std::string> fallbacks_;
 
-  thread_local static ExeGraphsMap  tls_exe_graphs_;
+  // Serializes the reloads.
+  std::mutex reload_mutex_;
+  // Guards the publish of reload.
+  std::mutex mutex_;
+  // Workflow name to id, replaced as a whole by reload and read without lock,
+  // the replaced one is freed after its readers are gone like the pools.
+  using GraphIds = std::map<std::string, int32_t>;
+  std::atomic<const GraphIds*> graph_ids_;
+
+  // Indexed by graph id, read without lock. The published pools are owned
+  // here, see ExecutionGraphPool::Retire for the replaced ones.
+  std::atomic<ExecutionGraphPool*> pools_[kMaxGraphNum];
+
+  // GetExeGraph counts itself in the shard of current epoch, Synchronize
+  // flips the epoch and waits for the shards of the former one to drain.
+  static const uint32_t kReaderShards = 16;
+  struct alignas(64) ReaderCount {
+    std::atomic<int64_t> count;
+  };
+  std::atomic<uint32_t> epoch_;
+  ReaderCount readers_[2][kReaderShards];
+
+  std::string handler_file_;
+  std::vector<FileMonitor::Cookie*> cookies_;
 
   ORC_DISALLOW_COPY_AND_ASSIGN(ExecutionGraphMgr);
 };
@@ -1,27 +1,103 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
 #include "gtest/gtest.h"
 #include "orc/framework/handler_mgr.h"
 #include "common/monitor/monitor_status.h"
 
 #define private public
 #include "orc/framework/execution_graph_mgr.h"
+#include "orc/framework/workflow.h"
 #undef private
 
 namespace orc {
 
+// Names of the handlers run by the requests, in order.
+std::mutex run_mutex;
+std::vector<std::string> run_handlers;
+// Time Mock1Handler takes, to exceed the deadline.
+std::atomic<int> mock1_sleep_ms(0);
+
+void RecordRun(const std::string& name) {
+  std::lock_guard<std::mutex> lock(run_mutex);
+  run_handlers.emplace_back(name);
+}
+
 class MockHandler : public HandlerBase {
  public:
   bool BaseInit(const YAML::Node& config) override { return true; }
-  bool BaseRun(SessionBase* session_base, Context* context) override { return true; }
+  bool BaseRun(SessionBase* session_base, Context* context) override {
+    // Later than the branches without dependency, so the order is checked.
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    RecordRun(name());
+    return true;
+  }
 };
 ORC_REGISTER_HANDLER(MockHandler);
 
 class Mock1Handler : public HandlerBase {
  public:
   bool BaseInit(const YAML::Node& config) override { return true; }
-  bool BaseRun(SessionBase* session_base, Context* context) override { return true; }
+  bool BaseRun(SessionBase* session_base, Context* context) override {
+    std::this_thread::sleep_for(std::chrono::milliseconds(mock1_sleep_ms.load()));
+    RecordRun(name());
+    return true;
+  }
+  bool IsSync() const override { return true; }
 };
 ORC_REGISTER_HANDLER(Mock1Handler);
 
+class Mock2Handler : public HandlerBase {
+ public:
+  bool BaseInit(const YAML::Node& config) override { return true; }
+  bool BaseRun(SessionBase* session_base, Context* context) override {
+    RecordRun(name());
+    return true;
+  }
+  bool IsSync() const override { return true; }
+};
+ORC_REGISTER_HANDLER(Mock2Handler);
+
+// Released when the request ends, the handlers run by then are kept.
+class MockSessionFactory : public SessionFactory {
+ public:
+  bool Init(const YAML::Node& config) override { return true; }
+  SessionBase* Acquire() override { return nullptr; }
+  void Release(SessionBase* session) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    {
+      std::lock_guard<std::mutex> run_lock(run_mutex);
+      handlers_ = run_handlers;
+    }
+    released_ = true;
+    cond_.notify_all();
+  }
+
+  bool Wait(std::vector<std::string>* handlers) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!cond_.wait_for(lock, std::chrono::seconds(5), [this]() { return released_; })) {
+      return false;
+    }
+    *handlers = handlers_;
+    return true;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool released_ = false;
+  std::vector<std::string> handlers_;
+};
+
+class MockServiceClosure : public ServiceClosure {
+ public:
+  void Done() override {}
+};
+
 
 class ExecutionGraphMgrTest : public ::testing::Test {
  public:
@@ -32,6 +108,38 @@ class ExecutionGraphMgrTest : public ::testing::Test {
     std::string file = "testdata/execution_graph_mgr_config.yaml";
     config_ = YAML::LoadFile(file);
     HandlerMgr::Instance()->Setup(config_);
+    MONITOR_STATUS_INIT("/tmp/monitor_status.dat");
+  }
+
+  // Run the request of workflow 'name' in a Workflow with 'worker_num'
+  // workers until it ends, return the handlers run.
+  static std::vector<std::string> RunRequest(const std::string& name,
+                                             size_t worker_num,
+                                             MockServiceClosure* closure) {
+    {
+      std::lock_guard<std::mutex> lock(run_mutex);
+      run_handlers.clear();
+    }
+    MockSessionFactory factory;
+    SessionBase session;
+    session.set_service_closure(closure);
+    std::vector<std::string> handlers;
+    {
+      Workflow workflow;
+      workflow.thread_pool_.reset(new ThreadPool(worker_num, 1, 64));
+      workflow.session_factory_ = &factory;
+      workflow.workflow_router_ = nullptr;
+      workflow.parallel_inline_ = false;
+
+      auto exe_graph = ExecutionGraphMgr::Instance()->GetExeGraph(name);
+      EXPECT_TRUE(exe_graph != nullptr);
+      if (exe_graph == nullptr) return handlers;
+      auto ctx = session.orc_ctx();
+      ctx->Setup(&workflow, exe_graph);
+      workflow.Run(ctx);
+      EXPECT_TRUE(factory.Wait(&handlers));
+    }
+    return handlers;
   }
 
   static YAML::Node config_;
@@ -40,8 +148,6 @@ class ExecutionGraphMgrTest : public ::testing::Test {
 YAML::Node ExecutionGraphMgrTest::config_;
 
 TEST_F(ExecutionGraphMgrTest, TestExeGraph) {
-  MONITOR_STATUS_INIT("/tmp/monitor_status.dat");
-
   ASSERT_TRUE(ExecutionGraphMgr::Instance()->Setup(config_));
 
   ASSERT_EQ(10u, ExecutionGraphMgr::Instance()->pool_size_);
@@ -53,26 +159,322 @@ TEST_F(ExecutionGraphMgrTest, TestExeGraph) {
 
   auto bad_case = ExecutionGraphMgr::Instance()->GetExeGraph("bad_wf");
   ASSERT_TRUE(bad_case == nullptr);
+  ASSERT_EQ(-1, ExecutionGraphMgr::Instance()->GetGraphId("bad_wf"));
+
+  int32_t id = ExecutionGraphMgr::Instance()->GetGraphId("mock_wf");
+  ASSERT_EQ(id, exe_graph->id());
+  auto pool = ExecutionGraphMgr::Instance()->pools_[id].load();
+  ASSERT_EQ(pool, exe_graph->pool());
+  ASSERT_EQ(9u, pool->FreeSize());
+
+  ExecutionGraphMgr::Instance()->ReleaseExeGraph(exe_graph);
+
+  // Cloned graph keeps the fork&join nodes.
+  exe_graph = ExecutionGraphMgr::Instance()->GetExeGraph("parallel_wf");
+  ASSERT_TRUE(exe_graph != nullptr);
 
-  ASSERT_EQ(9u, ExecutionGraphMgr::Instance()->exe_graphs_["mock_wf"].size());
+  auto fork = exe_graph->entry();
+  ASSERT_EQ(ExecutionNode::Type::Fork, fork->type());
+  ASSERT_EQ(2u, fork->branches().size());
+
+  auto join = fork->true_next();
+  ASSERT_EQ(ExecutionNode::Type::Join, join->type());
+  ASSERT_EQ(join, fork->false_next());
+  ASSERT_EQ(ExecutionNode::EndNode(), join->true_next());
+
+  ASSERT_EQ(exe_graph->GetNode("MockHandler"), fork->branches()[0]);
+  ASSERT_EQ(exe_graph->GetNode("Mock1Handler"), fork->branches()[1]);
+  for (auto branch : fork->branches()) {
+    ASSERT_EQ(join, branch->true_next());
+    ASSERT_EQ(join, branch->false_next());
+  }
 
   ExecutionGraphMgr::Instance()->ReleaseExeGraph(exe_graph);
-#if 0
-  ASSERT_EQ(9u, ExecutionGraphMgr::Instance()->exe_graphs_["mock_wf"].size());
-  ASSERT_EQ(1u, ExecutionGraphMgr::Instance()->tls_exe_graphs_["mock_wf"].size());
 
-  exe_graph = ExecutionGraphMgr::Instance()->GetExeGraph("mock_wf");
-  ASSERT_EQ(9u, ExecutionGraphMgr::Instance()->exe_graphs_["mock_wf"].size());
-  ASSERT_EQ(0u, ExecutionGraphMgr::Instance()->tls_exe_graphs_["mock_wf"].size());
+  // Mock1Handler reads 'a' written by MockHandler, Mock2Handler is independent.
+  exe_graph = ExecutionGraphMgr::Instance()->GetExeGraph("dag_wf");
+  ASSERT_TRUE(exe_graph != nullptr);
+
+  auto dag = exe_graph->entry();
+  ASSERT_EQ(ExecutionNode::Type::Dag, dag->type());
+  ASSERT_EQ(3u, dag->branches().size());
+
+  ASSERT_EQ(0, dag->in_degree(0));
+  ASSERT_EQ(1, dag->in_degree(1));
+  ASSERT_EQ(0, dag->in_degree(2));
 
-  // update version
+  ASSERT_EQ(std::vector<uint32_t>{1}, dag->successors(0));
+  ASSERT_TRUE(dag->successors(1).empty());
+  ASSERT_TRUE(dag->successors(2).empty());
+
+  ExecutionGraphMgr::Instance()->ReleaseExeGraph(exe_graph);
+
+  // Deadline comes from the workflow's own item, or the 'default' one.
+  exe_graph = ExecutionGraphMgr::Instance()->GetExeGraph("dag_wf");
+  ASSERT_EQ(20, exe_graph->deadline_ms());
+  ASSERT_TRUE(exe_graph->fallback() == nullptr);
+  ExecutionGraphMgr::Instance()->ReleaseExeGraph(exe_graph);
+
+  // Cloned graph keeps its own fallback node.
+  exe_graph = ExecutionGraphMgr::Instance()->GetExeGraph("parallel_wf");
+  ASSERT_EQ(100, exe_graph->deadline_ms());
+  auto fallback = exe_graph->fallback();
+  ASSERT_TRUE(fallback != nullptr);
+  ASSERT_EQ(exe_graph->GetNode("fallback:Mock2Handler"), fallback);
+  ASSERT_EQ(ExecutionNode::EndNode(), fallback->true_next());
+  ASSERT_EQ(ExecutionNode::EndNode(), fallback->false_next());
+  ExecutionGraphMgr::Instance()->ReleaseExeGraph(exe_graph);
+
+  // All instances share the topology, each has its own handlers.
+  std::vector<ExecutionGraph*> graphs;
+  for (size_t i = 0; i < 10; ++i) {
+    graphs.emplace_back(ExecutionGraphMgr::Instance()->GetExeGraph(id));
+    ASSERT_TRUE(graphs.back() != nullptr);
+  }
+  ASSERT_TRUE(ExecutionGraphMgr::Instance()->GetExeGraph(id) == nullptr);
+  ASSERT_EQ(0u, pool->FreeSize());
+  ASSERT_EQ(graphs[0]->topology(), graphs[1]->topology());
+  ASSERT_EQ(graphs[0]->entry(), graphs[1]->entry());
+  ASSERT_NE(graphs[0]->handler(0), graphs[1]->handler(0));
+  for (auto graph : graphs) {
+    ExecutionGraphMgr::Instance()->ReleaseExeGraph(graph);
+  }
+  ASSERT_EQ(10u, pool->FreeSize());
+
+  // Reload keeps the ids, the instance in use goes back to its old pool,
+  // which is freed then.
+  exe_graph = ExecutionGraphMgr::Instance()->GetExeGraph(id);
+  ASSERT_EQ(1u, pool->InUse());
   ASSERT_TRUE(ExecutionGraphMgr::Instance()->Setup(config_));
-  ASSERT_EQ(10u, ExecutionGraphMgr::Instance()->exe_graphs_["mock_wf"].size());
+  ASSERT_EQ(2u, ExecutionGraphMgr::Instance()->version());
+  ASSERT_EQ(id, ExecutionGraphMgr::Instance()->GetGraphId("mock_wf"));
+  auto new_pool = ExecutionGraphMgr::Instance()->pools_[id].load();
+  ASSERT_NE(pool, new_pool);
+  ASSERT_EQ(10u, new_pool->FreeSize());
+  ASSERT_EQ(pool, exe_graph->pool());
+  ASSERT_EQ(1u, exe_graph->version());
 
   ExecutionGraphMgr::Instance()->ReleaseExeGraph(exe_graph);
+  ASSERT_EQ(10u, new_pool->FreeSize());
+  ASSERT_EQ(0u, new_pool->InUse());
+}
+
+TEST_F(ExecutionGraphMgrTest, TestHotReload) {
+  auto mgr = ExecutionGraphMgr::Instance();
+  ASSERT_TRUE(mgr->Setup(config_));
+  uint32_t version = mgr->version();
+  int32_t id = mgr->GetGraphId("mock_wf");
+
+  // A change of either file rebuilds the workflows.
+  mgr->handler_file_ = config_["svr.handler.file"].as<std::string>();
+  auto exe_graph = mgr->GetExeGraph(id);
+  mgr->OnFileChange(mgr->src_file_, FileMonitor::Event::Modify);
+  ASSERT_EQ(version + 1, mgr->version());
+  mgr->OnFileChange(mgr->handler_file_, FileMonitor::Event::Create);
+  ASSERT_EQ(version + 2, mgr->version());
+  mgr->OnFileChange(mgr->src_file_, FileMonitor::Event::Delete);
+  ASSERT_EQ(version + 2, mgr->version());
+
+  // The request started before runs on its old instance.
+  ASSERT_EQ(version, exe_graph->version());
+  mgr->ReleaseExeGraph(exe_graph);
+  exe_graph = mgr->GetExeGraph(id);
+  ASSERT_EQ(version + 2, exe_graph->version());
+  mgr->ReleaseExeGraph(exe_graph);
+
+  // A broken file keeps the old workflows.
+  mgr->src_file_ = "testdata/not_exist.ww";
+  mgr->OnFileChange(mgr->src_file_, FileMonitor::Event::Modify);
+  ASSERT_EQ(version + 2, mgr->version());
+  exe_graph = mgr->GetExeGraph(id);
+  ASSERT_EQ(version + 2, exe_graph->version());
+  mgr->ReleaseExeGraph(exe_graph);
+  mgr->src_file_ = config_["svr.workflow.file"].as<std::string>();
+}
+
+TEST_F(ExecutionGraphMgrTest, TestHotReloadRollback) {
+  auto mgr = ExecutionGraphMgr::Instance();
+  ASSERT_TRUE(mgr->Setup(config_));
+  uint32_t version = mgr->version();
+
+  // The new handler config is fine, but the workflows fail to rebuild.
+  std::string handler_file = "/tmp/execution_graph_mgr_test_handler.yaml";
+  {
+    std::ofstream output(handler_file);
+    output << "MockHandler:\n  outputs: [x]\n";
+  }
+  mgr->handler_file_ = handler_file;
+  mgr->src_file_ = "testdata/not_exist.ww";
+  mgr->OnFileChange(handler_file, FileMonitor::Event::Modify);
+  ASSERT_EQ(version, mgr->version());
+
+  // The configs of the running workflows are kept.
+  HandlerIO io;
+  ASSERT_TRUE(HandlerMgr::Instance()->GetHandlerIO("MockHandler", &io));
+  ASSERT_EQ(std::vector<std::string>{"a"}, io.outputs);
+  ASSERT_TRUE(HandlerMgr::Instance()->GetHandlerIO("Mock1Handler", &io));
+
+  mgr->src_file_ = config_["svr.workflow.file"].as<std::string>();
+  mgr->handler_file_ = config_["svr.handler.file"].as<std::string>();
+  remove(handler_file.c_str());
+}
+
+TEST_F(ExecutionGraphMgrTest, TestSingletonReload) {
+  YAML::Node config = YAML::Clone(config_);
+  config["svr.workflow.pool.mode"] = "singleton";
+  auto mgr = ExecutionGraphMgr::Instance();
+  ASSERT_TRUE(mgr->Setup(config));
+
+  // The only instance is shared, it's counted per request.
+  auto graph1 = mgr->GetExeGraph("mock_wf");
+  auto graph2 = mgr->GetExeGraph("mock_wf");
+  ASSERT_EQ(graph1, graph2);
+  auto pool = graph1->pool();
+  ASSERT_EQ(2u, pool->InUse());
+
+  ASSERT_TRUE(mgr->Setup(config));
+  auto graph3 = mgr->GetExeGraph("mock_wf");
+  ASSERT_NE(graph1, graph3);
+  ASSERT_EQ(1u, graph3->pool()->InUse());
+
+  // The old instance is alive until the last request on it is finished.
+  mgr->ReleaseExeGraph(graph1);
+  ASSERT_EQ(1u, pool->InUse());
+  ASSERT_EQ(std::string("mock_wf"), graph2->name());
+  mgr->ReleaseExeGraph(graph2);
+  mgr->ReleaseExeGraph(graph3);
+
+  ASSERT_TRUE(mgr->Setup(config_));
+}
+
+TEST_F(ExecutionGraphMgrTest, TestConcurrentReload) {
+  auto mgr = ExecutionGraphMgr::Instance();
+  ASSERT_TRUE(mgr->Setup(config_));
+  int32_t id = mgr->GetGraphId("mock_wf");
+
+  std::atomic<bool> stop(false);
+  std::atomic<int64_t> runs(0);
+  std::atomic<int64_t> wrong_ids(0);
+  std::atomic<int64_t> wrong_names(0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&]() {
+      while (!stop) {
+        // The id is looked up while the map is replaced.
+        if (mgr->GetGraphId("mock_wf") != id) ++wrong_ids;
+        auto graph = mgr->GetExeGraph(id);
+        if (graph == nullptr) continue;
+        // Checked in the main thread, ASSERT can't stop the test here.
+        if (graph->name() != "mock_wf") ++wrong_names;
+        mgr->ReleaseExeGraph(graph);
+        ++runs;
+      }
+    });
+  }
+
+  int setup_fails = 0;
+  for (int i = 0; i < 20; ++i) {
+    if (!mgr->Setup(config_)) ++setup_fails;
+  }
+  stop = true;
+  for (auto& t : threads) t.join();
+
+  ASSERT_EQ(0, setup_fails);
+  ASSERT_EQ(0, wrong_names.load());
+  ASSERT_GT(runs.load(), 0);
+  ASSERT_EQ(0, wrong_ids.load());
+  ASSERT_EQ(0u, mgr->pools_[id].load()->InUse());
+}
+
+TEST_F(ExecutionGraphMgrTest, TestOptimize) {
+  auto mgr = ExecutionGraphMgr::Instance();
+  ASSERT_TRUE(mgr->Setup(config_));
+
+  auto exe_graph = mgr->GetExeGraph("chain_wf");
+  ASSERT_EQ(ExecutionNode::Type::Handler, exe_graph->entry()->type());
+  mgr->ReleaseExeGraph(exe_graph);
+
+  // The sync handlers are fused into one node, each keeps its handler.
+  YAML::Node config = YAML::Clone(config_);
+  config["svr.workflow.optimize"] = true;
+  ASSERT_TRUE(mgr->Setup(config));
+
+  exe_graph = mgr->GetExeGraph("chain_wf");
+  auto fused = exe_graph->entry();
+  ASSERT_EQ(ExecutionNode::Type::Fused, fused->type());
+  ASSERT_EQ(std::string("Mock1Handler+Mock2Handler"), fused->name());
+  ASSERT_EQ(2u, fused->fused_size());
+  ASSERT_EQ(std::string("Mock1Handler"),
+            exe_graph->handler(fused->fused_handler_index(0))->name());
+  ASSERT_EQ(std::string("Mock2Handler"),
+            exe_graph->handler(fused->fused_handler_index(1))->name());
+  ASSERT_EQ(ExecutionNode::EndNode(), fused->true_next());
+  mgr->ReleaseExeGraph(exe_graph);
+
+  // 'MockHandler' is the condition of the loop, it isn't fused.
+  exe_graph = mgr->GetExeGraph("mock_wf");
+  ASSERT_EQ(std::string("MockHandler"), exe_graph->entry()->name());
+  mgr->ReleaseExeGraph(exe_graph);
+
+  ASSERT_TRUE(mgr->Setup(config_));
+}
+
+TEST_F(ExecutionGraphMgrTest, TestRunParallel) {
+  ASSERT_TRUE(ExecutionGraphMgr::Instance()->Setup(config_));
+
+  // The request ends after both branches are joined.
+  for (size_t worker_num : {1, 4}) {
+    MockServiceClosure closure;
+    auto handlers = RunRequest("parallel_wf", worker_num, &closure);
+    ASSERT_EQ(2u, handlers.size());
+    std::sort(handlers.begin(), handlers.end());
+    ASSERT_EQ(std::string("Mock1Handler"), handlers[0]);
+    ASSERT_EQ(std::string("MockHandler"), handlers[1]);
+    ASSERT_EQ(ServiceClosure::RetCode::Success, closure.ret_code());
+  }
+}
+
+TEST_F(ExecutionGraphMgrTest, TestRunDag) {
+  ASSERT_TRUE(ExecutionGraphMgr::Instance()->Setup(config_));
+
+  // Mock1Handler waits for MockHandler, though MockHandler is the slowest.
+  for (size_t worker_num : {1, 4}) {
+    MockServiceClosure closure;
+    auto handlers = RunRequest("dag_wf", worker_num, &closure);
+    ASSERT_EQ(3u, handlers.size());
+    auto mock = std::find(handlers.begin(), handlers.end(), "MockHandler");
+    auto mock1 = std::find(handlers.begin(), handlers.end(), "Mock1Handler");
+    auto mock2 = std::find(handlers.begin(), handlers.end(), "Mock2Handler");
+    ASSERT_TRUE(mock != handlers.end());
+    ASSERT_TRUE(mock2 != handlers.end());
+    ASSERT_TRUE(mock1 == handlers.begin() + 2);
+    ASSERT_EQ(ServiceClosure::RetCode::Success, closure.ret_code());
+  }
+}
+
+TEST_F(ExecutionGraphMgrTest, TestRunDeadline) {
+  ASSERT_TRUE(ExecutionGraphMgr::Instance()->Setup(config_));
+  mock1_sleep_ms = 150;
+
+  // The deadline (100ms) is exceeded after Mock1Handler, the request ends
+  // without running Mock2Handler.
+  {
+    MockServiceClosure closure;
+    auto handlers = RunRequest("chain_wf", 1, &closure);
+    ASSERT_EQ(std::vector<std::string>{"Mock1Handler"}, handlers);
+    ASSERT_EQ(ServiceClosure::RetCode::Timeout, closure.ret_code());
+  }
+
+  // Mock1Handler runs in place, the other branch queued behind it expires and
+  // goes to the join node, then the fallback node runs instead of ending.
+  {
+    MockServiceClosure closure;
+    auto handlers = RunRequest("parallel_wf", 1, &closure);
+    ASSERT_EQ((std::vector<std::string>{"Mock1Handler", "Mock2Handler"}), handlers);
+    ASSERT_EQ(ServiceClosure::RetCode::Success, closure.ret_code());
+  }
 
-  ASSERT_EQ(10u, ExecutionGraphMgr::Instance()->exe_graphs_["mock_wf"].size());
-#endif
+  mock1_sleep_ms = 0;
 }
 
 }  // namespace orc
@@ -1,7 +1,10 @@
 #include "orc/framework/execution_node.h"
-#include "orc/framework/handler_mgr.h"
+#include "orc/framework/execution_graph.h"
 
 #include "orc/util/log.h"
+#include "orc/util/utils.h"
+
+#include "common/monitor/monitor_status_impl.h"
 
 namespace orc {
 
@@ -10,19 +13,57 @@ ExecutionNode* ExecutionNode::EndNode() {
   return &end_node;
 }
 
-std::unique_ptr<ExecutionNode> ExecutionNode::Clone() const {
-  auto node = std::unique_ptr<ExecutionNode>(new ExecutionNode(name_));
-  auto handler = HandlerMgr::Instance()->GetHandler(name_);
-  if (!handler) {
-    ORC_ERROR("Clone fail for can't get handler by name: %s", name_.c_str());
-    return nullptr;
+void ExecutionNode::Run(SessionBase* session, Context* ctx) {
+  switch (type_) {
+    case Type::Fork:
+    case Type::Dag:
+      ctx->set_next_edge(ctx->Fork(this));
+      break;
+
+    case Type::Join:
+      // All branches have reached here, nothing to do.
+      ctx->SetAsync(false);
+      ctx->set_next_edge(true);
+      break;
+
+    case Type::Fused:
+      ctx->set_next_edge(RunFused(session, ctx));
+      break;
+
+    default:
+      ctx->set_next_edge(ctx->graph()->handler(handler_index_)->BaseRun(session, ctx));
+      break;
   }
-  node->set_handler(std::move(handler));
-  return node;
 }
 
-void ExecutionNode::Run(SessionBase* session, Context* ctx) {
-  ctx->set_next_edge(handler_->BaseRun(session, ctx));
+void ExecutionNode::AddFusedHandler(int32_t index, const std::string& name) {
+  std::unique_ptr<FusedHandler> fused{new FusedHandler()};
+  fused->index = index;
+  fused->name = name;
+  fused->timer.store(nullptr);
+  fused_.emplace_back(std::move(fused));
+}
+
+bool ExecutionNode::RunFused(SessionBase* session, Context* ctx) {
+  // Only sync handlers are fused, each one finishes in place. The node is
+  // timed as a whole by Context, each handler is timed here under its own
+  // name as if it's not fused.
+  bool ret = true;
+  int64_t start = NowUs();
+  for (const auto& fused : fused_) {
+    ret = ctx->graph()->handler(fused->index)->BaseRun(session, ctx);
+
+    int64_t now = NowUs();
+    auto timer = fused->timer.load(std::memory_order_acquire);
+    if (timer == nullptr) {
+      timer = common::MonitorStatus::Instance()->GetShardedTimerCounter(
+          "handler", fused->name.c_str(), nullptr);
+      fused->timer.store(timer, std::memory_order_release);
+    }
+    common::ShardedTimerCounterUpdater(timer, now - start, 1);
+    start = now;
+  }
+  return ret;
 }
 
 }  // namespace orc
@@ -1,28 +1,45 @@
 #ifndef ORC_FRAMEWORK_EXECUTION_NODE_H_
 #define ORC_FRAMEWORK_EXECUTION_NODE_H_
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
 #include "orc/util/macros.h"
 #include "orc/framework/handler_base.h"
 #include "orc/framework/session_base.h"
 #include "orc/framework/context.h"
 
+namespace common {
+struct TimerMonitorStatusShard;
+}  // namespace common
+
 namespace orc {
 
 class ExecutionNode {
  public:
-  explicit ExecutionNode(const std::string& name)
-      : name_(name), true_next_(nullptr), false_next_(nullptr), handler_(nullptr) {}
+  // Same as 'wf::Node::Type', only 'Handler' and 'Fused' nodes have handlers.
+  enum class Type { Handler, Fork, Join, Dag, Fused };
+
+  explicit ExecutionNode(const std::string& name, Type type = Type::Handler)
+      : name_(name), type_(type), true_next_(nullptr), false_next_(nullptr),
+        handler_index_(-1) {}
   ~ExecutionNode() = default;
 
   static ExecutionNode* EndNode();
 
-  // Clone a ExecutionNode, leave 'true_next' and 'false_next' not set.
-  std::unique_ptr<ExecutionNode> Clone() const;
-
+  // The node is immutable and shared by all ExecutionGraph instances of the
+  // workflow, the handler is taken from the instance running by 'ctx'.
   void Run(SessionBase* session, Context* ctx);
 
-  void set_handler(std::unique_ptr<HandlerBase> handler) { handler_ = std::move(handler); }
-  HandlerBase* handler() const { return handler_.get(); }
+  // Index of the handler in ExecutionGraph, -1 for non 'Handler' node.
+  void set_handler_index(int32_t index) { handler_index_ = index; }
+  int32_t handler_index() const { return handler_index_; }
+
+  // Handlers of a 'Fused' node, run one by one in a step.
+  void AddFusedHandler(int32_t index, const std::string& name);
+  size_t fused_size() const { return fused_.size(); }
+  int32_t fused_handler_index(size_t idx) const { return fused_[idx]->index; }
 
   void set_true_next(ExecutionNode* next) { true_next_ = next; }
   ExecutionNode* true_next() const { return true_next_; }
@@ -30,14 +47,47 @@ class ExecutionNode {
   void set_false_next(ExecutionNode* next) { false_next_ = next; }
   ExecutionNode* false_next() const { return false_next_; }
 
+  // Branch entries of a 'Fork' node, all branches end at 'true_next'.
+  void AddBranch(ExecutionNode* node) {
+    branches_.emplace_back(node);
+    successors_.emplace_back();
+    in_degrees_.emplace_back(0);
+  }
+  const std::vector<ExecutionNode*>& branches() const { return branches_; }
+
+  // Branch 'to' of a 'Dag' node can't start until branch 'from' is finished,
+  // both are indexes of 'branches'.
+  void AddDependency(size_t from, size_t to) {
+    successors_[from].emplace_back(static_cast<uint32_t>(to));
+    ++in_degrees_[to];
+  }
+  const std::vector<uint32_t>& successors(size_t idx) const { return successors_[idx]; }
+  int32_t in_degree(size_t idx) const { return in_degrees_[idx]; }
+
   const std::string& name() const { return name_; }
+  Type type() const { return type_; }
+
+ private:
+  bool RunFused(SessionBase* session, Context* ctx);
+
+  struct FusedHandler {
+    int32_t index;
+    std::string name;
+    // The timer of the handler, looked up once instead of every run.
+    std::atomic<volatile common::TimerMonitorStatusShard*> timer;
+  };
 
  private:
   std::string name_;
+  Type type_;
   ExecutionNode* true_next_;
   ExecutionNode* false_next_;
+  std::vector<ExecutionNode*> branches_;
+  std::vector<std::vector<uint32_t>> successors_;
+  std::vector<int32_t> in_degrees_;
 
-  std::unique_ptr<HandlerBase> handler_;
+  int32_t handler_index_;
+  std::vector<std::unique_ptr<FusedHandler>> fused_;
 
   ORC_DISALLOW_COPY_AND_ASSIGN(ExecutionNode);
 };
@@ -17,6 +17,10 @@ class HandlerBase {
   virtual bool BaseInit(const YAML::Node& config) = 0;
   virtual bool BaseRun(SessionBase* session_base, Context* context) = 0;
 
+  // A sync handler never goes async in BaseRun, so it can be fused with the
+  // others into one step, see wf::Optimizer.
+  virtual bool IsSync() const { return false; }
+
   const std::string& name() const { return name_; }
   void set_name(const std::string& name) { name_ = name; }
 
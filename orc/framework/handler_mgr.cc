@@ -1,6 +1,7 @@
 #include "orc/framework/handler_mgr.h"
 
 #include "orc/util/log.h"
+#include "orc/util/utils.h"
 #include "orc/framework/configure.h"
 
 namespace orc {
@@ -47,13 +48,28 @@ bool HandlerMgr::ReloadConfigFile(const std::string& file, bool need_check) {
     }
   }
 
-  // Update config
-  handler_configs_ = config;
+  // Update config. 'reset' rebinds the node, the configs given to handlers
+  // before are untouched.
+  std::lock_guard<std::mutex> lock(mutex_);
+  handler_configs_.reset(config);
   config_file_ = file;
   ORC_INFO("HandlerMgr Setup successfully.");
   return true;
 }
 
+HandlerMgr::ConfigSnapshot HandlerMgr::SnapshotConfigs() {
+  // The copy shares the node, which is kept when 'handler_configs_' is rebound.
+  std::lock_guard<std::mutex> lock(mutex_);
+  return ConfigSnapshot{config_file_, handler_configs_};
+}
+
+void HandlerMgr::RestoreConfigs(const ConfigSnapshot& snapshot) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  handler_configs_.reset(snapshot.configs);
+  config_file_ = snapshot.file;
+  ORC_INFO("HandlerMgr configs are restored to %s.", snapshot.file.c_str());
+}
+
 std::unique_ptr<HandlerBase> HandlerMgr::GetHandler(const std::string& name) {
   auto ctor = handler_ctors_.find(name);
   if (ctor == handler_ctors_.end()) {
@@ -63,7 +79,11 @@ std::unique_ptr<HandlerBase> HandlerMgr::GetHandler(const std::string& name) {
 
   std::unique_ptr<HandlerBase> handler{ctor->second[0]()};
 
-  const YAML::Node& conf = handler_configs_[name] ? handler_configs_[name] : YAML::Node();
+  YAML::Node conf;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (handler_configs_[name]) conf.reset(handler_configs_[name]);
+  }
   if (!handler->BaseInit(conf)) {
     ORC_ERROR("Handler: %s BaseInit fail.", name.c_str());
     return nullptr;
@@ -73,4 +93,25 @@ std::unique_ptr<HandlerBase> HandlerMgr::GetHandler(const std::string& name) {
   return handler;
 }
 
+bool HandlerMgr::GetHandlerIO(const std::string& name, HandlerIO* io) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!handler_configs_[name]) {
+    return false;
+  }
+
+  const YAML::Node& conf = handler_configs_[name];
+  bool has_inputs = GetConfig(conf, "inputs", &io->inputs);
+  bool has_outputs = GetConfig(conf, "outputs", &io->outputs);
+  return has_inputs || has_outputs;
+}
+
+bool HandlerMgr::IsSyncHandler(const std::string& name) {
+  auto ctor = handler_ctors_.find(name);
+  if (ctor == handler_ctors_.end()) return false;
+
+  // Not inited, only asks its type.
+  std::unique_ptr<HandlerBase> handler{ctor->second[0]()};
+  return handler->IsSync();
+}
+
 }  // namespace orc
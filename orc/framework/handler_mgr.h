@@ -3,6 +3,7 @@
 
 #include <memory>
 #include <map>
+#include <mutex>
 #include <vector>
 #include <string>
 
@@ -13,6 +14,17 @@
 
 namespace orc {
 
+// Session fields read('inputs') and written('outputs') by a handler, declared
+// in the handler config file:
+//
+//   UserProfileHandler:
+//     inputs: [user_id]
+//     outputs: [user_profile]
+struct HandlerIO {
+  std::vector<std::string> inputs;
+  std::vector<std::string> outputs;
+};
+
 class HandlerMgr {
  public:
   ~HandlerMgr() = default;
@@ -26,12 +38,32 @@ class HandlerMgr {
 
   std::unique_ptr<HandlerBase> GetHandler(const std::string& name);
 
+  // Return false if the handler declares neither 'inputs' nor 'outputs'.
+  bool GetHandlerIO(const std::string& name, HandlerIO* io);
+
+  // Return false if the handler isn't registered.
+  bool IsSyncHandler(const std::string& name);
+
+  // Replace the handler configs. With 'need_check', all registered handlers
+  // must init with the new configs, or the old ones are kept.
+  bool ReloadConfigFile(const std::string& handler_file, bool need_check);
+
+  // The configs in use, put back by 'RestoreConfigs' if the workflows can't
+  // be rebuilt with the reloaded ones.
+  struct ConfigSnapshot {
+    std::string file;
+    YAML::Node configs;
+  };
+  ConfigSnapshot SnapshotConfigs();
+  void RestoreConfigs(const ConfigSnapshot& snapshot);
+
  private:
   HandlerMgr() = default;
-  bool ReloadConfigFile(const std::string& handler_file, bool need_check);
 
  private:
   std::map<std::string, std::vector<HandlerCtor>> handler_ctors_;
+  // Guards the configs, which may be reloaded at runtime.
+  std::mutex mutex_;
   std::string config_file_;
   YAML::Node handler_configs_;
 
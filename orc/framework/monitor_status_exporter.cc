@@ -0,0 +1,210 @@
+#include "orc/framework/monitor_status_exporter.h"
+
+#include <stdio.h>
+
+#include "orc/util/log.h"
+
+namespace orc {
+
+namespace {
+
+const char* kQuantiles[] = { "0.5", "0.99", "0.999" };
+const double kPercentiles[] = { 50, 99, 99.9 };
+const common::HistogramMonitorStatus kNullHistogram = {};
+
+void AppendEscaped(const std::string& value, std::string* text) {
+  for (char c : value) {
+    if (c == '\n') {
+      text->append("\\n");
+      continue;
+    }
+    if (c == '\\' || c == '"') text->push_back('\\');
+    text->push_back(c);
+  }
+}
+
+// Appends the labels of a "module#name" monitor key.
+void AppendLabels(const std::string& key, const char* extra, std::string* text) {
+  auto pos = key.find('#');
+  text->append("{module=\"");
+  AppendEscaped(key.substr(0, pos), text);
+  text->append("\",name=\"");
+  if (pos != std::string::npos) AppendEscaped(key.substr(pos + 1), text);
+  text->push_back('"');
+  if (extra != nullptr) {
+    text->push_back(',');
+    text->append(extra);
+  }
+  text->push_back('}');
+}
+
+void AppendSample(const char* metric, const std::string& key,
+                  const char* extra, double value, std::string* text) {
+  char buf[32];
+  text->append(metric);
+  AppendLabels(key, extra, text);
+  snprintf(buf, sizeof(buf), " %.17g\n", value);
+  text->append(buf);
+}
+
+void AppendType(const char* metric, const char* type, std::string* text) {
+  text->append("# TYPE ").append(metric).append(" ").append(type).append("\n");
+}
+
+template <typename T>
+const T* FindPrev(const std::map<std::string, T>& prev, const std::string& key) {
+  auto it = prev.find(key);
+  return it == prev.end() ? nullptr : &it->second;
+}
+
+}  // anonymous namespace
+
+MonitorStatusExporter::MonitorStatusExporter()
+    : interval_ms_(0),
+      current_(0),
+      text_(std::make_shared<std::string>()),
+      running_(false) {}
+
+MonitorStatusExporter::~MonitorStatusExporter() {
+  Stop();
+}
+
+MonitorStatusExporter* MonitorStatusExporter::Instance() {
+  static MonitorStatusExporter exporter;
+  return &exporter;
+}
+
+bool MonitorStatusExporter::Start(uint32_t interval_ms) {
+  if (running_) {
+    ORC_WARN("MonitorStatusExporter is started.");
+    return false;
+  }
+  if (interval_ms == 0) {
+    ORC_ERROR("MonitorStatusExporter interval must be positive.");
+    return false;
+  }
+
+  interval_ms_ = interval_ms;
+  TakeSnapshot(&snapshots_[current_]);
+  running_ = true;
+  worker_ = std::thread([this]() { WorkLoop(); });
+  ORC_INFO("MonitorStatusExporter Start success, interval: %u ms.", interval_ms);
+  return true;
+}
+
+void MonitorStatusExporter::Stop() {
+  if (!running_) return;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+  }
+  cond_.notify_all();
+  worker_.join();
+}
+
+std::shared_ptr<const std::string> MonitorStatusExporter::Export() const {
+  return std::atomic_load(&text_);
+}
+
+void MonitorStatusExporter::WorkLoop() {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cond_.wait_for(lock, std::chrono::milliseconds(interval_ms_),
+                     [this]() { return !running_; });
+      if (!running_) break;
+    }
+
+    const Snapshot& prev = snapshots_[current_];
+    current_ ^= 1;
+    Snapshot& cur = snapshots_[current_];
+    TakeSnapshot(&cur);
+
+    auto text = std::make_shared<std::string>();
+    Render(cur, prev, text.get());
+    std::atomic_store(&text_, std::shared_ptr<const std::string>(text));
+  }
+}
+
+void MonitorStatusExporter::TakeSnapshot(Snapshot* snapshot) {
+  auto monitor_status = common::MonitorStatus::Instance();
+  gettimeofday(&snapshot->time, NULL);
+  monitor_status->GetAllCounters(&snapshot->counters);
+  monitor_status->GetAllTimerCounters(&snapshot->timers);
+  monitor_status->GetAllBinaryCounters(&snapshot->binaries);
+  monitor_status->GetAllHistogramCounters(&snapshot->histograms);
+}
+
+void MonitorStatusExporter::Render(const Snapshot& cur, const Snapshot& prev,
+                                   std::string* text) {
+  double seconds = (cur.time.tv_sec - prev.time.tv_sec) +
+      (cur.time.tv_usec - prev.time.tv_usec) / 1000000.0;
+  if (seconds <= 0) seconds = 1;
+
+  AppendType("orc_counter_total", "counter", text);
+  for (const auto& it : cur.counters) {
+    AppendSample("orc_counter_total", it.first, nullptr, it.second, text);
+  }
+  AppendType("orc_counter_rate", "gauge", text);
+  for (const auto& it : cur.counters) {
+    auto old = FindPrev(prev.counters, it.first);
+    uint64_t delta = it.second - (old != nullptr ? *old : 0);
+    AppendSample("orc_counter_rate", it.first, nullptr, delta / seconds, text);
+  }
+
+  AppendType("orc_timer_count_total", "counter", text);
+  for (const auto& it : cur.timers) {
+    AppendSample("orc_timer_count_total", it.first, nullptr,
+                 it.second.total_count, text);
+  }
+  AppendType("orc_timer_time_us_total", "counter", text);
+  for (const auto& it : cur.timers) {
+    AppendSample("orc_timer_time_us_total", it.first, nullptr,
+                 it.second.total_time, text);
+  }
+  AppendType("orc_timer_qps", "gauge", text);
+  for (const auto& it : cur.timers) {
+    auto old = FindPrev(prev.timers, it.first);
+    uint64_t count = it.second.total_count - (old != nullptr ? old->total_count : 0);
+    AppendSample("orc_timer_qps", it.first, nullptr, count / seconds, text);
+  }
+  AppendType("orc_timer_avg_us", "gauge", text);
+  for (const auto& it : cur.timers) {
+    auto old = FindPrev(prev.timers, it.first);
+    uint64_t count = it.second.total_count - (old != nullptr ? old->total_count : 0);
+    uint64_t time = it.second.total_time - (old != nullptr ? old->total_time : 0);
+    AppendSample("orc_timer_avg_us", it.first, nullptr,
+                 count > 0 ? static_cast<double>(time) / count : 0, text);
+  }
+
+  AppendType("orc_binary_total", "counter", text);
+  for (const auto& it : cur.binaries) {
+    AppendSample("orc_binary_total", it.first, "value=\"true\"",
+                 it.second.true_count, text);
+    AppendSample("orc_binary_total", it.first, "value=\"false\"",
+                 it.second.false_count, text);
+  }
+  AppendType("orc_binary_flag", "gauge", text);
+  for (const auto& it : cur.binaries) {
+    AppendSample("orc_binary_flag", it.first, nullptr, it.second.flag, text);
+  }
+
+  // Quantiles are of the last interval, count and sum are cumulative.
+  AppendType("orc_histogram_us", "summary", text);
+  common::HistogramMonitorStatus diff;
+  for (const auto& it : cur.histograms) {
+    auto old = FindPrev(prev.histograms, it.first);
+    common::HistogramDiff(it.second, old != nullptr ? *old : kNullHistogram, &diff);
+    for (size_t i = 0; i < sizeof(kPercentiles) / sizeof(kPercentiles[0]); ++i) {
+      std::string quantile = std::string("quantile=\"") + kQuantiles[i] + "\"";
+      AppendSample("orc_histogram_us", it.first, quantile.c_str(),
+                   common::HistogramPercentile(diff, kPercentiles[i]), text);
+    }
+    AppendSample("orc_histogram_us_sum", it.first, nullptr,
+                 it.second.total_time, text);
+    AppendSample("orc_histogram_us_count", it.first, nullptr,
+                 it.second.total_count, text);
+  }
+}
+
+}  // namespace orc
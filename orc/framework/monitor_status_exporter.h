@@ -0,0 +1,67 @@
+#ifndef ORC_FRAMEWORK_MONITOR_STATUS_EXPORTER_H_
+#define ORC_FRAMEWORK_MONITOR_STATUS_EXPORTER_H_
+
+#include <sys/time.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "common/monitor/monitor_status_impl.h"
+#include "orc/util/macros.h"
+
+namespace orc {
+
+// Periodically snapshots MonitorStatus and renders it as Prometheus text.
+// Only the exporter thread reads the monitor file; it keeps the previous and
+// current snapshot (double buffer) to compute per-interval deltas and rates,
+// and publishes the rendered text atomically, so a scrape is a pointer copy.
+class MonitorStatusExporter {
+ public:
+  // Joins the worker, the function-static instance may be destroyed running.
+  ~MonitorStatusExporter();
+  static MonitorStatusExporter* Instance();
+
+  bool Start(uint32_t interval_ms);
+  void Stop();
+  bool running() const { return running_; }
+
+  // Prometheus text of the last interval, empty before the first interval.
+  std::shared_ptr<const std::string> Export() const;
+
+ private:
+  MonitorStatusExporter();
+
+  struct Snapshot {
+    struct timeval time;
+    std::map<std::string, uint64_t> counters;
+    std::map<std::string, common::TimerMonitorStatus> timers;
+    std::map<std::string, common::BinaryMonitorStatus> binaries;
+    std::map<std::string, common::HistogramMonitorStatus> histograms;
+  };
+
+  void WorkLoop();
+  void TakeSnapshot(Snapshot* snapshot);
+  void Render(const Snapshot& cur, const Snapshot& prev, std::string* text);
+
+ private:
+  uint32_t interval_ms_;
+  Snapshot snapshots_[2];
+  uint32_t current_;
+  std::shared_ptr<const std::string> text_;
+
+  std::thread worker_;
+  std::atomic<bool> running_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+
+  ORC_DISALLOW_COPY_AND_ASSIGN(MonitorStatusExporter);
+};
+
+}  // namespace orc
+
+#endif  // ORC_FRAMEWORK_MONITOR_STATUS_EXPORTER_H_
@@ -0,0 +1,55 @@
+#include "gtest/gtest.h"
+#include "orc/framework/monitor_status_exporter.h"
+
+#include <unistd.h>
+
+namespace orc {
+
+class MonitorStatusExporterTest : public ::testing::Test {
+ public:
+  static void SetUpTestCase() {
+    remove("/tmp/monitor_status_exporter_test.dat");
+    MONITOR_STATUS_INIT("/tmp/monitor_status_exporter_test.dat");
+  }
+};
+
+TEST_F(MonitorStatusExporterTest, Export) {
+  MONITOR_STATUS_NORMAL_COUNTER_BY("exporter", "counter", 10);
+  MONITOR_STATUS_NORMAL_TIMER_BY("exporter", "timer", 1000, 1);
+  MONITOR_STATUS_NORMAL_BINARY_BY("exporter", "binary", 1);
+  MONITOR_STATUS_HISTOGRAM_BY("exporter", "histogram", 1000, 1);
+
+  ASSERT_TRUE(MonitorStatusExporter::Instance()->Start(10));
+  ASSERT_TRUE(MonitorStatusExporter::Instance()->running());
+  MONITOR_STATUS_NORMAL_COUNTER_BY("exporter", "counter", 10);
+
+  std::shared_ptr<const std::string> text;
+  for (int i = 0; i < 100; ++i) {
+    usleep(10000);
+    text = MonitorStatusExporter::Instance()->Export();
+    if (text->find("orc_counter_total{module=\"exporter\",name=\"counter\"} 20") !=
+        std::string::npos) {
+      break;
+    }
+  }
+  MonitorStatusExporter::Instance()->Stop();
+  ASSERT_FALSE(MonitorStatusExporter::Instance()->running());
+
+  EXPECT_NE(std::string::npos, text->find("# TYPE orc_counter_total counter\n"));
+  EXPECT_NE(std::string::npos,
+            text->find("orc_counter_total{module=\"exporter\",name=\"counter\"} 20\n"));
+  EXPECT_NE(std::string::npos,
+            text->find("orc_timer_count_total{module=\"exporter\",name=\"timer\"} 1\n"));
+  EXPECT_NE(std::string::npos,
+            text->find("orc_binary_total{module=\"exporter\",name=\"binary\",value=\"true\"} 1\n"));
+  EXPECT_NE(std::string::npos,
+            text->find("orc_histogram_us_count{module=\"exporter\",name=\"histogram\"} 1\n"));
+}
+
+// Left running, the instance joins its worker when destroyed at exit.
+TEST_F(MonitorStatusExporterTest, ExitRunning) {
+  ASSERT_TRUE(MonitorStatusExporter::Instance()->Start(10));
+  ASSERT_TRUE(MonitorStatusExporter::Instance()->running());
+}
+
+}  // namespace orc
@@ -8,6 +8,8 @@ std::string Options::OrcOutFile         = "orc.app.outfile";
 std::string Options::OrcErrFile         = "orc.app.errfile";
 std::string Options::OrcLogMaxLength    = "orc.log.max.length";
 std::string Options::OrcLogLevel        = "orc.log.level";
+std::string Options::OrcLogRateLimit    = "orc.log.rate.limit";
+std::string Options::OrcLogRateBurst    = "orc.log.rate.burst";
 
 std::string Options::SvrName                = "svr.name";
 std::string Options::SvrMaxRestartIntensity = "svr.restart.max.intensity";
@@ -21,10 +23,31 @@ std::string Options::SvrWorkerQueueSize     = "svr.worker.queue.size";
 std::string Options::SvrWorkerPinCpu        = "svr.worker.pin.cpu";
 std::string Options::SvrServiceDiscovery    = "svr.service.discovery";
 std::string Options::SvrMonitorStatusFile   = "svr.monitor.status.file";
+std::string Options::SvrMonitorExportInterval = "svr.monitor.export.interval";
+std::string Options::SvrMonitorExportPath   = "svr.monitor.export.path";
 std::string Options::SvrWorkflowPoolMode    = "svr.workflow.pool.mode";
 std::string Options::SvrWorkflowPoolSize    = "svr.workflow.pool.size";
 std::string Options::SvrWorkflowUseTls      = "svr.workflow.use.tls";
 std::string Options::SvrWorkflowFile        = "svr.workflow.file";
+std::string Options::SvrWorkflowParallelInline = "svr.workflow.parallel.inline";
+std::string Options::SvrWorkflowDeadline    = "svr.workflow.deadline";
+std::string Options::SvrWorkflowFallback    = "svr.workflow.fallback";
+std::string Options::SvrWorkflowHotReload   = "svr.workflow.hot.reload";
+std::string Options::SvrWorkflowOptimize    = "svr.workflow.optimize";
+std::string Options::SvrWorkflowDump        = "svr.workflow.dump";
+std::string Options::SvrTraceEnable         = "svr.trace.enable";
+std::string Options::SvrTraceSampleRate     = "svr.trace.sample.rate";
+std::string Options::SvrTraceSlowThreshold  = "svr.trace.slow.threshold";
+std::string Options::SvrTraceRingSize       = "svr.trace.ring.size";
+std::string Options::SvrTraceExportPath     = "svr.trace.export.path";
+std::string Options::SvrAdmissionEnable     = "svr.admission.enable";
+std::string Options::SvrAdmissionInitLimit  = "svr.admission.init.limit";
+std::string Options::SvrAdmissionMinLimit   = "svr.admission.min.limit";
+std::string Options::SvrAdmissionMaxLimit   = "svr.admission.max.limit";
+std::string Options::SvrAdmissionWindow     = "svr.admission.window";
+std::string Options::SvrAdmissionQueueTarget = "svr.admission.queue.target";
+std::string Options::SvrAdmissionQueueInterval = "svr.admission.queue.interval";
+std::string Options::SvrAdmissionPriorityRatio = "svr.admission.priority.ratio";
 std::string Options::SvrHandlerFile         = "svr.handler.file";
 std::string Options::SvrSessionFactory      = "svr.session.factory";
 std::string Options::SvrSessionPoolSize     = "svr.session.pool.size";
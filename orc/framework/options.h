@@ -12,6 +12,8 @@ struct Options {
   static std::string OrcErrFile;
   static std::string OrcLogMaxLength;
   static std::string OrcLogLevel;
+  static std::string OrcLogRateLimit;
+  static std::string OrcLogRateBurst;
 
   static std::string SvrName;
   static std::string SvrMaxRestartIntensity;
@@ -25,10 +27,32 @@ struct Options {
   static std::string SvrWorkerPinCpu;
   static std::string SvrServiceDiscovery;
   static std::string SvrMonitorStatusFile;
+  static std::string SvrMonitorExportInterval;
+  static std::string SvrMonitorExportPath;
   static std::string SvrWorkflowPoolMode;
   static std::string SvrWorkflowPoolSize;
+  // Deprecated, ignored with a warning.
   static std::string SvrWorkflowUseTls;
   static std::string SvrWorkflowFile;
+  static std::string SvrWorkflowParallelInline;
+  static std::string SvrWorkflowDeadline;
+  static std::string SvrWorkflowFallback;
+  static std::string SvrWorkflowHotReload;
+  static std::string SvrWorkflowOptimize;
+  static std::string SvrWorkflowDump;
+  static std::string SvrTraceEnable;
+  static std::string SvrTraceSampleRate;
+  static std::string SvrTraceSlowThreshold;
+  static std::string SvrTraceRingSize;
+  static std::string SvrTraceExportPath;
+  static std::string SvrAdmissionEnable;
+  static std::string SvrAdmissionInitLimit;
+  static std::string SvrAdmissionMinLimit;
+  static std::string SvrAdmissionMaxLimit;
+  static std::string SvrAdmissionWindow;
+  static std::string SvrAdmissionQueueTarget;
+  static std::string SvrAdmissionQueueInterval;
+  static std::string SvrAdmissionPriorityRatio;
   static std::string SvrHandlerFile;
   static std::string SvrSessionFactory;
   static std::string SvrSessionPoolSize;
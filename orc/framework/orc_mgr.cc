@@ -4,6 +4,8 @@
 
 #include "common/monitor/monitor_status.h"
 #include "orc/framework/configure.h"
+#include "orc/framework/monitor_status_exporter.h"
+#include "orc/framework/trace_recorder.h"
 #include "orc/com/component_mgr.h"
 #include "orc/util/file_monitor.h"
 
@@ -21,9 +23,32 @@ bool OrcMgr::InitMonitorStatus(const YAML::Node& config) {
 
   MONITOR_STATUS_INIT(file.c_str());
   ORC_INFO("MonitorStatus Init success.");
+
+  // 0 disables the exporter.
+  uint32_t export_interval;
+  ORC_CONFIG_OR_DEFAULT(config, Options::SvrMonitorExportInterval,
+                        export_interval, 0);
+  if (export_interval > 0 &&
+      !MonitorStatusExporter::Instance()->Start(export_interval)) {
+    return false;
+  }
   return true;
 }
 
+bool OrcMgr::InitTraceRecorder(const YAML::Node& config) {
+  bool enable = false;
+  ORC_CONFIG_OR_DEFAULT(config, Options::SvrTraceEnable, enable, false);
+  if (!enable) return true;
+
+  TraceRecorder::Option option;
+  int64_t slow_ms;
+  ORC_CONFIG_OR_DEFAULT(config, Options::SvrTraceSampleRate, option.sample_rate, 1000);
+  ORC_CONFIG_OR_DEFAULT(config, Options::SvrTraceSlowThreshold, slow_ms, 100);
+  ORC_CONFIG_OR_DEFAULT(config, Options::SvrTraceRingSize, option.ring_size, 4096);
+  option.slow_us = slow_ms * 1000;
+  return TraceRecorder::Instance()->Start(option);
+}
+
 bool OrcMgr::InitFileMonitor(const YAML::Node& config) {
   return FileMonitor::Instance()->Start();
 }
@@ -51,6 +76,7 @@ bool OrcMgr::InitWorkflow(const YAML::Node& config) {
 
 bool OrcMgr::Setup(const YAML::Node& config) {
   if (!InitMonitorStatus(config) ||
+      !InitTraceRecorder(config) ||
       !InitFileMonitor(config) ||
       !InitComponents(config) ||
       !InitPlugins(config) ||
@@ -68,6 +94,8 @@ void OrcMgr::Stop() {
 
   ComponentMgr::Instance()->Release();
   FileMonitor::Instance()->Stop();
+  TraceRecorder::Instance()->Stop();
+  MonitorStatusExporter::Instance()->Stop();
 }
 
 void OrcMgr::Run(ServiceClosure* closure) {
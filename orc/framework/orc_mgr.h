@@ -28,6 +28,7 @@ class OrcMgr {
   OrcMgr() = default;
 
   bool InitMonitorStatus(const YAML::Node& config);
+  bool InitTraceRecorder(const YAML::Node& config);
   bool InitFileMonitor(const YAML::Node& config);
   bool InitComponents(const YAML::Node& config);
   bool InitPlugins(const YAML::Node& config);
@@ -98,6 +98,8 @@ SessionBase* PoolSessionFactory<T>::Acquire() {
 template<typename T>
 void PoolSessionFactory<T>::Release(SessionBase* session) {
   session->Clear();
+  // The calls of the session are all done.
+  session->ResetArena();
 
   if (tls_sessions_.size() < tls_size_) {
     tls_sessions_.emplace(session);
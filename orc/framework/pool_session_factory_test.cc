@@ -46,4 +46,22 @@ TEST(PoolSessionFactory, Init) {
   ASSERT_EQ(1u, factory.tls_sessions_.size());
 }
 
+TEST(PoolSessionFactory, ResetArena) {
+  YAML::Node config;
+  config[Options::SvrSessionPoolSize] = 20;
+  config[Options::SvrWorkerNum] = 16;
+  TestPoolSessionFactory factory;
+  ASSERT_TRUE(factory.Init(config));
+
+  auto session = factory.Acquire();
+  auto arena = session->arena();
+  google::protobuf::Arena::CreateArray<char>(arena, 4096);
+  ASSERT_LT(0u, arena->SpaceUsed());
+
+  // Freed all at once on release, and reused by the next request.
+  factory.Release(session);
+  ASSERT_EQ(0u, arena->SpaceUsed());
+  ASSERT_EQ(arena, session->arena());
+}
+
 }  // namespace orc
@@ -1,15 +1,19 @@
 #ifndef ORC_FRAMEWORK_SERVICE_CLOSURE_H_
 #define ORC_FRAMEWORK_SERVICE_CLOSURE_H_
 
+#include <stdint.h>
+
+#include <string>
+
 #include "orc/util/closure.h"
 
 namespace orc {
 
 class ServiceClosure : public Closure {
  public:
-  enum class RetCode {Success, NoSession, ReqError, AppError};
+  enum class RetCode {Success, NoSession, ReqError, AppError, Timeout, Overload};
 
-  ServiceClosure() : ret_code_(RetCode::Success) {}
+  ServiceClosure() : ret_code_(RetCode::Success), deadline_us_(-1), arrive_us_(0) {}
 
   RetCode ret_code() const { return ret_code_; }
   void set_ret_code(RetCode ret_code) { ret_code_ = ret_code; }
@@ -17,9 +21,20 @@ class ServiceClosure : public Closure {
   std::string message() const { return message_; }
   void set_message(const std::string& message) { message_ = message; }
 
+  // Deadline of the request since the Epoch in microseconds, -1 means no
+  // deadline.
+  int64_t deadline_us() const { return deadline_us_; }
+  void set_deadline_us(int64_t deadline_us) { deadline_us_ = deadline_us; }
+
+  // Time the request is admitted since the Epoch in microseconds.
+  int64_t arrive_us() const { return arrive_us_; }
+  void set_arrive_us(int64_t arrive_us) { arrive_us_ = arrive_us; }
+
  private:
   RetCode ret_code_;
   std::string message_;
+  int64_t deadline_us_;
+  int64_t arrive_us_;
 };
 
 }  // namespace orc
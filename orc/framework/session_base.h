@@ -1,15 +1,21 @@
 #ifndef ORC_FRAMEWORK_SESSION_BASE_H_
 #define ORC_FRAMEWORK_SESSION_BASE_H_
 
+#include <memory>
+
 #include "orc/util/macros.h"
 #include "orc/framework/context.h"
 #include "orc/framework/service_closure.h"
 
+#include "google/protobuf/arena.h"
+
 namespace orc {
 
+// Data of a request. The branches of 'parallel' and 'dag' share the session
+// of their request, their handlers may access it at the same time.
 class SessionBase {
  public:
-  SessionBase() : orc_ctx_(this) {}
+  SessionBase() : orc_ctx_(this), service_closure_(nullptr) {}
   virtual ~SessionBase() = default;
 
   virtual bool Init() { return true; }
@@ -18,12 +24,24 @@ class SessionBase {
   ServiceClosure* service_closure() const { return service_closure_; }
   void set_service_closure(ServiceClosure* closure) { service_closure_ = closure; }
 
+  // For the messages of the session, e.g. the requests and responses of its
+  // rpc calls, allocated by Arena::CreateMessage and freed all at once when
+  // the session is released. It's created on first use.
+  google::protobuf::Arena* arena() {
+    if (arena_ == nullptr) arena_.reset(new google::protobuf::Arena());
+    return arena_.get();
+  }
+
   // Only called by orc
   Context* orc_ctx() { return &orc_ctx_; }
+  void ResetArena() {
+    if (arena_ != nullptr) arena_->Reset();
+  }
 
  private:
   Context orc_ctx_;
   ServiceClosure* service_closure_;
+  std::unique_ptr<google::protobuf::Arena> arena_;
   ORC_DISALLOW_COPY_AND_ASSIGN(SessionBase);
 };
 
@@ -0,0 +1,330 @@
+#include "orc/framework/trace_recorder.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+
+#include "orc/util/log.h"
+#include "orc/util/utils.h"
+
+#include "common/monitor/monitor_status_impl.h"
+
+namespace orc {
+
+namespace {
+
+thread_local TraceRpcStat* current_rpc_stat = nullptr;
+
+const uint64_t kLaneMask = (1ull << 30) - 1;
+const uint64_t kRootBit = 1ull << 62;
+const uint64_t kSlowBit = 1ull << 63;
+
+void AppendJsonString(const std::string& value, std::string* text) {
+  text->push_back('"');
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      text->push_back('\\');
+      text->push_back(c);
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      text->append(buf);
+    } else {
+      text->push_back(c);
+    }
+  }
+  text->push_back('"');
+}
+
+// Appends the printf formatted text.
+template <typename... Args>
+void AppendFormat(std::string* text, const char* format, Args... args) {
+  char buf[256];
+  int n = snprintf(buf, sizeof(buf), format, args...);
+  if (n > 0) text->append(buf, std::min(static_cast<size_t>(n), sizeof(buf) - 1));
+}
+
+}  // anonymous namespace
+
+const size_t TraceRecorder::kRecordWords;
+
+void TraceRecorder::Ring::Write(const Record& record) {
+  Slot& slot = slots[next++ % size];
+  uint64_t seq = slot.seq.load(std::memory_order_relaxed);
+  slot.seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  uint64_t flags = (record.root ? kRootBit : 0) | (record.slow ? kSlowBit : 0);
+  slot.words[0].store(record.trace_id, std::memory_order_relaxed);
+  slot.words[1].store(record.name_id | (record.lane & kLaneMask) << 32 | flags,
+                      std::memory_order_relaxed);
+  slot.words[2].store(record.start_us, std::memory_order_relaxed);
+  slot.words[3].store(record.end_us, std::memory_order_relaxed);
+  slot.words[4].store(record.wait_us, std::memory_order_relaxed);
+  slot.words[5].store(record.rpc_count | static_cast<uint64_t>(record.rpc_retries) << 32,
+                      std::memory_order_relaxed);
+
+  slot.seq.store(seq + 2, std::memory_order_release);
+}
+
+bool TraceRecorder::Ring::Read(uint32_t index, Record* record) const {
+  const Slot& slot = slots[index];
+  uint64_t seq = slot.seq.load(std::memory_order_acquire);
+  // Never written or being written.
+  if (seq == 0 || (seq & 1) != 0) return false;
+
+  uint64_t words[kRecordWords];
+  for (size_t i = 0; i < kRecordWords; ++i) {
+    words[i] = slot.words[i].load(std::memory_order_relaxed);
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (slot.seq.load(std::memory_order_relaxed) != seq) return false;
+
+  record->trace_id = words[0];
+  record->name_id = static_cast<uint32_t>(words[1]);
+  record->lane = static_cast<uint32_t>((words[1] >> 32) & kLaneMask);
+  record->root = (words[1] & kRootBit) != 0;
+  record->slow = (words[1] & kSlowBit) != 0;
+  record->start_us = static_cast<int64_t>(words[2]);
+  record->end_us = static_cast<int64_t>(words[3]);
+  record->wait_us = static_cast<int64_t>(words[4]);
+  record->rpc_count = static_cast<uint32_t>(words[5]);
+  record->rpc_retries = static_cast<uint32_t>(words[5] >> 32);
+  return true;
+}
+
+TraceRecorder::TraceRecorder()
+    : enabled_(false),
+      sample_rate_(0),
+      slow_us_(0),
+      ring_size_(4096),
+      // Not reused by restarts.
+      next_trace_id_(static_cast<uint64_t>(NowUs()) << 12) {}
+
+TraceRecorder* TraceRecorder::Instance() {
+  static TraceRecorder recorder;
+  return &recorder;
+}
+
+bool TraceRecorder::Start(const Option& option) {
+  if (option.ring_size == 0) {
+    ORC_ERROR("TraceRecorder ring size must be positive.");
+    return false;
+  }
+
+  sample_rate_ = option.sample_rate;
+  slow_us_ = option.slow_us;
+  ring_size_ = option.ring_size;
+  enabled_ = true;
+  ORC_INFO("TraceRecorder Start success, sample rate: %u, slow: %ld us, ring size: %u.",
+           option.sample_rate, option.slow_us, option.ring_size);
+  return true;
+}
+
+void TraceRecorder::Stop() {
+  enabled_ = false;
+}
+
+TraceRpcStat* TraceRecorder::CurrentRpcStat() {
+  return current_rpc_stat;
+}
+
+void TraceRecorder::SetCurrentRpcStat(TraceRpcStat* stat) {
+  current_rpc_stat = stat;
+}
+
+TraceRecorder::Ring* TraceRecorder::GetRing() {
+  thread_local Ring* ring = nullptr;
+  if (ring == nullptr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rings_.emplace_back(new Ring(ring_size_));
+    ring = rings_.back().get();
+  }
+  return ring;
+}
+
+uint32_t TraceRecorder::Intern(const std::string& name) {
+  thread_local std::map<std::string, uint32_t> cache;
+  auto it = cache.find(name);
+  if (it != cache.end()) return it->second;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto ret = name_ids_.emplace(name, static_cast<uint32_t>(names_.size()));
+  if (ret.second) names_.emplace_back(name);
+  cache.emplace(name, ret.first->second);
+  return ret.first->second;
+}
+
+void TraceRecorder::Commit(const std::string& workflow, int64_t begin_us,
+                           int64_t end_us, const std::vector<TraceSpan>& spans) {
+  if (!enabled()) return;
+
+  int64_t slow_us = slow_us_.load(std::memory_order_relaxed);
+  uint32_t sample_rate = sample_rate_.load(std::memory_order_relaxed);
+  bool slow = slow_us > 0 && end_us - begin_us >= slow_us;
+  if (!slow && (sample_rate == 0 || Random() % sample_rate != 0)) return;
+
+  auto ring = GetRing();
+  if (spans.size() >= ring->size) {
+    MONITOR_STATUS_NORMAL_COUNTER_BY("trace", "oversize", 1);
+    return;
+  }
+
+  Record root;
+  root.trace_id = next_trace_id_.fetch_add(1, std::memory_order_relaxed);
+  root.name_id = Intern(workflow);
+  root.lane = static_cast<uint32_t>(spans.size());
+  root.root = true;
+  root.slow = slow;
+  root.start_us = begin_us;
+  root.end_us = end_us;
+  root.wait_us = 0;
+  root.rpc_count = 0;
+  root.rpc_retries = 0;
+  for (const auto& span : spans) {
+    // The wait of a Fork node covers its branches.
+    if (span.lane == 0) root.wait_us += span.wait_us;
+    root.rpc_count += span.rpc_count;
+    root.rpc_retries += span.rpc_retries;
+  }
+  // Written first and overwritten first, a trace with the root is complete
+  // unless it's being written.
+  ring->Write(root);
+
+  Record record = root;
+  record.root = false;
+  for (const auto& span : spans) {
+    record.name_id = Intern(*span.name);
+    record.lane = span.lane;
+    record.start_us = span.start_us;
+    record.end_us = span.end_us;
+    record.wait_us = span.wait_us;
+    record.rpc_count = span.rpc_count;
+    record.rpc_retries = span.rpc_retries;
+    ring->Write(record);
+  }
+
+  MONITOR_STATUS_NORMAL_COUNTER_BY("trace", slow ? "slow" : "sampled", 1);
+}
+
+void TraceRecorder::Export(Format format, bool slow_only, std::string* text) {
+  std::vector<Ring*> rings;
+  std::vector<std::string> names;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& ring : rings_) rings.emplace_back(ring.get());
+    names = names_;
+  }
+
+  std::map<uint64_t, std::vector<Record>> traces;
+  Record record;
+  for (auto ring : rings) {
+    for (uint32_t i = 0; i < ring->size; ++i) {
+      if (!ring->Read(i, &record)) continue;
+      if (slow_only && !record.slow) continue;
+      // The names interned after the copy.
+      if (record.name_id >= names.size()) continue;
+      traces[record.trace_id].emplace_back(record);
+    }
+  }
+
+  for (auto it = traces.begin(); it != traces.end();) {
+    auto& records = it->second;
+    std::sort(records.begin(), records.end(), [](const Record& a, const Record& b) {
+                if (a.root != b.root) return a.root;
+                return a.start_us < b.start_us;
+              });
+    if (!records[0].root || records[0].lane + 1 != records.size()) {
+      it = traces.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  if (format == Format::Chrome) {
+    RenderChrome(traces, names, text);
+  } else {
+    RenderOtlp(traces, names, text);
+  }
+}
+
+void TraceRecorder::RenderChrome(const std::map<uint64_t, std::vector<Record>>& traces,
+                                 const std::vector<std::string>& names,
+                                 std::string* text) {
+  // Every request is a process, its branches are the threads.
+  text->append("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  uint32_t pid = 0;
+  for (const auto& trace : traces) {
+    ++pid;
+    const auto& root = trace.second[0];
+    text->append(pid == 1 ? "\n" : ",\n");
+    char id[32];
+    snprintf(id, sizeof(id), " %016llx", static_cast<unsigned long long>(trace.first));
+    AppendFormat(text, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,"
+                 "\"args\":{\"name\":", pid);
+    AppendJsonString(names[root.name_id] + id + (root.slow ? " slow" : ""), text);
+    text->append("}}");
+
+    for (const auto& record : trace.second) {
+      text->append(",\n{\"name\":");
+      AppendJsonString(names[record.name_id], text);
+      AppendFormat(text, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,"
+                   "\"pid\":%u,\"tid\":%u,",
+                   record.root ? "request" : "node",
+                   static_cast<long long>(record.start_us),
+                   static_cast<long long>(record.end_us - record.start_us),
+                   pid, record.root ? 0 : record.lane);
+      AppendFormat(text, "\"args\":{\"async_wait_us\":%lld,\"rpc_count\":%u,"
+                   "\"rpc_retries\":%u}}",
+                   static_cast<long long>(record.wait_us),
+                   record.rpc_count, record.rpc_retries);
+    }
+  }
+  text->append("\n]}\n");
+}
+
+void TraceRecorder::RenderOtlp(const std::map<uint64_t, std::vector<Record>>& traces,
+                               const std::vector<std::string>& names,
+                               std::string* text) {
+  // The span id is the index in the trace + 1, the node spans are children of
+  // the root span.
+  text->append("{\"resourceSpans\":[{\"resource\":{\"attributes\":["
+               "{\"key\":\"service.name\",\"value\":{\"stringValue\":\"orc\"}}]},"
+               "\"scopeSpans\":[{\"scope\":{\"name\":\"orc\"},\"spans\":[");
+  bool first = true;
+  for (const auto& trace : traces) {
+    const auto& records = trace.second;
+    for (size_t i = 0; i < records.size(); ++i) {
+      const auto& record = records[i];
+      text->append(first ? "\n" : ",\n");
+      first = false;
+
+      AppendFormat(text, "{\"traceId\":\"%032llx\",\"spanId\":\"%016llx\",",
+                   static_cast<unsigned long long>(trace.first),
+                   static_cast<unsigned long long>(i + 1));
+      if (!record.root) text->append("\"parentSpanId\":\"0000000000000001\",");
+      text->append("\"name\":");
+      AppendJsonString(names[record.name_id], text);
+      AppendFormat(text, ",\"kind\":%d,\"startTimeUnixNano\":\"%lld000\","
+                   "\"endTimeUnixNano\":\"%lld000\",\"attributes\":[",
+                   record.root ? 2 : 1,
+                   static_cast<long long>(record.start_us),
+                   static_cast<long long>(record.end_us));
+      AppendFormat(text, "{\"key\":\"orc.async_wait_us\",\"value\":{\"intValue\":\"%lld\"}},"
+                   "{\"key\":\"orc.rpc.count\",\"value\":{\"intValue\":\"%u\"}},"
+                   "{\"key\":\"orc.rpc.retries\",\"value\":{\"intValue\":\"%u\"}},",
+                   static_cast<long long>(record.wait_us),
+                   record.rpc_count, record.rpc_retries);
+      if (record.root) {
+        AppendFormat(text, "{\"key\":\"orc.slow\",\"value\":{\"boolValue\":%s}}]}",
+                     record.slow ? "true" : "false");
+      } else {
+        AppendFormat(text, "{\"key\":\"orc.lane\",\"value\":{\"intValue\":\"%u\"}}]}",
+                     record.lane);
+      }
+    }
+  }
+  text->append("\n]}]}]}\n");
+}
+
+}  // namespace orc
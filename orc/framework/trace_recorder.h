@@ -0,0 +1,154 @@
+#ifndef ORC_FRAMEWORK_TRACE_RECORDER_H_
+#define ORC_FRAMEWORK_TRACE_RECORDER_H_
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "orc/util/macros.h"
+
+namespace orc {
+
+// Rpc calls issued by the running step, see TraceRecorder::CurrentRpcStat.
+struct TraceRpcStat {
+  TraceRpcStat() : count(0), retries(0) {}
+
+  void Reset() {
+    count.store(0, std::memory_order_relaxed);
+    retries.store(0, std::memory_order_relaxed);
+  }
+
+  std::atomic<uint32_t> count;
+  std::atomic<uint32_t> retries;
+};
+
+// A step of a request, kept by Context until the request ends.
+struct TraceSpan {
+  // Name of the node, valid until the ExecutionGraph is released.
+  const std::string* name;
+  // 0 for the root Context, 'index + 1' for a branch of Fork or Dag.
+  uint32_t lane;
+  int64_t start_us;
+  int64_t end_us;
+  // Time between the node going async and being resumed.
+  int64_t wait_us;
+  uint32_t rpc_count;
+  uint32_t rpc_retries;
+};
+
+// Always-on recorder of the steps of sampled and slow requests. A request is
+// kept if it's one of every 'sample_rate' requests or it runs longer than
+// 'slow_us'. The spans are written to a ring buffer owned by the thread ending
+// the request, every slot is guarded by a sequence number, so the writer never
+// waits for the exporter. The exporter drops the slots being written and the
+// traces partly overwritten. The node names are interned, the writer locks
+// only the first time it sees a name.
+class TraceRecorder {
+ public:
+  struct Option {
+    Option() : sample_rate(0), slow_us(0), ring_size(4096) {}
+
+    // One of every 'sample_rate' requests, 0 disables sampling.
+    uint32_t sample_rate;
+    // Requests not shorter than it, 0 disables slow capture.
+    int64_t slow_us;
+    // Number of spans of every ring buffer.
+    uint32_t ring_size;
+  };
+
+  enum class Format { Chrome, Otlp };
+
+  ~TraceRecorder() = default;
+  static TraceRecorder* Instance();
+
+  // The ring size takes effect for the rings created afterwards.
+  bool Start(const Option& option);
+  void Stop();
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  // Called when a request of 'workflow' ends, a root span covering the
+  // request is added before 'spans'.
+  void Commit(const std::string& workflow, int64_t begin_us, int64_t end_us,
+              const std::vector<TraceSpan>& spans);
+
+  // Render the traces in the ring buffers, the slow ones only if 'slow_only'.
+  // Chrome is the Trace Event Format read by chrome://tracing and Perfetto,
+  // Otlp is the JSON encoding of OpenTelemetry ExportTraceServiceRequest.
+  void Export(Format format, bool slow_only, std::string* text);
+
+  // The stat of the step running in current thread, nullptr if none. Rpc
+  // clients count their calls and retries to it.
+  static TraceRpcStat* CurrentRpcStat();
+  static void SetCurrentRpcStat(TraceRpcStat* stat);
+
+ private:
+  TraceRecorder();
+
+  // A TraceSpan of a committed request, the name is interned.
+  struct Record {
+    uint64_t trace_id;
+    uint32_t name_id;
+    // For the root span, number of the node spans of the trace.
+    uint32_t lane;
+    bool root;
+    bool slow;
+    int64_t start_us;
+    int64_t end_us;
+    int64_t wait_us;
+    uint32_t rpc_count;
+    uint32_t rpc_retries;
+  };
+
+  static const size_t kRecordWords = 6;
+
+  // Seqlock slot: the sequence is odd while the slot is being written.
+  struct Slot {
+    std::atomic<uint64_t> seq;
+    std::atomic<uint64_t> words[kRecordWords];
+  };
+
+  // Written by one thread only.
+  struct Ring {
+    explicit Ring(uint32_t size) : slots(new Slot[size]), size(size), next(0) {
+      for (uint32_t i = 0; i < size; ++i) slots[i].seq.store(0);
+    }
+
+    void Write(const Record& record);
+    bool Read(uint32_t index, Record* record) const;
+
+    std::unique_ptr<Slot[]> slots;
+    const uint32_t size;
+    uint64_t next;
+  };
+
+  Ring* GetRing();
+  uint32_t Intern(const std::string& name);
+
+  static void RenderChrome(const std::map<uint64_t, std::vector<Record>>& traces,
+                           const std::vector<std::string>& names, std::string* text);
+  static void RenderOtlp(const std::map<uint64_t, std::vector<Record>>& traces,
+                         const std::vector<std::string>& names, std::string* text);
+
+ private:
+  std::atomic<bool> enabled_;
+  std::atomic<uint32_t> sample_rate_;
+  std::atomic<int64_t> slow_us_;
+  std::atomic<uint32_t> ring_size_;
+  std::atomic<uint64_t> next_trace_id_;
+
+  // Guards the rings list and the names, taken by the first commit of a
+  // thread or of a name, and by exporting.
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<Ring>> rings_;
+  std::map<std::string, uint32_t> name_ids_;
+  std::vector<std::string> names_;
+
+  ORC_DISALLOW_COPY_AND_ASSIGN(TraceRecorder);
+};
+
+}  // namespace orc
+
+#endif  // ORC_FRAMEWORK_TRACE_RECORDER_H_
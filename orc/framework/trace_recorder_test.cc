@@ -0,0 +1,179 @@
+#include "gtest/gtest.h"
+#include "orc/framework/trace_recorder.h"
+
+#include <thread>
+
+#include "common/monitor/monitor_status.h"
+
+namespace orc {
+
+class TraceRecorderTest : public ::testing::Test {
+ public:
+  static void SetUpTestCase() {
+    remove("/tmp/trace_recorder_test.dat");
+    MONITOR_STATUS_INIT("/tmp/trace_recorder_test.dat");
+  }
+
+  virtual void TearDown() {
+    TraceRecorder::Instance()->Stop();
+  }
+
+  static TraceSpan Span(const std::string* name, uint32_t lane,
+                        int64_t start_us, int64_t end_us) {
+    TraceSpan span;
+    span.name = name;
+    span.lane = lane;
+    span.start_us = start_us;
+    span.end_us = end_us;
+    span.wait_us = 0;
+    span.rpc_count = 0;
+    span.rpc_retries = 0;
+    return span;
+  }
+
+  static size_t Count(const std::string& text, const std::string& pattern) {
+    size_t n = 0;
+    for (auto pos = text.find(pattern); pos != std::string::npos;
+         pos = text.find(pattern, pos + 1)) {
+      ++n;
+    }
+    return n;
+  }
+};
+
+TEST_F(TraceRecorderTest, Export) {
+  TraceRecorder::Option option;
+  option.sample_rate = 1;
+  ASSERT_TRUE(TraceRecorder::Instance()->Start(option));
+
+  std::string a = "export_a", b = "export_b";
+  auto span_a = Span(&a, 0, 1000, 1200);
+  span_a.wait_us = 150;
+  span_a.rpc_count = 3;
+  span_a.rpc_retries = 1;
+  std::vector<TraceSpan> spans{span_a, Span(&b, 1, 1200, 1500)};
+  TraceRecorder::Instance()->Commit("export_wf", 1000, 1600, spans);
+
+  std::string text;
+  TraceRecorder::Instance()->Export(TraceRecorder::Format::Chrome, false, &text);
+  EXPECT_NE(std::string::npos, text.find(
+      "{\"name\":\"export_wf\",\"cat\":\"request\",\"ph\":\"X\",\"ts\":1000,\"dur\":600,"));
+  EXPECT_NE(std::string::npos, text.find(
+      "{\"name\":\"export_a\",\"cat\":\"node\",\"ph\":\"X\",\"ts\":1000,\"dur\":200,"));
+  EXPECT_NE(std::string::npos, text.find(
+      "\"tid\":0,\"args\":{\"async_wait_us\":150,\"rpc_count\":3,\"rpc_retries\":1}}"));
+  EXPECT_NE(std::string::npos, text.find(
+      "{\"name\":\"export_b\",\"cat\":\"node\",\"ph\":\"X\",\"ts\":1200,\"dur\":300,"));
+
+  text.clear();
+  TraceRecorder::Instance()->Export(TraceRecorder::Format::Otlp, false, &text);
+  EXPECT_NE(std::string::npos, text.find("\"name\":\"export_wf\",\"kind\":2,"
+      "\"startTimeUnixNano\":\"1000000\",\"endTimeUnixNano\":\"1600000\""));
+  EXPECT_NE(std::string::npos, text.find("\"parentSpanId\":\"0000000000000001\","
+      "\"name\":\"export_b\""));
+  EXPECT_NE(std::string::npos, text.find(
+      "{\"key\":\"orc.rpc.retries\",\"value\":{\"intValue\":\"1\"}}"));
+
+  // Not kept after stop.
+  TraceRecorder::Instance()->Stop();
+  TraceRecorder::Instance()->Commit("stopped_wf", 1000, 1600, spans);
+  text.clear();
+  TraceRecorder::Instance()->Export(TraceRecorder::Format::Chrome, false, &text);
+  EXPECT_EQ(std::string::npos, text.find("stopped_wf"));
+}
+
+TEST_F(TraceRecorderTest, SlowOnly) {
+  TraceRecorder::Option option;
+  option.slow_us = 1000;
+  ASSERT_TRUE(TraceRecorder::Instance()->Start(option));
+
+  std::string a = "slow_a";
+  std::vector<TraceSpan> spans{Span(&a, 0, 0, 500)};
+  TraceRecorder::Instance()->Commit("fast_wf", 0, 999, spans);
+  TraceRecorder::Instance()->Commit("slow_wf", 0, 1000, spans);
+
+  option.sample_rate = 1;
+  ASSERT_TRUE(TraceRecorder::Instance()->Start(option));
+  TraceRecorder::Instance()->Commit("sampled_wf", 0, 999, spans);
+
+  std::string text;
+  TraceRecorder::Instance()->Export(TraceRecorder::Format::Chrome, false, &text);
+  EXPECT_EQ(std::string::npos, text.find("\"fast_wf\""));
+  EXPECT_NE(std::string::npos, text.find("\"sampled_wf\""));
+  EXPECT_NE(std::string::npos, text.find("\"slow_wf\""));
+
+  text.clear();
+  TraceRecorder::Instance()->Export(TraceRecorder::Format::Chrome, true, &text);
+  EXPECT_EQ(std::string::npos, text.find("\"sampled_wf\""));
+  EXPECT_NE(std::string::npos, text.find("\"slow_wf\""));
+  EXPECT_NE(std::string::npos, text.find(" slow\"}}"));
+}
+
+TEST_F(TraceRecorderTest, Overwrite) {
+  TraceRecorder::Option option;
+  option.sample_rate = 1;
+  option.ring_size = 5;
+  ASSERT_TRUE(TraceRecorder::Instance()->Start(option));
+
+  // A new thread gets a ring of 5 spans.
+  std::thread thread([]() {
+                       std::string a = "overwrite_a";
+                       std::vector<TraceSpan> spans{Span(&a, 0, 0, 10)};
+                       for (int i = 0; i < 3; ++i) {
+                         TraceRecorder::Instance()->Commit("overwrite_wf", 0, 10, spans);
+                       }
+                       // Larger than the ring.
+                       spans.resize(5, spans[0]);
+                       TraceRecorder::Instance()->Commit("oversize_wf", 0, 10, spans);
+                     });
+  thread.join();
+
+  std::string text;
+  TraceRecorder::Instance()->Export(TraceRecorder::Format::Chrome, false, &text);
+  // The root of the first one is overwritten by the third one, its node span
+  // left is dropped.
+  EXPECT_EQ(2u, Count(text, "\"name\":\"overwrite_wf\""));
+  EXPECT_EQ(2u, Count(text, "\"name\":\"overwrite_a\""));
+  EXPECT_EQ(0u, Count(text, "oversize_wf"));
+}
+
+TEST_F(TraceRecorderTest, Concurrent) {
+  TraceRecorder::Option option;
+  option.sample_rate = 1;
+  option.ring_size = 64;
+  ASSERT_TRUE(TraceRecorder::Instance()->Start(option));
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([t]() {
+                           std::string name = "concurrent_" + std::to_string(t);
+                           std::vector<TraceSpan> spans{Span(&name, 0, 0, 10),
+                                                        Span(&name, 1, 0, 10)};
+                           for (int i = 0; i < 10000; ++i) {
+                             TraceRecorder::Instance()->Commit("concurrent_wf", 0, 10, spans);
+                           }
+                         });
+  }
+
+  for (int i = 0; i < 20; ++i) {
+    std::string text;
+    TraceRecorder::Instance()->Export(TraceRecorder::Format::Otlp, false, &text);
+    // Every trace exported is complete.
+    ASSERT_EQ(3 * Count(text, "\"name\":\"concurrent_wf\""),
+              Count(text, "\"name\":\"concurrent_"));
+  }
+  for (auto& thread : threads) thread.join();
+}
+
+TEST_F(TraceRecorderTest, CurrentRpcStat) {
+  ASSERT_TRUE(TraceRecorder::CurrentRpcStat() == nullptr);
+
+  TraceRpcStat stat;
+  TraceRecorder::SetCurrentRpcStat(&stat);
+  std::thread thread([]() { ASSERT_TRUE(TraceRecorder::CurrentRpcStat() == nullptr); });
+  thread.join();
+  ASSERT_EQ(&stat, TraceRecorder::CurrentRpcStat());
+  TraceRecorder::SetCurrentRpcStat(nullptr);
+}
+
+}  // namespace orc
@@ -73,17 +73,49 @@ bool Workflow::InitThreadPool(const YAML::Node& config) {
   ORC_CONFIG_OR_FAIL(config, Options::SvrWorkerQueueNum, option.queue_num);
   ORC_CONFIG_OR_FAIL(config, Options::SvrWorkerQueueSize, option.queue_size);
   ORC_CONFIG_OR_DEFAULT(config, Options::SvrWorkerPinCpu, option.pin_cpu, false);
+  ORC_CONFIG_OR_DEFAULT(config, Options::SvrWorkflowParallelInline, parallel_inline_, false);
   thread_pool_.reset(new ThreadPool(option));
   ORC_INFO("ThreadPool Init success.");
   return true;
 }
 
+bool Workflow::InitAdmissionController(const YAML::Node& config) {
+  bool enable = false;
+  ORC_CONFIG_OR_DEFAULT(config, Options::SvrAdmissionEnable, enable, false);
+  if (!enable) return true;
+
+  AdmissionController::Option option;
+  int64_t queue_target_ms, queue_interval_ms;
+  ORC_CONFIG_OR_DEFAULT(config, Options::SvrAdmissionInitLimit, option.init_limit, 64);
+  ORC_CONFIG_OR_DEFAULT(config, Options::SvrAdmissionMinLimit, option.min_limit, 4);
+  ORC_CONFIG_OR_DEFAULT(config, Options::SvrAdmissionMaxLimit, option.max_limit, 4096);
+  ORC_CONFIG_OR_DEFAULT(config, Options::SvrAdmissionWindow, option.window, 100);
+  ORC_CONFIG_OR_DEFAULT(config, Options::SvrAdmissionQueueTarget, queue_target_ms, 5);
+  ORC_CONFIG_OR_DEFAULT(config, Options::SvrAdmissionQueueInterval, queue_interval_ms, 100);
+  ORC_CONFIG_OR_DEFAULT(config, Options::SvrAdmissionPriorityRatio, option.priority_ratio,
+                        std::vector<double>(1, 1.0));
+  option.queue_target_us = queue_target_ms * 1000;
+  option.queue_interval_us = queue_interval_ms * 1000;
+
+  if (option.min_limit == 0 || option.min_limit > option.max_limit ||
+      option.init_limit < option.min_limit || option.init_limit > option.max_limit) {
+    ORC_ERROR("Invalid admission limit, init: %u, min: %u, max: %u.",
+              option.init_limit, option.min_limit, option.max_limit);
+    return false;
+  }
+
+  admission_.reset(new AdmissionController(option));
+  ORC_INFO("AdmissionController Init success.");
+  return true;
+}
+
 bool Workflow::Setup(const YAML::Node& config) {
   if (!SetupHandlerMgr(config) ||
       !SetupExecutionGraphMgr(config) ||
       !InitSessionFactory(config) ||
       !InitWorkflowRouter(config) ||
-      !InitThreadPool(config)) {
+      !InitThreadPool(config) ||
+      !InitAdmissionController(config)) {
     ORC_ERROR("Workflow Setup fail.");
     return false;
   }
@@ -93,37 +125,78 @@ bool Workflow::Setup(const YAML::Node& config) {
 }
 
 void Workflow::Stop() {
+  ExecutionGraphMgr::Instance()->Stop();
   thread_pool_.reset(nullptr);
 }
 
 void Workflow::Run(ServiceClosure* closure) {
+  int32_t priority = 0;
+  if (admission_) {
+    priority = workflow_router_->Priority(closure);
+    if (!admission_->Acquire(priority)) {
+      Reject(closure);
+      return;
+    }
+    closure->set_arrive_us(NowUs());
+  }
+
   ThreadMeta* thread_meta = GetThreadMeta();
   if (thread_meta->pool != thread_pool_.get()) {
-    auto task = thread_pool_->Schedule([this, closure](){ RunInner(closure); });
+    auto task = thread_pool_->Schedule([this, closure, priority](){ RunInner(closure, priority); });
     if (task) {
       // Schedule fail.
       ORC_WARN("ThreadPool Schedule fail for ServiceClosure.");
+      if (admission_) admission_->Release(-1);
       closure->Done();
     }
   } else {
-    RunInner(closure);
+    RunInner(closure, priority);
   }
 }
 
+void Workflow::Reject(ServiceClosure* closure) {
+  ORC_WARN_RATELIMITED("Reject request for overload.");
+  closure->set_ret_code(ServiceClosure::RetCode::Overload);
+  closure->set_message(std::string("Orc overloaded"));
+  closure->Done();
+}
+
 void Workflow::Run(Context* ctx) {
   ThreadMeta* thread_meta = GetThreadMeta();
   if (thread_meta->pool != thread_pool_.get()) {
-    auto task = thread_pool_->Schedule([this, ctx](){ RunInner(ctx); });
+    // Resume on the worker which started the request, where its session is
+    // still in cache.
+    auto task = thread_pool_->Schedule([this, ctx](){ RunInner(ctx); },
+                                       ctx->schedule_hint());
     if (task) {
       // Schedule fail.
       ORC_WARN("ThreadPool Schedule fail for Context. hint: %d", ctx->schedule_hint());
-      ResetCtx(ctx);
+      if (ctx->parent() != nullptr) {
+        // A branch can't be dropped alone, run it in current thread.
+        RunInner(ctx);
+      } else {
+        ResetCtx(ctx);
+      }
     }
   } else {
     RunInner(ctx);
   }
 }
 
+void Workflow::RunBranch(Context* branch, bool in_place) {
+  if (!in_place && !parallel_inline_) {
+    auto task = thread_pool_->Schedule([this, branch](){ RunInner(branch); });
+    if (!task) {
+      return;
+    }
+    // Schedule fail, run the branch in current thread.
+    ORC_WARN_RATELIMITED("ThreadPool Schedule fail for branch. hint: %d",
+                         branch->schedule_hint());
+  }
+
+  RunInner(branch);
+}
+
 Context* Workflow::SetupCtx(ServiceClosure* closure) {
   auto session = session_factory_->Acquire();
   if (session == nullptr) {
@@ -145,12 +218,12 @@ Context* Workflow::SetupCtx(ServiceClosure* closure) {
     return nullptr;
   }
 
-  auto workflow_name = workflow_router_->Route(session);
-  auto exe_graph = ExecutionGraphMgr::Instance()->GetExeGraph(workflow_name);
+  auto workflow_id = workflow_router_->RouteId(session);
+  auto exe_graph = ExecutionGraphMgr::Instance()->GetExeGraph(workflow_id);
   if (exe_graph == nullptr) {
-    ORC_WARN("Get ExecutionGraph fail by name: %s.", workflow_name.c_str());
+    ORC_WARN("Get ExecutionGraph fail by id: %d.", workflow_id);
     closure->set_ret_code(ServiceClosure::RetCode::AppError);
-    closure->set_message(std::string("Get ExecutionGraph fail by name ") + workflow_name);
+    closure->set_message(std::string("Get ExecutionGraph fail by id ") + std::to_string(workflow_id));
     closure->Done();
     session_factory_->Release(session);
     return nullptr;
@@ -167,27 +240,49 @@ Context* Workflow::SetupCtx(ServiceClosure* closure) {
 void Workflow::ResetCtx(Context* ctx) {
   auto session = ctx->session();
   auto closure = session->service_closure();
+  if (admission_) admission_->Release(NowUs() - closure->arrive_us());
   closure->Done();
 
+  ctx->CommitTrace();
   ExecutionGraphMgr::Instance()->ReleaseExeGraph(ctx->graph());
   ctx->Reset();
   session_factory_->Release(session);
 }
 
-void Workflow::RunInner(ServiceClosure* closure) {
+void Workflow::RunInner(ServiceClosure* closure, int32_t priority) {
+  if (admission_) {
+    int64_t now = NowUs();
+    if (admission_->ShouldDrop(priority, now - closure->arrive_us(), now)) {
+      admission_->Release(-1);
+      Reject(closure);
+      return;
+    }
+  }
+
   auto ctx = SetupCtx(closure);
   if (ctx != nullptr) {
     RunInner(ctx);
+  } else if (admission_) {
+    admission_->Release(-1);
   }
 }
 
 void Workflow::RunInner(Context* ctx) {
-  while (!ctx->IsAsync() && !ctx->IsDone()) {
-    ctx->Step();
-  }
+  while (ctx != nullptr) {
+    while (!ctx->IsDone()) {
+      // The Context will be resumed by 'Context::Callback', it may be running
+      // in another thread already, so don't touch it anymore.
+      if (ctx->IsAsync()) return;
+      ctx->Step();
+    }
 
-  if (ctx->IsDone()) {
-    ResetCtx(ctx);
+    auto parent = ctx->parent();
+    if (parent == nullptr) {
+      ResetCtx(ctx);
+      return;
+    }
+    // Continue with the 'Dag' branch made ready by this one, if any.
+    ctx = parent->JoinBranch(ctx);
   }
 }
 
@@ -6,6 +6,7 @@
 #include "orc/util/macros.h"
 #include "orc/util/thread_pool.h"
 
+#include "orc/framework/admission_controller.h"
 #include "orc/framework/context.h"
 #include "orc/framework/session_factory.h"
 #include "orc/framework/workflow_router.h"
@@ -26,6 +27,10 @@ class Workflow {
   void Run(ServiceClosure* closure);
   void Run(Context* ctx);
 
+  // Run a branch Context started by 'Context::Fork', the branch is scheduled
+  // to ThreadPool unless 'in_place' or the parallel inline option is set.
+  void RunBranch(Context* branch, bool in_place);
+
   ThreadPool* thread_pool() const { return thread_pool_.get(); }
 
  private:
@@ -34,18 +39,25 @@ class Workflow {
   bool InitSessionFactory(const YAML::Node& config);
   bool InitWorkflowRouter(const YAML::Node& config);
   bool InitThreadPool(const YAML::Node& config);
+  bool InitAdmissionController(const YAML::Node& config);
+
+  // Reply the request fast without acquiring a session.
+  void Reject(ServiceClosure* closure);
 
   // Called in Worker
   Context* SetupCtx(ServiceClosure* closure);
   void ResetCtx(Context* ctx);
 
-  void RunInner(ServiceClosure* closure);
+  void RunInner(ServiceClosure* closure, int32_t priority);
   void RunInner(Context* ctx);
 
  private:
   std::unique_ptr<ThreadPool> thread_pool_;
   SessionFactory* session_factory_;
   WorkflowRouter* workflow_router_;
+  bool parallel_inline_;
+  // nullptr if admission control is disabled.
+  std::unique_ptr<AdmissionController> admission_;
 
   ORC_DISALLOW_COPY_AND_ASSIGN(Workflow);
 };
@@ -4,6 +4,8 @@
 #include <string>
 
 #include "orc/framework/session_base.h"
+#include "orc/framework/service_closure.h"
+#include "orc/framework/execution_graph_mgr.h"
 #include "yaml-cpp/yaml.h"
 
 namespace orc {
@@ -16,6 +18,17 @@ class WorkflowRouter {
   virtual bool Init(const YAML::Node& config) = 0;
 
   virtual std::string Route(SessionBase* session) = 0;
+
+  // Id of the workflow to run, see 'ExecutionGraphMgr::GetGraphId'. The
+  // default one looks up the name from 'Route' every time without lock,
+  // override it with the ids resolved once in 'Init' to avoid the lookup.
+  virtual int32_t RouteId(SessionBase* session) {
+    return ExecutionGraphMgr::Instance()->GetGraphId(Route(session));
+  }
+
+  // Priority class of the request for admission control, 0 is the highest.
+  // Called before the session is acquired, so only the request is available.
+  virtual int32_t Priority(ServiceClosure* closure) { return 0; }
 };
 
 }  // namespace orc
@@ -0,0 +1,88 @@
+#include "orc/handler/coroutine_handler.h"
+
+#include "orc/util/log.h"
+
+namespace orc {
+
+Coroutine::Coroutine()
+    : resume_point_(0),
+      result_(true),
+      context_(nullptr),
+      pending_(0),
+      barrier_(this) {}
+
+void Coroutine::CallMethod(RpcClient* client,
+                           const google::protobuf::MethodDescriptor* method,
+                           const google::protobuf::Message* request,
+                           google::protobuf::Message* response,
+                           bool* success) {
+  client->CallMethod(method, request, response, Barrier(), success,
+                     context_->deadline_us());
+}
+
+void Coroutine::CallMethod(RpcClient* client,
+                           uint64_t routing_key,
+                           const google::protobuf::MethodDescriptor* method,
+                           const google::protobuf::Message* request,
+                           google::protobuf::Message* response,
+                           bool* success) {
+  client->CallMethod(routing_key, method, request, response, Barrier(), success,
+                     context_->deadline_us());
+}
+
+void Coroutine::CallMethod(RpcClient* client,
+                           const google::protobuf::MethodDescriptor* method,
+                           const google::protobuf::Message* request,
+                           const butil::IOBuf& request_attachment,
+                           google::protobuf::Message* response,
+                           butil::IOBuf* response_attachment,
+                           bool* success) {
+  client->CallMethod(method, request, request_attachment, response, response_attachment,
+                     Barrier(), success, context_->deadline_us());
+}
+
+google::protobuf::Closure* Coroutine::Barrier() {
+  ++pending_;
+  return &barrier_;
+}
+
+void Coroutine::BarrierClosure::Run() {
+  if (--co_->pending_ != 0) return;
+  // The last call resumes the Context, the handler runs again.
+  co_->context_->Callback();
+}
+
+bool CoroutineHandlerBase::BaseInit(const YAML::Node& config) {
+  return Init(config);
+}
+
+bool CoroutineHandlerBase::BaseRun(SessionBase* session_base, Context* context) {
+  // The frame lives in the Context until the node finishes, then it's freed
+  // by 'Context::StepReset'.
+  auto co = static_cast<Coroutine*>(context->async_closure());
+  if (co == nullptr) {
+    co = NewCoroutine();
+    co->context_ = context;
+    context->set_async_closure(co);
+  }
+
+  while (!co->finished()) {
+    // Hold one more for this thread, so no call can resume the Context before
+    // 'Resume' returns.
+    context->SetAsync(true);
+    co->pending_ = 1;
+
+    Resume(session_base, co);
+
+    if (--co->pending_ != 0) {
+      // Resumed by the last call.
+      return true;
+    }
+    // All calls are finished in current thread, go on directly.
+  }
+
+  context->SetAsync(false);
+  return co->result();
+}
+
+}  // namespace orc
@@ -0,0 +1,147 @@
+#ifndef ORC_HANDLER_COROUTINE_HANDLER_H__
+#define ORC_HANDLER_COROUTINE_HANDLER_H__
+
+#include <atomic>
+
+#include "orc/framework/handler_base.h"
+#include "orc/com/rpc_client/rpc_client.h"
+
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+#include "google/protobuf/stubs/common.h"
+
+namespace orc {
+
+// Stackless coroutine for handlers, which lets one handler issue several
+// dependent async calls:
+//
+//   bool Resume(SessionBase* session, MyFrame* co) override {
+//     ORC_CO_BEGIN(co);
+//     co->CallMethod(client, method, &co->req1, &co->resp1, &co->ok1);
+//     ORC_CO_AWAIT(co);
+//     ...  // build req2 from resp1
+//     co->CallMethod(client, method, &co->req2, &co->resp2, &co->ok2);
+//     ORC_CO_AWAIT(co);
+//     ORC_CO_RETURN(co, co->ok2);
+//     ORC_CO_END(co);
+//   }
+//
+// Like 'switch', the locals of 'Resume' don't survive an ORC_CO_AWAIT, keep
+// them in the frame, i.e. the subclass of 'Coroutine'. The frame is the only
+// heap allocation of a handler run, it's freed when the node finishes.
+class Coroutine : public Closure {
+ public:
+  Coroutine();
+  virtual ~Coroutine() = default;
+
+  // Issue an async rpc call, it's bounded by the deadline of the request.
+  void CallMethod(RpcClient* client,
+                  const google::protobuf::MethodDescriptor* method,
+                  const google::protobuf::Message* request,
+                  google::protobuf::Message* response,
+                  bool* success);
+
+  // Same as above, routed by 'routing_key', see RpcClient::CallMethod.
+  void CallMethod(RpcClient* client,
+                  uint64_t routing_key,
+                  const google::protobuf::MethodDescriptor* method,
+                  const google::protobuf::Message* request,
+                  google::protobuf::Message* response,
+                  bool* success);
+
+  // Same as above, with the attachments beside the messages, see
+  // RpcClient::CallMethod. The frame keeps both until the call is awaited.
+  void CallMethod(RpcClient* client,
+                  const google::protobuf::MethodDescriptor* method,
+                  const google::protobuf::Message* request,
+                  const butil::IOBuf& request_attachment,
+                  google::protobuf::Message* response,
+                  butil::IOBuf* response_attachment,
+                  bool* success);
+
+  // The closure for any other async call, which must be run exactly once.
+  google::protobuf::Closure* Barrier();
+
+  Context* context() const { return context_; }
+
+  // Used by the ORC_CO_* macros.
+  int resume_point() const { return resume_point_; }
+  void set_resume_point(int resume_point) { resume_point_ = resume_point; }
+  bool finished() const { return resume_point_ < 0; }
+  bool result() const { return result_; }
+  void set_result(bool result) { result_ = result; }
+
+ private:
+  friend class CoroutineHandlerBase;
+
+  // Resumes the Context after all the pending calls are finished.
+  class BarrierClosure : public google::protobuf::Closure {
+   public:
+    explicit BarrierClosure(Coroutine* co) : co_(co) {}
+    void Run() override;
+
+   private:
+    Coroutine* co_;
+  };
+
+  int resume_point_;
+  bool result_;
+  Context* context_;
+  std::atomic<int32_t> pending_;
+  BarrierClosure barrier_;
+};
+
+#define ORC_CO_BEGIN(co) switch ((co)->resume_point()) { case 0:
+
+// Suspend until all calls issued before are finished. The resume points are
+// numbered by __COUNTER__ rather than __LINE__, so ORC_CO_AWAITs on one line
+// don't collide.
+#define ORC_CO_AWAIT(co) ORC_CO_AWAIT_AT(co, __COUNTER__ + 1)
+
+#define ORC_CO_AWAIT_AT(co, point) \
+  do { \
+    (co)->set_resume_point(point); \
+    return true; \
+    case point:; \
+  } while (0)
+
+#define ORC_CO_RETURN(co, ret) \
+  do { \
+    (co)->set_result(ret); \
+    (co)->set_resume_point(-1); \
+    return (co)->result(); \
+  } while (0)
+
+#define ORC_CO_END(co) } ORC_CO_RETURN(co, true)
+
+class CoroutineHandlerBase : public HandlerBase {
+ public:
+  virtual bool Init(const YAML::Node& config) = 0;
+
+  // Run from the start or the last ORC_CO_AWAIT, until the next ORC_CO_AWAIT
+  // or the end.
+  virtual bool Resume(SessionBase* session_base, Coroutine* co) = 0;
+
+  virtual Coroutine* NewCoroutine() { return new Coroutine(); }
+
+ private:
+  bool BaseInit(const YAML::Node& config) override;
+  bool BaseRun(SessionBase* session_base, Context* context) override;
+};
+
+template<typename Frame>
+class CoroutineHandler : public CoroutineHandlerBase {
+ public:
+  virtual bool Resume(SessionBase* session_base, Frame* co) = 0;
+
+  Coroutine* NewCoroutine() override { return new Frame(); }
+
+ private:
+  bool Resume(SessionBase* session_base, Coroutine* co) override {
+    return Resume(session_base, static_cast<Frame*>(co));
+  }
+};
+
+}  // namespace orc
+
+#endif  // ORC_HANDLER_COROUTINE_HANDLER_H__
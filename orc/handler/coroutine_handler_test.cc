@@ -0,0 +1,184 @@
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "orc/framework/execution_graph.h"
+#include "orc/framework/handler_mgr.h"
+#include "orc/handler/coroutine_handler.h"
+#include "common/monitor/monitor_status.h"
+
+#define private public
+#include "orc/framework/workflow.h"
+#undef private
+
+namespace orc {
+
+// The calls issued by the handler, finished by the test thread if they're
+// async, or in place.
+bool async_calls = false;
+std::mutex call_mutex;
+std::condition_variable call_cond;
+std::deque<google::protobuf::Closure*> calls;
+
+void Call(google::protobuf::Closure* done) {
+  if (!async_calls) {
+    done->Run();
+    return;
+  }
+  std::lock_guard<std::mutex> lock(call_mutex);
+  calls.emplace_back(done);
+  call_cond.notify_all();
+}
+
+google::protobuf::Closure* TakeCall() {
+  std::unique_lock<std::mutex> lock(call_mutex);
+  if (!call_cond.wait_for(lock, std::chrono::seconds(5), []() { return !calls.empty(); })) {
+    return nullptr;
+  }
+  auto done = calls.front();
+  calls.pop_front();
+  return done;
+}
+
+// Frames not freed yet.
+std::atomic<int> live_frames(0);
+// Steps of the last request.
+std::vector<int> run_steps;
+
+struct TestFrame : public Coroutine {
+  TestFrame() { ++live_frames; }
+  ~TestFrame() { --live_frames; }
+  std::vector<int> steps;
+};
+
+class CoTestHandler : public CoroutineHandler<TestFrame> {
+ public:
+  bool Init(const YAML::Node& config) override { return true; }
+
+  bool Resume(SessionBase* session_base, TestFrame* co) override {
+    ORC_CO_BEGIN(co);
+    co->steps.push_back(1);
+    Call(co->Barrier());
+    ORC_CO_AWAIT(co);
+
+    // Two calls, one of them is always finished in place.
+    co->steps.push_back(2);
+    Call(co->Barrier());
+    co->Barrier()->Run();
+    ORC_CO_AWAIT(co);
+
+    // Nothing to wait for, and two awaits on one line.
+    co->steps.push_back(3); ORC_CO_AWAIT(co); co->steps.push_back(4); ORC_CO_AWAIT(co);
+
+    run_steps = co->steps;
+    ORC_CO_RETURN(co, true);
+    ORC_CO_END(co);
+  }
+};
+ORC_REGISTER_HANDLER(CoTestHandler);
+
+class TestSessionFactory : public SessionFactory {
+ public:
+  bool Init(const YAML::Node& config) override { return true; }
+  SessionBase* Acquire() override { return nullptr; }
+  void Release(SessionBase* session) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    released_ = true;
+    cond_.notify_all();
+  }
+
+  bool Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cond_.wait_for(lock, std::chrono::seconds(5), [this]() { return released_; });
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool released_ = false;
+};
+
+class TestServiceClosure : public ServiceClosure {
+ public:
+  void Done() override {}
+};
+
+class CoroutineHandlerTest : public ::testing::Test {
+ public:
+  static void SetUpTestCase() {
+    MONITOR_STATUS_INIT("/tmp/coroutine_handler_test.dat");
+
+    // A workflow of the only node running CoTestHandler.
+    auto topology = std::make_shared<ExecutionTopology>("co_wf");
+    std::unique_ptr<ExecutionNode> node(new ExecutionNode("CoTestHandler"));
+    node->set_handler_index(topology->AddHandler("CoTestHandler"));
+    node->set_true_next(ExecutionNode::EndNode());
+    node->set_false_next(ExecutionNode::EndNode());
+    topology->set_entry(node.get());
+    topology->AddNode("CoTestHandler", std::move(node));
+    pool_ = new ExecutionGraphPool();
+    ASSERT_TRUE(pool_->Init(ExecutionGraph::New(topology), 1, false));
+  }
+
+  void SetUp() override {
+    run_steps.clear();
+    workflow_.thread_pool_.reset(new ThreadPool(1, 1, 64));
+    workflow_.session_factory_ = &factory_;
+    workflow_.workflow_router_ = nullptr;
+    workflow_.parallel_inline_ = false;
+    session_.set_service_closure(&closure_);
+  }
+
+  void TearDown() override {
+    workflow_.thread_pool_.reset();
+  }
+
+  // Start a request in the worker.
+  void Start() {
+    auto graph = pool_->Get();
+    ASSERT_TRUE(graph != nullptr);
+    session_.orc_ctx()->Setup(&workflow_, graph);
+    workflow_.Run(session_.orc_ctx());
+  }
+
+ protected:
+  static ExecutionGraphPool* pool_;
+
+  TestSessionFactory factory_;
+  TestServiceClosure closure_;
+  SessionBase session_;
+  Workflow workflow_;
+};
+
+ExecutionGraphPool* CoroutineHandlerTest::pool_ = nullptr;
+
+TEST_F(CoroutineHandlerTest, SyncCompletion) {
+  async_calls = false;
+  Start();
+  ASSERT_TRUE(factory_.Wait());
+  ASSERT_EQ((std::vector<int>{1, 2, 3, 4}), run_steps);
+  ASSERT_EQ(0, live_frames.load());
+}
+
+TEST_F(CoroutineHandlerTest, AsyncCompletion) {
+  async_calls = true;
+  Start();
+
+  // The frame is kept while the handler is suspended.
+  for (int i = 0; i < 2; ++i) {
+    auto done = TakeCall();
+    ASSERT_TRUE(done != nullptr);
+    ASSERT_EQ(1, live_frames.load());
+    done->Run();
+  }
+
+  ASSERT_TRUE(factory_.Wait());
+  ASSERT_EQ((std::vector<int>{1, 2, 3, 4}), run_steps);
+  ASSERT_EQ(0, live_frames.load());
+  async_calls = false;
+}
+
+}  // namespace orc
@@ -22,6 +22,28 @@ bool RpcHandlerBase::BaseInit(const YAML::Node& config) {
     return false;
   }
 
+  int64_t window_us;
+  CONFIG_OR_DEFAULT(config, "rpc_batch_window_us", window_us, 0);
+  if (window_us > 0) {
+    auto hook = batch_hook();
+    if (hook == nullptr) {
+      ORC_ERROR("Handler: %s batches rpc calls without batch hook.", name().c_str());
+      return false;
+    }
+    auto client_group = RpcClientFactory::Instance()->GetRpcClient(service_name_);
+    if (client_group == nullptr) {
+      ORC_ERROR("GetClientGroup for %s fail.", service_name_.c_str());
+      return false;
+    }
+
+    RpcBatcher::Option option;
+    option.window_us = window_us;
+    CONFIG_OR_DEFAULT(config, "rpc_batch_max_size", option.max_size, 32);
+    for (const auto& client : *client_group) {
+      batchers_.emplace_back(RpcBatcher::Get(client.get(), method_, hook, option));
+    }
+  }
+
   return Init(config);
 }
 
@@ -37,8 +59,10 @@ class RpcInvoker : public Closure {
   std::vector<RpcParam>* mutable_rpc_param() { return &rpc_param_; }
   const std::vector<RpcParam>& rpc_param() const { return rpc_param_; }
 
+  // Call through 'batchers' if there's one for every client.
   bool Invoke(const std::string& service_name,
-              const google::protobuf::MethodDescriptor* method);
+              const google::protobuf::MethodDescriptor* method,
+              const std::vector<RpcBatcher*>& batchers);
 
  private:
   std::vector<RpcParam> rpc_param_;
@@ -63,7 +87,8 @@ class BarrierClosure : public google::protobuf::Closure {
 };
 
 bool RpcInvoker::Invoke(const std::string& service_name,
-                        const google::protobuf::MethodDescriptor* method) {
+                        const google::protobuf::MethodDescriptor* method,
+                        const std::vector<RpcBatcher*>& batchers) {
   auto client_group = RpcClientFactory::Instance()->GetRpcClient(service_name);
   if (client_group == nullptr) {
     ORC_ERROR("GetClientGroup for %s fail.", service_name.c_str());
@@ -84,12 +109,21 @@ bool RpcInvoker::Invoke(const std::string& service_name,
   auto barrier_closure = new BarrierClosure(call_times, context_);
 
   // Async call start.
+  bool batched = !batchers.empty() && batchers.size() == client_group->size();
   context_->SetAsync(true);
   for (RpcParam& param : rpc_param_) {
     for (size_t i = 0; i < client_group->size(); ++i) {
+      if (batched && !param.has_routing_key && param.request_attachment.empty()) {
+        batchers[i]->CallMethod(
+            param.request, param.resps[i].response, barrier_closure,
+            &param.resps[i].success, context_->deadline_us());
+        continue;
+      }
+      // The response attachment is taken anyway, it's empty if none is sent.
       (*client_group)[i]->CallMethod(
-          method, param.request, param.resps[i].response, barrier_closure,
-          &param.resps[i].success);
+          method, param.request, param.request_attachment, param.resps[i].response,
+          &param.resps[i].attachment, barrier_closure, &param.resps[i].success,
+          context_->deadline_us(), param.has_routing_key ? &param.routing_key : nullptr);
     }
   }
 
@@ -111,7 +145,7 @@ bool RpcHandlerBase::BaseRun(SessionBase* session_base, Context* context) {
       return true;
     }
 
-    return rpc_invoker->Invoke(service_name_, method_);
+    return rpc_invoker->Invoke(service_name_, method_, batchers_);
 
   } else if (context->async_state() == Context::AsyncState::After) {
     context->set_async_state(Context::AsyncState::Finish);
@@ -5,7 +5,9 @@
 #include <string>
 
 #include "orc/framework/handler_base.h"
+#include "orc/com/rpc_client/rpc_batcher.h"
 
+#include "butil/iobuf.h"
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/message.h"
 #include "google/protobuf/stubs/common.h"
@@ -18,6 +20,9 @@ struct RpcParam {
   struct Resp {
     google::protobuf::Message* response;
     bool success;
+    // The response attachment of the call, it refers to the receive buffer.
+    // It's not set if the call is batched.
+    butil::IOBuf attachment;
 
     Resp() : response(nullptr), success(false) {}
     Resp(google::protobuf::Message* resp, bool suc) : response(resp), success(suc) {}
@@ -26,7 +31,16 @@ struct RpcParam {
 
   std::vector<Resp> resps;
 
-  RpcParam() : request(nullptr) {}
+  // Binary blobs sent beside the request to every client without being
+  // serialized or copied, e.g. embedding vectors. It's not batched.
+  butil::IOBuf request_attachment;
+
+  // The request goes to the node of the key if the client hashes by it, see
+  // RpcClient::CallMethod. It's not batched.
+  bool has_routing_key;
+  uint64_t routing_key;
+
+  RpcParam() : request(nullptr), has_routing_key(false), routing_key(0) {}
 };
 
 class RpcHandlerBase : public HandlerBase {
@@ -41,12 +55,19 @@ class RpcHandlerBase : public HandlerBase {
 
   virtual const google::protobuf::ServiceDescriptor* service_descriptor() = 0;
 
+  // Required if the calls are batched, i.e. the config 'rpc_batch_window_us'
+  // is positive. The calls of all requests in the window (or up to
+  // 'rpc_batch_max_size' calls) are merged into one call per client.
+  virtual const RpcBatchHook* batch_hook() const { return nullptr; }
+
  private:
   bool BaseInit(const YAML::Node& config) override;
   bool BaseRun(SessionBase* session_base, Context* context) override;
 
   std::string service_name_;
   const google::protobuf::MethodDescriptor* method_;
+  // One for every client of the group, empty if not batched.
+  std::vector<RpcBatcher*> batchers_;
 };
 
 template<typename Service>
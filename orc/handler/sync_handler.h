@@ -11,6 +11,8 @@ class SyncHandler : public HandlerBase {
 
   virtual bool Run(SessionBase* session_base) = 0;
 
+  bool IsSync() const override { return true; }
+
  private:
   bool BaseInit(const YAML::Node& config) override;
   bool BaseRun(SessionBase* SessionBase, Context* context) override;
@@ -1,6 +1,8 @@
 #include "orc/server/brpc_server.h"
 #include "orc/util/log.h"
 #include "orc/framework/configure.h"
+#include "orc/framework/monitor_status_exporter.h"
+#include "orc/framework/trace_recorder.h"
 
 #include "leader/brpc/brpc_server_register.h"
 
@@ -18,6 +20,28 @@ bool BrpcServer::StartServer(const YAML::Node& config) {
     ORC_ERROR("Failed to add service");
     return false;
   }
+  if (MonitorStatusExporter::Instance()->running()) {
+    std::string export_path;
+    ORC_CONFIG_OR_FAIL(config, Options::SvrMonitorExportPath, export_path);
+    monitor_status_service_.reset(new MonitorStatusServiceImpl());
+    if (server_->AddService(monitor_status_service_.get(),
+                            brpc::SERVER_DOESNT_OWN_SERVICE,
+                            export_path + " => Metrics") != 0) {
+      ORC_ERROR("Failed to add MonitorStatusService on %s", export_path.c_str());
+      return false;
+    }
+  }
+  if (TraceRecorder::Instance()->enabled()) {
+    std::string trace_path;
+    ORC_CONFIG_OR_FAIL(config, Options::SvrTraceExportPath, trace_path);
+    trace_service_.reset(new TraceServiceImpl());
+    if (server_->AddService(trace_service_.get(),
+                            brpc::SERVER_DOESNT_OWN_SERVICE,
+                            trace_path + " => Dump") != 0) {
+      ORC_ERROR("Failed to add TraceService on %s", trace_path.c_str());
+      return false;
+    }
+  }
   auto brpc_server_register = new leader::BrpcServerRegister();
   if (!brpc_server_register->AddPingService(server_.get())) {
     ORC_ERROR("Failed AddPingService");
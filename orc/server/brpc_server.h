@@ -4,6 +4,8 @@
 #include <memory>
 
 #include "orc/server/pb_rpc_server.h"
+#include "orc/server/monitor_status_service.h"
+#include "orc/server/trace_service.h"
 
 #include "brpc/server.h"
 
@@ -26,6 +28,8 @@ class BrpcServer : public PbRpcServer {
   uint32_t port_;
   std::unique_ptr<brpc::Server> server_;
   std::unique_ptr<google::protobuf::Service> service_;
+  std::unique_ptr<MonitorStatusServiceImpl> monitor_status_service_;
+  std::unique_ptr<TraceServiceImpl> trace_service_;
   ORC_DISALLOW_COPY_AND_ASSIGN(BrpcServer);
 };
 
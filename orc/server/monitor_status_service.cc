@@ -0,0 +1,23 @@
+#include "orc/server/monitor_status_service.h"
+
+#include "brpc/closure_guard.h"
+#include "brpc/controller.h"
+
+#include "orc/framework/monitor_status_exporter.h"
+
+namespace orc {
+
+void MonitorStatusServiceImpl::Metrics(
+    google::protobuf::RpcController* controller,
+    const MonitorStatusRequest* request,
+    MonitorStatusResponse* response,
+    google::protobuf::Closure* done) {
+  brpc::ClosureGuard done_guard(done);
+  brpc::Controller* cntl = static_cast<brpc::Controller*>(controller);
+
+  cntl->http_response().set_content_type("text/plain; version=0.0.4");
+  auto text = MonitorStatusExporter::Instance()->Export();
+  cntl->response_attachment().append(*text);
+}
+
+}  // namespace orc
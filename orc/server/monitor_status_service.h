@@ -0,0 +1,20 @@
+#ifndef ORC_SERVER_MONITOR_STATUS_SERVICE_H_
+#define ORC_SERVER_MONITOR_STATUS_SERVICE_H_
+
+#include "monitor_status.pb.h"
+
+namespace orc {
+
+// Serves the text rendered by MonitorStatusExporter, a scrape never touches
+// the monitor status file.
+class MonitorStatusServiceImpl : public MonitorStatusService {
+ public:
+  void Metrics(google::protobuf::RpcController* controller,
+               const MonitorStatusRequest* request,
+               MonitorStatusResponse* response,
+               google::protobuf::Closure* done) override;
+};
+
+}  // namespace orc
+
+#endif  // ORC_SERVER_MONITOR_STATUS_SERVICE_H_
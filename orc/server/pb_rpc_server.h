@@ -2,12 +2,14 @@
 #define ORC_SERVER_PB_RPC_SERVER_H_
 
 #include <atomic>
+#include <vector>
 
 #include "orc/framework/server_base.h"
 #include "orc/framework/service_closure.h"
 
 #include "leader/server_register.h"
 #include "google/protobuf/service.h"
+#include "brpc/controller.h"
 
 namespace orc {
 
@@ -20,13 +22,43 @@ class PbRpcClosure : public ServiceClosure {
     : controller_(controller),
       request_(request),
       response_(response),
-      done_(done) {}
+      done_(done),
+      cntl_(dynamic_cast<brpc::Controller*>(controller)) {
+    // Inherit the deadline set by the client.
+    if (cntl_ != nullptr && cntl_->deadline_us() > 0) {
+      set_deadline_us(cntl_->deadline_us());
+    }
+  }
 
   ::google::protobuf::RpcController* controller() const { return controller_; }
   const ::google::protobuf::Message* request() const { return request_; }
   ::google::protobuf::Message* response() const { return response_; }
   ::google::protobuf::Closure* done() const { return done_; }
 
+  // The binary blobs sent beside the messages, nullptr if the call isn't of
+  // brpc. The request attachment refers to the receive buffer, and the
+  // response attachment is sent as is, neither is copied.
+  const butil::IOBuf* request_attachment() const {
+    return cntl_ != nullptr ? &cntl_->request_attachment() : nullptr;
+  }
+  butil::IOBuf* response_attachment() const {
+    return cntl_ != nullptr ? &cntl_->response_attachment() : nullptr;
+  }
+
+  // Read-only views of the blocks of the request attachment in the receive
+  // buffer, valid until Done.
+  std::vector<butil::StringPiece> request_attachment_spans() const {
+    std::vector<butil::StringPiece> spans;
+    if (cntl_ != nullptr) {
+      const butil::IOBuf& attachment = cntl_->request_attachment();
+      spans.reserve(attachment.backing_block_num());
+      for (size_t i = 0; i < attachment.backing_block_num(); ++i) {
+        spans.push_back(attachment.backing_block(i));
+      }
+    }
+    return spans;
+  }
+
   void Done() override {
     if (ret_code() != ServiceClosure::RetCode::Success) {
       controller_->SetFailed(message());
@@ -40,6 +72,8 @@ class PbRpcClosure : public ServiceClosure {
   const ::google::protobuf::Message* request_;
   ::google::protobuf::Message* response_;
   ::google::protobuf::Closure* done_;
+  // nullptr if the call isn't of brpc.
+  brpc::Controller* cntl_;
 };
 
 class PbRpcServer : public ServerBase {
@@ -0,0 +1,37 @@
+#include "orc/server/trace_service.h"
+
+#include "brpc/closure_guard.h"
+#include "brpc/controller.h"
+
+#include "orc/framework/trace_recorder.h"
+
+namespace orc {
+
+void TraceServiceImpl::Dump(google::protobuf::RpcController* controller,
+                            const TraceRequest* request,
+                            TraceResponse* response,
+                            google::protobuf::Closure* done) {
+  brpc::ClosureGuard done_guard(done);
+  brpc::Controller* cntl = static_cast<brpc::Controller*>(controller);
+
+  const auto& uri = cntl->http_request().uri();
+  auto format = TraceRecorder::Format::Chrome;
+  const std::string* value = uri.GetQuery("format");
+  if (value != nullptr) {
+    if (*value == "otlp") {
+      format = TraceRecorder::Format::Otlp;
+    } else if (*value != "chrome") {
+      cntl->SetFailed(brpc::EREQUEST, "Unknown trace format: %s", value->c_str());
+      return;
+    }
+  }
+  value = uri.GetQuery("slow");
+  bool slow_only = value != nullptr && *value == "1";
+
+  std::string text;
+  TraceRecorder::Instance()->Export(format, slow_only, &text);
+  cntl->http_response().set_content_type("application/json");
+  cntl->response_attachment().append(text);
+}
+
+}  // namespace orc
@@ -0,0 +1,20 @@
+#ifndef ORC_SERVER_TRACE_SERVICE_H_
+#define ORC_SERVER_TRACE_SERVICE_H_
+
+#include "trace.pb.h"
+
+namespace orc {
+
+// Serves the traces kept by TraceRecorder, the query 'format' selects Chrome
+// trace or OpenTelemetry json, 'slow=1' keeps the slow requests only.
+class TraceServiceImpl : public TraceService {
+ public:
+  void Dump(google::protobuf::RpcController* controller,
+            const TraceRequest* request,
+            TraceResponse* response,
+            google::protobuf::Closure* done) override;
+};
+
+}  // namespace orc
+
+#endif  // ORC_SERVER_TRACE_SERVICE_H_
@@ -7,6 +7,7 @@
 #include <stdio.h>
 #include <unistd.h>
 
+#include <chrono>
 #include <memory>
 
 #include "orc/util/utils.h"
@@ -21,6 +22,9 @@ static LogWriter g_log_writer = DefaultLogWriter;
 
 static uint32_t g_log_max_length = 4096;
 
+static uint32_t g_log_rate_limit = 10;
+static uint32_t g_log_rate_burst = 20;
+
 static void DefaultLogWriter(LogLevel level, const char* file, int line,
                              const char* func, const char* format, va_list va) {
   std::unique_ptr<char[]> delete_guard{new char[g_log_max_length]};
@@ -92,6 +96,44 @@ LogLevel ToLogLevel(const std::string& level) {
 void SetLogMaxLength(uint32_t length) { g_log_max_length = length; }
 uint32_t GetLogMaxLength() { return g_log_max_length; }
 
+void SetLogRateLimit(uint32_t per_second, uint32_t burst) {
+  g_log_rate_limit = per_second;
+  g_log_rate_burst = burst > 0 ? burst : 1;
+}
+uint32_t GetLogRateLimit() { return g_log_rate_limit; }
+uint32_t GetLogRateBurst() { return g_log_rate_burst; }
+
+bool LogRateLimiter::Acquire(LogLevel level, const char* file, int line,
+                             const char* func) {
+  uint32_t rate = g_log_rate_limit;
+  if (rate == 0) return true;
+
+  int64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  int64_t interval = 1000000 / rate;
+  int64_t tolerance = interval * (g_log_rate_burst - 1);
+
+  int64_t tat = tat_us_.load(std::memory_order_relaxed);
+  while (true) {
+    int64_t base = tat > now ? tat : now;
+    if (base - now > tolerance) {
+      suppressed_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    if (tat_us_.compare_exchange_weak(tat, base + interval,
+                                      std::memory_order_relaxed)) {
+      break;
+    }
+  }
+
+  uint64_t suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+  if (suppressed > 0) {
+    Log(level, file, line, func, "suppressed %lu messages",
+        static_cast<unsigned long>(suppressed));
+  }
+  return true;
+}
+
 void Log(LogLevel level, const char* file, int line, const char* func,
          const char* format, ...) {
   va_list va;
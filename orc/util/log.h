@@ -1,6 +1,7 @@
 #ifndef ORC_UTIL_LOG_H_
 #define ORC_UTIL_LOG_H_
 
+#include <atomic>
 #include <string>
 #include <functional>
 #include <cstdarg>
@@ -15,6 +16,20 @@ void Log(LogLevel level, const char* file, int line, const char* func,
 void Log(LogLevel level, const char* file, int line, const char* func,
          const char* format, va_list va);
 
+// Token bucket of one ORC_*_RATELIMITED call site. The bucket is kept as a
+// theoretical arrival time so that Acquire is a single CAS. Dropped messages
+// are counted and reported by one summary line once the site logs again.
+class LogRateLimiter {
+ public:
+  LogRateLimiter() : tat_us_(0), suppressed_(0) {}
+
+  bool Acquire(LogLevel level, const char* file, int line, const char* func);
+
+ private:
+  std::atomic<int64_t> tat_us_;
+  std::atomic<uint64_t> suppressed_;
+};
+
 }  // namespace orc
 
 // Macros used in orc. Don't use these macros besides orc.
@@ -22,6 +37,14 @@ void Log(LogLevel level, const char* file, int line, const char* func,
   if (orc::GetLogLevel() >= level) \
     orc::Log(level, __FILE__, __LINE__, __func__, format, ##__VA_ARGS__)
 
+// Every expansion gets its own static LogRateLimiter.
+#define ORC_LOG_RATELIMITED(level, format, ...) \
+  if (orc::GetLogLevel() >= level && \
+      ([]() -> orc::LogRateLimiter& { \
+         static orc::LogRateLimiter limiter; return limiter; }()) \
+          .Acquire(level, __FILE__, __LINE__, __func__)) \
+    orc::Log(level, __FILE__, __LINE__, __func__, format, ##__VA_ARGS__)
+
 #define ORC_FATAL(format, ...) \
     ORC_LOG_COMMON(orc::LogLevel::Fatal, format, ##__VA_ARGS__)
 
@@ -37,4 +60,13 @@ void Log(LogLevel level, const char* file, int line, const char* func,
 #define ORC_DEBUG(format, ...) \
     ORC_LOG_COMMON(orc::LogLevel::Debug, format, ##__VA_ARGS__)
 
+#define ORC_ERROR_RATELIMITED(format, ...) \
+    ORC_LOG_RATELIMITED(orc::LogLevel::Error, format, ##__VA_ARGS__)
+
+#define ORC_WARN_RATELIMITED(format, ...) \
+    ORC_LOG_RATELIMITED(orc::LogLevel::Warn, format, ##__VA_ARGS__)
+
+#define ORC_INFO_RATELIMITED(format, ...) \
+    ORC_LOG_RATELIMITED(orc::LogLevel::Info, format, ##__VA_ARGS__)
+
 #endif  // ORC_UTIL_LOG_H_
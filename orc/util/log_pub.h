@@ -24,6 +24,12 @@ LogLevel ToLogLevel(const std::string& level);
 void SetLogMaxLength(uint32_t max_length);
 uint32_t GetLogMaxLength();
 
+// Messages per second (and burst) allowed for each ORC_*_RATELIMITED call
+// site, 0 disables the limit.
+void SetLogRateLimit(uint32_t per_second, uint32_t burst);
+uint32_t GetLogRateLimit();
+uint32_t GetLogRateBurst();
+
 }  // namespace orc
 
 #endif  // ORC_UTIL_LOG_PUB_H__
@@ -0,0 +1,64 @@
+#include "orc/util/log.h"
+
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace orc {
+
+static void WarnRateLimited(int i) {
+  ORC_WARN_RATELIMITED("rate limited %d", i);
+}
+
+class LogTest : public ::testing::Test {
+ public:
+  virtual void SetUp() {
+    SetLogWriter([this](LogLevel, const char*, int, const char*,
+                        const char* format, va_list) {
+      formats_.push_back(format);
+    });
+  }
+
+  virtual void TearDown() {
+    SetLogWriter([](LogLevel, const char*, int, const char*,
+                    const char*, va_list) {});
+    SetLogRateLimit(10, 20);
+  }
+
+ protected:
+  std::vector<std::string> formats_;
+};
+
+TEST_F(LogTest, RateLimited) {
+  SetLogRateLimit(1, 5);
+  for (int i = 0; i < 100; ++i) {
+    ORC_WARN_RATELIMITED("rate limited %d", i);
+  }
+  ASSERT_EQ(5u, formats_.size());
+}
+
+TEST_F(LogTest, SuppressedSummary) {
+  SetLogRateLimit(1000, 1);
+  for (int i = 0; i < 100; ++i) {
+    WarnRateLimited(i);
+  }
+  usleep(2000);
+  WarnRateLimited(100);
+
+  ASSERT_LE(3u, formats_.size());
+  ASSERT_EQ(std::string("suppressed %lu messages"),
+            formats_[formats_.size() - 2]);
+}
+
+TEST_F(LogTest, Unlimited) {
+  SetLogRateLimit(0, 0);
+  for (int i = 0; i < 100; ++i) {
+    ORC_WARN_RATELIMITED("rate limited %d", i);
+  }
+  ASSERT_EQ(100u, formats_.size());
+}
+
+}  // namespace orc
@@ -112,7 +112,8 @@ class ThreadPool::TaskQueue {
 ThreadPool::ThreadPool(size_t worker_num, size_t queue_num, size_t queue_size)
   : ThreadPool(Option{worker_num, queue_num, queue_size, false}) {}
 
-ThreadPool::ThreadPool(const Option& option) : stop_(false), option_(option) {
+ThreadPool::ThreadPool(const Option& option)
+    : stop_(false), stopping_(false), option_(option) {
   for (size_t i = 0; i < option.queue_num; ++i) {
     queues_.emplace_back(new TaskQueue(option.queue_size));
   }
@@ -123,6 +124,7 @@ ThreadPool::ThreadPool(const Option& option) : stop_(false), option_(option) {
 }
 
 ThreadPool::~ThreadPool() {
+  stopping_ = true;
   for (auto& q : queues_) {
     for (auto i = 0ul; i < (workers_.size() / queues_.size() + 1); ++i) {
       q->Push([this](){ stop_ = true; });
@@ -138,6 +140,35 @@ ThreadPool::Task ThreadPool::Schedule(ThreadPool::Task task) {
   return q->TryPush(std::move(task));
 }
 
+ThreadPool::Task ThreadPool::Schedule(ThreadPool::Task task, int32_t hint) {
+  if (hint < 0) return Schedule(std::move(task));
+
+  size_t n = queues_.size();
+  for (size_t i = 0; i < n; ++i) {
+    task = queues_[(hint + i) % n]->TryPush(std::move(task));
+    if (!task) return task;
+  }
+  return task;
+}
+
+ThreadPool::Task ThreadPool::Steal(size_t idx) {
+  if (stopping_) return Task();
+
+  size_t n = queues_.size();
+  for (size_t i = 1; i < n; ++i) {
+    auto q = queues_[(idx + i) % n];
+    auto task = q->TryPop();
+    if (!task) continue;
+    if (stopping_) {
+      // It may be a stop task of that queue, give it back.
+      q->Push(std::move(task));
+      return Task();
+    }
+    return task;
+  }
+  return Task();
+}
+
 void ThreadPool::Loop(size_t idx) {
   ThreadMeta* th = GetThreadMeta();
   th->pool = this;
@@ -149,7 +180,9 @@ void ThreadPool::Loop(size_t idx) {
   auto q = queues_[idx % queues_.size()];
 
   while (true) {
-    Task task = q->Pop();
+    Task task = q->TryPop();
+    if (!task) task = Steal(idx);
+    if (!task) task = q->Pop();
     task();
     if (stop_) return;
   }
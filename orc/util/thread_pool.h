@@ -33,8 +33,15 @@ class ThreadPool {
   // otherwise, 'Task()' will be returned.
   Task Schedule(Task task);
 
+  // Schedule to the queue of worker 'hint' to keep the task's data in the
+  // worker's cache, spill to the next queues only when it is full. A negative
+  // 'hint' is the same as 'Schedule(task)'.
+  Task Schedule(Task task, int32_t hint);
+
  private:
   void Loop(size_t idx);
+  // Take a task from the other queues when the own queue is empty.
+  Task Steal(size_t idx);
   void PinThread(uint32_t cpu_id);
 
  private:
@@ -45,6 +52,9 @@ class ThreadPool {
   std::vector<Worker*> workers_;
 
   std::atomic<bool> stop_;
+  // No stealing after the stop tasks are pushed, every queue's stop tasks
+  // are left for its own workers.
+  std::atomic<bool> stopping_;
   Option option_;
 
   ORC_DISALLOW_COPY_AND_ASSIGN(ThreadPool);
@@ -1,6 +1,9 @@
 #include <atomic>
 #include <memory>
 #include <thread>
+#include <string>
+#include <utility>
+#include <vector>
 #include <mutex>
 #include <condition_variable>
 
@@ -71,4 +74,68 @@ TEST_F(ThreadPoolTest, ScheduleFail) {
   }
 }
 */
+
+TEST_F(ThreadPoolTest, ScheduleHint) {
+  std::mutex mtx;
+  std::condition_variable cv;
+  bool release[2] = {false, false};
+  std::atomic<uint32_t> started(0);
+  // Name of the task and the worker running it, in order.
+  std::vector<std::pair<std::string, uint32_t>> runs;
+
+  auto block = [&]() {
+    started++;
+    std::unique_lock<std::mutex> lock(mtx);
+    uint32_t id = GetThreadMeta()->id;
+    cv.wait(lock, [&release, id](){ return release[id]; });
+  };
+  auto record = [&](const std::string& name) {
+    return [&runs, &mtx, name]() {
+      std::lock_guard<std::mutex> lock(mtx);
+      runs.emplace_back(name, GetThreadMeta()->id);
+    };
+  };
+  auto wait_runs = [&](size_t n) {
+    while (true) {
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (runs.size() >= n) return;
+      }
+      std::this_thread::yield();
+    }
+  };
+
+  {
+    std::unique_ptr<ThreadPool> pool(new ThreadPool(2, 2, 1));
+    ASSERT_FALSE(static_cast<bool>(pool->Schedule(block, 0)));
+    ASSERT_FALSE(static_cast<bool>(pool->Schedule(block, 1)));
+    while (started < 2) std::this_thread::yield();
+
+    // Both workers are busy, the hinted queue is taken first, then spill to
+    // the other one.
+    ASSERT_FALSE(static_cast<bool>(pool->Schedule(record("hinted"), 1)));
+    ASSERT_FALSE(static_cast<bool>(pool->Schedule(record("spilled"), 1)));
+    auto task = pool->Schedule(record("failed"), 1);
+    ASSERT_TRUE(static_cast<bool>(task));
+
+    // Worker 1 takes its own queue first, then steals from queue 0 while
+    // worker 0 is still busy.
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      release[1] = true;
+    }
+    cv.notify_all();
+    wait_runs(2);
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      EXPECT_EQ(std::make_pair(std::string("hinted"), 1u), runs[0]);
+      EXPECT_EQ(std::make_pair(std::string("spilled"), 1u), runs[1]);
+      release[0] = true;
+    }
+    cv.notify_all();
+  }
+
+  ASSERT_EQ(2u, runs.size());
+}
+
 }  // namespace orc
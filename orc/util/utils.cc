@@ -1,6 +1,7 @@
 #include "orc/util/utils.h"
 
 #include <sys/syscall.h>
+#include <sys/time.h>
 #include <unistd.h>
 
 #include <stdio.h>
@@ -13,6 +14,12 @@ uint32_t RandomMax() {
   return 2147483647;
 }
 
+int64_t NowUs() {
+  struct timeval now;
+  gettimeofday(&now, nullptr);
+  return static_cast<int64_t>(now.tv_sec) * 1000000 + now.tv_usec;
+}
+
 // Get current thread's meta info. Must not pass the return 'ThreadMeta' to
 // other thread.
 ThreadMeta* GetThreadMeta() {
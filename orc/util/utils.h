@@ -61,6 +61,9 @@ uint32_t Random();
 
 uint32_t RandomMax();
 
+// Microseconds since the Epoch, the same time base as deadline of brpc.
+int64_t NowUs();
+
 }  // namespace orc
 
 #endif  // ORC_UTIL_UTILS_H_
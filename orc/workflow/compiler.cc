@@ -1,11 +1,14 @@
 #include "orc/workflow/compiler.h"
 
+#include <set>
+#include <string>
 #include <utility>
 #include <vector>
 
 #include "orc/workflow/parser/compiler.h"
 #include "orc/workflow/graph.h"
 #include "orc/workflow/node.h"
+#include "orc/workflow/optimizer.h"
 #include "orc/util/log.h"
 
 namespace orc {
@@ -87,6 +90,7 @@ do {\
 
 bool CompileExp(struct workflow_syntax*, Context*);
 bool CompileBlock(struct workflow_syntax*, Context*);
+bool ComplieStmt(struct workflow_syntax*, Context*);
 
 bool CompileName(struct workflow_syntax* syntax, Context* ctx) {
   CHECK_KIND(syntax, WORKFLOW_SYNTAX_KIND_NAME);
@@ -280,6 +284,155 @@ bool CompileDoWhileStmt(struct workflow_syntax* syntax, Context* ctx) {
   return true;
 }
 
+bool HasReturnStmt(struct workflow_syntax* syntax) {
+  switch (syntax->kind) {
+    case WORKFLOW_SYNTAX_KIND_RETURN_STMT:
+      return true;
+
+    case WORKFLOW_SYNTAX_KIND_STMT_LIST:
+      for (auto i = 0; i < syntax->u.stmt_list.size; ++i) {
+        if (HasReturnStmt(syntax->u.stmt_list.child[i])) return true;
+      }
+      return false;
+
+    case WORKFLOW_SYNTAX_KIND_IF_STMT:
+      return HasReturnStmt(syntax->u.if_stmt.then_block) ||
+             HasReturnStmt(syntax->u.if_stmt.else_block);
+
+    case WORKFLOW_SYNTAX_KIND_WHILE_STMT:
+      return HasReturnStmt(syntax->u.while_stmt.block);
+
+    case WORKFLOW_SYNTAX_KIND_DOWHILE_STMT:
+      return HasReturnStmt(syntax->u.dowhile_stmt.block);
+
+    case WORKFLOW_SYNTAX_KIND_PARALLEL_STMT:
+      return HasReturnStmt(syntax->u.parallel_stmt.block);
+
+    case WORKFLOW_SYNTAX_KIND_DAG_STMT:
+      return HasReturnStmt(syntax->u.dag_stmt.block);
+
+    default:
+      return false;
+  }
+}
+
+// Every stmt of the parallel block is a branch, the branches start from a
+// 'Fork' node and end at a 'Join' node:
+//
+//   fork --P--> branch_0 --> join
+//        --P--> branch_1 --> join
+//        --T/F------------> join --T/F--> next
+bool CompileParallelStmt(struct workflow_syntax* syntax, Context* ctx) {
+  CHECK_KIND(syntax, WORKFLOW_SYNTAX_KIND_PARALLEL_STMT);
+
+  auto stx_block = syntax->u.parallel_stmt.block;
+  CHECK_KIND(stx_block, WORKFLOW_SYNTAX_KIND_STMT_LIST);
+
+  if (stx_block->u.stmt_list.size == 0) {
+    ORC_ERROR("Compile syntax parallel fail for empty block.");
+    return false;
+  }
+
+  // Handler names are identifiers, so ':' makes the names unique. The fork
+  // and join are added before the branches are compiled, so the nodes only
+  // grow and every nested or later block takes a larger id.
+  auto id = std::to_string(ctx->graph->nodes().size());
+  auto fork = new Node("fork:" + id, Node::Type::Fork);
+  auto join = new Node("join:" + id, Node::Type::Join);
+  ctx->graph->AddNode(std::unique_ptr<Node>(fork));
+  ctx->graph->AddNode(std::unique_ptr<Node>(join));
+
+  for (auto i = 0; i < stx_block->u.stmt_list.size; ++i) {
+    auto stx_branch = stx_block->u.stmt_list.child[i];
+    if (HasReturnStmt(stx_branch)) {
+      ORC_ERROR("Compile syntax parallel fail for return in branch %d.", i);
+      return false;
+    }
+
+    Context branch_ctx;
+    Label branch_start_label;
+    Label branch_end_label;
+    branch_ctx.graph = ctx->graph;
+    branch_ctx.prev_label = &branch_start_label;
+    branch_ctx.next_label = &branch_end_label;
+
+    if (!ComplieStmt(stx_branch, &branch_ctx)) {
+      ORC_ERROR("Compile syntax parallel branch %d fail.", i);
+      return false;
+    }
+
+    if (branch_ctx.entry == nullptr) {
+      ORC_ERROR("Compile syntax parallel fail for empty branch %d.", i);
+      return false;
+    }
+
+    fork->AddBranch(branch_ctx.entry);
+    branch_end_label.Attach(join);
+  }
+
+  fork->set_true_edge(join);
+  fork->set_false_edge(join);
+
+  ctx->entry = fork;
+  ctx->prev_label->Attach(fork);
+  ctx->next_label->AddEdge({true, join});
+  ctx->next_label->AddEdge({false, join});
+  return true;
+}
+
+// Every stmt of the dag block must be a handler name, the dependencies of the
+// handlers are decided by their inputs&outputs when building ExecutionGraph:
+//
+//   dag --P--> handler_0 --> join
+//       --P--> handler_1 --> join
+//       --T/F------------> join --T/F--> next
+bool CompileDagStmt(struct workflow_syntax* syntax, Context* ctx) {
+  CHECK_KIND(syntax, WORKFLOW_SYNTAX_KIND_DAG_STMT);
+
+  auto stx_block = syntax->u.dag_stmt.block;
+  CHECK_KIND(stx_block, WORKFLOW_SYNTAX_KIND_STMT_LIST);
+
+  if (stx_block->u.stmt_list.size == 0) {
+    ORC_ERROR("Compile syntax dag fail for empty block.");
+    return false;
+  }
+
+  // Added first to take a unique id, the same as CompileParallelStmt.
+  auto id = std::to_string(ctx->graph->nodes().size());
+  auto dag = new Node("dag:" + id, Node::Type::Dag);
+  auto join = new Node("join:" + id, Node::Type::Join);
+  ctx->graph->AddNode(std::unique_ptr<Node>(dag));
+  ctx->graph->AddNode(std::unique_ptr<Node>(join));
+
+  std::set<std::string> names;
+  for (auto i = 0; i < stx_block->u.stmt_list.size; ++i) {
+    auto stx_handler = stx_block->u.stmt_list.child[i];
+    CHECK_KIND(stx_handler, WORKFLOW_SYNTAX_KIND_NAME);
+
+    std::string name{stx_handler->u.name.str,
+                     static_cast<size_t>(stx_handler->u.name.size)};
+    if (!names.emplace(name).second) {
+      ORC_ERROR("Compile syntax dag fail for duplicate handler: %s.", name.c_str());
+      return false;
+    }
+
+    std::unique_ptr<Node> node{new Node(name)};
+    node->set_true_edge(join);
+    node->set_false_edge(join);
+    dag->AddBranch(node.get());
+    ctx->graph->AddNode(std::move(node));
+  }
+
+  dag->set_true_edge(join);
+  dag->set_false_edge(join);
+
+  ctx->entry = dag;
+  ctx->prev_label->Attach(dag);
+  ctx->next_label->AddEdge({true, join});
+  ctx->next_label->AddEdge({false, join});
+  return true;
+}
+
 bool ComplieStmt(struct workflow_syntax* syntax, Context* ctx) {
   switch (syntax->kind) {
     case WORKFLOW_SYNTAX_KIND_IF_STMT:
@@ -294,6 +447,15 @@ bool ComplieStmt(struct workflow_syntax* syntax, Context* ctx) {
     case WORKFLOW_SYNTAX_KIND_RETURN_STMT:
       return CompileReturnStmt(syntax, ctx);
 
+    case WORKFLOW_SYNTAX_KIND_PARALLEL_STMT:
+      return CompileParallelStmt(syntax, ctx);
+
+    case WORKFLOW_SYNTAX_KIND_DAG_STMT:
+      return CompileDagStmt(syntax, ctx);
+
+    case WORKFLOW_SYNTAX_KIND_STMT_LIST:
+      return CompileBlock(syntax, ctx);
+
     default: {
       return CompileExpStmt(syntax, ctx);
     }
@@ -367,6 +529,7 @@ bool CompileWorkflow(struct workflow_syntax* syntax, Context* ctx) {
   ctx->next_label->Attach(Node::EndNode());
   graph->set_entry(ctx->entry);
 
+  Optimizer::RemoveDeadNodes(graph.get());
   if (!graph->CheckValid()) {
     ORC_ERROR("Workflow %s is not valid graph.", name.c_str());
     return false;
@@ -402,6 +565,10 @@ Compiler::Compiler() {
   workflow_set_compiler_error_reporter(&error_report);
 }
 
+Compiler::Compiler(const Option& option) : option_(option) {
+  workflow_set_compiler_error_reporter(&error_report);
+}
+
 bool Compiler::Compile(const std::string& file,
                        std::map<std::string, std::unique_ptr<Graph>>* graphs) {
   std::unique_ptr<struct workflow_syntax, void(*)(struct workflow_syntax*)> node{
@@ -418,6 +585,28 @@ bool Compiler::Compile(const std::string& file,
     return false;
   }
 
+  if (option_.optimize) {
+    Optimizer optimizer(option_.optimizer);
+    for (const auto& p : *graphs) {
+      auto graph = p.second.get();
+      if (option_.dump) {
+        ORC_INFO("Workflow %s before optimization:\n%s",
+                 p.first.c_str(), graph->DebugString().c_str());
+      }
+
+      optimizer.Optimize(graph);
+      if (!graph->CheckValid()) {
+        ORC_ERROR("Workflow %s is not valid graph after optimization.", p.first.c_str());
+        return false;
+      }
+
+      if (option_.dump) {
+        ORC_INFO("Workflow %s after optimization:\n%s",
+                 p.first.c_str(), graph->DebugString().c_str());
+      }
+    }
+  }
+
   ORC_INFO("Compile successfully.");
   return true;
 }
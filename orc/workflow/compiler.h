@@ -7,19 +7,34 @@
 
 #include "orc/util/macros.h"
 #include "orc/workflow/graph.h"
+#include "orc/workflow/optimizer.h"
 
 namespace orc {
 namespace wf {
 
 class Compiler {
  public:
+  struct Option {
+    Option() : optimize(false), dump(false) {}
+
+    // Run the Optimizer passes on the compiled graphs. The unreachable nodes
+    // are always dropped.
+    bool optimize;
+    Optimizer::Option optimizer;
+    // Log the graphs before and after the optimization.
+    bool dump;
+  };
+
   Compiler();
+  explicit Compiler(const Option& option);
   ~Compiler() = default;
 
   bool Compile(const std::string& file,
                std::map<std::string, std::unique_ptr<Graph>>* graphs);
 
  private:
+  Option option_;
+
   ORC_DISALLOW_COPY_AND_ASSIGN(Compiler);
 };
 
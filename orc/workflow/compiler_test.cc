@@ -1,5 +1,7 @@
 #include <fstream>
+#include <map>
 #include <memory>
+#include <set>
 
 #include "gtest/gtest.h"
 #include "orc/workflow/compiler.h"
@@ -32,6 +34,90 @@ TEST_F(CompilerTest, Compile) {
   ASSERT_EQ(expect_str, real_str);
 }
 
+TEST_F(CompilerTest, ParallelReturn) {
+  std::map<std::string, std::unique_ptr<Graph>> graphs;
+  Compiler compiler;
+  ASSERT_FALSE(compiler.Compile("testdata/compiler_parallel_return.wf", &graphs));
+}
+
+TEST_F(CompilerTest, ParallelNested) {
+  std::map<std::string, std::unique_ptr<Graph>> graphs;
+  Compiler compiler;
+  ASSERT_TRUE(compiler.Compile("testdata/compiler_parallel_nested.wf", &graphs));
+  auto graph = graphs["h_wf"].get();
+
+  // ExecutionGraph builds one node per name.
+  std::set<std::string> names;
+  for (const auto& node : graph->nodes()) {
+    ASSERT_TRUE(names.emplace(node->name()).second) << node->name();
+  }
+
+  auto outer = graph->entry()->true_edge();
+  ASSERT_EQ(Node::Type::Fork, outer->type());
+  ASSERT_EQ(2u, outer->branches().size());
+  auto inner = outer->branches()[0];
+  ASSERT_EQ(Node::Type::Fork, inner->type());
+  ASSERT_EQ(2u, inner->branches().size());
+  EXPECT_EQ("B", inner->branches()[0]->name());
+  EXPECT_EQ("C", inner->branches()[1]->name());
+  EXPECT_EQ("D", outer->branches()[1]->name());
+
+  auto inner_join = inner->true_edge();
+  auto outer_join = outer->true_edge();
+  ASSERT_EQ(Node::Type::Join, inner_join->type());
+  ASSERT_EQ(Node::Type::Join, outer_join->type());
+  EXPECT_NE(inner_join, outer_join);
+  EXPECT_EQ(inner_join, inner->branches()[0]->true_edge());
+  EXPECT_EQ(outer_join, inner_join->true_edge());
+  EXPECT_EQ(outer_join, outer->branches()[1]->true_edge());
+
+  auto next = outer_join->true_edge();
+  ASSERT_EQ(Node::Type::Fork, next->type());
+  EXPECT_NE(outer->name(), next->name());
+  EXPECT_NE(inner->name(), next->name());
+}
+
+TEST_F(CompilerTest, DagNested) {
+  std::map<std::string, std::unique_ptr<Graph>> graphs;
+  Compiler compiler;
+  ASSERT_TRUE(compiler.Compile("testdata/compiler_dag_nested.wf", &graphs));
+  auto graph = graphs["i_wf"].get();
+
+  std::set<std::string> names;
+  std::map<Node::Type, int> types;
+  for (const auto& node : graph->nodes()) {
+    ASSERT_TRUE(names.emplace(node->name()).second) << node->name();
+    ++types[node->type()];
+  }
+  EXPECT_EQ(2, types[Node::Type::Fork]);
+  EXPECT_EQ(3, types[Node::Type::Dag]);
+  EXPECT_EQ(5, types[Node::Type::Join]);
+
+  // dag in parallel
+  auto fork = graph->entry()->true_edge();
+  ASSERT_EQ(Node::Type::Fork, fork->type());
+  auto dag = fork->branches()[0];
+  ASSERT_EQ(Node::Type::Dag, dag->type());
+  ASSERT_EQ(2u, dag->branches().size());
+  EXPECT_EQ("B", dag->branches()[0]->name());
+  EXPECT_EQ("C", dag->branches()[1]->name());
+  EXPECT_NE(dag->true_edge(), fork->true_edge());
+  EXPECT_EQ(fork->true_edge(), dag->true_edge()->true_edge());
+
+  // dag after parallel
+  auto next = fork->true_edge()->true_edge();
+  ASSERT_EQ(Node::Type::Dag, next->type());
+  EXPECT_EQ("E", next->branches()[0]->name());
+  EXPECT_NE(dag->true_edge(), next->true_edge());
+}
+
+TEST_F(CompilerTest, DagParallel) {
+  std::map<std::string, std::unique_ptr<Graph>> graphs;
+  Compiler compiler;
+  // Every stmt of a dag block must be a handler name.
+  ASSERT_FALSE(compiler.Compile("testdata/compiler_dag_parallel.wf", &graphs));
+}
+
 
 }  // namespace wf
 }  // namespace orc
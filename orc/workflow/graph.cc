@@ -9,6 +9,15 @@ void Graph::AddNode(std::unique_ptr<Node> node) {
   nodes_.emplace(std::move(node));
 }
 
+void Graph::RemoveNode(Node* node) {
+  for (auto it = nodes_.begin(); it != nodes_.end(); ++it) {
+    if (it->get() == node) {
+      nodes_.erase(it);
+      return;
+    }
+  }
+}
+
 bool Graph::CheckNode(Node* node, std::set<Node*>* checked_nodes) const {
   if (node->true_edge() == nullptr || node->false_edge() == nullptr) {
     ORC_ERROR("Node %s has not two edge.", node->name().c_str());
@@ -21,6 +30,18 @@ bool Graph::CheckNode(Node* node, std::set<Node*>* checked_nodes) const {
 
   checked_nodes->emplace(node);
 
+  if ((node->type() == Node::Type::Fork || node->type() == Node::Type::Dag) &&
+      node->branches().empty()) {
+    ORC_ERROR("Node %s has no branch.", node->name().c_str());
+    return false;
+  }
+
+  for (auto branch : node->branches()) {
+    if (!CheckNode(branch, checked_nodes)) {
+      return false;
+    }
+  }
+
   if ((node->true_edge() != Node::EndNode()) &&
       (!CheckNode(node->true_edge(), checked_nodes))) {
     return false;
@@ -68,7 +89,8 @@ bool Graph::CheckValid() const {
 
 void Graph::TraverseNode(Node* node, const std::function<void(Node*)>& f,
                          std::set<Node*>* checked_nodes) const {
-  if (checked_nodes->find(node) != checked_nodes->end()) {
+  // Edges may be unset before the graph is checked.
+  if (node == nullptr || checked_nodes->find(node) != checked_nodes->end()) {
     return;
   }
 
@@ -76,6 +98,10 @@ void Graph::TraverseNode(Node* node, const std::function<void(Node*)>& f,
 
   f(node);
 
+  for (auto branch : node->branches()) {
+    TraverseNode(branch, f, checked_nodes);
+  }
+
   if (node->true_edge() != Node::EndNode()) {
     TraverseNode(node->true_edge(), f, checked_nodes);
   }
@@ -93,6 +119,13 @@ void Graph::Traverse(const std::function<void(Node*)>& f) const {
 std::string Graph::DebugString() const {
   std::string out;
   Traverse([&out](Node* node) {
+           for (auto branch : node->branches()) {
+             out += node->name();
+             out += "  P  ";
+             out += branch->name();
+             out += "\n";
+           }
+
            out += node->name();
            out += "  T  ";
            out += node->true_edge()->name();
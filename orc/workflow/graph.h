@@ -17,6 +17,8 @@ class Graph {
   ~Graph() = default;
 
   void AddNode(std::unique_ptr<Node> node);
+  // The node mustn't be linked by others any more.
+  void RemoveNode(Node* node);
 
   // Node must be added by 'AddNode' already.
   void set_entry(Node* node) { entry_ = node; }
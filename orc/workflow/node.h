@@ -2,6 +2,7 @@
 #define ORC_WORKFLOW_NODE_H_
 
 #include <string>
+#include <vector>
 
 #include "orc/util/macros.h"
 
@@ -10,8 +11,15 @@ namespace wf {
 
 class Node {
  public:
-  explicit Node(const std::string& name)
-      : name_(name), true_edge_(nullptr), false_edge_(nullptr) {}
+  // 'Fork' starts all of its branches concurrently, every branch ends at the
+  // 'Join' node which is the true&false edge of the 'Fork'. 'Dag' is a 'Fork'
+  // whose branches are single handlers, started once the handlers they depend
+  // on are finished. 'Fused' runs a chain of sync handlers in one step, made
+  // by the Optimizer.
+  enum class Type { Handler, Fork, Join, Dag, Fused };
+
+  explicit Node(const std::string& name, Type type = Type::Handler)
+      : name_(name), type_(type), true_edge_(nullptr), false_edge_(nullptr) {}
 
   ~Node() = default;
 
@@ -23,12 +31,25 @@ class Node {
   void set_false_edge(Node* node) { false_edge_ = node; }
   Node* false_edge() const { return false_edge_; }
 
+  void AddBranch(Node* node) { branches_.emplace_back(node); }
+  void set_branch(size_t idx, Node* node) { branches_[idx] = node; }
+  const std::vector<Node*>& branches() const { return branches_; }
+
+  // Handlers of a 'Fused' node in running order, the result of the last one
+  // decides the edge.
+  void AddHandler(const std::string& name) { handlers_.emplace_back(name); }
+  const std::vector<std::string>& handlers() const { return handlers_; }
+
   const std::string& name() const { return name_; }
+  Type type() const { return type_; }
 
  private:
   std::string name_;
+  Type type_;
   Node* true_edge_;
   Node* false_edge_;
+  std::vector<Node*> branches_;
+  std::vector<std::string> handlers_;
 
   ORC_DISALLOW_COPY_AND_ASSIGN(Node);
 };
@@ -0,0 +1,334 @@
+#include "orc/workflow/optimizer.h"
+
+#include <algorithm>
+#include <memory>
+
+#include "orc/util/log.h"
+
+namespace orc {
+namespace wf {
+
+namespace {
+
+// The nodes run after 'node': the edges and the branches.
+std::vector<Node*> Successors(Node* node) {
+  std::vector<Node*> nodes(node->branches());
+  if (node->true_edge() != nullptr) nodes.emplace_back(node->true_edge());
+  if (node->false_edge() != nullptr) nodes.emplace_back(node->false_edge());
+  return nodes;
+}
+
+bool Intersect(const std::set<std::string>& a, const std::set<std::string>& b) {
+  for (const auto& field : a) {
+    if (b.find(field) != b.end()) return true;
+  }
+  return false;
+}
+
+// Strongly connected components by Tarjan, the loops are the components of
+// more than one node or with a self edge.
+class Scc {
+ public:
+  explicit Scc(const Graph* graph) : index_(0) {
+    graph->Traverse([this](Node* node) {
+                      if (indexes_.find(node) == indexes_.end()) Visit(node);
+                    });
+  }
+
+  const std::vector<std::set<Node*>>& loops() const { return loops_; }
+
+ private:
+  int Visit(Node* node) {
+    int index = index_++;
+    int low = index;
+    indexes_[node] = index;
+    stack_.emplace_back(node);
+    on_stack_.emplace(node);
+
+    bool self_edge = false;
+    for (auto next : Successors(node)) {
+      if (next == Node::EndNode()) continue;
+      if (next == node) self_edge = true;
+
+      auto it = indexes_.find(next);
+      if (it == indexes_.end()) {
+        low = std::min(low, Visit(next));
+      } else if (on_stack_.find(next) != on_stack_.end()) {
+        low = std::min(low, it->second);
+      }
+    }
+
+    if (low == index) {
+      std::set<Node*> component;
+      Node* top = nullptr;
+      do {
+        top = stack_.back();
+        stack_.pop_back();
+        on_stack_.erase(top);
+        component.emplace(top);
+      } while (top != node);
+
+      if (component.size() > 1 || self_edge) {
+        loops_.emplace_back(std::move(component));
+      }
+    }
+    return low;
+  }
+
+ private:
+  int index_;
+  std::map<Node*, int> indexes_;
+  std::vector<Node*> stack_;
+  std::set<Node*> on_stack_;
+  std::vector<std::set<Node*>> loops_;
+};
+
+// Whether every path from 'header' runs 'node' before it leaves the loop or
+// goes back to 'header'.
+bool RunsEveryIteration(const std::set<Node*>& loop, Node* header, Node* node) {
+  if (header == node) return true;
+
+  std::set<Node*> visited{header};
+  std::vector<Node*> stack{header};
+  while (!stack.empty()) {
+    auto cur = stack.back();
+    stack.pop_back();
+    for (auto next : Successors(cur)) {
+      if (loop.find(next) == loop.end() || next == header) return false;
+      if (next == node) continue;
+      if (visited.emplace(next).second) stack.emplace_back(next);
+    }
+  }
+  return true;
+}
+
+}  // anonymous namespace
+
+void Optimizer::Optimize(Graph* graph) {
+  size_t hoisted = HoistInvariants(graph);
+  size_t fused = FuseNodes(graph);
+  ORC_INFO("Optimize workflow %s, hoisted nodes: %zu, fused nodes: %zu.",
+           graph->name().c_str(), hoisted, fused);
+}
+
+size_t Optimizer::RemoveDeadNodes(Graph* graph) {
+  if (graph->entry() == nullptr) return 0;
+
+  std::set<Node*> reachable;
+  graph->Traverse([&reachable](Node* node) { reachable.emplace(node); });
+
+  std::vector<Node*> dead;
+  for (const auto& node : graph->nodes()) {
+    if (reachable.find(node.get()) == reachable.end()) {
+      dead.emplace_back(node.get());
+    }
+  }
+
+  for (auto node : dead) {
+    ORC_WARN("Workflow %s drops unreachable node: %s.",
+             graph->name().c_str(), node->name().c_str());
+    graph->RemoveNode(node);
+  }
+  return dead.size();
+}
+
+void Optimizer::Redirect(Graph* graph, Node* from, Node* to,
+                         const std::function<bool(Node*)>& filter) {
+  for (const auto& p : graph->nodes()) {
+    auto node = p.get();
+    if (!filter(node)) continue;
+
+    if (node->true_edge() == from) node->set_true_edge(to);
+    if (node->false_edge() == from) node->set_false_edge(to);
+    for (size_t i = 0; i < node->branches().size(); ++i) {
+      if (node->branches()[i] == from) node->set_branch(i, to);
+    }
+  }
+}
+
+std::map<std::string, int> Optimizer::CountNames(const Graph* graph) {
+  std::map<std::string, int> names;
+  for (const auto& node : graph->nodes()) {
+    switch (node->type()) {
+      case Node::Type::Handler:
+        ++names[node->name()];
+        break;
+      case Node::Type::Fused:
+        for (const auto& name : node->handlers()) ++names[name];
+        break;
+      default:
+        break;
+    }
+  }
+  return names;
+}
+
+size_t Optimizer::HoistInvariants(Graph* graph) {
+  if (!option_.get_io) return 0;
+
+  size_t hoisted = 0;
+  while (HoistOne(graph)) ++hoisted;
+  return hoisted;
+}
+
+bool Optimizer::HoistOne(Graph* graph) {
+  // The node names are the identities of nodes when building ExecutionGraph,
+  // a handler used more than once is never moved.
+  auto names = CountNames(graph);
+
+  std::map<Node*, std::set<Node*>> preds;
+  std::set<Node*> branch_targets;
+  for (const auto& node : graph->nodes()) {
+    for (auto next : Successors(node.get())) preds[next].emplace(node.get());
+    branch_targets.insert(node->branches().begin(), node->branches().end());
+  }
+
+  // Try the nodes in the order of running, so the hoisted ones keep it.
+  std::vector<Node*> order;
+  graph->Traverse([&order](Node* node) { order.emplace_back(node); });
+
+  Scc scc(graph);
+  for (const auto& loop : scc.loops()) {
+    // Only the loop with single entry.
+    Node* header = nullptr;
+    bool single_entry = true;
+    for (auto node : loop) {
+      bool entered = node == graph->entry();
+      for (auto pred : preds[node]) {
+        if (loop.find(pred) == loop.end()) entered = true;
+      }
+      if (!entered) continue;
+      if (header != nullptr) single_entry = false;
+      header = node;
+    }
+    if (header == nullptr || !single_entry) continue;
+
+    // Every handler in the loop must declare its fields.
+    struct Fields {
+      std::set<std::string> inputs;
+      std::set<std::string> outputs;
+    };
+    std::map<Node*, Fields> fields;
+    bool declared = true;
+    for (auto node : loop) {
+      if (node->type() == Node::Type::Fused) declared = false;
+      if (node->type() != Node::Type::Handler) continue;
+
+      auto& f = fields[node];
+      if (!option_.get_io(node->name(), &f.inputs, &f.outputs)) declared = false;
+    }
+    if (!declared) continue;
+
+    for (auto node : order) {
+      auto it = fields.find(node);
+      if (it == fields.end()) continue;
+
+      const auto& f = it->second;
+      auto next = node->true_edge();
+      if (names[node->name()] != 1 || next != node->false_edge() || next == node ||
+          branch_targets.find(node) != branch_targets.end()) {
+        continue;
+      }
+      // Running it again must give the same fields.
+      if (Intersect(f.inputs, f.outputs)) continue;
+
+      bool invariant = true;
+      for (const auto& other : fields) {
+        if (other.first == node) continue;
+        if (Intersect(other.second.outputs, f.inputs) ||
+            Intersect(other.second.inputs, f.outputs) ||
+            Intersect(other.second.outputs, f.outputs)) {
+          invariant = false;
+          break;
+        }
+      }
+      if (!invariant || !RunsEveryIteration(loop, header, node)) continue;
+
+      // Unlink it from the loop, then put it before the header.
+      Redirect(graph, node, next, [&loop, node](Node* n) {
+                 return n != node && loop.find(n) != loop.end();
+               });
+      if (node != header) {
+        Redirect(graph, header, node, [&loop](Node* n) {
+                   return loop.find(n) == loop.end();
+                 });
+        if (graph->entry() == header) graph->set_entry(node);
+        node->set_true_edge(header);
+        node->set_false_edge(header);
+      }
+
+      ORC_INFO("Workflow %s hoists node: %s out of the loop at: %s.",
+               graph->name().c_str(), node->name().c_str(), header->name().c_str());
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t Optimizer::FuseNodes(Graph* graph) {
+  if (!option_.is_sync) return 0;
+
+  auto names = CountNames(graph);
+  std::map<Node*, std::set<Node*>> preds;
+  std::set<Node*> branch_targets;
+  for (const auto& node : graph->nodes()) {
+    for (auto next : Successors(node.get())) preds[next].emplace(node.get());
+    branch_targets.insert(node->branches().begin(), node->branches().end());
+  }
+
+  auto fusible = [this, &names](Node* node) {
+    return node->type() == Node::Type::Handler && node != Node::EndNode() &&
+           names[node->name()] == 1 && option_.is_sync(node->name());
+  };
+
+  // The head of a chain is visited before the rest.
+  std::vector<Node*> order;
+  graph->Traverse([&order](Node* node) { order.emplace_back(node); });
+
+  std::set<Node*> removed;
+  size_t fused = 0;
+  for (auto head : order) {
+    if (removed.find(head) != removed.end() || !fusible(head)) continue;
+
+    std::vector<Node*> chain{head};
+    while (true) {
+      auto last = chain.back();
+      auto next = last->true_edge();
+      if (next != last->false_edge() || !fusible(next) ||
+          next == graph->entry() || preds[next].size() != 1 ||
+          branch_targets.find(next) != branch_targets.end() ||
+          std::find(chain.begin(), chain.end(), next) != chain.end()) {
+        break;
+      }
+      chain.emplace_back(next);
+    }
+    if (chain.size() < 2) continue;
+
+    // Handler names are identifiers, so '+' makes the name unique.
+    std::string name;
+    for (auto node : chain) {
+      if (!name.empty()) name += "+";
+      name += node->name();
+    }
+    std::unique_ptr<Node> fused_node{new Node(name, Node::Type::Fused)};
+    for (auto node : chain) fused_node->AddHandler(node->name());
+    fused_node->set_true_edge(chain.back()->true_edge());
+    fused_node->set_false_edge(chain.back()->false_edge());
+
+    // The fused node itself too, if the chain is a loop.
+    auto fused_ptr = fused_node.get();
+    graph->AddNode(std::move(fused_node));
+    Redirect(graph, head, fused_ptr, [](Node*) { return true; });
+    if (graph->entry() == head) graph->set_entry(fused_ptr);
+
+    for (auto node : chain) {
+      removed.emplace(node);
+      graph->RemoveNode(node);
+    }
+    fused += chain.size();
+  }
+  return fused;
+}
+
+}  // namespace wf
+}  // namespace orc
@@ -0,0 +1,69 @@
+#ifndef ORC_WORKFLOW_OPTIMIZER_H__
+#define ORC_WORKFLOW_OPTIMIZER_H__
+
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "orc/util/macros.h"
+#include "orc/workflow/graph.h"
+
+namespace orc {
+namespace wf {
+
+// Passes over a compiled Graph, run at compile time. The workflow DSL knows
+// nothing about the handlers, the passes rely on the traits given by 'Option',
+// a pass is skipped if its trait isn't given.
+class Optimizer {
+ public:
+  struct Option {
+    // Whether the handler finishes without any async call.
+    std::function<bool(const std::string& name)> is_sync;
+    // Session fields read and written by the handler, false if not declared.
+    std::function<bool(const std::string& name,
+                       std::set<std::string>* inputs,
+                       std::set<std::string>* outputs)> get_io;
+  };
+
+  explicit Optimizer(const Option& option) : option_(option) {}
+  ~Optimizer() = default;
+
+  // Run all passes, the graph must be valid.
+  void Optimize(Graph* graph);
+
+  // Drop the nodes can't be reached from the entry, e.g. the statements after
+  // an 'if' whose both blocks return. Return the number of dropped nodes.
+  static size_t RemoveDeadNodes(Graph* graph);
+
+  // Move a handler out of a loop to run once before the loop, if the loop
+  // doesn't touch its fields and every iteration runs it before leaving the
+  // loop. Handlers are taken as depending on their declared fields only, so
+  // it needs 'get_io'. Return the number of hoisted nodes.
+  size_t HoistInvariants(Graph* graph);
+
+  // Collapse a chain of sync handlers, each of which always goes to the next
+  // one, into a 'Fused' node. It needs 'is_sync'. Return the number of fused
+  // nodes.
+  size_t FuseNodes(Graph* graph);
+
+ private:
+  // Point all the edges, branches and entry linked to 'from' to 'to'.
+  static void Redirect(Graph* graph, Node* from, Node* to,
+                       const std::function<bool(Node*)>& filter);
+  // Number of times of every handler name used in the graph.
+  static std::map<std::string, int> CountNames(const Graph* graph);
+
+  bool HoistOne(Graph* graph);
+
+ private:
+  Option option_;
+
+  ORC_DISALLOW_COPY_AND_ASSIGN(Optimizer);
+};
+
+}  // namespace wf
+}  // namespace orc
+
+#endif  // ORC_WORKFLOW_OPTIMIZER_H__
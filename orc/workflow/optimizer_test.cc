@@ -0,0 +1,129 @@
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "orc/workflow/compiler.h"
+#include "orc/workflow/optimizer.h"
+
+namespace orc {
+namespace wf {
+
+class OptimizerTest : public ::testing::Test {
+ public:
+  virtual void SetUp() {}
+  virtual void TearDown() {}
+
+  static Node* FindNode(const Graph* graph, const std::string& name) {
+    for (const auto& node : graph->nodes()) {
+      if (node->name() == name) return node.get();
+    }
+    return nullptr;
+  }
+};
+
+TEST_F(OptimizerTest, RemoveDeadNodes) {
+  std::map<std::string, std::unique_ptr<Graph>> graphs;
+  Compiler compiler;
+  ASSERT_TRUE(compiler.Compile("testdata/optimizer_test.wf", &graphs));
+
+  // Both blocks return, 'D' is never run.
+  auto graph = graphs["dead_wf"].get();
+  ASSERT_EQ(3u, graph->nodes().size());
+  ASSERT_TRUE(FindNode(graph, "D") == nullptr);
+}
+
+TEST_F(OptimizerTest, FuseNodes) {
+  Compiler::Option option;
+  option.optimize = true;
+  option.dump = true;
+  option.optimizer.is_sync = [](const std::string& name) { return name != "C"; };
+
+  std::map<std::string, std::unique_ptr<Graph>> graphs;
+  Compiler compiler(option);
+  ASSERT_TRUE(compiler.Compile("testdata/optimizer_test.wf", &graphs));
+
+  // 'C' is async, 'D' is a condition, 'F' is the target of two edges.
+  auto graph = graphs["fuse_wf"].get();
+  std::string expect =
+      "A+B  T  C\n"
+      "A+B  F  C\n"
+      "C  T  D\n"
+      "C  F  D\n"
+      "D  T  E\n"
+      "D  F  F+G\n"
+      "E  T  F+G\n"
+      "E  F  F+G\n"
+      "F+G  T  end_node\n"
+      "F+G  F  end_node\n";
+  ASSERT_EQ(expect, graph->DebugString());
+
+  auto fused = graph->entry();
+  ASSERT_EQ(Node::Type::Fused, fused->type());
+  ASSERT_EQ((std::vector<std::string>{"A", "B"}), fused->handlers());
+  ASSERT_EQ(5u, graph->nodes().size());
+}
+
+TEST_F(OptimizerTest, HoistInvariants) {
+  // 'H' only reads 'x' which isn't written in the loop, 'J' reads 'c'
+  // written by 'C' in the loop.
+  std::map<std::string, std::pair<std::set<std::string>, std::set<std::string>>> io = {
+    {"B", {{"a"}, {"b"}}},
+    {"H", {{"x"}, {"h"}}},
+    {"C", {{"b"}, {"c"}}},
+    {"J", {{"c"}, {"j"}}},
+    {"D", {{"c"}, {}}},
+  };
+
+  Compiler::Option option;
+  option.optimize = true;
+  option.optimizer.get_io = [&io](const std::string& name,
+                                  std::set<std::string>* inputs,
+                                  std::set<std::string>* outputs) {
+    auto it = io.find(name);
+    if (it == io.end()) return false;
+    *inputs = it->second.first;
+    *outputs = it->second.second;
+    return true;
+  };
+
+  std::map<std::string, std::unique_ptr<Graph>> graphs;
+  Compiler compiler(option);
+  ASSERT_TRUE(compiler.Compile("testdata/optimizer_test.wf", &graphs));
+
+  auto graph = graphs["hoist_wf"].get();
+  std::string expect =
+      "A  T  H\n"
+      "A  F  H\n"
+      "H  T  B\n"
+      "H  F  B\n"
+      "B  T  C\n"
+      "B  F  C\n"
+      "C  T  J\n"
+      "C  F  J\n"
+      "J  T  D\n"
+      "J  F  D\n"
+      "D  T  B\n"
+      "D  F  E\n"
+      "E  T  end_node\n"
+      "E  F  end_node\n";
+  ASSERT_EQ(expect, graph->DebugString());
+
+  // The body of 'while' may not run at all, it's kept.
+  io["W"] = {{"w"}, {}};
+  graphs.clear();
+  ASSERT_TRUE(compiler.Compile("testdata/optimizer_test.wf", &graphs));
+  graph = graphs["while_wf"].get();
+  ASSERT_EQ(graph->entry(), FindNode(graph, "H")->true_edge());
+
+  // Not declared handler is a barrier.
+  io.erase("J");
+  graphs.clear();
+  ASSERT_TRUE(compiler.Compile("testdata/optimizer_test.wf", &graphs));
+  graph = graphs["hoist_wf"].get();
+  ASSERT_EQ(FindNode(graph, "B"), FindNode(graph, "A")->true_edge());
+}
+
+}  // namespace wf
+}  // namespace orc
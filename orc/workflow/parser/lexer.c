@@ -377,8 +377,8 @@ static void yy_fatal_error (yyconst char msg[]  );
 	*yy_cp = '\0'; \
 	(yy_c_buf_p) = yy_cp;
 
-#define YY_NUM_RULES 10
-#define YY_END_OF_BUFFER 11
+#define YY_NUM_RULES 12
+#define YY_END_OF_BUFFER 13
 /* This struct is not used in this scanner,
    but its presence is necessary. */
 struct yy_trans_info
@@ -386,12 +386,13 @@ struct yy_trans_info
 	flex_int32_t yy_verify;
 	flex_int32_t yy_nxt;
 	};
-static yyconst flex_int16_t yy_accept[37] =
+static yyconst flex_int16_t yy_accept[47] =
     {   0,
-        0,    0,   11,    9,    8,    8,    7,    7,    7,    7,
-        7,    7,    8,    7,    3,    7,    1,    7,    7,    7,
-        7,    7,    7,    7,    2,    7,    7,    7,    7,    4,
-        7,    6,    7,    7,    5,    0
+        0,    0,   13,   11,   10,   10,    9,    9,    9,    9,
+        9,    9,    9,   10,    9,    9,    3,    9,    1,    9,
+        9,    9,    9,    8,    9,    9,    9,    9,    9,    2,
+        9,    9,    9,    9,    9,    9,    4,    9,    9,    6,
+        9,    9,    9,    7,    5,    0
     } ;
 
 static yyconst flex_int32_t yy_ec[256] =
@@ -405,10 +406,10 @@ static yyconst flex_int32_t yy_ec[256] =
         1,    1,    1,    1,    5,    5,    5,    5,    5,    5,
         5,    5,    5,    5,    5,    5,    5,    5,    5,    5,
         5,    5,    5,    5,    5,    5,    5,    5,    5,    5,
-        1,    1,    1,    1,    4,    1,    5,    5,    5,    6,
+        1,    1,    1,    1,    4,    1,    6,    5,    5,    7,
 
-        7,    8,    5,    9,   10,    5,   11,   12,    5,   13,
-       14,    5,    5,   15,   16,   17,   18,    5,   19,    5,
+        8,    9,   10,   11,   12,    5,   13,   14,    5,   15,
+       16,   17,    5,   18,   19,   20,   21,    5,   22,    5,
         5,    5,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
@@ -426,54 +427,61 @@ static yyconst flex_int32_t yy_ec[256] =
         1,    1,    1,    1,    1
     } ;
 
-static yyconst flex_int32_t yy_meta[20] =
+static yyconst flex_int32_t yy_meta[23] =
     {   0,
         1,    1,    1,    2,    2,    2,    2,    2,    2,    2,
-        2,    2,    2,    2,    2,    2,    2,    2,    2
+        2,    2,    2,    2,    2,    2,    2,    2,    2,    2,
+        2,    2
     } ;
 
-static yyconst flex_int16_t yy_base[38] =
+static yyconst flex_int16_t yy_base[48] =
     {   0,
-        0,    0,   48,   49,   18,   20,    0,   33,   34,   37,
-       37,   15,   23,    0,    0,   27,    0,   25,   31,   25,
-       32,   20,   25,   25,    0,   20,   27,   25,   19,    0,
-       19,    0,   16,    9,    0,   49,   25
+        0,    0,   60,   61,   21,   23,    0,   21,   45,   49,
+       51,   48,   17,   27,    0,   45,    0,   35,    0,   35,
+       32,   39,   32,    0,   41,   42,   26,   32,   32,    0,
+       30,   25,   34,   32,   26,   24,    0,   24,   28,    0,
+       19,   20,   10,    0,    0,   61,   29
     } ;
 
-static yyconst flex_int16_t yy_def[38] =
+static yyconst flex_int16_t yy_def[48] =
     {   0,
-       36,    1,   36,   36,   36,   36,   37,   37,   37,   37,
-       37,   37,   36,   37,   37,   37,   37,   37,   37,   37,
-       37,   37,   37,   37,   37,   37,   37,   37,   37,   37,
-       37,   37,   37,   37,   37,    0,   36
+       46,    1,   46,   46,   46,   46,   47,   47,   47,   47,
+       47,   47,   47,   46,   47,   47,   47,   47,   47,   47,
+       47,   47,   47,   47,   47,   47,   47,   47,   47,   47,
+       47,   47,   47,   47,   47,   47,   47,   47,   47,   47,
+       47,   47,   47,   47,   47,    0,   46
     } ;
 
-static yyconst flex_int16_t yy_nxt[69] =
+static yyconst flex_int16_t yy_nxt[84] =
     {   0,
-        4,    5,    6,    4,    7,    8,    9,    7,    7,   10,
-        7,    7,    7,    7,   11,    7,    7,    7,   12,   13,
-       13,   13,   13,   19,   13,   13,   14,   35,   20,   34,
-       33,   32,   31,   30,   29,   28,   27,   26,   25,   24,
-       23,   22,   21,   18,   17,   16,   15,   36,    3,   36,
-       36,   36,   36,   36,   36,   36,   36,   36,   36,   36,
-       36,   36,   36,   36,   36,   36,   36,   36
+        4,    5,    6,    4,    7,    7,    8,    9,    7,    7,
+        7,   10,    7,    7,    7,    7,   11,   12,    7,    7,
+        7,   13,   14,   14,   14,   14,   16,   22,   14,   14,
+       15,   45,   23,   44,   43,   42,   17,   41,   40,   39,
+       38,   37,   36,   35,   34,   33,   32,   31,   30,   29,
+       28,   27,   26,   25,   24,   21,   20,   19,   18,   46,
+        3,   46,   46,   46,   46,   46,   46,   46,   46,   46,
+       46,   46,   46,   46,   46,   46,   46,   46,   46,   46,
+       46,   46,   46
     } ;
 
-static yyconst flex_int16_t yy_chk[69] =
+static yyconst flex_int16_t yy_chk[84] =
     {   0,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    5,
-        5,    6,    6,   12,   13,   13,   37,   34,   12,   33,
-       31,   29,   28,   27,   26,   24,   23,   22,   21,   20,
-       19,   18,   16,   11,   10,    9,    8,    3,   36,   36,
-       36,   36,   36,   36,   36,   36,   36,   36,   36,   36,
-       36,   36,   36,   36,   36,   36,   36,   36
+        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+        1,    1,    5,    5,    6,    6,    8,   13,   14,   14,
+       47,   43,   13,   42,   41,   39,    8,   38,   36,   35,
+       34,   33,   32,   31,   29,   28,   27,   26,   25,   23,
+       22,   21,   20,   18,   16,   12,   11,   10,    9,    3,
+       46,   46,   46,   46,   46,   46,   46,   46,   46,   46,
+       46,   46,   46,   46,   46,   46,   46,   46,   46,   46,
+       46,   46,   46
     } ;
 
 /* Table of booleans, true if rule could match eol. */
-static yyconst flex_int32_t yy_rule_can_match_eol[11] =
+static yyconst flex_int32_t yy_rule_can_match_eol[13] =
     {   0,
-0, 0, 0, 0, 0, 0, 0, 1, 0, 0,     };
+0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0,     };
 
 static yy_state_type yy_last_accepting_state;
 static char *yy_last_accepting_cpos;
@@ -493,7 +501,7 @@ char *yytext;
 #line 4 "workflow.l"
 #include "orc/workflow/parser/syntax.h"  
 #include "orc/workflow/parser/parser.h"  
-#line 497 "lexer.c"
+#line 505 "lexer.c"
 
 #define INITIAL 0
 
@@ -678,7 +686,7 @@ YY_DECL
 #line 8 "workflow.l"
 
 
-#line 682 "lexer.c"
+#line 690 "lexer.c"
 
 	if ( !(yy_init) )
 		{
@@ -731,13 +739,13 @@ yy_match:
 			while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 				{
 				yy_current_state = (int) yy_def[yy_current_state];
-				if ( yy_current_state >= 37 )
+				if ( yy_current_state >= 47 )
 					yy_c = yy_meta[(unsigned int) yy_c];
 				}
 			yy_current_state = yy_nxt[yy_base[yy_current_state] + (unsigned int) yy_c];
 			++yy_cp;
 			}
-		while ( yy_base[yy_current_state] != 49 );
+		while ( yy_base[yy_current_state] != 61 );
 
 yy_find_action:
 		yy_act = yy_accept[yy_current_state];
@@ -803,26 +811,36 @@ YY_RULE_SETUP
 	YY_BREAK
 case 7:
 YY_RULE_SETUP
-#line 17 "workflow.l"
-{ yylval.node = workflow_syntax_new_name_stmt(yytext); return NAME; }
+#line 16 "workflow.l"
+{ return PARALLEL; }
 	YY_BREAK
 case 8:
-/* rule 8 can match eol */
 YY_RULE_SETUP
-#line 19 "workflow.l"
-/* ignore space */
+#line 17 "workflow.l"
+{ return DAG; }
 	YY_BREAK
 case 9:
 YY_RULE_SETUP
-#line 21 "workflow.l"
-{ return *yytext; }
+#line 19 "workflow.l"
+{ yylval.node = workflow_syntax_new_name_stmt(yytext); return NAME; }
 	YY_BREAK
 case 10:
+/* rule 10 can match eol */
+YY_RULE_SETUP
+#line 21 "workflow.l"
+/* ignore space */
+	YY_BREAK
+case 11:
 YY_RULE_SETUP
 #line 23 "workflow.l"
+{ return *yytext; }
+	YY_BREAK
+case 12:
+YY_RULE_SETUP
+#line 25 "workflow.l"
 YY_FATAL_ERROR( "flex scanner jammed" );
 	YY_BREAK
-#line 826 "lexer.c"
+#line 844 "lexer.c"
 case YY_STATE_EOF(INITIAL):
 	yyterminate();
 
@@ -1114,7 +1132,7 @@ static int yy_get_next_buffer (void)
 		while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 			{
 			yy_current_state = (int) yy_def[yy_current_state];
-			if ( yy_current_state >= 37 )
+			if ( yy_current_state >= 47 )
 				yy_c = yy_meta[(unsigned int) yy_c];
 			}
 		yy_current_state = yy_nxt[yy_base[yy_current_state] + (unsigned int) yy_c];
@@ -1142,11 +1160,11 @@ static int yy_get_next_buffer (void)
 	while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 		{
 		yy_current_state = (int) yy_def[yy_current_state];
-		if ( yy_current_state >= 37 )
+		if ( yy_current_state >= 47 )
 			yy_c = yy_meta[(unsigned int) yy_c];
 		}
 	yy_current_state = yy_nxt[yy_base[yy_current_state] + (unsigned int) yy_c];
-	yy_is_jam = (yy_current_state == 36);
+	yy_is_jam = (yy_current_state == 46);
 
 		return yy_is_jam ? 0 : yy_current_state;
 }
@@ -1828,7 +1846,7 @@ void yyfree (void * ptr )
 
 #define YYTABLES_NAME "yytables"
 
-#line 23 "workflow.l"
+#line 25 "workflow.l"
 
 
 
@@ -59,6 +59,14 @@ void workflow_syntax_delete_node(struct workflow_syntax* node) {
       workflow_syntax_delete_node(node->u.unop.left);
       break;
 
+    case WORKFLOW_SYNTAX_KIND_PARALLEL_STMT:
+      workflow_syntax_delete_node(node->u.parallel_stmt.block);
+      break;
+
+    case WORKFLOW_SYNTAX_KIND_DAG_STMT:
+      workflow_syntax_delete_node(node->u.dag_stmt.block);
+      break;
+
     default:
       break;
   }
@@ -153,6 +161,30 @@ struct workflow_syntax* workflow_syntax_new_return_stmt() {
   return workflow_syntax_new_node(WORKFLOW_SYNTAX_KIND_RETURN_STMT);
 }
 
+struct workflow_syntax* workflow_syntax_new_parallel_stmt(
+    struct workflow_syntax* block) {
+  struct workflow_syntax* parallel_stmt =
+    workflow_syntax_new_node(WORKFLOW_SYNTAX_KIND_PARALLEL_STMT);
+  if (parallel_stmt == NULL) {
+    return NULL;
+  }
+
+  parallel_stmt->u.parallel_stmt.block = block;
+  return parallel_stmt;
+}
+
+struct workflow_syntax* workflow_syntax_new_dag_stmt(
+    struct workflow_syntax* block) {
+  struct workflow_syntax* dag_stmt =
+    workflow_syntax_new_node(WORKFLOW_SYNTAX_KIND_DAG_STMT);
+  if (dag_stmt == NULL) {
+    return NULL;
+  }
+
+  dag_stmt->u.dag_stmt.block = block;
+  return dag_stmt;
+}
+
 struct workflow_syntax* workflow_syntax_new_unop_exp(
     int opkind,
     struct workflow_syntax* exp) {
@@ -240,6 +272,16 @@ void workflow_syntax_print_node(struct workflow_syntax* node) {
       printf("return\n");
       break;
 
+    case WORKFLOW_SYNTAX_KIND_PARALLEL_STMT:
+      printf("parallel ");
+      workflow_syntax_print_node(node->u.parallel_stmt.block);
+      break;
+
+    case WORKFLOW_SYNTAX_KIND_DAG_STMT:
+      printf("dag ");
+      workflow_syntax_print_node(node->u.dag_stmt.block);
+      break;
+
     case WORKFLOW_SYNTAX_KIND_UNOP_EXP:
       workflow_syntax_print_unop_node(node);
       break;
@@ -20,6 +20,8 @@ enum {
   WORKFLOW_SYNTAX_KIND_DOWHILE_STMT,
   WORKFLOW_SYNTAX_KIND_RETURN_STMT,
   WORKFLOW_SYNTAX_KIND_UNOP_EXP,
+  WORKFLOW_SYNTAX_KIND_PARALLEL_STMT,
+  WORKFLOW_SYNTAX_KIND_DAG_STMT,
 };
 
 struct workflow_syntax {
@@ -62,6 +64,14 @@ struct workflow_syntax {
     struct {
       struct workflow_syntax* left;
     } unop;
+
+    struct {
+      struct workflow_syntax* block;
+    } parallel_stmt;
+
+    struct {
+      struct workflow_syntax* block;
+    } dag_stmt;
   } u;
 };
 
@@ -95,6 +105,12 @@ struct workflow_syntax* workflow_syntax_new_dowhile_stmt(
 
 struct workflow_syntax* workflow_syntax_new_return_stmt();
 
+struct workflow_syntax* workflow_syntax_new_parallel_stmt(
+    struct workflow_syntax* block);
+
+struct workflow_syntax* workflow_syntax_new_dag_stmt(
+    struct workflow_syntax* block);
+
 struct workflow_syntax* workflow_syntax_new_unop_exp(
     int opkind,
     struct workflow_syntax* exp);
@@ -16,10 +16,10 @@ void yyerror(struct workflow_syntax* root_node, const char* s);
 }
 
 %token <node> NAME
-%token IF ELSE DO WHILE WORKFLOW RETURN
+%token IF ELSE DO WHILE WORKFLOW RETURN PARALLEL DAG
 
 %type <node> workflowlist workflow block stmtlist stmt exp
-%type <node> ifstmt elsestmt whilestmt dowhilestmt returnstmt
+%type <node> ifstmt elsestmt whilestmt dowhilestmt returnstmt parallelstmt dagstmt
 
 %start workflowlist
 
@@ -39,12 +39,16 @@ block: '{' stmtlist '}' { $$ = $2; }
 
 stmtlist: %empty { $$ = workflow_syntax_new_stmt_list(); }
         | stmtlist stmt { workflow_syntax_add_stmt($1, $2); $$ = $1; }
+        | stmtlist ';' { $$ = $1; }
         ;
 
 stmt: ifstmt
     | whilestmt
     | dowhilestmt
     | returnstmt
+    | parallelstmt
+    | dagstmt
+    | block
     | exp
     ;
 
@@ -69,6 +73,16 @@ dowhilestmt: DO block WHILE exp {
 
 returnstmt: RETURN { $$ = workflow_syntax_new_return_stmt(); }
 
+parallelstmt: PARALLEL block {
+               $$ = workflow_syntax_new_parallel_stmt($2);
+            }
+            ;
+
+dagstmt: DAG block {
+          $$ = workflow_syntax_new_dag_stmt($2);
+       }
+       ;
+
 exp: '!' exp { $$ = workflow_syntax_new_unop_exp(WORKFLOW_SYNTAX_OPKIND_NOT, $2); }
    | '(' exp ')' { $$ = $2; }
    | NAME
@@ -311,11 +311,66 @@ static void PrintTimerMap(std::map<std::string,
   }
 }
 
+static HistogramMonitorStatus g_null_hm_status;
+
+static void PrintHistogramMap(std::map<std::string,
+                                       HistogramMonitorStatus>& all_histogram_counters,
+                              std::map<std::string,
+                                       HistogramMonitorStatus>& old_all_histogram_counters) {
+  if (all_histogram_counters.empty()) {
+    return;
+  }
+
+  int max_len = GetCounterNameMaxLen(all_histogram_counters);
+  char buff[128] = "";
+  snprintf(buff,
+           sizeof(buff) - 1,
+           g_show_timestamp ? "%%|-21|%%|-%d|%s" : "%%|-%d|%s",
+           max_len,
+           "%|-14.0f|%|-14.3f|%|-14.3f|%|-14.3f|%|-14.3f|%|-14.3f|");
+  boost::format counter_format(buff);
+  if (g_show_timestamp) {
+    counter_format % "time";
+  }
+  counter_format % "name" % "qps" % "rt(ms)" % "p50(ms)" % "p99(ms)"
+      % "p999(ms)" % "max(ms)";
+  cout << counter_format.str() << endl;
+
+  HistogramMonitorStatus diff;
+  for (std::map<std::string, HistogramMonitorStatus>::iterator
+           mit = all_histogram_counters.begin();
+       mit != all_histogram_counters.end(); ++mit) {
+    const string& counter_name = mit->first;
+    HistogramMonitorStatus* old_status = &g_null_hm_status;
+    std::map<std::string, HistogramMonitorStatus>::iterator
+        old_mit = old_all_histogram_counters.find(counter_name);
+    if (old_mit != old_all_histogram_counters.end()) {
+      old_status = &old_mit->second;
+    }
+    HistogramDiff(mit->second, *old_status, &diff);
+    double qps = (double) diff.total_count
+        / (g_time_interval == 0 ? 1 : g_time_interval / 1000000);
+    double rt = (double) diff.total_time
+        / (diff.total_count == 0 ? 1 : diff.total_count) / 1000;
+    if (g_show_timestamp) {
+      counter_format % GetTime().c_str();
+    }
+    counter_format % counter_name % qps % rt
+        % (HistogramPercentile(diff, 50) / 1000.0)
+        % (HistogramPercentile(diff, 99) / 1000.0)
+        % (HistogramPercentile(diff, 99.9) / 1000.0)
+        % (diff.max_time / 1000.0);
+    cout << counter_format.str() << endl;
+  }
+}
+
 static void PrintJsonMap(std::map<std::string, uint64_t>& all_counters,
                          std::map<std::string,
                                   TimerMonitorStatus>& all_timer_counter,
                          std::map<std::string,
-                                  BinaryMonitorStatus>& all_binary_counter) {
+                                  BinaryMonitorStatus>& all_binary_counter,
+                         std::map<std::string,
+                                  HistogramMonitorStatus>& all_histogram_counter) {
   string result;
   result += "{";
   //timestamp
@@ -366,13 +421,35 @@ static void PrintJsonMap(std::map<std::string, uint64_t>& all_counters,
   if (all_binary_counter.begin() != all_binary_counter.end()) {
     result.erase(result.size() - 1);
   }
+  result += "},";
+  //histogram counter
+  result += "\"histogram_counters\":{";
+  for (std::map<std::string, HistogramMonitorStatus>::iterator
+           mit = all_histogram_counter.begin();
+       mit != all_histogram_counter.end(); ++mit) {
+    HistogramMonitorStatus& s = mit->second;
+    result += "\"" + mit->first + "\":";
+    result += "{";
+    result += "\"count\":" + lexical_cast<string>(s.total_count) + ",";
+    result += "\"time\":" + lexical_cast<string>(s.total_time) + ",";
+    result += "\"p50\":" + lexical_cast<string>(HistogramPercentile(s, 50)) + ",";
+    result += "\"p99\":" + lexical_cast<string>(HistogramPercentile(s, 99)) + ",";
+    result += "\"p999\":" + lexical_cast<string>(HistogramPercentile(s, 99.9)) + ",";
+    result += "\"max\":" + lexical_cast<string>(s.max_time);
+    result += "},";
+  }
+  if (all_histogram_counter.begin() != all_histogram_counter.end()) {
+    result.erase(result.size() - 1);
+  }
   result += "}}";
   cout << result << endl;
 }
 
 static void PrintTextMap(std::map<std::string, uint64_t>& all_counters,
                          std::map<std::string,
-                                  TimerMonitorStatus>& all_timer_counter) {
+                                  TimerMonitorStatus>& all_timer_counter,
+                         std::map<std::string,
+                                  HistogramMonitorStatus>& all_histogram_counter) {
   string result;
   result += lexical_cast<string>(time(0)) + "\t";
   //counter
@@ -388,7 +465,18 @@ static void PrintTextMap(std::map<std::string, uint64_t>& all_counters,
         mit->first + "#count=" + lexical_cast<string>(s.total_count) + " ";
     result += mit->first + "#time=" + lexical_cast<string>(s.total_time) + " ";
   }
-  if (all_timer_counter.begin() != all_timer_counter.end()) {
+  for (std::map<std::string, HistogramMonitorStatus>::iterator
+           mit = all_histogram_counter.begin();
+       mit != all_histogram_counter.end(); ++mit) {
+    HistogramMonitorStatus& s = mit->second;
+    result +=
+        mit->first + "#count=" + lexical_cast<string>(s.total_count) + " ";
+    result += mit->first + "#time=" + lexical_cast<string>(s.total_time) + " ";
+    result += mit->first + "#p50=" + lexical_cast<string>(HistogramPercentile(s, 50)) + " ";
+    result += mit->first + "#p99=" + lexical_cast<string>(HistogramPercentile(s, 99)) + " ";
+    result += mit->first + "#p999=" + lexical_cast<string>(HistogramPercentile(s, 99.9)) + " ";
+  }
+  if (result[result.size() - 1] == ' ') {
     result.erase(result.size() - 1);
   }
   cout << result << endl;
@@ -487,10 +575,15 @@ int main(int argc, char* argv[]) {
   std::map<std::string, BinaryMonitorStatus> all_binary_counter;
   std::map<std::string, BinaryMonitorStatus> filtered_all_binary_counter;
   std::map<std::string, BinaryMonitorStatus> old_filtered_all_binary_counter;
+
+  std::map<std::string, HistogramMonitorStatus> all_histogram_counter;
+  std::map<std::string, HistogramMonitorStatus> filtered_all_histogram_counter;
+  std::map<std::string, HistogramMonitorStatus> old_filtered_all_histogram_counter;
   if (g_output_type.empty()) {
     MonitorStatus::Instance()->GetAllCounters(&old_filtered_all_counters);
     MonitorStatus::Instance()->GetAllTimerCounters(&old_filtered_all_timer_counter);
     MonitorStatus::Instance()->GetAllBinaryCounters(&old_filtered_all_binary_counter);
+    MonitorStatus::Instance()->GetAllHistogramCounters(&old_filtered_all_histogram_counter);
     uint64_t usleep_time = g_time_interval > 0 ? g_time_interval : 1000000;
     usleep(usleep_time);
   }
@@ -498,17 +591,21 @@ int main(int argc, char* argv[]) {
     MonitorStatus::Instance()->GetAllCounters(&all_counters);
     MonitorStatus::Instance()->GetAllTimerCounters(&all_timer_counter);
     MonitorStatus::Instance()->GetAllBinaryCounters(&all_binary_counter);
+    MonitorStatus::Instance()->GetAllHistogramCounters(&all_histogram_counter);
     CounterFilter(all_counters, &filtered_all_counters);
     CounterFilter(all_timer_counter, &filtered_all_timer_counter);
     CounterFilter(all_binary_counter, &filtered_all_binary_counter);
+    CounterFilter(all_histogram_counter, &filtered_all_histogram_counter);
     if (g_output_type == "json") {
       PrintJsonMap(filtered_all_counters,
                    filtered_all_timer_counter,
-                   filtered_all_binary_counter);
+                   filtered_all_binary_counter,
+                   filtered_all_histogram_counter);
       break;
 
     } else if (g_output_type == "text") {
-      PrintTextMap(filtered_all_counters, filtered_all_timer_counter);
+      PrintTextMap(filtered_all_counters, filtered_all_timer_counter,
+                   filtered_all_histogram_counter);
       break;
 
     } else {
@@ -516,9 +613,12 @@ int main(int argc, char* argv[]) {
       PrintTimerMap(filtered_all_timer_counter, old_filtered_all_timer_counter);
       PrintBinaryMap(filtered_all_binary_counter,
                      old_filtered_all_binary_counter);
+      PrintHistogramMap(filtered_all_histogram_counter,
+                        old_filtered_all_histogram_counter);
       old_filtered_all_counters = filtered_all_counters;
       old_filtered_all_timer_counter = filtered_all_timer_counter;
       old_filtered_all_binary_counter = filtered_all_binary_counter;
+      old_filtered_all_histogram_counter = filtered_all_histogram_counter;
     }
 
   } while (g_time_interval && usleep(g_time_interval) == 0);